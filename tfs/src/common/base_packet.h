@@ -257,6 +257,8 @@ namespace tfs
       REQ_RC_RELOAD_MESSAGE = 71,
       GET_DATASERVER_INFORMATION_MESSAGE = 72,
       GET_DATASERVER_INFORMATION_RESPONSE_MESSAGE = 73,
+      BATCH_READ_DATA_MESSAGE = 74,
+      RESP_BATCH_READ_DATA_MESSAGE = 75,
       LOCAL_PACKET = 500,
     };
 
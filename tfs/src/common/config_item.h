@@ -76,14 +76,18 @@ namespace tfs
 #define CONF_RUN_PLAN_EXPIRE_INTERVAL                 "run_plan_expire_interval"
 #define CONF_BUILD_PLAN_RATIO                         "build_plan_ratio"
 #define CONF_BUILD_PLAN_DEFAULT_WAIT_TIME             "build_plan_default_wait_time"
+#define CONF_BUILD_PLAN_FULL_SCAN_INTERVAL            "build_plan_full_scan_interval"
+#define CONF_BUILD_PLAN_SCAN_THREAD_NUM               "build_plan_scan_thread_num"
 
 #define CONF_COMPACT_DELETE_RATIO                     "compact_delete_ratio"
 #define CONF_COMPACT_MAX_LOAD                         "compact_max_load"
+#define CONF_COMPACT_INCREMENTAL_RATIO                "compact_incremental_ratio"
 #define CONF_REPLICATE_RATIO                          "replicate_ratio"
 #define CONF_REPL_WAIT_TIME                           "repl_wait_time"
 
 #define CONF_OPLOG_SYSNC_MAX_SLOTS_NUM                "oplog_sync_max_slots_num"
 #define CONF_OPLOGSYNC_THREAD_NUM                     "oplog_sync_thread_num"
+#define CONF_CHECKPOINT_INTERVAL                      "checkpoint_interval"
 
 #define CONF_MAX_WAIT_WRITE_LEASE                     "max_wait_write_lease"
 #define CONF_MAX_LEASE_TIMEOUT                        "max_lease_timeout"
@@ -120,11 +124,32 @@ namespace tfs
 #define CONF_BLOCKTYPE_RATIO                          "block_ratio"            //"2"
 #define CONF_BLOCK_VERSION                            "fs_version"             //"1"
 #define CONF_HASH_SLOT_RATIO                          "hash_slot_ratio"
+#define CONF_BOOTSTRAP_THREAD_COUNT                   "bootstrap_thread_count"
+#define CONF_LAZY_LOAD_INDEX                          "lazy_load_index"
+#define CONF_INDEX_PATH                               "index_path"             //index files and super block, mount point if not set
 #define CONF_WRITE_SYNC_FLAG                          "write_sync_flag"
 #define CONF_DATA_FILE_NUMS                           "max_data_file_nums"
 #define CONF_MAX_CRCERROR_NUMS                        "max_crc_error_nums"
 #define CONF_MAX_EIOERROR_NUMS                        "max_eio_error_nums_"
-//#define CONF_READ_CACHE_SIZE                          "read_cache_size"
+#define CONF_READ_CACHE_SIZE                          "read_cache_size"
+#define CONF_READ_CACHE_MAX_FILE_SIZE                 "read_cache_max_file_size"
+#define CONF_READ_CACHE_ADMIT_VISIT_COUNT             "read_cache_admit_visit_count"
+#define CONF_GROUP_COMMIT_MAX_DELAY                   "group_commit_max_delay"
+#define CONF_GROUP_COMMIT_MAX_COUNT                   "group_commit_max_count"
+#define CONF_IO_THREAD_COUNT                          "io_thread_count"
+#define CONF_READ_AHEAD_CACHE_SIZE                    "read_ahead_cache_size"
+#define CONF_READ_AHEAD_SIZE                          "read_ahead_size"
+#define CONF_BACKGROUND_IO_POLICY                     "background_io_policy"
+#define CONF_COMPACT_RATE_LIMIT                       "compact_rate_limit"
+#define CONF_COMPACT_THREAD_COUNT                     "compact_thread_count"
+#define CONF_REPLICATE_CHUNK_SIZE                     "replicate_chunk_size"
+#define CONF_REPLICATE_WINDOW_SIZE                    "replicate_window_size"
+#define CONF_REPLICATE_MAX_PER_SERVER                 "replicate_max_per_server"
+#define CONF_SCRUB_INTERVAL                           "scrub_interval"
+#define CONF_SCRUB_RATE_LIMIT                         "scrub_rate_limit"
+#define CONF_INDEX_MEMORY_BUDGET                      "index_memory_budget"
+#define CONF_INDEX_PIN_COUNT                          "index_pin_count"
+#define CONF_INDEX_PIN_MLOCK                          "index_pin_mlock"
 #define CONF_BACKUP_PATH                              "backup_path"
 #define CONF_BACKUP_TYPE                              "backup_type"
 #define CONF_EXPIRE_CHECKBLOCK_TIME                   "expire_checkblock_time"
@@ -38,6 +38,7 @@ namespace tfs
     const int32_t EXIT_ACCESS_PERMISSION_ERROR = -1013; //access permission error
     const int32_t EXIT_SYSTEM_PARAMETER_ERROR = -1014; //system parameter error
     const int32_t EXIT_UNIQUE_META_NOT_EXIST = -1015;
+    const int32_t EXIT_BUFFER_TOO_SMALL_ERROR = -1016; // buffer is smaller than the data
 
     const int32_t EXIT_FILE_OP_ERROR = -2000;
     const int32_t EXIT_OPEN_FILE_ERROR = -2001;
@@ -114,6 +115,7 @@ namespace tfs
     const int32_t EXIT_DS_CONNECT_ERROR = -8035; // connect to ds fail
     const int32_t EXIT_BLOCK_CHECKER_OVERLOAD = -8036; // too much block checker
     const int32_t EXIT_FALLOCATE_NOT_IMPLEMENT = -8037; // fallocate is not implement
+    const int32_t EXIT_IO_QUEUE_FULL_ERROR = -8038; // io queue of the disk is full
 
     const int32_t EXIT_SESSION_EXIST_ERROR = -9001;
     const int32_t EXIT_SESSIONID_INVALID_ERROR = -9002;
@@ -14,6 +14,14 @@
  *
  */
 #include <sys/resource.h>
+#include <string.h>
+#include <endian.h>
+#if defined(__x86_64__) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define TFS_CRC32_CLMUL
+#include <cpuid.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
 
 #include "func.h"
 #include "error_msg.h"
@@ -366,15 +374,244 @@ namespace tfs
       return psz_buf;
     }
 
+    namespace
+    {
+      // reflected polynomial of _crc32tab
+      const uint32_t CRC32_POLY = 0xedb88320;
+
+      uint32_t crc_bytes(uint32_t crc, const unsigned char* data, int32_t len)
+      {
+        while (len-- > 0)
+        {
+          crc = (crc >> 8) ^ _crc32tab[(crc ^ *data++) & 0xff];
+        }
+        return crc;
+      }
+
+      // slicing by 8: table k gives the crc of a byte followed by k zero bytes,
+      // 8 bytes are consumed per step with 8 independent lookups
+      struct CrcSlicingTable
+      {
+        CrcSlicingTable()
+        {
+          for (int32_t i = 0; i < 256; ++i)
+          {
+            table_[0][i] = _crc32tab[i];
+          }
+          for (int32_t k = 1; k < 8; ++k)
+          {
+            for (int32_t i = 0; i < 256; ++i)
+            {
+              uint32_t c = table_[k - 1][i];
+              table_[k][i] = (c >> 8) ^ _crc32tab[c & 0xff];
+            }
+          }
+        }
+        uint32_t table_[8][256];
+      };
+
+      // built on first use, crc may be called from static initializers of other units
+      const CrcSlicingTable& crc_slicing_table()
+      {
+        static const CrcSlicingTable table;
+        return table;
+      }
+
+      uint32_t crc_slicing8(uint32_t crc, const unsigned char* data, int32_t len)
+      {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        const uint32_t (*t)[256] = crc_slicing_table().table_;
+        for (; len > 0 && (reinterpret_cast<size_t>(data) & 7) != 0; --len)
+        {
+          crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+        }
+        for (; len >= 8; len -= 8, data += 8)
+        {
+          uint32_t low = 0, high = 0;
+          memcpy(&low, data, 4);
+          memcpy(&high, data + 4, 4);
+          low ^= crc;
+          crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+            ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+        }
+#endif
+        return crc_bytes(crc, data, len);
+      }
+
+#ifdef TFS_CRC32_CLMUL
+      // carry-less multiply folding for the reflected crc32 polynomial, constants and
+      // steps from intel's "Fast CRC Computation Using PCLMULQDQ Instruction".
+      // len must be a multiple of 16 and at least 64.
+      __attribute__((target("pclmul,sse4.1")))
+      uint32_t crc_clmul_fold(uint32_t crc, const unsigned char* data, int32_t len)
+      {
+        static const uint64_t k1k2[] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+        static const uint64_t k3k4[] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+        static const uint64_t k5k0[] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+        static const uint64_t poly[] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+        __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+        x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+        x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+        x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+        data += 64;
+        len -= 64;
+
+        // fold 4 x 128 bits in parallel
+        while (len >= 64)
+        {
+          x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+          x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+          x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+          x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+          x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+          x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+          x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+          x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+          y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+          y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+          y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+          y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+          x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+          x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+          x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+          x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+          data += 64;
+          len -= 64;
+        }
+
+        // fold into 128 bits
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+        while (len >= 16)
+        {
+          x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+          x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+          x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+          x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+          data += 16;
+          len -= 16;
+        }
+
+        // fold 128 bits to 64 bits
+        x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+        x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+        x1 = _mm_srli_si128(x1, 8);
+        x1 = _mm_xor_si128(x1, x2);
+        x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, x3);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        // barrett reduction to 32 bits
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+        x2 = _mm_and_si128(x1, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+        x2 = _mm_and_si128(x2, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+        return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+      }
+
+      uint32_t crc_clmul(uint32_t crc, const unsigned char* data, int32_t len)
+      {
+        if (len >= 64)
+        {
+          int32_t fold_len = len & ~15;
+          crc = crc_clmul_fold(crc, data, fold_len);
+          data += fold_len;
+          len -= fold_len;
+        }
+        return crc_slicing8(crc, data, len);
+      }
+
+      bool has_clmul()
+      {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+      }
+#endif
+
+      typedef uint32_t (*CrcFunc)(uint32_t crc, const unsigned char* data, int32_t len);
+
+      CrcFunc select_crc_func()
+      {
+#ifdef TFS_CRC32_CLMUL
+        if (has_clmul())
+        {
+          return crc_clmul;
+        }
+#endif
+        return crc_slicing8;
+      }
+
+      // a * b mod p, polynomials in reflected bit order
+      uint32_t crc_multmodp(uint32_t a, uint32_t b)
+      {
+        uint32_t m = 1U << 31, p = 0;
+        while (0 != m)
+        {
+          if (a & m)
+          {
+            p ^= b;
+          }
+          m >>= 1;
+          b = (b & 1) ? (b >> 1) ^ CRC32_POLY : b >> 1;
+        }
+        return p;
+      }
+
+      // x^(8 * len) mod p, the operator shifting a crc over len zero bytes
+      uint32_t crc_zeros_operator(int64_t len)
+      {
+        uint32_t square = 1U << 30; // x^1
+        uint32_t p = 1U << 31;      // x^0
+        for (int32_t k = 0; k < 3; ++k)
+        {
+          square = crc_multmodp(square, square);
+        }
+        while (len > 0)
+        {
+          if (len & 1)
+          {
+            p = crc_multmodp(square, p);
+          }
+          square = crc_multmodp(square, square);
+          len >>= 1;
+        }
+        return p;
+      }
+    }
+
     uint32_t Func::crc(uint32_t crc, const char* data, const int32_t len)
     {
-      int32_t i;
-      for (i = 0; i < len; ++i)
+      // byte wise table crc without pre or post inversion, stored in FileInfo. the
+      // faster paths, chosen once by what the cpu supports, give the same value.
+      static const CrcFunc crc_func = select_crc_func();
+      if (len <= 0)
       {
-        crc = (crc >> 8) ^ _crc32tab[(crc ^ (*data)) & 0xff];
-        data++;
+        return crc;
       }
-      return (crc);
+      return crc_func(crc, reinterpret_cast<const unsigned char*>(data), len);
+    }
+
+    uint32_t Func::crc_combine(const uint32_t crc1, const uint32_t crc2, const int64_t len2)
+    {
+      // linear without inversion: crc(0, A + B) = crc1 * x^(8 * len2) + crc(0, B)
+      return crc_multmodp(crc_zeros_operator(len2), crc1) ^ crc2;
     }
 
     string Func::format_size(const int64_t c)
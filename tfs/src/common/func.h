@@ -65,6 +65,8 @@ namespace tfs
       static char* str_to_upper(char* psz_buf);
 
       static uint32_t crc(uint32_t crc, const char* data, const int32_t len);
+      // crc of A + B from crc1 = crc(0, A) and crc2 = crc(0, B), len2 the length of B
+      static uint32_t crc_combine(const uint32_t crc1, const uint32_t crc2, const int64_t len2);
 
       static char* subright(char* dst, char* src, int32_t n);
       static int check_pid(const char* lock_file);
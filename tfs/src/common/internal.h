@@ -107,6 +107,8 @@ namespace tfs
 
     static const int32_t MAX_DEV_NAME_LEN = 64;
     static const int32_t MAX_READ_SIZE = 1048576;
+    static const int32_t MAX_BATCH_READ_COUNT = 128; // files of one batch read
+    static const int64_t MAX_BATCH_READ_SIZE = TFS_MALLOC_MAX_SIZE; // bytes of one batch read
 
     static const int MAX_FILE_FD = INT_MAX;
     static const int MAX_OPEN_FD_COUNT = MAX_FILE_FD - 1;
@@ -178,7 +180,8 @@ namespace tfs
     enum HasBlockFlag
     {
       HAS_BLOCK_FLAG_NO = 0x0,
-      HAS_BLOCK_FLAG_YES
+      HAS_BLOCK_FLAG_YES,
+      HAS_BLOCK_FLAG_DELTA // only the blocks changed since the report nameserver acked
     };
 
     enum GetServerStatusType
@@ -186,7 +189,8 @@ namespace tfs
       GSS_MAX_VISIT_COUNT,
       GSS_BLOCK_FILE_INFO,
       GSS_BLOCK_RAW_META_INFO,
-      GSS_CLIENT_ACCESS_INFO
+      GSS_CLIENT_ACCESS_INFO,
+      GSS_INDEX_MAP_INFO
     };
 
     enum CheckDsBlockType
@@ -307,6 +311,12 @@ namespace tfs
       COMPACT_STATUS_FAILED
     };
 
+    enum CompactMode
+    {
+      COMPACT_MODE_FULL = 0,       // copy live files to a new block
+      COMPACT_MODE_INCREMENTAL     // move tail files into holes of the block
+    };
+
     enum DeleteExcessBackupStrategy
     {
       DELETE_EXCESS_BACKUP_STRATEGY_NORMAL = 1,
@@ -540,6 +550,20 @@ namespace tfs
       DataServerLiveStatus status_;
     };
 
+    //dataserver read cache stat info
+    struct ReadCacheStat
+    {
+      int deserialize(const char* data, const int64_t data_len, int64_t& pos);
+      int serialize(char* data, const int64_t data_len, int64_t& pos) const;
+      int64_t length() const;
+      int64_t hit_count_;
+      int64_t miss_count_;
+      int64_t evict_count_;
+      int64_t item_count_;
+      int64_t used_size_;
+      int64_t capacity_;
+    };
+
     struct WriteDataInfo
     {
       int deserialize(const char* data, const int64_t data_len, int64_t& pos);
@@ -101,6 +101,8 @@ namespace tfs
       compact_delete_ratio_ = std::min(compact_delete_ratio_, 100);
 
       compact_max_load_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_COMPACT_MAX_LOAD, 100);
+      compact_incremental_ratio_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_COMPACT_INCREMENTAL_RATIO, 30);
+      compact_incremental_ratio_ = std::min(compact_incremental_ratio_, 100);
       object_dead_max_time_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_OBJECT_DEAD_MAX_TIME, 86400);
       if (object_dead_max_time_ <=  0)
         object_dead_max_time_ = 86400;
@@ -141,6 +143,12 @@ namespace tfs
       balance_max_diff_block_num_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_BALANCE_MAX_DIFF_BLOCK_NUM, 5);//s
       if (balance_max_diff_block_num_ <= 0)
         balance_max_diff_block_num_ = 5;
+      build_plan_full_scan_interval_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_BUILD_PLAN_FULL_SCAN_INTERVAL, 600);//s
+      if (build_plan_full_scan_interval_ < build_plan_interval_)
+        build_plan_full_scan_interval_ = build_plan_interval_;
+      build_plan_scan_thread_num_ = TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_BUILD_PLAN_SCAN_THREAD_NUM, 4);
+      if (build_plan_scan_thread_num_ <= 0)
+        build_plan_scan_thread_num_ = 1;
       return TFS_SUCCESS;
     }
 
@@ -191,6 +199,31 @@ namespace tfs
         = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_EXPIRE_CHECKBLOCK_TIME, 86400);
       max_cpu_usage_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_MAX_CPU_USAGE, 60);
       dump_stat_info_interval_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_DUMP_STAT_INFO_INTERVAL, 60000000);
+      const char* read_cache_size = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_READ_CACHE_SIZE, "0");
+      read_cache_size_ = strtoll(read_cache_size, NULL, 10);
+      read_cache_max_file_size_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_READ_CACHE_MAX_FILE_SIZE, 65536);
+      read_cache_admit_visit_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_READ_CACHE_ADMIT_VISIT_COUNT, 2);
+      group_commit_max_delay_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_GROUP_COMMIT_MAX_DELAY, 0);
+      group_commit_max_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_GROUP_COMMIT_MAX_COUNT, 32);
+      io_thread_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_IO_THREAD_COUNT, 0);
+      const char* read_ahead_cache_size = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_READ_AHEAD_CACHE_SIZE, "0");
+      read_ahead_cache_size_ = strtoll(read_ahead_cache_size, NULL, 10);
+      read_ahead_size_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_READ_AHEAD_SIZE, 1048576);
+      background_io_policy_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_BACKGROUND_IO_POLICY, 1);
+      const char* compact_rate_limit = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_COMPACT_RATE_LIMIT, "0");
+      compact_rate_limit_ = strtoll(compact_rate_limit, NULL, 10);
+      compact_thread_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_COMPACT_THREAD_COUNT, 1);
+      replicate_chunk_size_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_REPLICATE_CHUNK_SIZE, 2097152);
+      replicate_chunk_size_ = std::max(std::min(replicate_chunk_size_, 8388608), MAX_READ_SIZE);
+      replicate_window_size_ = std::max(TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_REPLICATE_WINDOW_SIZE, 8), 1);
+      replicate_max_per_server_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_REPLICATE_MAX_PER_SERVER, 2);
+      scrub_interval_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_SCRUB_INTERVAL, 0);
+      const char* scrub_rate_limit = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_SCRUB_RATE_LIMIT, "4194304");
+      scrub_rate_limit_ = strtoll(scrub_rate_limit, NULL, 10);
+      const char* index_memory_budget = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_INDEX_MEMORY_BUDGET, "0");
+      index_memory_budget_ = strtoll(index_memory_budget, NULL, 10);
+      index_pin_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_INDEX_PIN_COUNT, 32);
+      index_pin_mlock_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_INDEX_PIN_MLOCK, 0);
       return SYSPARAM_FILESYSPARAM.initialize(index);
     }
 
@@ -207,15 +240,57 @@ namespace tfs
 
     int FileSystemParameter::initialize(const std::string& index)
     {
-      if (TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_MOUNT_POINT_NAME) == NULL || strlen(TBSYS_CONFIG.getString(
-              CONF_SN_DATASERVER, CONF_MOUNT_POINT_NAME)) >= static_cast<uint32_t> (MAX_DEV_NAME_LEN))
+      // several mount points are separated by ',', each is a disk served by this dataserver
+      const char* mount_name = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_MOUNT_POINT_NAME);
+      std::vector<std::string> mount_names;
+      if (NULL != mount_name)
+      {
+        Func::split_string(mount_name, ',', mount_names);
+      }
+      if (mount_names.empty())
       {
         TBSYS_LOG(ERROR, "can not find %s in [%s]", CONF_MOUNT_POINT_NAME, CONF_SN_DATASERVER);
         return EXIT_SYSTEM_PARAMETER_ERROR;
       }
 
-      mount_name_ = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_MOUNT_POINT_NAME);
-      mount_name_ = get_real_mount_name(mount_name_, index);
+      // index lookups are random io, an ssd path keeps them off the data disk
+      const char* index_path = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_INDEX_PATH);
+      std::vector<std::string> index_paths;
+      if (NULL != index_path)
+      {
+        Func::split_string(index_path, ',', index_paths);
+      }
+      if (!index_paths.empty() && index_paths.size() != mount_names.size())
+      {
+        TBSYS_LOG(ERROR, "%s in [%s] must have a path for each of %s", CONF_INDEX_PATH, CONF_SN_DATASERVER,
+            CONF_MOUNT_POINT_NAME);
+        return EXIT_SYSTEM_PARAMETER_ERROR;
+      }
+
+      mount_names_.clear();
+      index_paths_.clear();
+      for (uint32_t i = 0; i < mount_names.size(); ++i)
+      {
+        if (mount_names[i].size() >= static_cast<uint32_t> (MAX_DEV_NAME_LEN))
+        {
+          TBSYS_LOG(ERROR, "%s in [%s] is too long: %s", CONF_MOUNT_POINT_NAME, CONF_SN_DATASERVER,
+              mount_names[i].c_str());
+          return EXIT_SYSTEM_PARAMETER_ERROR;
+        }
+        mount_names_.push_back(get_real_mount_name(mount_names[i], index));
+        std::string real_index_path;
+        if (!index_paths.empty())
+        {
+          real_index_path = get_real_mount_name(index_paths[i], index);
+          if (real_index_path == mount_names_[i])
+          {
+            real_index_path.clear();
+          }
+        }
+        index_paths_.push_back(real_index_path);
+      }
+      mount_name_ = mount_names_[0];
+      index_path_ = index_paths_[0];
 
       const char* tmp_max_size = TBSYS_CONFIG.getString(CONF_SN_DATASERVER, CONF_MOUNT_MAX_USESIZE);
       if (tmp_max_size == NULL)
@@ -261,6 +336,8 @@ namespace tfs
         return EXIT_SYSTEM_PARAMETER_ERROR;
       }
 
+      bootstrap_thread_count_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_BOOTSTRAP_THREAD_COUNT, 8);
+      lazy_load_index_ = TBSYS_CONFIG.getInt(CONF_SN_DATASERVER, CONF_LAZY_LOAD_INDEX, 0);
       return TFS_SUCCESS;
     }
     std::string FileSystemParameter::get_real_mount_name(const std::string& mount_name, const std::string& index)
@@ -268,6 +345,25 @@ namespace tfs
       return mount_name + index;
     }
 
+    void FileSystemParameter::get_disks(std::vector<FileSystemParameter>& disks) const
+    {
+      disks.clear();
+      // set up by hand with mount_name_ only, one disk
+      if (mount_names_.empty())
+      {
+        disks.push_back(*this);
+      }
+      for (uint32_t i = 0; i < mount_names_.size(); ++i)
+      {
+        FileSystemParameter disk = *this;
+        disk.mount_name_ = mount_names_[i];
+        disk.index_path_ = index_paths_[i];
+        disk.mount_names_.assign(1, mount_names_[i]);
+        disk.index_paths_.assign(1, index_paths_[i]);
+        disks.push_back(disk);
+      }
+    }
+
     int RcServerParameter::initialize(void)
     {
       db_info_ = TBSYS_CONFIG.getString(CONF_SN_RCSERVER, CONF_RC_DB_INFO, "");
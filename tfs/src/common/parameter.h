@@ -36,6 +36,7 @@ namespace tfs
       int32_t replicate_wait_time_;
       int32_t compact_delete_ratio_;
       int32_t compact_max_load_;
+      int32_t compact_incremental_ratio_;
       int32_t cluster_index_;
       int32_t max_wait_write_lease_;
       int32_t cleanup_lease_threshold_;
@@ -49,6 +50,8 @@ namespace tfs
       int32_t dump_stat_info_interval_;
       int32_t build_plan_default_wait_time_;
       int32_t balance_max_diff_block_num_;
+      int32_t build_plan_full_scan_interval_;
+      int32_t build_plan_scan_thread_num_;
 
       static NameServerParameter ns_parameter_;
       static NameServerParameter& instance()
@@ -60,8 +63,11 @@ namespace tfs
     struct FileSystemParameter
     {
       int initialize(const std::string& index);
-      std::string mount_name_; // name of mount point
-      uint64_t max_mount_size_; // the max space of the mount point
+      std::string mount_name_; // name of mount point, the first one if there are several
+      std::string index_path_; // index files and super block, on mount point if empty
+      std::vector<std::string> mount_names_; // all mount points, a disk each
+      std::vector<std::string> index_paths_; // index path of each mount point
+      uint64_t max_mount_size_; // the max space of a mount point
       int base_fs_type_;
       int32_t super_block_reserve_offset_;
       int32_t avg_segment_size_;
@@ -70,8 +76,16 @@ namespace tfs
       float block_type_ratio_;
       int32_t file_system_version_;
       float hash_slot_ratio_; // 0.5
+      int32_t bootstrap_thread_count_; // threads loading blocks at startup
+      int32_t lazy_load_index_; // read only block info at startup, the index at first access
       static FileSystemParameter fs_parameter_;
       static std::string get_real_mount_name(const std::string& mount_name, const std::string& index);
+      // parameter of every mount point, the same as this but mount_name_ and index_path_
+      void get_disks(std::vector<FileSystemParameter>& disks) const;
+      const std::string& get_index_path() const
+      {
+        return index_path_.empty() ? mount_name_ : index_path_;
+      }
       static FileSystemParameter& instance()
       {
         return fs_parameter_;
@@ -102,6 +116,25 @@ namespace tfs
       int32_t expire_check_block_time_;
       int32_t max_cpu_usage_;
       int32_t dump_stat_info_interval_;
+      int64_t read_cache_size_;
+      int32_t read_cache_max_file_size_;
+      int32_t read_cache_admit_visit_count_;
+      int32_t group_commit_max_delay_;
+      int32_t group_commit_max_count_;
+      int32_t io_thread_count_;
+      int64_t read_ahead_cache_size_;
+      int32_t read_ahead_size_;
+      int32_t background_io_policy_;
+      int64_t compact_rate_limit_;
+      int32_t compact_thread_count_;
+      int32_t replicate_chunk_size_;
+      int32_t replicate_window_size_;
+      int32_t replicate_max_per_server_;
+      int32_t scrub_interval_;
+      int64_t scrub_rate_limit_;
+      int64_t index_memory_budget_;
+      int32_t index_pin_count_;
+      int32_t index_pin_mlock_;
       static std::string get_real_file_name(const std::string& src_file, 
           const std::string& index, const std::string& suffix);
       static int get_real_ds_port(const int ds_port, const std::string& index);
@@ -19,7 +19,7 @@
  */
 #include <Memory.hpp>
 #include "block_checker.h"
-#include "blockfile_manager.h"
+#include "disk_manager.h"
 #include "common/func.h"
 
 namespace tfs
@@ -62,6 +62,7 @@ namespace tfs
       if (check_file_queue_.size() >= static_cast<uint32_t>(MAX_CHECK_BLOCK_SIZE))
       {
         // too much
+        check_mutex_.unlock();
         tbsys::gDelete(repair_task);
         return EXIT_BLOCK_CHECKER_OVERLOAD;
       }
@@ -130,7 +131,7 @@ namespace tfs
     //reaction async
     int BlockChecker::do_repair_crc(const CrcCheckFile& check_file)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(check_file.block_id_);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(check_file.block_id_);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "block is not exist. blockid: %u.\n", check_file.block_id_);
@@ -183,7 +184,7 @@ namespace tfs
 
     int BlockChecker::do_repair_eio(const uint32_t blockid)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(blockid);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(blockid);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "block is not exist. blockid: %u.\n", blockid);
@@ -208,7 +209,7 @@ namespace tfs
     int BlockChecker::expire_error_block()
     {
       list<LogicBlock*> logic_blocks;
-      int ret = BlockFileManager::get_instance()->get_all_logic_block(logic_blocks);
+      int ret = DiskManager::get_instance()->get_all_logic_block(logic_blocks);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "list logic block fail ret: %d", ret);
@@ -285,7 +286,7 @@ namespace tfs
         }
       }
 
-      BlockFileManager::get_instance()->set_error_bitmap(phy_block_ids);
+      DiskManager::get_instance()->set_error_bitmap(logic_block->get_logic_block_id(), phy_block_ids);
       return TFS_SUCCESS;
     }
   }
@@ -0,0 +1,140 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "block_reporter.h"
+#include <tbsys.h>
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+    using namespace message;
+
+    BlockReporter::BlockReporter()
+    {
+      // seqs of a restarted dataserver never meet those nameserver holds of the last run
+      seq_ = tbsys::CTimeUtil::getTime();
+      for (int32_t i = 0; i < 2; ++i)
+      {
+        states_[i].acked_seq_ = 0;
+        states_[i].sent_seq_ = 0;
+        states_[i].ns_seq_ = 0;
+      }
+      memset(&stat_, 0, sizeof(stat_));
+    }
+
+    BlockReporter::~BlockReporter()
+    {
+    }
+
+    void BlockReporter::build_report(const int32_t who, const std::vector<BlockInfo>& blocks,
+        SetDataserverMessage& msg)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      ReportState& state = states_[who];
+      BlockInfoMap now;
+      for (uint32_t i = 0; i < blocks.size(); ++i)
+      {
+        now[blocks[i].block_id_] = blocks[i];
+      }
+
+      int64_t seq = ++seq_;
+      if (state.acked_seq_ > 0 && state.ns_seq_ == state.acked_seq_)
+      {
+        msg.set_has_block(HAS_BLOCK_FLAG_DELTA);
+        msg.set_report_seq(seq, state.acked_seq_);
+        int32_t count = 0;
+        for (BlockInfoMapIter it = now.begin(); it != now.end(); ++it)
+        {
+          BlockInfoMapIter ait = state.acked_.find(it->first);
+          if (ait == state.acked_.end() || 0 != memcmp(&ait->second, &it->second, sizeof(BlockInfo)))
+          {
+            msg.add_block(&it->second);
+            ++count;
+          }
+        }
+        for (BlockInfoMapIter ait = state.acked_.begin(); ait != state.acked_.end(); ++ait)
+        {
+          if (now.find(ait->first) == now.end())
+          {
+            msg.add_removed_block(ait->first);
+            ++count;
+          }
+        }
+        ++stat_.delta_count_;
+        stat_.delta_block_count_ += count;
+        TBSYS_LOG(INFO, "delta block report to ns: %d, seq: %" PRI64_PREFIX "d, base seq: %" PRI64_PREFIX
+            "d, blocks: %u, changed: %u, removed: %u", who + 1, seq, state.acked_seq_,
+            static_cast<uint32_t>(blocks.size()), static_cast<uint32_t>(msg.get_blocks().size()),
+            static_cast<uint32_t>(msg.get_removed_blocks().size()));
+      }
+      else
+      {
+        msg.set_has_block(HAS_BLOCK_FLAG_YES);
+        msg.set_report_seq(seq, 0);
+        for (BlockInfoMapIter it = now.begin(); it != now.end(); ++it)
+        {
+          msg.add_block(&it->second);
+        }
+        ++stat_.full_count_;
+        stat_.full_block_count_ += blocks.size();
+        TBSYS_LOG(INFO, "full block report to ns: %d, seq: %" PRI64_PREFIX "d, blocks: %u, ns seq: %"
+            PRI64_PREFIX "d, acked seq: %" PRI64_PREFIX "d", who + 1, seq, static_cast<uint32_t>(blocks.size()), state.ns_seq_,
+            state.acked_seq_);
+      }
+      state.sent_seq_ = seq;
+      state.sent_.swap(now);
+    }
+
+    void BlockReporter::on_response(const int32_t who, const int64_t sent_seq, const int64_t ns_seq)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      ReportState& state = states_[who];
+      state.ns_seq_ = ns_seq;
+      if (sent_seq > 0 && sent_seq == state.sent_seq_)
+      {
+        if (ns_seq == sent_seq)
+        {
+          state.acked_.swap(state.sent_);
+          state.acked_seq_ = sent_seq;
+        }
+        state.sent_.clear();
+        state.sent_seq_ = 0;
+      }
+    }
+
+    void BlockReporter::reset(const int32_t who)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      ReportState& state = states_[who];
+      state.acked_.clear();
+      state.sent_.clear();
+      state.acked_seq_ = 0;
+      state.sent_seq_ = 0;
+    }
+
+    void BlockReporter::get_stat(BlockReportStat& stat)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      stat = stat_;
+    }
+
+    void BlockReporter::dump_stat()
+    {
+      BlockReportStat stat;
+      get_stat(stat);
+      TBSYS_LOG(INFO, "block report stat, full: %" PRI64_PREFIX "d, blocks: %" PRI64_PREFIX "d, delta: %" PRI64_PREFIX
+          "d, blocks: %" PRI64_PREFIX "d", stat.full_count_, stat.full_block_count_, stat.delta_count_,
+          stat.delta_block_count_);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_BLOCKREPORTER_H_
+#define TFS_DATASERVER_BLOCKREPORTER_H_
+
+#include <Mutex.h>
+#include <map>
+#include <vector>
+#include "common/internal.h"
+#include "message/dataserver_message.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    struct BlockReportStat
+    {
+      int64_t full_count_;         // full reports sent
+      int64_t delta_count_;        // delta reports sent
+      int64_t full_block_count_;   // blocks in full reports
+      int64_t delta_block_count_;  // blocks changed or removed in delta reports
+    };
+
+    // block reports of a dataserver to its two nameservers. every report has a seq, and
+    // nameserver answers each heartbeat with the seq of the last report it applied. the blocks
+    // of the last report a nameserver acked are kept, so that when it asks for the blocks again
+    // (a switch of master, or a report lost) and still holds that report, only the blocks
+    // added, changed or removed since are sent. a full report is sent when nameserver holds
+    // no report of us (new to it, restarted), or one we do not know.
+    class BlockReporter
+    {
+      public:
+        BlockReporter();
+        ~BlockReporter();
+
+        // fill the report to nameserver who, blocks are those of the dataserver now
+        void build_report(const int32_t who, const std::vector<common::BlockInfo>& blocks,
+            message::SetDataserverMessage& msg);
+        // the answer of nameserver who to a heartbeat, sent_seq the report it carried (0 if none),
+        // ns_seq the last report nameserver applied
+        void on_response(const int32_t who, const int64_t sent_seq, const int64_t ns_seq);
+        // forget what nameserver who holds, the next report to it is a full one
+        void reset(const int32_t who);
+
+        void get_stat(BlockReportStat& stat);
+        void dump_stat();
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(BlockReporter);
+        typedef std::map<uint32_t, common::BlockInfo> BlockInfoMap;
+        typedef BlockInfoMap::iterator BlockInfoMapIter;
+
+        struct ReportState
+        {
+          int64_t acked_seq_;   // the last report nameserver acked, 0 if none
+          int64_t sent_seq_;    // the report sent and not acked yet, 0 if none
+          int64_t ns_seq_;      // the last report nameserver said it applied
+          BlockInfoMap acked_;  // blocks of the acked report
+          BlockInfoMap sent_;   // blocks of the sent report
+        };
+
+        tbutil::Mutex mutex_;
+        ReportState states_[2];
+        int64_t seq_;
+        BlockReportStat stat_;
+    };
+  }
+}
+#endif //TFS_DATASERVER_BLOCKREPORTER_H_
@@ -0,0 +1,352 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "block_scrubber.h"
+#include <algorithm>
+#include <Memory.hpp>
+#include "disk_manager.h"
+#include "common/func.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+    using namespace std;
+
+    BlockScrubber::BlockScrubber() :
+      interval_(0), policy_(IO_POLICY_CACHED), block_checker_(NULL), work_queue_(NULL), stop_(0)
+    {
+      memset(&cursor_, 0, sizeof(cursor_));
+      memset(&stat_, 0, sizeof(stat_));
+    }
+
+    BlockScrubber::~BlockScrubber()
+    {
+    }
+
+    void BlockScrubber::initialize(const std::string& cursor_file, const int32_t interval, const int64_t rate,
+        const IOPolicy policy, BlockChecker* block_checker, tbnet::PacketQueueThread* work_queue)
+    {
+      cursor_file_ = cursor_file;
+      interval_ = interval;
+      rate_limiter_.set_rate(rate);
+      policy_ = policy;
+      block_checker_ = block_checker;
+      work_queue_ = work_queue;
+      TBSYS_LOG(INFO, "block scrubber, cursor file: %s, interval: %d, rate: %" PRI64_PREFIX "d, io policy: %d",
+          cursor_file_.c_str(), interval_, rate, policy_);
+    }
+
+    void BlockScrubber::stop()
+    {
+      stop_ = 1;
+      monitor_.lock();
+      monitor_.notifyAll();
+      monitor_.unlock();
+    }
+
+    int BlockScrubber::run_scrub()
+    {
+      if (interval_ <= 0)
+      {
+        return TFS_SUCCESS;
+      }
+      if (TFS_SUCCESS != load_cursor())
+      {
+        memset(&cursor_, 0, sizeof(cursor_));
+      }
+      TBSYS_LOG(INFO, "block scrubber start, blockid: %u, round start: %d", cursor_.block_id_, cursor_.round_start_);
+
+      std::vector<FileInfo> bad_files;
+      while (!stop_)
+      {
+        if (0 == cursor_.block_id_)
+        {
+          int32_t now = time(NULL);
+          if (now < cursor_.round_start_ + interval_)
+          {
+            wait(std::min(cursor_.round_start_ + interval_ - now, 60));
+            continue;
+          }
+        }
+
+        uint32_t block_id = next_block_id(cursor_.block_id_);
+        if (0 == block_id)
+        {
+          if (0 != cursor_.block_id_)
+          {
+            TBSYS_LOG(INFO, "block scrub round end, cost: %d(s)", static_cast<int32_t>(time(NULL)) - cursor_.round_start_);
+            cursor_.block_id_ = 0;
+            save_cursor();
+            tbutil::Mutex::Lock lock(stat_mutex_);
+            ++stat_.round_count_;
+          }
+          else // no block yet
+          {
+            wait(60);
+          }
+          continue;
+        }
+        if (0 == cursor_.block_id_)
+        {
+          cursor_.round_start_ = time(NULL);
+          TBSYS_LOG(INFO, "block scrub round start");
+        }
+
+        // not a visit, the scrub leaves the index memory order as it is
+        bool loaded = false;
+        LogicBlock* logic_block = DiskManager::get_instance()->scan_logic_block(block_id, loaded);
+        if (NULL != logic_block)
+        {
+          bad_files.clear();
+          int ret = scrub_block(logic_block, bad_files);
+          if (TFS_SUCCESS != ret)
+          {
+            TBSYS_LOG(WARN, "scrub blockid: %u fail, ret: %d", block_id, ret);
+          }
+          if (loaded)
+          {
+            logic_block->release_index();
+          }
+          report_bad_files(block_id, bad_files);
+        }
+        if (stop_)
+          break;
+        cursor_.block_id_ = block_id;
+        save_cursor();
+      }
+      return TFS_SUCCESS;
+    }
+
+    int BlockScrubber::scrub_block(LogicBlock* logic_block, std::vector<FileInfo>& bad_files)
+    {
+      int64_t start = tbsys::CTimeUtil::getTime();
+      int64_t scrub_size = 0;
+      int32_t file_count = 0;
+      char* buf = new char[MAX_COMPACT_READ_SIZE];
+      FileIterator* fit = new FileIterator(logic_block, policy_);
+      int ret = TFS_SUCCESS;
+      while (TFS_SUCCESS == ret && fit->has_next() && !stop_)
+      {
+        yield();
+        ret = fit->next();
+        if (TFS_SUCCESS != ret)
+        {
+          break;
+        }
+
+        const FileInfo* pfinfo = fit->current_file_info();
+        scrub_size += pfinfo->size_ + sizeof(FileInfo);
+        if (!fit->is_big_file())
+        {
+          rate_limiter_.acquire(pfinfo->size_ + sizeof(FileInfo));
+        }
+        if (pfinfo->flag_ & (FI_DELETED | FI_INVALID))
+        {
+          continue;
+        }
+
+        uint32_t crc = 0;
+        if (fit->is_big_file())
+        {
+          ret = scrub_big_file(logic_block, *pfinfo, buf, crc);
+        }
+        else
+        {
+          int32_t len = MAX_COMPACT_READ_SIZE;
+          ret = fit->read_buffer(buf, len);
+          if (TFS_SUCCESS == ret)
+          {
+            crc = Func::crc(0, buf, len);
+          }
+        }
+        if (TFS_SUCCESS != ret)
+        {
+          break;
+        }
+        ++file_count;
+        if (crc != pfinfo->crc_)
+        {
+          TBSYS_LOG(ERROR, "scrub blockid: %u, crc error. fileid: %" PRI64_PREFIX "u, size: %d, crc: %u <> %u",
+              logic_block->get_logic_block_id(), pfinfo->id_, pfinfo->size_, crc, pfinfo->crc_);
+          bad_files.push_back(*pfinfo);
+        }
+      }
+      tbsys::gDelete(fit);
+      tbsys::gDeleteA(buf);
+
+      TBSYS_LOG(INFO, "scrub blockid: %u, files: %d, size: %" PRI64_PREFIX "d, bad files: %u, cost: %" PRI64_PREFIX
+          "d(us), ret: %d", logic_block->get_logic_block_id(), file_count, scrub_size,
+          static_cast<uint32_t>(bad_files.size()), tbsys::CTimeUtil::getTime() - start, ret);
+      tbutil::Mutex::Lock lock(stat_mutex_);
+      ++stat_.block_count_;
+      stat_.file_count_ += file_count;
+      stat_.scrub_size_ += scrub_size;
+      stat_.error_count_ += bad_files.size();
+      return ret;
+    }
+
+    int BlockScrubber::scrub_big_file(LogicBlock* logic_block, const FileInfo& finfo, char* buf, uint32_t& crc)
+    {
+      int32_t offset = finfo.offset_ + sizeof(FileInfo);
+      int32_t read_len = 0;
+      int ret = TFS_SUCCESS;
+      crc = 0;
+      while (TFS_SUCCESS == ret && read_len < finfo.size_ && !stop_)
+      {
+        int32_t cur_read = std::min(MAX_COMPACT_READ_SIZE, finfo.size_ - read_len);
+        yield();
+        rate_limiter_.acquire(cur_read);
+        ret = logic_block->read_raw_data(buf, cur_read, offset, policy_);
+        if (TFS_SUCCESS == ret && cur_read <= 0)
+        {
+          ret = EXIT_READ_OFFSET_ERROR;
+        }
+        if (TFS_SUCCESS == ret)
+        {
+          crc = Func::crc(crc, buf, cur_read);
+          read_len += cur_read;
+          offset += cur_read;
+        }
+      }
+      if (TFS_SUCCESS == ret && read_len < finfo.size_) // stopped
+      {
+        ret = TFS_ERROR;
+      }
+      return ret;
+    }
+
+    void BlockScrubber::report_bad_files(const uint32_t block_id, const std::vector<FileInfo>& bad_files)
+    {
+      for (uint32_t i = 0; NULL != block_checker_ && i < bad_files.size(); ++i)
+      {
+        CrcCheckFile* check_file_item = new CrcCheckFile(block_id, CRC_DS_PATIAL_ERROR);
+        check_file_item->file_id_ = bad_files[i].id_;
+        check_file_item->crc_ = bad_files[i].crc_;
+        // queue full, the next round finds it again
+        int ret = block_checker_->add_repair_task(check_file_item);
+        TBSYS_LOG(INFO, "add repair task of scrub, blockid: %u, fileid: %" PRI64_PREFIX "u, ret: %d",
+            block_id, bad_files[i].id_, ret);
+      }
+    }
+
+    uint32_t BlockScrubber::next_block_id(const uint32_t block_id)
+    {
+      std::list<LogicBlock*> logic_blocks;
+      DiskManager::get_instance()->get_all_logic_block(logic_blocks);
+      uint32_t next_id = 0;
+      for (std::list<LogicBlock*>::iterator it = logic_blocks.begin(); it != logic_blocks.end(); ++it)
+      {
+        uint32_t id = (*it)->get_logic_block_id();
+        if (id > block_id && (0 == next_id || id < next_id))
+        {
+          next_id = id;
+        }
+      }
+      return next_id;
+    }
+
+    void BlockScrubber::yield()
+    {
+      int32_t wait_time = 0;
+      while (!stop_ && wait_time < MAX_YIELD_TIME)
+      {
+        IOClassStat read_stat, write_stat;
+        DiskManager::get_instance()->get_io_stat(IO_CLASS_READ, read_stat);
+        DiskManager::get_instance()->get_io_stat(IO_CLASS_WRITE, write_stat);
+        bool busy = read_stat.queue_depth_ > 0 || write_stat.queue_depth_ > 0
+          || (NULL != work_queue_ && work_queue_->size() > 0);
+        if (!busy)
+        {
+          break;
+        }
+        usleep(YIELD_TIME);
+        wait_time += YIELD_TIME;
+      }
+    }
+
+    void BlockScrubber::wait(const int32_t seconds)
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      if (!stop_)
+      {
+        monitor_.timedWait(tbutil::Time::seconds(seconds));
+      }
+    }
+
+    int BlockScrubber::load_cursor()
+    {
+      FILE* fp = fopen(cursor_file_.c_str(), "r");
+      if (NULL == fp)
+      {
+        return TFS_ERROR;
+      }
+      ScrubCursor cursor;
+      int ret = 2 == fscanf(fp, "%u %d", &cursor.block_id_, &cursor.round_start_) ? TFS_SUCCESS : TFS_ERROR;
+      fclose(fp);
+      if (TFS_SUCCESS == ret)
+      {
+        cursor_ = cursor;
+      }
+      else
+      {
+        TBSYS_LOG(WARN, "invalid scrub cursor file: %s", cursor_file_.c_str());
+      }
+      return ret;
+    }
+
+    int BlockScrubber::save_cursor()
+    {
+      // write a new one then rename, never a half written file
+      std::string tmp_file = cursor_file_ + ".tmp";
+      FILE* fp = fopen(tmp_file.c_str(), "w");
+      if (NULL == fp)
+      {
+        TBSYS_LOG(ERROR, "open scrub cursor file: %s fail, error: %s", tmp_file.c_str(), strerror(errno));
+        return TFS_ERROR;
+      }
+      int ret = fprintf(fp, "%u %d\n", cursor_.block_id_, cursor_.round_start_) > 0 ? TFS_SUCCESS : TFS_ERROR;
+      if (0 != fclose(fp))
+      {
+        ret = TFS_ERROR;
+      }
+      if (TFS_SUCCESS == ret && 0 != rename(tmp_file.c_str(), cursor_file_.c_str()))
+      {
+        ret = TFS_ERROR;
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "save scrub cursor file: %s fail, error: %s", cursor_file_.c_str(), strerror(errno));
+      }
+      return ret;
+    }
+
+    void BlockScrubber::get_stat(ScrubStat& stat)
+    {
+      tbutil::Mutex::Lock lock(stat_mutex_);
+      stat = stat_;
+    }
+
+    void BlockScrubber::dump_stat()
+    {
+      if (interval_ <= 0)
+      {
+        return;
+      }
+      ScrubStat stat;
+      get_stat(stat);
+      TBSYS_LOG(INFO, "scrub stat, rounds: %" PRI64_PREFIX "d, blocks: %" PRI64_PREFIX "d, files: %" PRI64_PREFIX
+          "d, size: %s, errors: %" PRI64_PREFIX "d, blockid now: %u", stat.round_count_, stat.block_count_,
+          stat.file_count_, Func::format_size(stat.scrub_size_).c_str(), stat.error_count_, cursor_.block_id_);
+    }
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_BLOCKSCRUBBER_H_
+#define TFS_DATASERVER_BLOCKSCRUBBER_H_
+
+#include <Mutex.h>
+#include <Monitor.h>
+#include <tbnet.h>
+#include <string>
+#include <vector>
+#include "logic_block.h"
+#include "block_checker.h"
+#include "rate_limiter.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // where the scrub of a round is, kept in a file over restarts
+    struct ScrubCursor
+    {
+      uint32_t block_id_;  // the last block scrubbed in this round, 0 if the round is not started
+      int32_t round_start_; // when this round (or the last one, if not started) started
+    };
+
+    struct ScrubStat
+    {
+      int64_t round_count_;  // rounds finished
+      int64_t block_count_;  // blocks scrubbed
+      int64_t file_count_;   // files verified
+      int64_t scrub_size_;   // bytes read
+      int64_t error_count_;  // files of bad crc
+    };
+
+    // background scrub of all blocks, to find silent corruption of cold data before a
+    // client reads it. a round goes through the blocks in the order of id, at most one round
+    // every scrub_interval seconds. every live file of a block is read by large sequential
+    // reads and its crc is checked against its FileInfo. the reads are limited by a rate, and
+    // wait while client requests are queued. the files of bad crc are given to BlockChecker,
+    // which repairs them from the other replicas.
+    class BlockScrubber
+    {
+      public:
+        BlockScrubber();
+        ~BlockScrubber();
+
+        // interval in seconds, rate in bytes per second (<= 0 no limit).
+        // block_checker and work_queue may be NULL
+        void initialize(const std::string& cursor_file, const int32_t interval, const int64_t rate,
+            const IOPolicy policy, BlockChecker* block_checker, tbnet::PacketQueueThread* work_queue);
+        void stop();
+        int run_scrub();
+
+        // read all live files of the block, bad_files are those of bad crc
+        int scrub_block(LogicBlock* logic_block, std::vector<common::FileInfo>& bad_files);
+
+        int load_cursor();
+        int save_cursor();
+        inline const ScrubCursor& get_cursor() const
+        {
+          return cursor_;
+        }
+        inline void set_cursor(const ScrubCursor& cursor)
+        {
+          cursor_ = cursor;
+        }
+
+        void get_stat(ScrubStat& stat);
+        void dump_stat();
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(BlockScrubber);
+        // the first block of id greater than block_id, 0 if none
+        uint32_t next_block_id(const uint32_t block_id);
+        int scrub_big_file(LogicBlock* logic_block, const common::FileInfo& finfo, char* buf, uint32_t& crc);
+        void report_bad_files(const uint32_t block_id, const std::vector<common::FileInfo>& bad_files);
+        // wait while foreground requests are queued, at most MAX_YIELD_TIME
+        void yield();
+        // wait seconds, or till stopped
+        void wait(const int32_t seconds);
+
+      private:
+        static const int32_t YIELD_TIME = 10000;       // us
+        static const int32_t MAX_YIELD_TIME = 1000000; // us
+
+        tbutil::Monitor<tbutil::Mutex> monitor_;
+        tbutil::Mutex stat_mutex_;
+        ScrubCursor cursor_;
+        ScrubStat stat_;
+        RateLimiter rate_limiter_;
+        std::string cursor_file_;
+        int32_t interval_;
+        IOPolicy policy_;
+        BlockChecker* block_checker_;
+        tbnet::PacketQueueThread* work_queue_;
+        int stop_;
+    };
+  }
+}
+#endif //TFS_DATASERVER_BLOCKSCRUBBER_H_
@@ -17,8 +17,11 @@
  */
 #include "blockfile_manager.h"
 #include "blockfile_format.h"
+#include "file_cache.h"
+#include "read_ahead.h"
 #include "common/directory_op.h"
 #include <string.h>
+#include <unistd.h>
 #include <Memory.hpp>
 
 namespace tfs
@@ -28,6 +31,13 @@ namespace tfs
     using namespace common;
     using namespace std;
 
+    BlockFileManager::BlockFileManager():
+      bit_map_size_(0), normal_bit_map_(NULL), error_bit_map_(NULL), super_block_impl_(NULL),
+      bootstrap_thread_count_(1), lazy_load_(false), load_blocks_(NULL), load_cursor_(0)
+    {
+      memset(&super_block_, 0, sizeof(super_block_));
+    }
+
     BlockFileManager::~BlockFileManager()
     {
       tbsys::gDelete(normal_bit_map_);
@@ -68,6 +78,7 @@ namespace tfs
     int BlockFileManager::format_block_file_system(const FileSystemParameter& fs_param)
     {
       // 1. initialize super block parameter
+      index_path_ = fs_param.get_index_path();
       int ret = init_super_blk_param(fs_param);
       if (TFS_SUCCESS != ret)
         return ret;
@@ -98,12 +109,25 @@ namespace tfs
     int BlockFileManager::clear_block_file_system(const FileSystemParameter& fs_param)
     {
       bool ret = DirectoryOp::delete_directory_recursively(fs_param.mount_name_.c_str());
-      TBSYS_LOG(INFO, "clear block file system end. mount_point: %s, ret: %d", fs_param.mount_name_.c_str(), ret);
+      if (ret && fs_param.get_index_path() != fs_param.mount_name_)
+      {
+        ret = DirectoryOp::delete_directory_recursively(fs_param.get_index_path().c_str());
+      }
+      TBSYS_LOG(INFO, "clear block file system end. mount_point: %s, index path: %s, ret: %d",
+          fs_param.mount_name_.c_str(), fs_param.get_index_path().c_str(), ret);
       return ret ? TFS_SUCCESS : TFS_ERROR;
     }
 
     int BlockFileManager::bootstrap(const FileSystemParameter& fs_param)
     {
+      bootstrap_thread_count_ = fs_param.bootstrap_thread_count_;
+      if (bootstrap_thread_count_ < 1)
+        bootstrap_thread_count_ = 1;
+      else if (bootstrap_thread_count_ > MAX_BOOTSTRAP_THREAD_COUNT)
+        bootstrap_thread_count_ = MAX_BOOTSTRAP_THREAD_COUNT;
+      lazy_load_ = 0 != fs_param.lazy_load_index_;
+      TBSYS_LOG(INFO, "bootstrap, thread count: %d, lazy load index: %d", bootstrap_thread_count_, lazy_load_);
+
       // 1. load super block
       int ret = load_super_blk(fs_param);
       if (TFS_SUCCESS != ret)
@@ -164,7 +188,8 @@ namespace tfs
       }
 
       // 5. create logic block
-      LogicBlock* t_logic_block = new LogicBlock(logic_block_id, physical_block_id, super_block_.mount_point_);
+      LogicBlock* t_logic_block = new LogicBlock(logic_block_id, physical_block_id, index_path_);
+      t_logic_block->set_block_manager(this);
       t_logic_block->add_physic_block(t_physical_block);
 
       TBSYS_LOG(INFO,
@@ -280,6 +305,11 @@ namespace tfs
 
       // 7. delete logic block from logic block map
       erase_logic_block(logic_block_id, tmp_block_type);
+      if (C_MAIN_BLOCK == tmp_block_type)
+      {
+        FileCache::get_instance()->erase_block(logic_block_id);
+        ReadAheadCache::get_instance()->erase_block(logic_block_id);
+      }
 
       int ret = TFS_SUCCESS;
       do
@@ -449,6 +479,8 @@ namespace tfs
       // switch
       logic_blocks_[block_id] = cpt_logic_block;
       compact_logic_blocks_[block_id] = old_logic_block;
+      FileCache::get_instance()->erase_block(block_id);
+      ReadAheadCache::get_instance()->erase_block(block_id);
 
       return TFS_SUCCESS;
     }
@@ -505,6 +537,43 @@ namespace tfs
     }
 
     LogicBlock* BlockFileManager::get_logic_block(const uint32_t logic_block_id, const BlockType block_type)
+    {
+      LogicBlock* logic_block = find_logic_block(logic_block_id, block_type, true);
+      if (NULL != logic_block && TFS_SUCCESS != check_load(logic_block, block_type))
+      {
+        logic_block = NULL;
+      }
+      return logic_block;
+    }
+
+    bool BlockFileManager::has_logic_block(const uint32_t logic_block_id, const BlockType block_type)
+    {
+      if (C_CONFUSE_BLOCK == block_type)
+      {
+        return NULL != find_logic_block(logic_block_id, C_MAIN_BLOCK, false)
+          || NULL != find_logic_block(logic_block_id, C_COMPACT_BLOCK, false);
+      }
+      return NULL != find_logic_block(logic_block_id, block_type, false);
+    }
+
+    LogicBlock* BlockFileManager::scan_logic_block(const uint32_t logic_block_id, bool& loaded)
+    {
+      loaded = false;
+      LogicBlock* logic_block = find_logic_block(logic_block_id, C_MAIN_BLOCK, false);
+      if (NULL != logic_block)
+      {
+        loaded = !logic_block->is_loaded();
+        if (TFS_SUCCESS != check_load(logic_block, C_MAIN_BLOCK))
+        {
+          logic_block = NULL;
+          loaded = false;
+        }
+      }
+      return logic_block;
+    }
+
+    LogicBlock* BlockFileManager::find_logic_block(const uint32_t logic_block_id, const BlockType block_type,
+        const bool visit)
     {
       ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
       LogicBlockMapIter mit;
@@ -527,8 +596,31 @@ namespace tfs
       }
 
       // update visit count
-      mit->second->add_visit_count();
-      return mit->second;
+      LogicBlock* logic_block = mit->second;
+      if (visit)
+      {
+        logic_block->add_visit_count();
+        logic_block->set_last_access(time(NULL));
+      }
+      return logic_block;
+    }
+
+    int BlockFileManager::check_load(LogicBlock* logic_block, const BlockType block_type)
+    {
+      // the first access of a lazy loaded block maps its index, out of the manager lock
+      int ret = logic_block->check_load();
+      if (TFS_SUCCESS != ret)
+      {
+        uint32_t logic_block_id = logic_block->get_logic_block_id();
+        TBSYS_LOG(ERROR, "load index fail, logic blockid: %u, ret: %d", logic_block_id, ret);
+        // a bad index found late is dropped as at bootstrap, so the block is no longer reported
+        if (EXIT_COMPACT_BLOCK_ERROR == ret || EXIT_BLOCKID_ZERO_ERROR == ret || EXIT_INDEX_CORRUPT_ERROR == ret)
+        {
+          TBSYS_LOG(WARN, "logicblock status abnormal, need delete! logic blockid: %u. ret: %d", logic_block_id, ret);
+          del_block(logic_block_id, C_COMPACT_BLOCK == block_type ? C_COMPACT_BLOCK : C_MAIN_BLOCK);
+        }
+      }
+      return ret;
     }
 
     int BlockFileManager::get_all_logic_block(std::list<LogicBlock*>& logic_block_list, const BlockType block_type)
@@ -675,9 +767,10 @@ namespace tfs
     {
       bool fs_init_status = true;
 
-      TBSYS_LOG(INFO, "read super block. mount name: %s, offset: %d\n", fs_param.mount_name_.c_str(),
-                fs_param.super_block_reserve_offset_);
-      super_block_impl_ = new SuperBlockImpl(fs_param.mount_name_, fs_param.super_block_reserve_offset_);
+      index_path_ = fs_param.get_index_path();
+      TBSYS_LOG(INFO, "read super block. mount name: %s, index path: %s, offset: %d\n", fs_param.mount_name_.c_str(),
+                index_path_.c_str(), fs_param.super_block_reserve_offset_);
+      super_block_impl_ = new SuperBlockImpl(index_path_, fs_param.super_block_reserve_offset_);
       int ret = super_block_impl_->read_super_blk(super_block_);
       if (TFS_SUCCESS != ret)
       {
@@ -697,6 +790,14 @@ namespace tfs
         return EXIT_FS_NOTINIT_ERROR;
       }
 
+      // super block is on index path, the data disk may be missing or not mounted
+      if (index_path_ != fs_param.mount_name_ && 0 != access((fs_param.mount_name_ + EXTENDBLOCK_DIR_PREFIX).c_str(), F_OK))
+      {
+        TBSYS_LOG(ERROR, "data of file system not found on mount point: %s, index path: %s. error desc: %s\n",
+            fs_param.mount_name_.c_str(), index_path_.c_str(), strerror(errno));
+        return EXIT_FS_NOTINIT_ERROR;
+      }
+
       if (fs_param.mount_name_.compare(super_block_.mount_point_) != 0)
       {
         TBSYS_LOG(WARN, "mount point conflict, rewrite mount point. former: %s, now: %s.\n",
@@ -757,6 +858,7 @@ namespace tfs
       PhysicalBlock* t_physical_block = NULL;
       PhysicalBlock* ext_physical_block = NULL;
       LogicBlock* t_logic_block = NULL;
+      std::vector<LogicBlock*> pending_blocks;
       int ret = TFS_SUCCESS;
       // traverse bitmap
       for (uint32_t pos = 1; pos <= static_cast<uint32_t> (super_block_.main_block_count_); ++pos)
@@ -802,7 +904,8 @@ namespace tfs
           }
 
           // 4. construct logic block, add physic block
-          t_logic_block = new LogicBlock(block_prefix.logic_blockid_, pos, super_block_.mount_point_);
+          t_logic_block = new LogicBlock(block_prefix.logic_blockid_, pos, index_path_);
+          t_logic_block->set_block_manager(this);
           t_logic_block->add_physic_block(t_physical_block);
 
           // record physical block id
@@ -827,7 +930,19 @@ namespace tfs
 
           // 6. find if it is a existed logic block.
           // if exist, delete the exist one(this scene is appear in the compact process: server down after set clean),
+          // the blocks before are loaded first, an abnormal one of them is gone then as loaded one by one
           LogicBlockMapIter mit = logic_blocks_.find(logic_block_id);
+          if (mit != logic_blocks_.end() && !pending_blocks.empty())
+          {
+            ret = load_block_index(pending_blocks);
+            if (TFS_SUCCESS != ret)
+            {
+              tbsys::gDelete(t_physical_block);
+              tbsys::gDelete(t_logic_block);
+              break;
+            }
+            mit = logic_blocks_.find(logic_block_id);
+          }
           if (mit != logic_blocks_.end())
           {
             TBSYS_LOG(INFO, "logic blockid: %u, map blockid: %u already exist", logic_block_id, mit->first);
@@ -935,31 +1050,97 @@ namespace tfs
             continue;
           }
 
-          // 9. load logic block
-          ret = t_logic_block->load_block_file(super_block_.hash_slot_size_, super_block_.mmap_option_);
-          // if these error happened when load block, program should exit
-          if (TFS_SUCCESS != ret && EXIT_COMPACT_BLOCK_ERROR != ret && EXIT_BLOCKID_ZERO_ERROR != ret
-              && EXIT_INDEX_CORRUPT_ERROR != ret)
-          {
-            TBSYS_LOG(ERROR, "logicblock load error! logic blockid: %u. ret: %d", logic_block_id, ret);
-            break;
-          }
-          else if (TFS_SUCCESS != ret) // ret == EXIT_COMPACT_BLOCK_ERROR || ret == EXIT_BLOCKID_CONFLICT_ERROR || EXIT_INDEX_CORRUPT_ERROR
-          {
-            // roll back
-            // can not make sure the type of this block, so add to confuse type
-            TBSYS_LOG(WARN, "logicblock status abnormal, need delete! logic blockid: %u. ret: %d", logic_block_id, ret);
-            del_block(logic_block_id, C_CONFUSE_BLOCK);
-            ret = TFS_SUCCESS;
-          }
+          // 9. load logic block, later together with others
+          pending_blocks.push_back(t_logic_block);
         }
 
         conflict_flag = false;
       }
 
+      if (TFS_SUCCESS == ret)
+      {
+        ret = load_block_index(pending_blocks);
+      }
       return ret;
     }
 
+    int BlockFileManager::load_block_index(std::vector<LogicBlock*>& blocks)
+    {
+      int64_t start = tbsys::CTimeUtil::getTime();
+      load_blocks_ = &blocks;
+      load_rets_.assign(blocks.size(), TFS_SUCCESS);
+      load_cursor_ = 0;
+      int32_t thread_count = std::min(bootstrap_thread_count_, static_cast<int32_t>(blocks.size()));
+      if (thread_count <= 1)
+      {
+        run_load_block_index();
+      }
+      else
+      {
+        std::vector<LoadBlockThreadHelperPtr> threads;
+        for (int32_t i = 0; i < thread_count; ++i)
+        {
+          threads.push_back(new LoadBlockThreadHelper(*this));
+        }
+        for (int32_t i = 0; i < thread_count; ++i)
+        {
+          threads[i]->join();
+        }
+      }
+      TBSYS_LOG(INFO, "load block index, count: %d, threads: %d, lazy: %d, cost: %" PRI64_PREFIX "d(us)",
+          static_cast<int32_t>(blocks.size()), thread_count, lazy_load_, tbsys::CTimeUtil::getTime() - start);
+
+      int ret = TFS_SUCCESS;
+      for (size_t i = 0; i < blocks.size(); ++i)
+      {
+        uint32_t logic_block_id = blocks[i]->get_logic_block_id();
+        ret = load_rets_[i];
+        // if these error happened when load block, program should exit
+        if (TFS_SUCCESS != ret && EXIT_COMPACT_BLOCK_ERROR != ret && EXIT_BLOCKID_ZERO_ERROR != ret
+            && EXIT_INDEX_CORRUPT_ERROR != ret)
+        {
+          TBSYS_LOG(ERROR, "logicblock load error! logic blockid: %u. ret: %d", logic_block_id, ret);
+          break;
+        }
+        else if (TFS_SUCCESS != ret) // ret == EXIT_COMPACT_BLOCK_ERROR || ret == EXIT_BLOCKID_CONFLICT_ERROR || EXIT_INDEX_CORRUPT_ERROR
+        {
+          // roll back
+          // can not make sure the type of this block, so add to confuse type
+          TBSYS_LOG(WARN, "logicblock status abnormal, need delete! logic blockid: %u. ret: %d", logic_block_id, ret);
+          del_block(logic_block_id, C_CONFUSE_BLOCK);
+          ret = TFS_SUCCESS;
+        }
+      }
+      blocks.clear();
+      load_blocks_ = NULL;
+      return ret;
+    }
+
+    void BlockFileManager::run_load_block_index()
+    {
+      while (true)
+      {
+        int32_t index = 0;
+        {
+          tbutil::Mutex::Lock lock(load_mutex_);
+          index = load_cursor_++;
+        }
+        if (index >= static_cast<int32_t>(load_blocks_->size()))
+        {
+          break;
+        }
+        LogicBlock* logic_block = (*load_blocks_)[index];
+        load_rets_[index] = lazy_load_
+          ? logic_block->load_block_header(super_block_.hash_slot_size_, super_block_.mmap_option_)
+          : logic_block->load_block_file(super_block_.hash_slot_size_, super_block_.mmap_option_);
+      }
+    }
+
+    void BlockFileManager::LoadBlockThreadHelper::run()
+    {
+      manager_.run_load_block_index();
+    }
+
     int BlockFileManager::find_avail_block(uint32_t& ext_physical_block_id, const BlockType block_type)
     {
       int32_t i = 1;
@@ -1109,8 +1290,17 @@ namespace tfs
         return TFS_ERROR;
       }
 
-      // index file directory
-      std::string index_dir = super_block_.mount_point_;
+      // index file directory, index path apart from mount point is made here too
+      if (index_path_ != super_block_.mount_point_)
+      {
+        ret = mkdir(index_path_.c_str(), DIR_MODE);
+        if (ret && errno != EEXIST)
+        {
+          TBSYS_LOG(ERROR, "make index path: %s error. ret: %d, error: %d", index_path_.c_str(), ret, errno);
+          return TFS_ERROR;
+        }
+      }
+      std::string index_dir = index_path_;
       index_dir += INDEX_DIR_PREFIX;
       ret = mkdir(index_dir.c_str(), DIR_MODE);
       if (ret)
@@ -1141,7 +1331,7 @@ namespace tfs
       memcpy(tmp_buffer + sizeof(SuperBlock), &super_block_, sizeof(SuperBlock));
       memset(tmp_buffer + 2 * sizeof(SuperBlock), 0, 4 * bit_map_size + sizeof(int));
 
-      std::string super_block_file = super_block_.mount_point_;
+      std::string super_block_file = index_path_;
       super_block_file += SUPERBLOCK_NAME;
       FileOperation* super_file_op = new FileOperation(super_block_file, O_RDWR | O_CREAT);
       int ret = super_file_op->pwrite_file(tmp_buffer, super_block_file_size, 0);
@@ -22,6 +22,8 @@
 #include <list>
 #include <vector>
 #include <set>
+#include <TbThread.h>
+#include <Handle.h>
 #include "physical_block.h"
 #include "logic_block.h"
 #include "bit_map.h"
@@ -34,16 +36,13 @@ namespace tfs
   namespace dataserver
   {
     class LogicBlock;
+    // blocks of a mount point, the dataserver has one of these for each disk, see DiskManager
     class BlockFileManager
     {
       public:
-        static BlockFileManager* get_instance()
-        {
-          static BlockFileManager s_blockfile_manager;
-          return &s_blockfile_manager;
-        }
+        BlockFileManager();
+        ~BlockFileManager();
 
-      public:
         int format_block_file_system(const common::FileSystemParameter& fs_param);
         int clear_block_file_system(const common::FileSystemParameter& fs_param);
         int bootstrap(const common::FileSystemParameter& fs_param);
@@ -55,6 +54,11 @@ namespace tfs
         int del_block(const uint32_t logic_block_id, const BlockType block_type = C_MAIN_BLOCK);
 
         LogicBlock* get_logic_block(const uint32_t logic_block_id, const BlockType block_type = C_MAIN_BLOCK);
+        // the block is on this mount point, the visit is not counted
+        bool has_logic_block(const uint32_t logic_block_id, const BlockType block_type = C_MAIN_BLOCK);
+        // for background scans: the visit is not counted, so the block keeps its place among the
+        // indexes in memory. loaded is set if the index was loaded by this call, to be released after
+        LogicBlock* scan_logic_block(const uint32_t logic_block_id, bool& loaded);
         int get_all_logic_block(std::list<LogicBlock*>& logic_block_list, const BlockType block_type = C_MAIN_BLOCK);
         int64_t get_all_logic_block_size(const BlockType block_type = C_MAIN_BLOCK);
         int get_logic_block_ids(common::VUINT& logic_block_ids, const BlockType block_type = C_MAIN_BLOCK);
@@ -76,13 +80,29 @@ namespace tfs
         int reset_error_bitmap(const std::set<uint32_t>& reset_error_blocks);
 
       private:
-        BlockFileManager()
+        // loads index files of blocks at bootstrap, takes the next one till all are done
+        class LoadBlockThreadHelper: public tbutil::Thread
         {
-        }
-        ~BlockFileManager();
+          public:
+            explicit LoadBlockThreadHelper(BlockFileManager& manager):
+              manager_(manager)
+            {
+              start();
+            }
+            virtual ~LoadBlockThreadHelper() {}
+            void run();
+          private:
+            DISALLOW_COPY_AND_ASSIGN(LoadBlockThreadHelper);
+            BlockFileManager& manager_;
+        };
+        typedef tbutil::Handle<LoadBlockThreadHelper> LoadBlockThreadHelperPtr;
+
         DISALLOW_COPY_AND_ASSIGN(BlockFileManager);
 
         int load_block_file();
+        // load index of blocks found by load_block_file, drop the abnormal ones
+        int load_block_index(std::vector<LogicBlock*>& blocks);
+        void run_load_block_index();
 
         int init_super_blk_param(const common::FileSystemParameter& fs_param);
         void calc_block_count(const int64_t avail_data_space, int32_t& main_block_count, int32_t& ext_block_count);
@@ -93,6 +113,11 @@ namespace tfs
 
         int find_avail_block(uint32_t& ext_physical_block_id, const BlockType block_type);
 
+        // the index of the block found may not be loaded yet
+        LogicBlock* find_logic_block(const uint32_t logic_block_id, const BlockType block_type, const bool visit);
+        // load a lazy loaded index, the block is deleted if the index is bad
+        int check_load(LogicBlock* logic_block, const BlockType block_type);
+
         LogicBlock* choose_del_block(const uint32_t logic_block_id, BlockType& block_type);
         int erase_logic_block(const uint32_t logic_block_id, const BlockType block_type);
         void destruct_logic_blocks(const BlockType block_type);
@@ -103,6 +128,7 @@ namespace tfs
       private:
         static const int32_t INDEXFILE_SAFE_MULT = 4;
         static const int32_t INNERFILE_MAX_MULTIPE = 30;
+        static const int32_t MAX_BOOTSTRAP_THREAD_COUNT = 64;
 
         typedef std::map<uint32_t, LogicBlock*> LogicBlockMap;
         typedef LogicBlockMap::iterator LogicBlockMapIter;
@@ -117,8 +143,16 @@ namespace tfs
         BitMap* normal_bit_map_; // normal bitmap
         BitMap* error_bit_map_;  // error bitmap
         common::SuperBlock super_block_; // super block
+        std::string index_path_;         // index files and super block, may be apart from mount point
         SuperBlockImpl* super_block_impl_; // super block implementation handle
         common::RWLock rw_lock_;           // read-write lock
+
+        int32_t bootstrap_thread_count_;          // threads loading index files
+        bool lazy_load_;                          // read only index headers at bootstrap
+        std::vector<LogicBlock*>* load_blocks_;   // blocks being loaded
+        std::vector<int> load_rets_;
+        int32_t load_cursor_;                     // the next one to load
+        tbutil::Mutex load_mutex_;
     };
   }
 }
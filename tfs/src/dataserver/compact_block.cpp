@@ -52,6 +52,7 @@ namespace tfs
       expire_compact_interval_ = SYSPARAM_DATASERVER.expire_compact_time_;
       last_expire_compact_block_time_ = 0;
       dataserver_id_ = 0;
+      rate_limiter_.set_rate(SYSPARAM_DATASERVER.compact_rate_limit_);
     }
 
     void CompactBlock::stop()
@@ -85,17 +86,26 @@ namespace tfs
         compact_block_queue_.pop_front();
         compact_block_monitor_.unlock();
 
+        // another compact thread is on it
+        if (!start_progress(cpt_blk->block_id_))
+        {
+          TBSYS_LOG(WARN, "block is being compacted. blockid: %u", cpt_blk->block_id_);
+          tbsys::gDelete(cpt_blk);
+          continue;
+        }
+
         int64_t start_time = Func::curr_time();
 
-        TBSYS_LOG(INFO, "start compact block. blockid: %d", cpt_blk->block_id_);
+        TBSYS_LOG(INFO, "start compact block. blockid: %d, mode: %d", cpt_blk->block_id_, cpt_blk->mode_);
         // compact the first block
-        int ret = real_compact(cpt_blk->block_id_);
+        int ret = COMPACT_MODE_INCREMENTAL == cpt_blk->mode_
+          ? incremental_compact(cpt_blk->block_id_) : real_compact(cpt_blk->block_id_);
         // send complete message
         req_block_compact_complete(cpt_blk->block_id_, ret);
         // failed, clear compact files
-        if (TFS_SUCCESS != ret)
+        if (TFS_SUCCESS != ret && COMPACT_MODE_INCREMENTAL != cpt_blk->mode_)
         {
-          int del_ret = BlockFileManager::get_instance()->del_block(cpt_blk->block_id_, C_COMPACT_BLOCK);
+          int del_ret = DiskManager::get_instance()->del_block(cpt_blk->block_id_, C_COMPACT_BLOCK);
           if (TFS_SUCCESS != del_ret)
           {
             TBSYS_LOG(ERROR, "compact blockid: %u, del old block error ret: %d\n", cpt_blk->block_id_, del_ret);
@@ -105,6 +115,7 @@ namespace tfs
         int64_t end_time = Func::curr_time();
         TBSYS_LOG(INFO, "finish compact. blockid: %u, cost time: %" PRI64_PREFIX "u, ret: %d", cpt_blk->block_id_,
             (end_time - start_time), ret);
+        finish_progress(cpt_blk->block_id_);
 
         tbsys::gDelete(cpt_blk);
       }
@@ -161,7 +172,7 @@ namespace tfs
     {
       TBSYS_LOG(DEBUG, "compact start blockid: %u\n", block_id);
       int ret = TFS_SUCCESS;
-      LogicBlock* src_logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* src_logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == src_logic_block)
       {
         TBSYS_LOG(ERROR, "block is not exist. blockid: %u\n", block_id);
@@ -174,13 +185,13 @@ namespace tfs
 
       // create the dest block
       uint32_t physical_block_id = 0;
-      ret = BlockFileManager::get_instance()->new_block(block_id, physical_block_id, C_COMPACT_BLOCK);
+      ret = DiskManager::get_instance()->new_block(block_id, physical_block_id, C_COMPACT_BLOCK);
       if (TFS_SUCCESS != ret)
         return ret;
       TBSYS_LOG(DEBUG, "compact new block blockid: %u, physical blockid: %d\n", block_id, physical_block_id);
 
       // get dest block
-      LogicBlock* dest_logic_block = BlockFileManager::get_instance()->get_logic_block(block_id, C_COMPACT_BLOCK);
+      LogicBlock* dest_logic_block = DiskManager::get_instance()->get_logic_block(block_id, C_COMPACT_BLOCK);
       if (NULL == dest_logic_block)
       {
         TBSYS_LOG(ERROR, "get compact dest block fail. blockid: %u\n", block_id);
@@ -196,7 +207,7 @@ namespace tfs
       TBSYS_LOG(DEBUG, "compact blockid : %u, switch compact blk\n", block_id);
 
       // switch the compact block with serve block
-      ret = BlockFileManager::get_instance()->switch_compact_blk(block_id);
+      ret = DiskManager::get_instance()->switch_compact_blk(block_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "compact blockid: %u, switch compact blk fail. ret: %d\n", block_id, ret);
@@ -205,7 +216,7 @@ namespace tfs
 
       TBSYS_LOG(DEBUG, "compact del old blockid: %u\n", block_id);
       // del serve block 
-      ret = BlockFileManager::get_instance()->del_block(block_id, C_COMPACT_BLOCK);
+      ret = DiskManager::get_instance()->del_block(block_id, C_COMPACT_BLOCK);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "compact blockid: %u after switch, del old block fail. ret: %d\n", block_id, ret);
@@ -214,10 +225,177 @@ namespace tfs
       return TFS_SUCCESS;
     }
 
+    int CompactBlock::incremental_compact(const uint32_t block_id)
+    {
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
+      if (NULL == logic_block)
+      {
+        TBSYS_LOG(ERROR, "block is not exist. blockid: %u\n", block_id);
+        return EXIT_NO_LOGICBLOCK_ERROR;
+      }
+
+      int32_t old_size = logic_block->get_data_file_size();
+      int32_t move_size = 0;
+      int ret = compact_in_place(logic_block, move_size);
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact blockid: %u in place fail. ret: %d", block_id, ret);
+      }
+      else
+      {
+        logic_block->set_last_update(time(NULL));
+        TBSYS_LOG(INFO, "compact blockid: %u in place, moved: %d, data size: %d => %d", block_id, move_size,
+            old_size, logic_block->get_data_file_size());
+      }
+      return ret;
+    }
+
+    int CompactBlock::compact_in_place(LogicBlock* block, int32_t& move_size)
+    {
+      move_size = 0;
+      const uint32_t block_id = block->get_logic_block_id();
+      IOScheduler* io_scheduler = DiskManager::get_instance()->get_io_scheduler(block_id);
+      RawMetaVec metas;
+      block->rlock();
+      int ret = block->get_sorted_meta_infos(metas);
+      block->unlock();
+      const int64_t total_size = block->get_data_file_size();
+      int64_t read_size = 0;
+
+      // 1. find deleted files, drop them from index. their space is free from then on
+      RawMetaVec deletes;
+      for (RawMetaVecIter it = metas.begin(); TFS_SUCCESS == ret && it != metas.end(); ++it)
+      {
+        FileInfo finfo;
+        int32_t len = sizeof(FileInfo);
+        rate_limiter_.acquire(len);
+        ret = io_scheduler->read_raw_data(IO_CLASS_COMPACT, block, reinterpret_cast<char*>(&finfo), len,
+            it->get_offset());
+        if (TFS_SUCCESS == ret && static_cast<int32_t>(sizeof(FileInfo)) != len)
+        {
+          ret = EXIT_READ_OFFSET_ERROR;
+        }
+        if (TFS_SUCCESS == ret && finfo.id_ == it->get_file_id() && (finfo.flag_ & (FI_DELETED | FI_INVALID)))
+        {
+          deletes.push_back(*it);
+        }
+        read_size += len;
+      }
+      int32_t del_count = 0;
+      int32_t del_size = 0;
+      if (TFS_SUCCESS == ret)
+      {
+        ret = block->drop_deleted_files(deletes, del_count, del_size);
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact in place, drop deleted files fail. blockid: %u, ret: %d", block_id, ret);
+        return ret;
+      }
+      update_progress(block_id, total_size, read_size, 0, 0);
+
+      // 2. holes between the files left, lowest first. files written from now on go after them
+      block->rlock();
+      ret = block->get_sorted_meta_infos(metas);
+      block->unlock();
+      std::vector<std::pair<int32_t, int32_t> > holes; // offset, size
+      int32_t end = 0;
+      for (RawMetaVecIter it = metas.begin(); TFS_SUCCESS == ret && it != metas.end(); ++it)
+      {
+        if (it->get_offset() > end)
+        {
+          holes.push_back(std::make_pair(end, it->get_offset() - end));
+        }
+        end = std::max(end, it->get_offset() + it->get_size());
+      }
+
+      // 3. copy files from the end into the lowest hole each fits before it, till one does not fit
+      std::vector<MovedFile> moves;
+      char* buf = NULL;
+      int32_t buf_size = 0;
+      int64_t write_size = 0;
+      for (int32_t i = static_cast<int32_t>(metas.size()) - 1; TFS_SUCCESS == ret && i >= 0; --i)
+      {
+        if (stop_)
+        {
+          TBSYS_LOG(WARN, "compact in place blockid: %u stopped", block_id);
+          ret = TFS_ERROR;
+          break;
+        }
+        const RawMeta& meta = metas[i];
+        size_t h = 0;
+        while (h < holes.size() && holes[h].first < meta.get_offset() && holes[h].second < meta.get_size())
+        {
+          ++h;
+        }
+        if (h >= holes.size() || holes[h].first >= meta.get_offset())
+        {
+          break;
+        }
+
+        MovedFile move;
+        move.meta_ = meta;
+        move.to_offset_ = holes[h].first;
+        if (buf_size < std::min(meta.get_size(), MAX_COMPACT_READ_SIZE))
+        {
+          tbsys::gDeleteA(buf);
+          buf_size = std::min(meta.get_size(), MAX_COMPACT_READ_SIZE);
+          buf = new char[buf_size];
+        }
+        for (int32_t pos = 0, len = 0; TFS_SUCCESS == ret && pos < meta.get_size(); pos += len)
+        {
+          len = std::min(meta.get_size() - pos, buf_size);
+          int32_t read_len = len;
+          rate_limiter_.acquire(len);
+          ret = io_scheduler->read_raw_data(IO_CLASS_COMPACT, block, buf, read_len, meta.get_offset() + pos);
+          if (TFS_SUCCESS == ret && read_len != len)
+          {
+            ret = EXIT_READ_OFFSET_ERROR;
+          }
+          if (TFS_SUCCESS == ret)
+          {
+            if (0 == pos)
+            {
+              memcpy(&move.info_, buf, sizeof(FileInfo));
+              reinterpret_cast<FileInfo*>(buf)->offset_ = move.to_offset_;
+            }
+            rate_limiter_.acquire(len);
+            ret = io_scheduler->write_raw_data(IO_CLASS_COMPACT, block, buf, len, move.to_offset_ + pos);
+          }
+          read_size += len;
+          write_size += len;
+        }
+        if (TFS_SUCCESS == ret)
+        {
+          moves.push_back(move);
+          holes[h].first += meta.get_size();
+          holes[h].second -= meta.get_size();
+          update_progress(block_id, total_size, read_size, write_size, moves.size());
+        }
+      }
+      tbsys::gDeleteA(buf);
+
+      // 4. point the files at their copies, unless changed meanwhile
+      if (TFS_SUCCESS == ret)
+      {
+        ret = block->commit_moved_files(moves, del_size, move_size);
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact in place, move file fail. blockid: %u, ret: %d", block_id, ret);
+      }
+      else if (move_size < write_size)
+      {
+        TBSYS_LOG(INFO, "compact in place, blockid: %u, files changed while moved stay, copied: %"
+            PRI64_PREFIX "d, moved: %d", block_id, write_size, move_size);
+      }
+      return ret;
+    }
+
     // send complete message to ns
     int CompactBlock::req_block_compact_complete(const uint32_t block_id, const int32_t success)
     {
-      LogicBlock* LogicBlock = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* LogicBlock = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == LogicBlock)
       {
         TBSYS_LOG(ERROR, "get block failed. blockid: %u\n", block_id);
@@ -249,10 +427,10 @@ namespace tfs
     {
       int ret = TFS_SUCCESS;
       VUINT compact_blocks;
-      BlockFileManager::get_instance()->get_logic_block_ids(compact_blocks, C_COMPACT_BLOCK);
+      DiskManager::get_instance()->get_logic_block_ids(compact_blocks, C_COMPACT_BLOCK);
       for (uint32_t i = 0; i < compact_blocks.size(); i++)
       {
-        ret = BlockFileManager::get_instance()->del_block(compact_blocks[i], C_COMPACT_BLOCK);
+        ret = DiskManager::get_instance()->del_block(compact_blocks[i], C_COMPACT_BLOCK);
         if (TFS_SUCCESS != ret)
         {
           TBSYS_LOG(ERROR, "in check thread: del compact blockid: %u fail. ret: %d", compact_blocks[i], ret);
@@ -270,11 +448,11 @@ namespace tfs
       if (last_expire_compact_block_time_ < now_time)
       {
         set < uint32_t > erase_blocks;
-        BlockFileManager::get_instance()->expire_compact_blk((uint32_t) now_time, erase_blocks);
+        DiskManager::get_instance()->expire_compact_blk((uint32_t) now_time, erase_blocks);
 
         for (set<uint32_t>::iterator mit = erase_blocks.begin(); mit != erase_blocks.end(); ++mit)
         {
-          BlockFileManager::get_instance()->del_block(*mit, C_COMPACT_BLOCK);
+          DiskManager::get_instance()->del_block(*mit, C_COMPACT_BLOCK);
         }
         last_expire_compact_block_time_ = current_time;
       }
@@ -298,24 +476,38 @@ namespace tfs
       dest->set_last_update(time(NULL));
       TBSYS_LOG(DEBUG, "compact block set last update. blockid: %u\n", dest->get_logic_block_id());
 
-      char* dest_buf = new char[MAX_COMPACT_READ_SIZE];
+      // read and verify here, write in the writer thread
+      CompactWriter writer(dest, &rate_limiter_);
+      char* dest_buf = writer.get_buffer();
       int32_t write_offset = 0, data_len = 0;
       int32_t w_file_offset = 0;
+      int64_t read_size = 0;
       RawMetaVec dest_metas;
-      FileIterator* fit = new FileIterator(src);
+      FileIterator* fit = new FileIterator(src,
+          DiskManager::get_instance()->get_io_scheduler(src->get_logic_block_id())->get_io_policy(IO_CLASS_COMPACT));
 
       int ret = TFS_SUCCESS;
-      while (fit->has_next())
+      while (TFS_SUCCESS == ret && fit->has_next())
       {
+        if (stop_)
+        {
+          TBSYS_LOG(WARN, "compact blockid: %u stopped", dest->get_logic_block_id());
+          ret = TFS_ERROR;
+          break;
+        }
         ret = fit->next();
         if (TFS_SUCCESS != ret)
         {
-          tbsys::gDeleteA(dest_buf);
-          tbsys::gDelete(fit);
-          return ret;
+          break;
         }
 
         const FileInfo* pfinfo = fit->current_file_info();
+        // reads of the source block, big files are read as they are copied
+        read_size += pfinfo->size_ + sizeof(FileInfo);
+        if (!fit->is_big_file())
+        {
+          rate_limiter_.acquire(pfinfo->size_ + sizeof(FileInfo));
+        }
         if (pfinfo->flag_ & (FI_DELETED | FI_INVALID))
         {
           continue;
@@ -343,56 +535,72 @@ namespace tfs
         {
           TBSYS_LOG(DEBUG, "write one, blockid: %u, write offset: %d\n", dest->get_logic_block_id(),
               write_offset);
-          ret = dest->write_raw_data(dest_buf, data_len, write_offset);
+          ret = writer.write(dest_buf, data_len, write_offset);
+          dest_buf = NULL;
           if (TFS_SUCCESS != ret)
           {
-            TBSYS_LOG(ERROR, "write raw data fail, blockid: %u, offset %d, readinglen: %d, ret :%d",
-                dest->get_logic_block_id(), write_offset, data_len, ret);
-            tbsys::gDeleteA(dest_buf);
-            tbsys::gDelete(fit);
-            return ret;
+            break;
           }
           write_offset += data_len;
           data_len = 0;
+          update_progress(dest->get_logic_block_id(), src_blk->size_, read_size, writer.get_write_size(),
+              dest_blk.file_count_);
+          // the other buffer, the one just filled is being written
+          dest_buf = writer.get_buffer();
+          if (NULL == dest_buf)
+          {
+            ret = writer.finish();
+            break;
+          }
         }
 
         if (fit->is_big_file())
         {
-          ret = write_big_file(src, dest, *pfinfo, dfinfo, write_offset);
+          // both buffers for the chunks of the big file
+          writer.write(dest_buf, 0, write_offset);
+          ret = write_big_file(src, writer, *pfinfo, dfinfo, write_offset);
           write_offset += dfinfo.size_;
+          dest_buf = writer.get_buffer();
+          if (TFS_SUCCESS == ret && NULL == dest_buf)
+          {
+            ret = writer.finish();
+          }
         }
         else
         {
           memcpy(dest_buf + data_len, &dfinfo, sizeof(FileInfo));
           int left_len = MAX_COMPACT_READ_SIZE - data_len;
-          ret = fit->read_buffer(dest_buf + data_len + sizeof(FileInfo), left_len);
+          char* data = dest_buf + data_len + sizeof(FileInfo);
+          ret = fit->read_buffer(data, left_len);
+          if (TFS_SUCCESS == ret && Func::crc(0, data, pfinfo->size_) != pfinfo->crc_)
+          {
+            TBSYS_LOG(ERROR, "compact blockid: %u, crc error. fileid: %" PRI64_PREFIX "u, size: %d, crc: %u",
+                dest->get_logic_block_id(), pfinfo->id_, pfinfo->size_, pfinfo->crc_);
+            ret = EXIT_CHECK_CRC_ERROR;
+          }
           data_len += dfinfo.size_;
         }
-        if (TFS_SUCCESS != ret)
-        {
-          tbsys::gDeleteA(dest_buf);
-          tbsys::gDelete(fit);
-          return ret;
-        }
-
       } // end of iterate
 
-      if (0 != data_len) // flush the last buffer
+      if (TFS_SUCCESS == ret && 0 != data_len) // flush the last buffer
       {
         TBSYS_LOG(DEBUG, "write one, blockid: %u, write offset: %d\n", dest->get_logic_block_id(), write_offset);
-        ret = dest->write_raw_data(dest_buf, data_len, write_offset);
-        if (TFS_SUCCESS != ret)
-        {
-          TBSYS_LOG(ERROR, "write raw data fail, blockid: %u, offset %d, readinglen: %d, ret :%d",
-              dest->get_logic_block_id(), write_offset, data_len, ret);
-          tbsys::gDeleteA(dest_buf);
-          tbsys::gDelete(fit);
-          return ret;
-        }
+        ret = writer.write(dest_buf, data_len, write_offset);
+      }
+      int write_ret = writer.finish();
+      if (TFS_SUCCESS == ret)
+      {
+        ret = write_ret;
       }
-
-      tbsys::gDeleteA(dest_buf);
       tbsys::gDelete(fit);
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact copy data fail, blockid: %u, write offset: %d, ret: %d",
+            dest->get_logic_block_id(), write_offset, ret);
+        return ret;
+      }
+      update_progress(dest->get_logic_block_id(), src_blk->size_, read_size, writer.get_write_size(),
+          dest_blk.file_count_);
       TBSYS_LOG(DEBUG, "compact write complete. blockid: %u\n", dest->get_logic_block_id());
 
       ret = dest->batch_write_meta(&dest_blk, &dest_metas);
@@ -414,44 +622,250 @@ namespace tfs
       return TFS_SUCCESS;
     }
 
-    int CompactBlock::write_big_file(LogicBlock* src, LogicBlock* dest, const FileInfo& src_info,
+    int CompactBlock::write_big_file(LogicBlock* src, CompactWriter& writer, const FileInfo& src_info,
         const FileInfo& dest_info, int32_t woffset)
     {
       int32_t rsize = src_info.size_;
       int32_t roffset = src_info.offset_ + sizeof(FileInfo);
-      char* buf = new char[MAX_COMPACT_READ_SIZE];
       int32_t read_len = 0;
+      uint32_t crc = 0;
       int ret = TFS_SUCCESS;
 
-      memcpy(buf, &dest_info, sizeof(FileInfo));
+      IOScheduler* io_scheduler = DiskManager::get_instance()->get_io_scheduler(src->get_logic_block_id());
       int32_t data_len = sizeof(FileInfo);
-      while (read_len < rsize)
+      while (TFS_SUCCESS == ret && read_len < rsize)
       {
+        char* buf = writer.get_buffer();
+        if (NULL == buf)
+        {
+          ret = writer.finish();
+          break;
+        }
+        if (0 == read_len)
+        {
+          memcpy(buf, &dest_info, sizeof(FileInfo));
+        }
         int32_t cur_read = MAX_COMPACT_READ_SIZE - data_len;
         if (cur_read > rsize - read_len)
           cur_read = rsize - read_len;
-        ret = src->read_raw_data(buf + data_len, cur_read, roffset);
+        rate_limiter_.acquire(cur_read);
+        ret = io_scheduler->read_raw_data(IO_CLASS_COMPACT, src, buf + data_len, cur_read, roffset);
         if (TFS_SUCCESS != ret)
+        {
+          // not queued, the writer still owns it
+          writer.write(buf, 0, woffset);
           break;
+        }
+        crc = Func::crc(crc, buf + data_len, cur_read);
         data_len += cur_read;
         read_len += cur_read;
         roffset += cur_read;
 
-        ret = dest->write_raw_data(buf, data_len, woffset);
-        if (TFS_SUCCESS != ret)
+        if (read_len >= rsize && crc != src_info.crc_)
+        {
+          TBSYS_LOG(ERROR, "compact blockid: %u, crc error. fileid: %" PRI64_PREFIX "u, size: %d, crc: %u",
+              src->get_logic_block_id(), src_info.id_, src_info.size_, src_info.crc_);
+          ret = EXIT_CHECK_CRC_ERROR;
+          writer.write(buf, 0, woffset);
           break;
+        }
+        ret = writer.write(buf, data_len, woffset);
         woffset += data_len;
 
         data_len = 0;
       }
 
-      tbsys::gDeleteA(buf);
       if (TFS_SUCCESS != ret)
       {
-        TBSYS_LOG(ERROR, "write big file error, blockid: %u, ret: %d", dest->get_logic_block_id(), ret);
+        TBSYS_LOG(ERROR, "write big file error, blockid: %u, ret: %d", src->get_logic_block_id(), ret);
       }
 
       return ret;
     }
+
+    bool CompactBlock::start_progress(const uint32_t block_id)
+    {
+      tbutil::Mutex::Lock lock(progress_mutex_);
+      if (progress_.find(block_id) != progress_.end())
+      {
+        return false;
+      }
+      CompactProgress& progress = progress_[block_id];
+      memset(&progress, 0, sizeof(progress));
+      progress.block_id_ = block_id;
+      progress.start_time_ = Func::curr_time();
+      return true;
+    }
+
+    void CompactBlock::update_progress(const uint32_t block_id, const int64_t total_size, const int64_t read_size,
+        const int64_t write_size, const int32_t file_count)
+    {
+      tbutil::Mutex::Lock lock(progress_mutex_);
+      map<uint32_t, CompactProgress>::iterator it = progress_.find(block_id);
+      if (it != progress_.end())
+      {
+        CompactProgress& progress = it->second;
+        // a line every quarter of the block
+        if (total_size > 0 && read_size * 4 / total_size > progress.read_size_ * 4 / total_size)
+        {
+          TBSYS_LOG(INFO, "compact blockid: %u, read: %" PRI64_PREFIX "d of %" PRI64_PREFIX "d, written: %"
+              PRI64_PREFIX "d, files: %d", block_id, read_size, total_size, write_size, file_count);
+        }
+        progress.total_size_ = total_size;
+        progress.read_size_ = read_size;
+        progress.write_size_ = write_size;
+        progress.file_count_ = file_count;
+      }
+    }
+
+    void CompactBlock::finish_progress(const uint32_t block_id)
+    {
+      tbutil::Mutex::Lock lock(progress_mutex_);
+      progress_.erase(block_id);
+    }
+
+    void CompactBlock::get_progress(vector<CompactProgress>& progress)
+    {
+      tbutil::Mutex::Lock lock(progress_mutex_);
+      progress.clear();
+      for (map<uint32_t, CompactProgress>::const_iterator it = progress_.begin(); it != progress_.end(); ++it)
+      {
+        progress.push_back(it->second);
+      }
+    }
+
+    void CompactBlock::dump_progress()
+    {
+      vector<CompactProgress> progress;
+      get_progress(progress);
+      int64_t now = Func::curr_time();
+      for (vector<CompactProgress>::const_iterator it = progress.begin(); it != progress.end(); ++it)
+      {
+        TBSYS_LOG(INFO, "compacting blockid: %u, read: %" PRI64_PREFIX "d of %" PRI64_PREFIX "d, written: %"
+            PRI64_PREFIX "d, files: %d, cost time: %" PRI64_PREFIX "d", it->block_id_, it->read_size_,
+            it->total_size_, it->write_size_, it->file_count_, now - it->start_time_);
+      }
+    }
+
+    CompactWriter::CompactWriter(LogicBlock* dest, RateLimiter* rate_limiter) :
+      dest_(dest), io_scheduler_(DiskManager::get_instance()->get_io_scheduler(dest->get_logic_block_id())),
+      rate_limiter_(rate_limiter), write_thread_(0), write_size_(0), ret_(TFS_SUCCESS), finished_(false)
+    {
+      for (int32_t i = 0; i < BUFFER_COUNT; ++i)
+      {
+        buffers_[i] = new char[MAX_COMPACT_READ_SIZE];
+        free_buffers_.push_back(buffers_[i]);
+      }
+      write_thread_ = new WriteThreadHelper(*this);
+    }
+
+    CompactWriter::~CompactWriter()
+    {
+      finish();
+      for (int32_t i = 0; i < BUFFER_COUNT; ++i)
+      {
+        tbsys::gDeleteA(buffers_[i]);
+      }
+    }
+
+    char* CompactWriter::get_buffer()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      while (TFS_SUCCESS == ret_ && free_buffers_.empty())
+      {
+        monitor_.wait();
+      }
+      if (TFS_SUCCESS != ret_)
+      {
+        return NULL;
+      }
+      char* buf = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buf;
+    }
+
+    int CompactWriter::write(char* buf, const int32_t nbytes, const int32_t offset)
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      if (TFS_SUCCESS != ret_ || nbytes <= 0)
+      {
+        free_buffers_.push_back(buf);
+      }
+      else
+      {
+        WriteRequest request;
+        request.buf_ = buf;
+        request.nbytes_ = nbytes;
+        request.offset_ = offset;
+        requests_.push_back(request);
+      }
+      monitor_.notifyAll();
+      return ret_;
+    }
+
+    int CompactWriter::finish()
+    {
+      {
+        tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+        finished_ = true;
+        monitor_.notifyAll();
+      }
+      if (0 != write_thread_)
+      {
+        write_thread_->join();
+        write_thread_ = 0;
+      }
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      return ret_;
+    }
+
+    int64_t CompactWriter::get_write_size()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      return write_size_;
+    }
+
+    void CompactWriter::WriteThreadHelper::run()
+    {
+      writer_.run_write();
+    }
+
+    void CompactWriter::run_write()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      while (true)
+      {
+        while (!finished_ && requests_.empty())
+        {
+          monitor_.wait();
+        }
+        if (requests_.empty())
+        {
+          break;
+        }
+        WriteRequest request = requests_.front();
+        requests_.pop_front();
+        if (TFS_SUCCESS == ret_)
+        {
+          monitor_.unlock();
+          rate_limiter_->acquire(request.nbytes_);
+          int ret = io_scheduler_->write_raw_data(IO_CLASS_COMPACT, dest_, request.buf_,
+              request.nbytes_, request.offset_);
+          monitor_.lock();
+          if (TFS_SUCCESS == ret)
+          {
+            write_size_ += request.nbytes_;
+          }
+          else
+          {
+            TBSYS_LOG(ERROR, "write raw data fail, blockid: %u, offset %d, len: %d, ret :%d",
+                dest_->get_logic_block_id(), request.offset_, request.nbytes_, ret);
+            ret_ = ret;
+          }
+        }
+        free_buffers_.push_back(request.buf_);
+        monitor_.notifyAll();
+      }
+    }
   }
 }
@@ -20,9 +20,13 @@
 
 #include <Mutex.h>
 #include <Monitor.h>
+#include <TbThread.h>
+#include <Handle.h>
+#include <map>
 #include "logic_block.h"
-#include "blockfile_manager.h"
+#include "disk_manager.h"
 #include "dataserver_define.h"
+#include "rate_limiter.h"
 //#include "common/config.h"
 
 namespace tfs
@@ -35,6 +39,79 @@ namespace tfs
       uint32_t block_id_;
       int32_t preserve_time_;
       int32_t owner_;
+      int32_t mode_;  // CompactMode
+    };
+
+    // progress of a running compaction
+    struct CompactProgress
+    {
+      uint32_t block_id_;
+      int64_t start_time_;   // us
+      int64_t total_size_;   // data size of the source block
+      int64_t read_size_;    // bytes of the source block gone through
+      int64_t write_size_;   // bytes written to the compact block
+      int32_t file_count_;   // files copied
+    };
+
+    // writer stage of a compaction. the reader fills a buffer with files and queues it,
+    // an own thread writes it to the compact block while the reader fills the other one.
+    class CompactWriter
+    {
+      public:
+        CompactWriter(LogicBlock* dest, RateLimiter* rate_limiter);
+        ~CompactWriter();
+
+        // a buffer of MAX_COMPACT_READ_SIZE, wait while all are queued. NULL if a write failed
+        char* get_buffer();
+        // queue nbytes of buf to be written at offset of the compact block, buf is given back
+        // to get_buffer when written
+        int write(char* buf, const int32_t nbytes, const int32_t offset);
+        // wait till all queued are written, return the first error
+        int finish();
+        int64_t get_write_size();
+
+      private:
+        class WriteThreadHelper: public tbutil::Thread
+        {
+          public:
+            explicit WriteThreadHelper(CompactWriter& writer):
+              writer_(writer)
+            {
+              start();
+            }
+            virtual ~WriteThreadHelper(){}
+            void run();
+          private:
+            DISALLOW_COPY_AND_ASSIGN(WriteThreadHelper);
+            CompactWriter& writer_;
+        };
+        typedef tbutil::Handle<WriteThreadHelper> WriteThreadHelperPtr;
+
+        struct WriteRequest
+        {
+          char* buf_;
+          int32_t nbytes_;
+          int32_t offset_;
+        };
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(CompactWriter);
+        void run_write();
+
+      private:
+        static const int32_t BUFFER_COUNT = 2;
+
+        tbutil::Monitor<tbutil::Mutex> monitor_;
+        std::deque<WriteRequest> requests_;
+        std::vector<char*> free_buffers_;
+        char* buffers_[BUFFER_COUNT];
+        LogicBlock* dest_;
+        IOScheduler* io_scheduler_; // of the disk of dest
+        RateLimiter* rate_limiter_;
+        WriteThreadHelperPtr write_thread_;
+        int64_t write_size_;
+        int ret_;        // first write error
+        bool finished_;
     };
 
     class CompactBlock
@@ -51,16 +128,34 @@ namespace tfs
         int add_cpt_task(CompactBlkInfo* cpt_blk);
         int real_compact(const uint32_t block_id);
         int real_compact(LogicBlock* src, LogicBlock *dest);
+        // compact the block in place, no new block
+        int incremental_compact(const uint32_t block_id);
+        // drop deleted files, move files at the end of the block into the holes before them and
+        // cut the data size down to the end of the last file. the data is moved out of the block
+        // lock, a file changed meanwhile stays where it is. move_size is the bytes of files moved
+        int compact_in_place(LogicBlock* block, int32_t& move_size);
         // delete expired compact block files
         int expire_compact_block_map();
 
         int run_compact_block();
 
+        // progress of the running compactions
+        void get_progress(std::vector<CompactProgress>& progress);
+        void dump_progress();
+        inline RateLimiter& get_rate_limiter()
+        {
+          return rate_limiter_;
+        }
+
       private:
         void init();
+        bool start_progress(const uint32_t block_id);
+        void update_progress(const uint32_t block_id, const int64_t total_size, const int64_t read_size,
+            const int64_t write_size, const int32_t file_count);
+        void finish_progress(const uint32_t block_id);
 
         int clear_compact_block_map();
-        int write_big_file(LogicBlock* src, LogicBlock* dest, const common::FileInfo& src_info,
+        int write_big_file(LogicBlock* src, CompactWriter& writer, const common::FileInfo& src_info,
             const common::FileInfo& dest_info, int32_t woffset);
         int req_block_compact_complete(const uint32_t block_id, const int32_t success);
 
@@ -75,6 +170,11 @@ namespace tfs
         int32_t expire_compact_interval_;
         int32_t last_expire_compact_block_time_;
         uint64_t dataserver_id_;
+
+        // shared by the compact threads, reads and writes of all running compactions
+        RateLimiter rate_limiter_;
+        tbutil::Mutex progress_mutex_;
+        std::map<uint32_t, CompactProgress> progress_;
     };
   }
 }
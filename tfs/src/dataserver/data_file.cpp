@@ -13,6 +13,9 @@
  *      - initial release
  *
  */
+#include <sys/mman.h>
+#include <vector>
+#include <algorithm>
 #include "common/parameter.h"
 #include "common/func.h"
 #include "data_file.h"
@@ -28,20 +31,25 @@ namespace tfs
     {
       last_update_ = time(NULL);
       length_ = 0;
+      memset(chunks_, 0, sizeof(chunks_));
+      spill_data_ = NULL;
+      spill_size_ = 0;
       crc_ = 0;
       fd_ = -1;
       sprintf(tmp_file_name_, "%s/tmp/%"PRI64_PREFIX"u.dat", dynamic_cast<DataService*>(DataService::instance())->get_real_work_dir().c_str(), fn);
       atomic_set(&ref_count_, 0);
     }
 
-    DataFile::DataFile(uint64_t fn, char* path)
+    DataFile::DataFile(uint64_t fn, const char* work_dir)
     {
-      UNUSED(path);
       last_update_ = time(NULL);
       length_ = 0;
+      memset(chunks_, 0, sizeof(chunks_));
+      spill_data_ = NULL;
+      spill_size_ = 0;
       crc_ = 0;
       fd_ = -1;
-      sprintf(tmp_file_name_, "%s/tmp/%"PRI64_PREFIX"u.dat", dynamic_cast<DataService*>(DataService::instance())->get_real_work_dir().c_str(), fn);
+      snprintf(tmp_file_name_, MAX_PATH_LENGTH, "%s/tmp/%"PRI64_PREFIX"u.dat", work_dir, fn);
       atomic_set(&ref_count_, 0);
     }
 
@@ -54,6 +62,17 @@ namespace tfs
     void DataFile::set_over()
     {
       length_ = 0;
+      for (int32_t i = 0; i < CHUNK_COUNT; ++i)
+      {
+        WriteBufferPool::get_instance()->free(chunks_[i], i);
+        chunks_[i] = NULL;
+      }
+      if (NULL != spill_data_)
+      {
+        munmap(spill_data_, spill_size_);
+        spill_data_ = NULL;
+        spill_size_ = 0;
+      }
       if (fd_ != -1)
       {
         close(fd_);
@@ -70,38 +89,29 @@ namespace tfs
       }
       int32_t length = offset + len;
 
-      if (length > WRITE_DATA_TMPBUF_SIZE || length_ > WRITE_DATA_TMPBUF_SIZE)      // write to file if length is large then max_read_size
+      tbutil::Mutex::Lock lock(mutex_);
+      if (length > MEMORY_DATA_SIZE || NULL != spill_data_) // write to temporary file if larger than chunks
       {
-        if (fd_ == -1)          // first write to file
-        {
-          fd_ = open(tmp_file_name_, O_RDWR | O_CREAT | O_TRUNC, 0600);
-          if (fd_ == -1)
-          {
-            TBSYS_LOG(ERROR, "open file fail: %s, %s", tmp_file_name_, strerror(errno));
-            return TFS_ERROR;
-          }
-          // write memory content to file
-          if (write(fd_, data_, length_) != length_)
-          {
-            TBSYS_LOG(ERROR, "write file fail: %s, length_: %d, error:%s", tmp_file_name_, length_, strerror(errno));
-            return TFS_ERROR;
-          }
-        }
-        if (lseek(fd_, offset, SEEK_SET) == -1)
-        {
-          TBSYS_LOG(ERROR, "lseek file fail: %s, offset: %d", tmp_file_name_, offset);
-          return TFS_ERROR;
-        }
-        // no append, just write
-        if (write(fd_, data, len) != len)
+        int ret = NULL == spill_data_ ? spill(length) : extend_spill(length);
+        if (TFS_SUCCESS != ret)
         {
-          TBSYS_LOG(ERROR, "write file fail: %s, len: %d", tmp_file_name_, len);
           return TFS_ERROR;
         }
+        memcpy(spill_data_ + offset, data, len);
       }
-      else                      // length ok
+      else
       {
-        memcpy(data_ + offset, data, len);
+        // chunks are allocated in order, no hole between them
+        int32_t chunk_offset = 0;
+        int32_t last_index = get_chunk_index(length - 1, chunk_offset);
+        for (int32_t i = 0; i <= last_index; ++i)
+        {
+          if (NULL == chunks_[i])
+          {
+            chunks_[i] = WriteBufferPool::get_instance()->alloc(i);
+          }
+        }
+        copy_data(const_cast<char*>(data), len, offset, true);
       }
 
       // set the max length
@@ -114,52 +124,40 @@ namespace tfs
 
     char* DataFile::get_data(char* data, int32_t* len, int32_t offset)
     {
-      if (offset >= length_)
+      if (offset < 0 || offset >= length_)
       {
         *len = -1;
         return NULL;
       }
-      if (length_ > WRITE_DATA_TMPBUF_SIZE) // read from file
+      int32_t remain_len = length_ - offset;
+      if (NULL == data)       // just use inner buffer
       {
-        if (fd_ == -1)
-        {
-          *len = -1;
-          return NULL;
-        }
-        if (lseek(fd_, offset, SEEK_SET) == -1)
-        {
-          TBSYS_LOG(ERROR, "lseek file fail: %s, offset: %d", tmp_file_name_, offset);
-          *len = -1;
-          return NULL;
-        }
-        if (data == NULL)
+        if (NULL != spill_data_)
         {
-          data = data_;
-          *len = WRITE_DATA_TMPBUF_SIZE;
+          data = spill_data_ + offset;
+          *len = remain_len;
         }
-        int rlen;
-        if ((rlen = read(fd_, data, *len)) < 0)
+        else
         {
-          TBSYS_LOG(ERROR, "read file fail: %s, len: %d", tmp_file_name_, *len);
-          *len = -1;
-          return NULL;
+          int32_t chunk_offset = 0;
+          int32_t index = get_chunk_index(offset, chunk_offset);
+          data = chunks_[index] + chunk_offset;
+          *len = std::min(WriteBufferPool::get_chunk_size(index) - chunk_offset, remain_len);
         }
-        *len = rlen;
       }
       else
       {
-        if (data == NULL)       // just use inner buffer
+        if (*len > remain_len)
         {
-          data = data_;
-          *len = length_;
+          *len = remain_len;
+        }
+        if (NULL != spill_data_)
+        {
+          memcpy(data, spill_data_ + offset, *len);
         }
         else
         {
-          if (*len > length_)
-          {
-            *len = length_;
-          }
-          memcpy(data, data_, *len);
+          copy_data(data, *len, offset, false);
         }
       }
       return data;
@@ -167,31 +165,251 @@ namespace tfs
 
     uint32_t DataFile::get_crc()
     {
+      tbutil::Mutex::Lock lock(mutex_);
       if (crc_ == 0)
       {
-        if (length_ > WRITE_DATA_TMPBUF_SIZE) // read from file
+        char* data = NULL;
+        int32_t len = 0, offset = 0;
+        while (offset < length_ && (data = get_data(NULL, &len, offset)) != NULL)
         {
-          if (fd_ == -1)
+          crc_ = Func::crc(crc_, data, len);
+          offset += len;
+        }
+      }
+      return crc_;
+    }
+
+    int32_t DataFile::get_chunk_index(const int32_t offset, int32_t& chunk_offset)
+    {
+      int32_t index = 0, chunk_start = 0;
+      int32_t chunk_size = WriteBufferPool::MIN_CHUNK_SIZE;
+      while (offset >= chunk_start + chunk_size && index < CHUNK_COUNT - 1)
+      {
+        chunk_start += chunk_size;
+        chunk_size <<= 1;
+        ++index;
+      }
+      chunk_offset = offset - chunk_start;
+      return index;
+    }
+
+    void DataFile::copy_data(char* data, const int32_t len, const int32_t offset, const bool to_chunk)
+    {
+      int32_t chunk_offset = 0;
+      int32_t index = get_chunk_index(offset, chunk_offset);
+      int32_t copy_len = 0;
+      for (int32_t done = 0; done < len; done += copy_len, ++index, chunk_offset = 0)
+      {
+        copy_len = std::min(WriteBufferPool::get_chunk_size(index) - chunk_offset, len - done);
+        if (to_chunk)
+        {
+          memcpy(chunks_[index] + chunk_offset, data + done, copy_len);
+        }
+        else
+        {
+          memcpy(data + done, chunks_[index] + chunk_offset, copy_len);
+        }
+      }
+    }
+
+    // move chunks to temporary file
+    int DataFile::spill(const int32_t length)
+    {
+      fd_ = open(tmp_file_name_, O_RDWR | O_CREAT | O_TRUNC, 0600);
+      if (fd_ == -1)
+      {
+        TBSYS_LOG(ERROR, "open file fail: %s, %s", tmp_file_name_, strerror(errno));
+        return TFS_ERROR;
+      }
+      int ret = extend_spill(length);
+      if (TFS_SUCCESS != ret)
+      {
+        close(fd_);
+        unlink(tmp_file_name_);
+        fd_ = -1;
+        return ret;
+      }
+
+      copy_data(spill_data_, length_, 0, false);
+      for (int32_t i = 0; i < CHUNK_COUNT; ++i)
+      {
+        WriteBufferPool::get_instance()->free(chunks_[i], i);
+        chunks_[i] = NULL;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DataFile::extend_spill(const int32_t length)
+    {
+      if (length <= spill_size_)
+      {
+        return TFS_SUCCESS;
+      }
+      int64_t size = (static_cast<int64_t>(length) + SPILL_EXTEND_SIZE - 1) / SPILL_EXTEND_SIZE * SPILL_EXTEND_SIZE;
+      size = std::min(size, static_cast<int64_t>(INT32_MAX));
+      // allocate disk space first, or writing to a hole of the map gets SIGBUS when disk is full
+      int ret = posix_fallocate(fd_, 0, size);
+      if (0 != ret)
+      {
+        TBSYS_LOG(ERROR, "allocate file fail: %s, size: %" PRI64_PREFIX "d, error: %s", tmp_file_name_, size,
+            strerror(ret));
+        return TFS_ERROR;
+      }
+      void* data = NULL == spill_data_ ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0)
+        : mremap(spill_data_, spill_size_, size, MREMAP_MAYMOVE);
+      if (MAP_FAILED == data)
+      {
+        TBSYS_LOG(ERROR, "map file fail: %s, size: %" PRI64_PREFIX "d, error: %s", tmp_file_name_, size,
+            strerror(errno));
+        return TFS_ERROR;
+      }
+      spill_data_ = static_cast<char*>(data);
+      spill_size_ = static_cast<int32_t>(size);
+      return TFS_SUCCESS;
+    }
+
+    DataFileRegistry::DataFileRegistry(const int32_t shard_count) :
+      shard_count_(shard_count > 0 ? shard_count : DEFAULT_SHARD_COUNT), shards_(NULL)
+    {
+      shards_ = new DataFileShard[shard_count_];
+      atomic_set(&count_, 0);
+    }
+
+    DataFileRegistry::~DataFileRegistry()
+    {
+      clear();
+      tbsys::gDeleteA(shards_);
+    }
+
+    int DataFileRegistry::acquire(const uint64_t file_number, const bool create, const int32_t max_count,
+        DataFile*& datafile, const char* work_dir)
+    {
+      datafile = NULL;
+      DataFileShard& shard = get_shard(file_number);
+      {
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        DataFileMapIter it = shard.map_.find(file_number);
+        if (it != shard.map_.end())
+        {
+          datafile = it->second;
+          datafile->add_ref();
+          datafile->set_last_update();
+          return TFS_SUCCESS;
+        }
+      }
+
+      if (!create)
+      {
+        return EXIT_DATAFILE_EXPIRE_ERROR;
+      }
+
+      // control datafile size
+      if (atomic_add_return(1, &count_) > max_count)
+      {
+        atomic_dec(&count_);
+        return EXIT_DATAFILE_OVERLOAD;
+      }
+
+      // build the datafile out of lock, it owns a large buffer
+      DataFile* new_datafile = NULL == work_dir ? new DataFile(file_number) : new DataFile(file_number, work_dir);
+      new_datafile->add_ref(); // reference of map
+      {
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        DataFileMapIter it = shard.map_.find(file_number);
+        if (it == shard.map_.end())
+        {
+          shard.map_.insert(DataFileMap::value_type(file_number, new_datafile));
+          datafile = new_datafile;
+          new_datafile = NULL;
+        }
+        else // another writer of the same file won
+        {
+          datafile = it->second;
+        }
+        datafile->add_ref();
+        datafile->set_last_update();
+      }
+
+      if (NULL != new_datafile)
+      {
+        atomic_dec(&count_);
+        tbsys::gDelete(new_datafile);
+      }
+      return TFS_SUCCESS;
+    }
+
+    void DataFileRegistry::release(DataFile* datafile)
+    {
+      if (NULL != datafile && datafile->sub_ref() <= 0)
+      {
+        tbsys::gDelete(datafile);
+      }
+    }
+
+    int DataFileRegistry::erase(const uint64_t file_number)
+    {
+      DataFile* datafile = NULL;
+      DataFileShard& shard = get_shard(file_number);
+      {
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        DataFileMapIter it = shard.map_.find(file_number);
+        if (it != shard.map_.end())
+        {
+          datafile = it->second;
+          shard.map_.erase(it);
+          atomic_dec(&count_);
+        }
+      }
+      release(datafile);
+      return TFS_SUCCESS;
+    }
+
+    int DataFileRegistry::expire(const int32_t expire_time, int32_t& old_size, int32_t& new_size)
+    {
+      old_size = size();
+      for (int32_t i = 0; i < shard_count_; ++i)
+      {
+        DataFileShard& shard = shards_[i];
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        for (DataFileMapIter it = shard.map_.begin(); it != shard.map_.end();)
+        {
+          // only referred by map and expire
+          if (it->second->get_ref() <= 1 && it->second->get_last_update() < expire_time)
           {
-            return crc_;
+            tbsys::gDelete(it->second);
+            shard.map_.erase(it++);
+            atomic_dec(&count_);
           }
-          if (lseek(fd_, 0, SEEK_SET) == -1)
+          else
           {
-            return crc_;
+            ++it;
           }
-          int rlen;
-          while ((rlen = read(fd_, data_, WRITE_DATA_TMPBUF_SIZE)) > 0)
+        }
+      }
+      new_size = size();
+      return TFS_SUCCESS;
+    }
+
+    void DataFileRegistry::clear()
+    {
+      for (int32_t i = 0; i < shard_count_; ++i)
+      {
+        DataFileShard& shard = shards_[i];
+        std::vector<DataFile*> datafiles;
+        {
+          tbutil::Mutex::Lock lock(shard.mutex_);
+          for (DataFileMapIter it = shard.map_.begin(); it != shard.map_.end(); ++it)
           {
-            crc_ = Func::crc(crc_, data_, rlen);
+            datafiles.push_back(it->second);
+            atomic_dec(&count_);
           }
+          shard.map_.clear();
         }
-        else
+        for (std::vector<DataFile*>::iterator it = datafiles.begin(); it != datafiles.end(); ++it)
         {
-          crc_ = Func::crc(0, data_, length_);
+          release(*it);
         }
       }
-      return crc_;
     }
-
   }
 }
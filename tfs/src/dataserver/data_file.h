@@ -22,23 +22,29 @@
 #include <errno.h>
 #include <ext/hash_map>
 #include <tbsys.h>
+#include <Mutex.h>
 #include "common/config_item.h"
 //#include "common/config.h"
 #include "dataserver_define.h"
+#include "write_buffer_pool.h"
 
 namespace tfs
 {
   namespace dataserver
   {
 
+    // staging data of a writing file until it is closed. data is kept in pooled
+    // chunks growing in size(16K, 32K, ... 1M), so memory follows the bytes written.
+    // a file larger than the chunks is moved to a preallocated, mmaped temporary file.
     class DataFile
     {
       public:
         explicit DataFile(uint64_t fn);
-        DataFile(uint64_t fn, char* path);
+        DataFile(uint64_t fn, const char* work_dir);
         ~DataFile();
 
         int set_data(const char *data, const int32_t len, const int32_t offset);
+        // data NULL: return inner buffer at offset, len is set to the continuous length of it
         char* get_data(char *data, int32_t *len, const int32_t offset);
 
         inline int32_t get_length() const
@@ -64,9 +70,9 @@ namespace tfs
           return atomic_add_return(1, &ref_count_);
         }
 
-        inline void sub_ref()
+        inline int sub_ref()
         {
-          atomic_dec(&ref_count_);
+          return atomic_sub_return(1, &ref_count_);
         }
 
         inline int get_ref() const
@@ -75,25 +81,94 @@ namespace tfs
         }
 
       private:
-        static const int WRITE_DATA_TMPBUF_SIZE = 2 * 1024 * 1024;
+        // chunk i holds [MIN_CHUNK_SIZE * (2^i - 1), MIN_CHUNK_SIZE * (2^(i+1) - 1))
+        static int32_t get_chunk_index(const int32_t offset, int32_t& chunk_offset);
+        // copy between data and chunks, from offset of file
+        void copy_data(char* data, const int32_t len, const int32_t offset, const bool to_chunk);
+        int spill(const int32_t length);
+        int extend_spill(const int32_t length);
+
+      private:
+        static const int32_t CHUNK_COUNT = WriteBufferPool::SIZE_CLASS_COUNT;
+        static const int32_t MEMORY_DATA_SIZE = WriteBufferPool::MIN_CHUNK_SIZE * ((1 << CHUNK_COUNT) - 1);
+        static const int32_t SPILL_EXTEND_SIZE = 2 * 1024 * 1024;
 
       private:
         int32_t last_update_;   // last update time
         int32_t length_;        // current max buffer write length
-        char data_[WRITE_DATA_TMPBUF_SIZE]; // data buffer
+        char* chunks_[CHUNK_COUNT];  // data chunks, allocated in order
+        char* spill_data_;      // mmaped temporary file
+        int32_t spill_size_;    // preallocated size of temporary file
         uint32_t crc_;          // crc checksum
         int fd_;                // temporary file fd
         char tmp_file_name_[common::MAX_PATH_LENGTH]; // temporary file name
         atomic_t ref_count_;                          // reference count
+        tbutil::Mutex mutex_;
 
       private:
         DataFile();
         DISALLOW_COPY_AND_ASSIGN(DataFile);
     };
 
-    typedef __gnu_cxx::hash_map<uint64_t, DataFile*, __gnu_cxx::hash<int> > DataFileMap; // fileid_ => DataFile
+    struct DataFileNumberHash
+    {
+      size_t operator()(const uint64_t file_number) const
+      {
+        return static_cast<size_t>(file_number ^ (file_number >> 32));
+      }
+    };
+    typedef __gnu_cxx::hash_map<uint64_t, DataFile*, DataFileNumberHash> DataFileMap; // file number => DataFile
     typedef DataFileMap::iterator DataFileMapIter;
 
+    // in-flight DataFile of all writing files, keyed by file number.
+    // the map is split into shards by file number, each with its own lock, so
+    // concurrent uploads do not queue on one mutex. the total number of datafiles
+    // is kept by an atomic counter.
+    // the map holds one reference of every DataFile, acquire() adds another one
+    // for the caller, the DataFile is deleted when the last reference is released.
+    class DataFileRegistry
+    {
+      public:
+        explicit DataFileRegistry(const int32_t shard_count = DEFAULT_SHARD_COUNT);
+        ~DataFileRegistry();
+
+        // find the datafile of file_number, if not found and create is true,
+        // a new one is created unless there are already max_count datafiles.
+        // datafile is returned with a reference held
+        int acquire(const uint64_t file_number, const bool create, const int32_t max_count, DataFile*& datafile,
+            const char* work_dir = NULL);
+        void release(DataFile* datafile);
+
+        int erase(const uint64_t file_number);
+        // remove the datafiles no one refers to and not updated since expire_time
+        int expire(const int32_t expire_time, int32_t& old_size, int32_t& new_size);
+        void clear();
+
+        inline int32_t size() const
+        {
+          return atomic_read(&count_);
+        }
+
+      private:
+        struct DataFileShard
+        {
+          tbutil::Mutex mutex_;
+          DataFileMap map_;
+        };
+        inline DataFileShard& get_shard(const uint64_t file_number)
+        {
+          return shards_[file_number % shard_count_];
+        }
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(DataFileRegistry);
+        static const int32_t DEFAULT_SHARD_COUNT = 64;
+
+        int32_t shard_count_;
+        DataFileShard* shards_;
+        atomic_t count_;
+    };
+
   }
 }
 #endif //TFS_DATASERVER_DATAFILE_H_
@@ -17,6 +17,8 @@
  */
 #include "data_handle.h"
 #include <list>
+#include <vector>
+#include <algorithm>
 #include "logic_block.h"
 #include "common/error_msg.h"
 
@@ -44,7 +46,8 @@ namespace tfs
       return write_segment_data(reinterpret_cast<const char*>(inner_file_info), FILEINFO_SIZE, offset);
     }
 
-    int DataHandle::write_segment_data(const char* buf, const int32_t nbytes, const int32_t offset)
+    int DataHandle::write_segment_data(const char* buf, const int32_t nbytes, const int32_t offset,
+        const IOPolicy policy)
     {
       if (NULL == buf)
       {
@@ -62,7 +65,7 @@ namespace tfs
         if (TFS_SUCCESS != ret)
           return ret;
 
-        ret = tmp_physical_block->pwrite_data(buf + written_len, writting_len, inner_offset);
+        ret = tmp_physical_block->pwrite_data(buf + written_len, writting_len, inner_offset, policy);
         if (TFS_SUCCESS != ret)
           return ret;
 
@@ -71,7 +74,57 @@ namespace tfs
       return ret;
     }
 
-    int DataHandle::read_segment_data(char* buf, const int32_t nbytes, const int32_t offset)
+    int DataHandle::write_segment_datav(const struct iovec* iov, const int32_t iovcnt, const int32_t offset)
+    {
+      if (NULL == iov)
+      {
+        return EXIT_POINTER_NULL;
+      }
+      int32_t nbytes = 0;
+      for (int32_t i = 0; i < iovcnt; ++i)
+      {
+        nbytes += iov[i].iov_len;
+      }
+      PhysicalBlock* tmp_physical_block = NULL;
+      int32_t inner_offset = 0;
+      int32_t written_len = 0, writting_len = 0;
+      int32_t index = 0, iov_offset = 0; // position in iov
+      std::vector<struct iovec> part_iov;
+      int ret = TFS_SUCCESS;
+
+      while (written_len < nbytes)
+      {
+        writting_len = nbytes - written_len;
+        ret = choose_physic_block(&tmp_physical_block, offset + written_len, inner_offset, writting_len);
+        if (TFS_SUCCESS != ret)
+          return ret;
+
+        // buffers falling in this physical block, split the one crossing the end
+        part_iov.clear();
+        for (int32_t part_len = 0; part_len < writting_len; ++index, iov_offset = 0)
+        {
+          struct iovec part;
+          part.iov_base = reinterpret_cast<char*>(iov[index].iov_base) + iov_offset;
+          part.iov_len = std::min(static_cast<int32_t>(iov[index].iov_len) - iov_offset, writting_len - part_len);
+          part_iov.push_back(part);
+          part_len += part.iov_len;
+          if (iov_offset + static_cast<int32_t>(part.iov_len) < static_cast<int32_t>(iov[index].iov_len))
+          {
+            iov_offset += part.iov_len;
+            break;
+          }
+        }
+
+        ret = tmp_physical_block->pwritev_data(&part_iov[0], part_iov.size(), inner_offset);
+        if (TFS_SUCCESS != ret)
+          return ret;
+
+        written_len += writting_len;
+      }
+      return ret;
+    }
+
+    int DataHandle::read_segment_data(char* buf, const int32_t nbytes, const int32_t offset, const IOPolicy policy)
     {
       if (NULL == buf)
       {
@@ -89,7 +142,7 @@ namespace tfs
         if (TFS_SUCCESS != ret)
           return ret;
 
-        ret = tmp_physical_block->pread_data(buf + has_read_len, reading_len, inner_offset);
+        ret = tmp_physical_block->pread_data(buf + has_read_len, reading_len, inner_offset, policy);
         if (TFS_SUCCESS != ret)
           return ret;
 
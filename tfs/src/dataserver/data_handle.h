@@ -42,8 +42,12 @@ namespace tfs
         int read_segment_info(common::FileInfo* inner_file_info, const int32_t offset);
         int write_segment_info(const common::FileInfo* inner_file_info, const int32_t offset);
 
-        int write_segment_data(const char* buf, const int32_t nbytes, const int32_t offset);
-        int read_segment_data(char* buf, const int32_t nbytes, const int32_t offset);
+        int write_segment_data(const char* buf, const int32_t nbytes, const int32_t offset,
+            const IOPolicy policy = IO_POLICY_CACHED);
+        // write buffers of iov continuously from offset
+        int write_segment_datav(const struct iovec* iov, const int32_t iovcnt, const int32_t offset);
+        int read_segment_data(char* buf, const int32_t nbytes, const int32_t offset,
+            const IOPolicy policy = IO_POLICY_CACHED);
 
       private:
         int choose_physic_block(PhysicalBlock** tmp_physical_block, const int32_t offset, int32_t& inner_offset,
@@ -18,9 +18,11 @@
  *
  */
 #include "data_management.h"
-#include "blockfile_manager.h"
+#include "disk_manager.h"
 #include "dataserver_define.h"
 #include "visit_stat.h"
+#include "file_cache.h"
+#include "read_ahead.h"
 #include <Memory.hpp>
 
 namespace tfs
@@ -51,12 +53,24 @@ namespace tfs
       int64_t time_start = tbsys::CTimeUtil::getTime();
       TBSYS_LOG(INFO, "block file load blocks begin. start time: %" PRI64_PREFIX "d\n", time_start);
       // just start up
-      int ret = BlockFileManager::get_instance()->bootstrap(fs_param);
+      int ret = DiskManager::get_instance()->bootstrap(fs_param);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "blockfile manager boot fail! ret: %d\n", ret);
         return ret;
       }
+      ret = FileCache::get_instance()->initialize(SYSPARAM_DATASERVER.read_cache_size_,
+          SYSPARAM_DATASERVER.read_cache_max_file_size_, SYSPARAM_DATASERVER.read_cache_admit_visit_count_);
+      if (TFS_SUCCESS != ret)
+      {
+        return ret;
+      }
+      ret = ReadAheadCache::get_instance()->initialize(SYSPARAM_DATASERVER.read_ahead_cache_size_,
+          SYSPARAM_DATASERVER.read_ahead_size_);
+      if (TFS_SUCCESS != ret)
+      {
+        return ret;
+      }
       int64_t time_end = tbsys::CTimeUtil::getTime();
       TBSYS_LOG(INFO, "block file load blocks end. end time: %" PRI64_PREFIX "d. cost time: %" PRI64_PREFIX "d.",
           time_end, time_end - time_start);
@@ -65,24 +79,24 @@ namespace tfs
 
     void DataManagement::get_ds_filesystem_info(int32_t& block_count, int64_t& use_capacity, int64_t& total_capacity)
     {
-      BlockFileManager::get_instance()->query_approx_block_count(block_count);
-      BlockFileManager::get_instance()->query_space(use_capacity, total_capacity);
+      DiskManager::get_instance()->query_approx_block_count(block_count);
+      DiskManager::get_instance()->query_space(use_capacity, total_capacity);
       return;
     }
 
     int DataManagement::get_all_logic_block(std::list<LogicBlock*>& logic_block_list)
     {
-      return BlockFileManager::get_instance()->get_all_logic_block(logic_block_list);
+      return DiskManager::get_instance()->get_all_logic_block(logic_block_list);
     }
 
     int64_t DataManagement::get_all_logic_block_size()
     {
-      return BlockFileManager::get_instance()->get_all_logic_block_size();
+      return DiskManager::get_instance()->get_all_logic_block_size();
     }
 
     int DataManagement::create_file(const uint32_t block_id, uint64_t& file_id, uint64_t& file_number)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -105,9 +119,9 @@ namespace tfs
         logic_block->reset_seq_id(file_id);
       }
 
-      data_file_mutex_.lock();
+      file_number_mutex_.lock();
       file_number = ++file_number_;
-      data_file_mutex_.unlock();
+      file_number_mutex_.unlock();
 
       TBSYS_LOG(DEBUG, "open write file. blockid: %u, fileid: %" PRI64_PREFIX "u, filenumber: %" PRI64_PREFIX "u",
           block_id, file_id, file_number_);
@@ -123,7 +137,7 @@ namespace tfs
       //if the first fragment, check version
       if (0 == write_info.offset_)
       {
-        LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(write_info.block_id_);
+        LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(write_info.block_id_);
         if (NULL == logic_block)
         {
           TBSYS_LOG(ERROR, "blockid: %u is not exist.", write_info.block_id_);
@@ -139,40 +153,24 @@ namespace tfs
       }
 
       // write data to DataFile first
-      data_file_mutex_.lock();
-      DataFileMapIter bit = data_file_map_.find(write_info.file_number_);
       DataFile* datafile = NULL;
-      if (bit != data_file_map_.end())
+      int ret = data_files_.acquire(write_info.file_number_, true, SYSPARAM_DATASERVER.max_datafile_nums_, datafile);
+      if (EXIT_DATAFILE_OVERLOAD == ret)
       {
-        datafile = bit->second;
-      }
-      else                      // not found
-      {
-        // control datafile size
-        if (data_file_map_.size() >= static_cast<uint32_t> (SYSPARAM_DATASERVER.max_datafile_nums_))
-        {
-          TBSYS_LOG(ERROR, "blockid: %u, datafile nums: %u is large than default.", write_info.block_id_,
-              data_file_map_.size());
-          data_file_mutex_.unlock();
-          return EXIT_DATAFILE_OVERLOAD;
-        }
-
-        datafile = new DataFile(write_info.file_number_);
-        data_file_map_.insert(DataFileMap::value_type(write_info.file_number_, datafile));
+        TBSYS_LOG(ERROR, "blockid: %u, datafile nums: %d is large than default.", write_info.block_id_,
+            data_files_.size());
+        return ret;
       }
-
-      if (NULL == datafile)
+      else if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "datafile is null. blockid: %u, fileid: %" PRI64_PREFIX "u, filenumber: %" PRI64_PREFIX "u",
             write_info.block_id_, write_info.file_id_, write_info.file_number_);
-        data_file_mutex_.unlock();
         return EXIT_DATA_FILE_ERROR;
       }
-      datafile->set_last_update();
-      data_file_mutex_.unlock();
 
       // write to datafile
       int32_t write_len = datafile->set_data(data_buffer, write_info.length_, write_info.offset_);
+      data_files_.release(datafile);
       if (write_len != write_info.length_)
       {
         TBSYS_LOG(
@@ -199,24 +197,14 @@ namespace tfs
 
       //find datafile
       DataFile* datafile = NULL;
-      data_file_mutex_.lock();
-      DataFileMapIter bit = data_file_map_.find(file_number);
-      if (bit != data_file_map_.end())
-      {
-        datafile = bit->second;
-      }
-
+      int ret = data_files_.acquire(file_number, false, 0, datafile);
       //lease expire
-      if (NULL == datafile)
+      if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "Datafile is null. blockid: %u, fileid: %" PRI64_PREFIX "u, filenumber: %" PRI64_PREFIX "u",
             block_id, file_id, file_number);
-        data_file_mutex_.unlock();
         return EXIT_DATAFILE_EXPIRE_ERROR;
       }
-      datafile->set_last_update();
-      datafile->add_ref();
-      data_file_mutex_.unlock();
 
       //compare crc
       uint32_t datafile_crc = datafile->get_crc();
@@ -226,27 +214,30 @@ namespace tfs
             ERROR,
             "Datafile crc error. blockid: %u, fileid: %" PRI64_PREFIX "u, filenumber: %" PRI64_PREFIX "u, local crc: %u, msg crc: %u",
             block_id, file_id, file_number, datafile_crc, crc);
-        datafile->sub_ref();
+        data_files_.release(datafile);
         erase_data_file(file_number);
         return EXIT_DATA_FILE_ERROR;
       }
 
       write_file_size = datafile->get_length();
       //find block
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
-        datafile->sub_ref();
+        data_files_.release(datafile);
         erase_data_file(file_number);
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
         return EXIT_NO_LOGICBLOCK_ERROR;
       }
 
       TIMER_START();
-      int ret = logic_block->close_write_file(file_id, datafile, datafile_crc);
+      ret = logic_block->close_write_file(file_id, datafile, datafile_crc);
+      // file may be overwritten
+      FileCache::get_instance()->erase(block_id, file_id);
+      ReadAheadCache::get_instance()->erase(block_id, file_id);
       if (TFS_SUCCESS != ret)
       {
-        datafile->sub_ref();
+        data_files_.release(datafile);
         erase_data_file(file_number);
         return ret;
       }
@@ -260,36 +251,36 @@ namespace tfs
 
       // success, gc datafile
       // close tmp file, release opened file handle
-      // datafile , bit->second point to same thing, once delete
-      // bit->second, datafile will be obseleted immediately.
-      datafile->sub_ref();
+      // drop our reference and the one of the registry, the last
+      // holder deletes the datafile.
+      data_files_.release(datafile);
       erase_data_file(file_number);
       return TFS_SUCCESS;
     }
 
     int DataManagement::erase_data_file(const uint64_t file_number)
     {
-      data_file_mutex_.lock();
-      DataFileMapIter bit = data_file_map_.find(file_number);
-      if (bit != data_file_map_.end() && NULL != bit->second)
-      {
-        tbsys::gDelete(bit->second);
-        data_file_map_.erase(bit);
-      }
-      data_file_mutex_.unlock();
-      return TFS_SUCCESS;
+      return data_files_.erase(file_number);
     }
 
     int DataManagement::read_data(const uint32_t block_id, const uint64_t file_id, const int32_t read_offset, const int8_t flag,
         int32_t& real_read_len, char* tmp_data_buffer)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "block not exist, blockid: %u", block_id);
         return EXIT_NO_LOGICBLOCK_ERROR;
       }
 
+      FileCache* file_cache = FileCache::get_instance();
+      uint64_t generation = 0;
+      if (file_cache->enabled()
+          && TFS_SUCCESS == file_cache->get(block_id, file_id, read_offset, tmp_data_buffer, real_read_len, generation))
+      {
+        return TFS_SUCCESS;
+      }
+
       int64_t start = tbsys::CTimeUtil::getTime();
       int ret = logic_block->read_file(file_id, tmp_data_buffer, real_read_len, read_offset, flag);
       if (TFS_SUCCESS != ret)
@@ -302,6 +293,13 @@ namespace tfs
       TBSYS_LOG(DEBUG, "blockid: %u read data, fileid: %" PRI64_PREFIX "u, read size: %d, offset: %d", block_id,
           file_id, real_read_len, read_offset);
 
+      // whole file is read, try to keep it in cache
+      if (file_cache->enabled() && 0 == read_offset
+          && real_read_len == reinterpret_cast<FileInfo*>(tmp_data_buffer)->size_)
+      {
+        file_cache->put(block_id, file_id, tmp_data_buffer, real_read_len, logic_block->get_visit_count(), generation);
+      }
+
       int64_t end = tbsys::CTimeUtil::getTime();
       if (end - start > SYSPARAM_DATASERVER.max_io_warn_time_)
       {
@@ -312,10 +310,61 @@ namespace tfs
       return TFS_SUCCESS;
     }
 
+    int DataManagement::batch_read_data(const uint32_t block_id, std::vector<BatchReadItem*>& items,
+        const int8_t flag)
+    {
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
+      if (NULL == logic_block)
+      {
+        TBSYS_LOG(ERROR, "block not exist, blockid: %u", block_id);
+        for (std::vector<BatchReadItem*>::iterator it = items.begin(); it != items.end(); ++it)
+        {
+          (*it)->ret_ = EXIT_NO_LOGICBLOCK_ERROR;
+        }
+        return EXIT_NO_LOGICBLOCK_ERROR;
+      }
+
+      FileCache* file_cache = FileCache::get_instance();
+      std::vector<BatchReadItem*> misses;
+      std::vector<uint64_t> generations;
+      for (std::vector<BatchReadItem*>::iterator it = items.begin(); it != items.end(); ++it)
+      {
+        BatchReadItem* item = *it;
+        uint64_t generation = 0;
+        if (file_cache->enabled() && TFS_SUCCESS == file_cache->get(block_id, item->inner_file_id_, item->offset_,
+              item->buf_, item->nbytes_, generation))
+        {
+          item->ret_ = TFS_SUCCESS;
+        }
+        else
+        {
+          misses.push_back(item);
+          generations.push_back(generation);
+        }
+      }
+
+      if (!misses.empty())
+      {
+        logic_block->batch_read_file(misses, flag);
+      }
+
+      for (uint32_t i = 0; i < misses.size() && file_cache->enabled(); ++i)
+      {
+        BatchReadItem* item = misses[i];
+        if (TFS_SUCCESS == item->ret_ && 0 == item->offset_
+            && item->nbytes_ == reinterpret_cast<FileInfo*>(item->buf_)->size_)
+        {
+          file_cache->put(block_id, item->inner_file_id_, item->buf_, item->nbytes_, logic_block->get_visit_count(),
+              generations[i]);
+        }
+      }
+      return TFS_SUCCESS;
+    }
+
     int DataManagement::read_raw_data(const uint32_t block_id, const int32_t read_offset, int32_t& real_read_len,
         char* tmp_data_buffer)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "block not exist, blockid: %u", block_id);
@@ -336,7 +385,7 @@ namespace tfs
     int DataManagement::read_file_info(const uint32_t block_id, const uint64_t file_id, const int32_t mode,
         FileInfo& finfo)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -375,7 +424,7 @@ namespace tfs
         return EXIT_RENAME_FILEID_SAME_ERROR;
       }
 
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -383,6 +432,10 @@ namespace tfs
       }
 
       int ret = logic_block->rename_file(file_id, new_file_id);
+      FileCache::get_instance()->erase(block_id, file_id);
+      ReadAheadCache::get_instance()->erase(block_id, file_id);
+      FileCache::get_instance()->erase(block_id, new_file_id);
+      ReadAheadCache::get_instance()->erase(block_id, new_file_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR,
@@ -396,7 +449,7 @@ namespace tfs
 
     int DataManagement::unlink_file(const uint32_t block_id, const uint64_t file_id, const int32_t action, int64_t& file_size)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -404,6 +457,8 @@ namespace tfs
       }
 
       int ret = logic_block->unlink_file(file_id, action, file_size);
+      FileCache::get_instance()->erase(block_id, file_id);
+      ReadAheadCache::get_instance()->erase(block_id, file_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "del file fail, blockid: %u, fileid: %" PRI64_PREFIX "u, ret: %d", block_id, file_id, ret);
@@ -422,7 +477,7 @@ namespace tfs
         {
           TBSYS_LOG(INFO, "new block: %u\n", new_blocks->at(i));
           uint32_t physic_block_id = 0;
-          ret = BlockFileManager::get_instance()->new_block(new_blocks->at(i), physic_block_id);
+          ret = DiskManager::get_instance()->new_block(new_blocks->at(i), physic_block_id);
           if (TFS_SUCCESS != ret)
           {
             TBSYS_LOG(ERROR, "new block fail, blockid: %u, ret: %d", new_blocks->at(i), ret);
@@ -447,7 +502,7 @@ namespace tfs
         for (uint32_t i = 0; i < remove_blocks->size(); ++i)
         {
           TBSYS_LOG(INFO, "remove block: %u\n", remove_blocks->at(i));
-          ret = BlockFileManager::get_instance()->del_block(remove_blocks->at(i));
+          ret = DiskManager::get_instance()->del_block(remove_blocks->at(i));
           if (TFS_SUCCESS != ret)
           {
             TBSYS_LOG(ERROR, "remove block error, blockid: %u, ret: %d", remove_blocks->at(i), ret);
@@ -469,11 +524,11 @@ namespace tfs
       // the caller should release the tmp_data_buffer memory
       if (NORMAL_BIT_MAP == query_type)
       {
-        BlockFileManager::get_instance()->query_bit_map(tmp_data_buffer, bit_map_len, set_count, C_ALLOCATE_BLOCK);
+        DiskManager::get_instance()->query_bit_map(tmp_data_buffer, bit_map_len, set_count, C_ALLOCATE_BLOCK);
       }
       else
       {
-        BlockFileManager::get_instance()->query_bit_map(tmp_data_buffer, bit_map_len, set_count, C_ERROR_BLOCK);
+        DiskManager::get_instance()->query_bit_map(tmp_data_buffer, bit_map_len, set_count, C_ERROR_BLOCK);
       }
 
       return TFS_SUCCESS;
@@ -485,8 +540,8 @@ namespace tfs
       std::list<LogicBlock*> logic_blocks;
       std::list<LogicBlock*>::iterator lit;
 
-      BlockFileManager::get_instance()->get_logic_block_ids(block_ids);
-      BlockFileManager::get_instance()->get_all_logic_block(logic_blocks);
+      DiskManager::get_instance()->get_logic_block_ids(block_ids);
+      DiskManager::get_instance()->get_all_logic_block(logic_blocks);
 
       if (query_type & LB_PAIRS) // logick block ==> physic block list
       {
@@ -529,7 +584,7 @@ namespace tfs
 
     int DataManagement::get_block_info(const uint32_t block_id, BlockInfo*& blk, int32_t& visit_count)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -544,7 +599,7 @@ namespace tfs
     int DataManagement::get_visit_sorted_blockids(std::vector<LogicBlock*>& block_ptrs)
     {
       std::list<LogicBlock*> logic_blocks;
-      BlockFileManager::get_instance()->get_all_logic_block(logic_blocks);
+      DiskManager::get_instance()->get_all_logic_block(logic_blocks);
 
       for (std::list<LogicBlock*>::iterator lit = logic_blocks.begin(); lit != logic_blocks.end(); ++lit)
       {
@@ -558,7 +613,7 @@ namespace tfs
     int DataManagement::get_block_file_list(const uint32_t block_id, std::vector<FileInfo>& fileinfos)
     {
       TBSYS_LOG(INFO, "getfilelist. blockid: %u\n", block_id);
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -573,7 +628,7 @@ namespace tfs
     int DataManagement::get_block_meta_info(const uint32_t block_id, RawMetaVec& meta_list)
     {
       TBSYS_LOG(INFO, "get raw meta list. blockid: %u\n", block_id);
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -587,7 +642,7 @@ namespace tfs
 
     int DataManagement::reset_block_version(const uint32_t block_id)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -603,11 +658,11 @@ namespace tfs
     {
       int ret = TFS_SUCCESS;
       // delete if exist
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL != logic_block)
       {
         TBSYS_LOG(INFO, "block already exist, blockid: %u. first del it", block_id);
-        ret = BlockFileManager::get_instance()->del_block(block_id);
+        ret = DiskManager::get_instance()->del_block(block_id);
         if (TFS_SUCCESS != ret)
         {
           TBSYS_LOG(ERROR, "block already exist, blockid: %u. block delete fail. ret: %d", block_id, ret);
@@ -616,7 +671,7 @@ namespace tfs
       }
 
       uint32_t physic_block_id = 0;
-      ret = BlockFileManager::get_instance()->new_block(block_id, physic_block_id);
+      ret = DiskManager::get_instance()->new_block(block_id, physic_block_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "block create error, blockid: %u, ret: %d", block_id, ret);
@@ -628,12 +683,12 @@ namespace tfs
     int DataManagement::del_single_block(const uint32_t block_id)
     {
       TBSYS_LOG(INFO, "remove single block, blockid: %u", block_id);
-      return BlockFileManager::get_instance()->del_block(block_id);
+      return DiskManager::get_instance()->del_block(block_id);
     }
 
     int DataManagement::get_block_curr_size(const uint32_t block_id, int32_t& size)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -646,7 +701,7 @@ namespace tfs
     }
 
     int DataManagement::write_raw_data(const uint32_t block_id, const int32_t data_offset, const int32_t msg_len,
-        const char* data_buffer)
+        const char* data_buffer, const IOPolicy policy)
     {
       //zero length
       if (0 == msg_len)
@@ -654,14 +709,16 @@ namespace tfs
         return TFS_SUCCESS;
       }
       int ret = TFS_SUCCESS;
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
         return EXIT_NO_LOGICBLOCK_ERROR;
       }
 
-      ret = logic_block->write_raw_data(data_buffer, msg_len, data_offset);
+      ret = logic_block->write_raw_data(data_buffer, msg_len, data_offset, policy);
+      FileCache::get_instance()->erase_block(block_id);
+      ReadAheadCache::get_instance()->erase_block(block_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "write data batch error. blockid: %u, ret: %d", block_id, ret);
@@ -673,7 +730,7 @@ namespace tfs
 
     int DataManagement::batch_write_meta(const uint32_t block_id, const BlockInfo* blk, const RawMetaVec* meta_list)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "blockid: %u is not exist.", block_id);
@@ -681,6 +738,8 @@ namespace tfs
       }
 
       int ret = logic_block->batch_write_meta(blk, meta_list);
+      FileCache::get_instance()->erase_block(block_id);
+      ReadAheadCache::get_instance()->erase_block(block_id);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "blockid: %u batch write meta error.", block_id);
@@ -699,7 +758,7 @@ namespace tfs
         for (uint32_t i = 0; i < expire_block_ids->size(); ++i)
         {
           TBSYS_LOG(INFO, "expire(delete) block. blockid: %u\n", expire_block_ids->at(i));
-          BlockFileManager::get_instance()->del_block(expire_block_ids->at(i));
+          DiskManager::get_instance()->del_block(expire_block_ids->at(i));
         }
       }
 
@@ -710,7 +769,7 @@ namespace tfs
         for (uint32_t i = 0; i < remove_block_ids->size(); ++i)
         {
           TBSYS_LOG(INFO, "delete block. blockid: %u\n", remove_block_ids->at(i));
-          BlockFileManager::get_instance()->del_block(remove_block_ids->at(i));
+          DiskManager::get_instance()->del_block(remove_block_ids->at(i));
         }
       }
 
@@ -722,7 +781,7 @@ namespace tfs
         {
           TBSYS_LOG(INFO, "new block. blockid: %u\n", new_block_ids->at(i));
           uint32_t physical_block_id = 0;
-          BlockFileManager::get_instance()->new_block(new_block_ids->at(i), physical_block_id);
+          DiskManager::get_instance()->new_block(new_block_ids->at(i), physical_block_id);
         }
       }
 
@@ -737,26 +796,10 @@ namespace tfs
 
       if (last_gc_data_file_time_ < diff_time)
       {
-        data_file_mutex_.lock();
-        int32_t old_data_file_size = data_file_map_.size();
-        for (DataFileMapIter it = data_file_map_.begin(); it != data_file_map_.end();)
-        {
-          // no reference and expire
-          if (it->second && it->second->get_ref() <= 0 && it->second->get_last_update() < diff_time)
-          {
-            tbsys::gDelete(it->second);
-            data_file_map_.erase(it++);
-          }
-          else
-          {
-            ++it;
-          }
-        }
-
-        int32_t new_data_file_size = data_file_map_.size();
-
+        int32_t old_data_file_size = 0;
+        int32_t new_data_file_size = 0;
+        data_files_.expire(diff_time, old_data_file_size, new_data_file_size);
         last_gc_data_file_time_ = current_time;
-        data_file_mutex_.unlock();
         TBSYS_LOG(INFO, "datafilemap size. old: %d, new: %d", old_data_file_size, new_data_file_size);
       }
 
@@ -766,13 +809,7 @@ namespace tfs
     // remove all datafile
     int DataManagement::remove_data_file()
     {
-      data_file_mutex_.lock();
-      for (DataFileMapIter it = data_file_map_.begin(); it != data_file_map_.end(); ++it)
-      {
-        tbsys::gDelete(it->second);
-      }
-      data_file_map_.clear();
-      data_file_mutex_.unlock();
+      data_files_.clear();
       return TFS_SUCCESS;
     }
 
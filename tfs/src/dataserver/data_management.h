@@ -54,6 +54,8 @@ namespace tfs
         int close_write_file(const common::CloseFileInfo& close_file_info, int32_t& write_file_size);
         int read_data(const uint32_t block_id, const uint64_t file_id, const int32_t read_offset, const int8_t flag,
             int32_t& real_read_len, char* tmpDataBuffer);
+        // read files of one block, result of every file is in its ret_
+        int batch_read_data(const uint32_t block_id, std::vector<BatchReadItem*>& items, const int8_t flag);
         int read_raw_data(uint32_t block_id, int32_t read_offset, int32_t& real_read_len, char* tmpDataBuffer);
 
         int read_file_info(const uint32_t block_id,
@@ -79,7 +81,7 @@ namespace tfs
         int del_single_block(const uint32_t block_id);
         int get_block_curr_size(const uint32_t block_id, int32_t& size);
         int write_raw_data(const uint32_t block_id, const int32_t data_offset, const int32_t msg_len,
-            const char* data_buffer);
+            const char* data_buffer, const IOPolicy policy = IO_POLICY_CACHED);
         int batch_write_meta(const uint32_t block_id, const common::BlockInfo* blk,
             const common::RawMetaVec* meta_list);
 
@@ -94,8 +96,8 @@ namespace tfs
         DISALLOW_COPY_AND_ASSIGN(DataManagement);
 
         uint64_t file_number_;          // file id
-        tbutil::Mutex data_file_mutex_; // datafile mutex
-        DataFileMap data_file_map_; // datafile map
+        tbutil::Mutex file_number_mutex_; // file number mutex
+        DataFileRegistry data_files_;   // writing datafiles
 
         //gc datafile
         int32_t last_gc_data_file_time_; // last datafile gc time
@@ -23,6 +23,8 @@
 #include "common/func.h"
 #include "common/directory_op.h"
 #include "new_client/fsname.h"
+#include "disk_manager.h"
+#include "file_cache.h"
 
 namespace tfs
 {
@@ -55,7 +57,8 @@ namespace tfs
         heartbeat_thread_(0),
         do_check_thread_(0),
         replicate_block_threads_(NULL),
-        compact_block_thread_(0),
+        compact_block_threads_(NULL),
+        scrub_block_thread_(0),
         do_sync_mirror_thread_(0)
     {
       //init dataserver info
@@ -334,13 +337,42 @@ namespace tfs
         {
           heartbeat_thread_ = new HeartBeatThreadHelper(*this);
           do_check_thread_  = new DoCheckThreadHelper(*this);
-          compact_block_thread_ = new CompactBlockThreadHelper(*this);
           do_sync_mirror_thread_ = new DoSyncMirrorThreadHelper(*this);
           replicate_block_threads_ =  new ReplicateBlockThreadHelperPtr[SYSPARAM_DATASERVER.replicate_thread_count_];
           for (int32_t i = 0; i < SYSPARAM_DATASERVER.replicate_thread_count_; ++i)
           {
             replicate_block_threads_[i] = new ReplicateBlockThreadHelper(*this);
           }
+          compact_block_threads_ = new CompactBlockThreadHelperPtr[SYSPARAM_DATASERVER.compact_thread_count_];
+          for (int32_t i = 0; i < SYSPARAM_DATASERVER.compact_thread_count_; ++i)
+          {
+            compact_block_threads_[i] = new CompactBlockThreadHelper(*this);
+          }
+          iret = DiskManager::get_instance()->initialize_io(SYSPARAM_DATASERVER.io_thread_count_,
+              get_work_queue_size());
+        }
+
+        if (TFS_SUCCESS == iret)
+        {
+          int32_t policy = SYSPARAM_DATASERVER.background_io_policy_;
+          iret = policy >= IO_POLICY_CACHED && policy <= IO_POLICY_DIRECT ? TFS_SUCCESS : EXIT_INVALID_ARGU;
+          if (TFS_SUCCESS != iret)
+          {
+            TBSYS_LOG(ERROR, "invalid background io policy: %d", policy);
+          }
+          else
+          {
+            DiskManager::get_instance()->set_io_policy(IO_CLASS_REPLICATE, static_cast<IOPolicy>(policy));
+            DiskManager::get_instance()->set_io_policy(IO_CLASS_COMPACT, static_cast<IOPolicy>(policy));
+          }
+          block_scrubber_.initialize(get_real_work_dir() + "/storage/scrub_cursor", SYSPARAM_DATASERVER.scrub_interval_,
+              SYSPARAM_DATASERVER.scrub_rate_limit_, static_cast<IOPolicy>(policy), &block_checker_, &main_workers_);
+          if (SYSPARAM_DATASERVER.scrub_interval_ > 0)
+          {
+            scrub_block_thread_ = new ScrubBlockThreadHelper(*this);
+          }
+          IndexMapManager::get_instance()->initialize(SYSPARAM_DATASERVER.index_memory_budget_,
+              SYSPARAM_DATASERVER.index_pin_count_, 0 != SYSPARAM_DATASERVER.index_pin_mlock_);
         }
 
         if (TFS_SUCCESS == iret)
@@ -459,6 +491,9 @@ namespace tfs
         compact_block_->stop();
       }
       block_checker_.stop();
+      block_scrubber_.stop();
+      DiskManager::get_instance()->stop_io();
+      DiskManager::get_instance()->wait_io();
 
       if (0 != heartbeat_thread_)
       {
@@ -470,10 +505,10 @@ namespace tfs
         do_check_thread_->join();
         do_check_thread_ = 0;
       }
-      if (0 != compact_block_thread_)
+      if (0 != scrub_block_thread_)
       {
-        compact_block_thread_->join();
-        compact_block_thread_ = 0;
+        scrub_block_thread_->join();
+        scrub_block_thread_ = 0;
       }
       if (0 != do_sync_mirror_thread_)
       {
@@ -492,6 +527,18 @@ namespace tfs
         }
       }
       tbsys::gDeleteA(replicate_block_threads_);
+      if (NULL != compact_block_threads_)
+      {
+        for (int32_t i = 0; i < SYSPARAM_DATASERVER.compact_thread_count_; ++i)
+        {
+          if (0 != compact_block_threads_[i])
+          {
+            compact_block_threads_[i]->join();
+            compact_block_threads_[i] = 0;
+          }
+        }
+      }
+      tbsys::gDeleteA(compact_block_threads_);
       tbsys::gDelete(repl_block_);
       tbsys::gDelete(compact_block_);
       tbsys::gDelete(sync_mirror_);
@@ -535,6 +582,7 @@ namespace tfs
     int DataService::run_check()
     {
       int32_t last_rlog = 0;
+      int64_t last_io_stat = tbsys::CTimeUtil::getTime();
       tzset();
       int zonesec = 86400 + timezone;
       while (!stop_)
@@ -574,6 +622,26 @@ namespace tfs
         if (stop_)
           break;
 
+        int64_t now = tbsys::CTimeUtil::getTime();
+        if (now - last_io_stat >= SYSPARAM_DATASERVER.dump_stat_info_interval_)
+        {
+          last_io_stat = now;
+          DiskManager::get_instance()->dump_io_stat();
+          compact_block_->dump_progress();
+          block_scrubber_.dump_stat();
+          block_reporter_.dump_stat();
+          TBSYS_LOG(INFO, "%s", IndexMapManager::get_instance()->format_stat().c_str());
+        }
+
+        // check index memory
+        {
+          std::list<LogicBlock*> logic_blocks;
+          DiskManager::get_instance()->get_all_logic_block(logic_blocks);
+          IndexMapManager::get_instance()->check(logic_blocks);
+        }
+        if (stop_)
+          break;
+
         // check stat
         count_mutex_.lock();
         visit_stat_.check_visit_stat();
@@ -864,105 +932,176 @@ namespace tfs
       bool bret = BaseService::handlePacketQueue(packet, args);
       if (bret)
       {
-        int32_t pcode = packet->getPCode();
-        int32_t ret = LOCAL_PACKET == pcode ? TFS_ERROR : TFS_SUCCESS;
-        if (TFS_SUCCESS == ret)
+        // hand disk io to io threads of the disk of the block, they delete the packet when done.
+        // do it here if the io queue is full
+        uint32_t block_id = 0;
+        int io_class = get_io_class(packet, block_id);
+        IOScheduler* scheduler = io_class >= 0 ? DiskManager::get_instance()->get_io_scheduler(block_id) : NULL;
+        if (NULL != scheduler && scheduler->enabled())
         {
-          switch (pcode)
-          {
-            case CREATE_FILENAME_MESSAGE:
-              ret = create_file_number(dynamic_cast<CreateFilenameMessage*>(packet));
-              break;
-            case WRITE_DATA_MESSAGE:
-              ret = write_data(dynamic_cast<WriteDataMessage*>(packet));
-              break;
-            case CLOSE_FILE_MESSAGE:
-              ret = close_write_file(dynamic_cast<CloseFileMessage*>(packet));
-              break;
-            case WRITE_RAW_DATA_MESSAGE:
-              ret = write_raw_data(dynamic_cast<WriteRawDataMessage*>(packet));
-              break;
-            case WRITE_INFO_BATCH_MESSAGE:
-              ret = batch_write_info(dynamic_cast<WriteInfoBatchMessage*>(packet));
-              break;
-            case READ_DATA_MESSAGE_V2:
-              ret = read_data_extra(dynamic_cast<ReadDataMessageV2*>(packet), READ_VERSION_2);
-              break;
-            case READ_DATA_MESSAGE_V3:
-              ret = read_data_extra(dynamic_cast<ReadDataMessageV3*>(packet), READ_VERSION_3);
-              break;
-            case READ_DATA_MESSAGE:
-              ret = read_data(dynamic_cast<ReadDataMessage*>(packet));
-              break;
-            case READ_RAW_DATA_MESSAGE:
-              ret = read_raw_data(dynamic_cast<ReadRawDataMessage*>(packet));
-              break;
-            case FILE_INFO_MESSAGE:
-              ret = read_file_info(dynamic_cast<FileInfoMessage*>(packet));
-              break;
-            case UNLINK_FILE_MESSAGE:
-              ret = unlink_file(dynamic_cast<UnlinkFileMessage*>(packet));
-              break;
-            case RENAME_FILE_MESSAGE:
-              ret = rename_file(dynamic_cast<RenameFileMessage*>(packet));
-              break;
-            case NEW_BLOCK_MESSAGE:
-              ret = new_block(dynamic_cast<NewBlockMessage*>(packet));
-              break;
-            case REMOVE_BLOCK_MESSAGE:
-              ret = remove_block(dynamic_cast<RemoveBlockMessage*>(packet));
-              break;
-            case LIST_BLOCK_MESSAGE:
-              ret = list_blocks(dynamic_cast<ListBlockMessage*>(packet));
-              break;
-            case LIST_BITMAP_MESSAGE:
-              ret = query_bit_map(dynamic_cast<ListBitMapMessage*>(packet));
-              break;
-            case REPLICATE_BLOCK_MESSAGE:
-              ret = replicate_block_cmd(dynamic_cast<ReplicateBlockMessage*>(packet));
-              break;
-            case COMPACT_BLOCK_MESSAGE:
-              ret = compact_block_cmd(dynamic_cast<CompactBlockMessage*>(packet));
-              break;
-            case CRC_ERROR_MESSAGE:
-              ret = crc_error_cmd(dynamic_cast<CrcErrorMessage*>(packet));
-              break;
-            case GET_BLOCK_INFO_MESSAGE:
-              ret = get_block_info(dynamic_cast<GetBlockInfoMessage*>(packet));
-              break;
-            case RESET_BLOCK_VERSION_MESSAGE:
-              ret = reset_block_version(dynamic_cast<ResetBlockVersionMessage*>(packet));
-              break;
-            case GET_SERVER_STATUS_MESSAGE:
-              ret = get_server_status(dynamic_cast<GetServerStatusMessage*>(packet));
-              break;
-            case RELOAD_CONFIG_MESSAGE:
-              ret = reload_config(dynamic_cast<ReloadConfigMessage*>(packet));
-              break;
-            case STATUS_MESSAGE:
-              ret = get_ping_status(dynamic_cast<StatusMessage*>(packet));
-              break;
-            case CLIENT_CMD_MESSAGE:
-              ret = client_command(dynamic_cast<ClientCmdMessage*>(packet));
-              break;
-            case GET_DATASERVER_INFORMATION_MESSAGE:
-              ret = get_dataserver_information(dynamic_cast<BasePacket*>(packet));
-              break;
-            default:
-              TBSYS_LOG(ERROR, "process packet pcode: %d\n", pcode);
-              ret = TFS_ERROR;
-              break;
-          }
-          if (common::TFS_SUCCESS != ret)
+          IOPacketTask* task = new IOPacketTask(*this, packet);
+          if (TFS_SUCCESS == scheduler->submit(task, static_cast<IOClass>(io_class)))
           {
-            common::BasePacket* msg = dynamic_cast<common::BasePacket*>(packet);
-            msg->reply_error_packet(TBSYS_LOG_LEVEL(ERROR), ret, "execute message failed");
+            return false;
           }
+          tbsys::gDelete(task);
         }
+        process_packet(packet);
       }
       return bret;
     }
 
+    int DataService::process_packet(tbnet::Packet* packet)
+    {
+      int32_t pcode = packet->getPCode();
+      int32_t ret = LOCAL_PACKET == pcode ? TFS_ERROR : TFS_SUCCESS;
+      if (TFS_SUCCESS == ret)
+      {
+        switch (pcode)
+        {
+          case CREATE_FILENAME_MESSAGE:
+            ret = create_file_number(dynamic_cast<CreateFilenameMessage*>(packet));
+            break;
+          case WRITE_DATA_MESSAGE:
+            ret = write_data(dynamic_cast<WriteDataMessage*>(packet));
+            break;
+          case CLOSE_FILE_MESSAGE:
+            ret = close_write_file(dynamic_cast<CloseFileMessage*>(packet));
+            break;
+          case WRITE_RAW_DATA_MESSAGE:
+            ret = write_raw_data(dynamic_cast<WriteRawDataMessage*>(packet));
+            break;
+          case WRITE_INFO_BATCH_MESSAGE:
+            ret = batch_write_info(dynamic_cast<WriteInfoBatchMessage*>(packet));
+            break;
+          case READ_DATA_MESSAGE_V2:
+            ret = read_data_extra(dynamic_cast<ReadDataMessageV2*>(packet), READ_VERSION_2);
+            break;
+          case READ_DATA_MESSAGE_V3:
+            ret = read_data_extra(dynamic_cast<ReadDataMessageV3*>(packet), READ_VERSION_3);
+            break;
+          case READ_DATA_MESSAGE:
+            ret = read_data(dynamic_cast<ReadDataMessage*>(packet));
+            break;
+          case BATCH_READ_DATA_MESSAGE:
+            ret = batch_read_data(dynamic_cast<BatchReadDataMessage*>(packet));
+            break;
+          case READ_RAW_DATA_MESSAGE:
+            ret = read_raw_data(dynamic_cast<ReadRawDataMessage*>(packet));
+            break;
+          case FILE_INFO_MESSAGE:
+            ret = read_file_info(dynamic_cast<FileInfoMessage*>(packet));
+            break;
+          case UNLINK_FILE_MESSAGE:
+            ret = unlink_file(dynamic_cast<UnlinkFileMessage*>(packet));
+            break;
+          case RENAME_FILE_MESSAGE:
+            ret = rename_file(dynamic_cast<RenameFileMessage*>(packet));
+            break;
+          case NEW_BLOCK_MESSAGE:
+            ret = new_block(dynamic_cast<NewBlockMessage*>(packet));
+            break;
+          case REMOVE_BLOCK_MESSAGE:
+            ret = remove_block(dynamic_cast<RemoveBlockMessage*>(packet));
+            break;
+          case LIST_BLOCK_MESSAGE:
+            ret = list_blocks(dynamic_cast<ListBlockMessage*>(packet));
+            break;
+          case LIST_BITMAP_MESSAGE:
+            ret = query_bit_map(dynamic_cast<ListBitMapMessage*>(packet));
+            break;
+          case REPLICATE_BLOCK_MESSAGE:
+            ret = replicate_block_cmd(dynamic_cast<ReplicateBlockMessage*>(packet));
+            break;
+          case COMPACT_BLOCK_MESSAGE:
+            ret = compact_block_cmd(dynamic_cast<CompactBlockMessage*>(packet));
+            break;
+          case CRC_ERROR_MESSAGE:
+            ret = crc_error_cmd(dynamic_cast<CrcErrorMessage*>(packet));
+            break;
+          case GET_BLOCK_INFO_MESSAGE:
+            ret = get_block_info(dynamic_cast<GetBlockInfoMessage*>(packet));
+            break;
+          case RESET_BLOCK_VERSION_MESSAGE:
+            ret = reset_block_version(dynamic_cast<ResetBlockVersionMessage*>(packet));
+            break;
+          case GET_SERVER_STATUS_MESSAGE:
+            ret = get_server_status(dynamic_cast<GetServerStatusMessage*>(packet));
+            break;
+          case RELOAD_CONFIG_MESSAGE:
+            ret = reload_config(dynamic_cast<ReloadConfigMessage*>(packet));
+            break;
+          case STATUS_MESSAGE:
+            ret = get_ping_status(dynamic_cast<StatusMessage*>(packet));
+            break;
+          case CLIENT_CMD_MESSAGE:
+            ret = client_command(dynamic_cast<ClientCmdMessage*>(packet));
+            break;
+          case GET_DATASERVER_INFORMATION_MESSAGE:
+            ret = get_dataserver_information(dynamic_cast<BasePacket*>(packet));
+            break;
+          default:
+            TBSYS_LOG(ERROR, "process packet pcode: %d\n", pcode);
+            ret = TFS_ERROR;
+            break;
+        }
+        if (common::TFS_SUCCESS != ret)
+        {
+          common::BasePacket* msg = dynamic_cast<common::BasePacket*>(packet);
+          msg->reply_error_packet(TBSYS_LOG_LEVEL(ERROR), ret, "execute message failed");
+        }
+      }
+      return ret;
+    }
+
+    // io class of a packet and the block it is about, -1 if it is not processed by io threads.
+    // a batch read is queued on the disk of its first block
+    int DataService::get_io_class(tbnet::Packet* packet, uint32_t& block_id) const
+    {
+      int io_class = -1;
+      block_id = 0;
+      switch (packet->getPCode())
+      {
+        case READ_DATA_MESSAGE:
+        case READ_DATA_MESSAGE_V2:
+        case READ_DATA_MESSAGE_V3:
+        case READ_RAW_DATA_MESSAGE:
+          io_class = IO_CLASS_READ;
+          block_id = dynamic_cast<ReadDataMessage*>(packet)->get_block_id();
+          break;
+        case FILE_INFO_MESSAGE:
+          io_class = IO_CLASS_READ;
+          block_id = dynamic_cast<FileInfoMessage*>(packet)->get_block_id();
+          break;
+        case BATCH_READ_DATA_MESSAGE:
+          {
+            io_class = IO_CLASS_READ;
+            const std::vector<ReadDataInfo>& read_infos = dynamic_cast<BatchReadDataMessage*>(packet)->get_read_infos();
+            block_id = read_infos.empty() ? 0 : read_infos[0].block_id_;
+          }
+          break;
+        case WRITE_DATA_MESSAGE:
+          io_class = IO_CLASS_WRITE;
+          block_id = dynamic_cast<WriteDataMessage*>(packet)->get_block_id();
+          break;
+        case CLOSE_FILE_MESSAGE:
+          io_class = IO_CLASS_WRITE;
+          block_id = dynamic_cast<CloseFileMessage*>(packet)->get_block_id();
+          break;
+        case WRITE_RAW_DATA_MESSAGE:
+          io_class = IO_CLASS_REPLICATE;
+          block_id = dynamic_cast<WriteRawDataMessage*>(packet)->get_block_id();
+          break;
+        case WRITE_INFO_BATCH_MESSAGE:
+          io_class = IO_CLASS_REPLICATE;
+          block_id = dynamic_cast<WriteInfoBatchMessage*>(packet)->get_block_id();
+          break;
+        default:
+          break;
+      }
+      return io_class;
+    }
+
     int DataService::create_file_number(CreateFilenameMessage* message)
     {
       TIMER_START();
@@ -1307,58 +1446,45 @@ namespace tfs
         read_offset += FILEINFO_SIZE;
       }
 
-      char* tmp_data_buffer = new char[real_read_len];
-      int ret = data_management_.read_data(block_id, file_id, read_offset, flag, real_read_len, tmp_data_buffer);
+      // read FileInfo and data straight into the reply packet, FileInfo lies in
+      // the head room in front of the data
+      int32_t head_len = 0 == read_offset ? FILEINFO_SIZE : 0;
+      int ret = TFS_SUCCESS;
+      char* packet_data = resp_rd_v2_msg->alloc_data(real_read_len - head_len, head_len);
+      if (real_read_len > 0 && NULL == packet_data)
+      {
+        TBSYS_LOG(ERROR, "alloc data failed, blockid: %u, fileid: %" PRI64_PREFIX "u, real len: %d", block_id,
+                  file_id, real_read_len);
+        ret = TFS_ERROR;
+      }
+      else
+      {
+        ret = data_management_.read_data(block_id, file_id, read_offset, flag, real_read_len, packet_data);
+      }
+
       if (TFS_SUCCESS != ret)
       {
         try_add_repair_task(block_id, ret);
-        tbsys::gDeleteA(tmp_data_buffer);
         resp_rd_v2_msg->set_length(ret);
         message->reply(resp_rd_v2_msg);
       }
       else
       {
+        int32_t visit_file_size = 0;
         if (0 == read_offset)
         {
           real_read_len -= FILEINFO_SIZE;
+          //set FileInfo
+          FileInfo* file_info = reinterpret_cast<FileInfo*>(packet_data);
+          visit_file_size = file_info->size_;
+          file_info->size_ -= FILEINFO_SIZE;
+          resp_rd_v2_msg->set_file_info(file_info);
         }
+        resp_rd_v2_msg->set_length(real_read_len);
 
-        int32_t visit_file_size = reinterpret_cast<FileInfo*>(tmp_data_buffer)->size_;
-        char* packet_data = resp_rd_v2_msg->alloc_data(real_read_len);
-        if (0 != real_read_len)
-        {
-          if (NULL == packet_data)
-          {
-            tbsys::gDelete(resp_rd_v2_msg);
-            tbsys::gDeleteA(tmp_data_buffer);
-            TBSYS_LOG(ERROR, "alloc data failed, blockid: %u, fileid: %" PRI64_PREFIX "u, real len: %d", block_id,
-                      file_id, real_read_len);
-            ret = TFS_ERROR;
-          }
-
-          if (TFS_SUCCESS == ret)
-          {
-            if (0 == read_offset)
-            {
-              //set FileInfo
-              reinterpret_cast<FileInfo*>(tmp_data_buffer)->size_ -= FILEINFO_SIZE;
-              resp_rd_v2_msg->set_file_info(reinterpret_cast<FileInfo*>(tmp_data_buffer));
-              memcpy(packet_data, tmp_data_buffer + FILEINFO_SIZE, real_read_len);
-            }
-            else
-            {
-              memcpy(packet_data, tmp_data_buffer, real_read_len);
-            }
-          }
-        }
-
-        if (TFS_SUCCESS == ret)
-        {
-          //set to connection
-          message->reply(resp_rd_v2_msg);
-          tbsys::gDeleteA(tmp_data_buffer);
-          do_stat(peer_id, visit_file_size, real_read_len, read_offset, AccessStat::READ_BYTES);
-        }
+        //set to connection
+        message->reply(resp_rd_v2_msg);
+        do_stat(peer_id, visit_file_size, real_read_len, read_offset, AccessStat::READ_BYTES);
       }
 
       TIMER_END();
@@ -1400,55 +1526,41 @@ namespace tfs
         read_offset += FILEINFO_SIZE;
       }
 
-      char* tmp_data_buffer = new char[real_read_len];
-      int ret = data_management_.read_data(block_id, file_id, read_offset, flag, real_read_len, tmp_data_buffer);
+      // read FileInfo and data straight into the reply packet, FileInfo lies in
+      // the head room in front of the data
+      int32_t head_len = 0 == read_offset ? FILEINFO_SIZE : 0;
+      int ret = TFS_SUCCESS;
+      char* packet_data = resp_rd_msg->alloc_data(real_read_len - head_len, head_len);
+      if (real_read_len > 0 && NULL == packet_data)
+      {
+        TBSYS_LOG(ERROR, "alloc data failed, blockid: %u, fileid: %" PRI64_PREFIX "u, real len: %d",
+            block_id, file_id, real_read_len);
+        ret = TFS_ERROR;
+      }
+      else
+      {
+        ret = data_management_.read_data(block_id, file_id, read_offset, flag, real_read_len, packet_data);
+      }
+
       if (TFS_SUCCESS != ret)
       {
         try_add_repair_task(block_id, ret);
-        tbsys::gDeleteA(tmp_data_buffer);
         resp_rd_msg->set_length(ret);
         message->reply(resp_rd_msg);
       }
       else
       {
+        int32_t visit_file_size = 0;
         if (0 == read_offset)
         {
           real_read_len -= FILEINFO_SIZE;
+          visit_file_size = reinterpret_cast<FileInfo*>(packet_data)->size_;
         }
+        resp_rd_msg->set_length(real_read_len);
 
-        int32_t visit_file_size = reinterpret_cast<FileInfo *>(tmp_data_buffer)->size_;
-        char* packet_data = resp_rd_msg->alloc_data(real_read_len);
-        if (0 != real_read_len)
-        {
-          if (NULL == packet_data)
-          {
-            tbsys::gDelete(resp_rd_msg);
-            tbsys::gDeleteA(tmp_data_buffer);
-            TBSYS_LOG(ERROR, "alloc data failed, blockid: %u, fileid: %" PRI64_PREFIX "u, real len: %d",
-                block_id, file_id, real_read_len);
-            ret = TFS_ERROR;
-          }
-
-          if (TFS_SUCCESS == ret)
-          {
-            if (0 == read_offset)
-            {
-              memcpy(packet_data, tmp_data_buffer + FILEINFO_SIZE, real_read_len);
-            }
-            else
-            {
-              memcpy(packet_data, tmp_data_buffer, real_read_len);
-            }
-          }
-        }
-
-        if (TFS_SUCCESS == ret)
-        {
-          // set to connection
-          message->reply(resp_rd_msg);
-          tbsys::gDeleteA(tmp_data_buffer);
-          do_stat(peer_id, visit_file_size, real_read_len, read_offset, AccessStat::READ_BYTES);
-        }
+        // set to connection
+        message->reply(resp_rd_msg);
+        do_stat(peer_id, visit_file_size, real_read_len, read_offset, AccessStat::READ_BYTES);
       }
 
       TIMER_END();
@@ -1467,6 +1579,101 @@ namespace tfs
       return ret;
     }
 
+    int DataService::batch_read_data(BatchReadDataMessage* message)
+    {
+      TIMER_START();
+      const std::vector<ReadDataInfo>& read_infos = message->get_read_infos();
+      uint64_t peer_id = message->get_connection()->getPeerId();
+      int8_t flag = message->get_flag();
+
+      // offset and length of every file are changed the same way as read_data
+      std::vector<BatchReadItem> items(read_infos.size());
+      int64_t total_len = 0;
+      int ret = TFS_SUCCESS;
+      for (uint32_t i = 0; i < read_infos.size() && TFS_SUCCESS == ret; ++i)
+      {
+        const ReadDataInfo& read_info = read_infos[i];
+        BatchReadItem& item = items[i];
+        item.inner_file_id_ = read_info.file_id_;
+        item.offset_ = 0 == read_info.offset_ ? 0 : read_info.offset_ + FILEINFO_SIZE;
+        item.nbytes_ = 0 == read_info.offset_ ? read_info.length_ + FILEINFO_SIZE : read_info.length_;
+        item.data_offset_ = 0;
+        item.ret_ = TFS_SUCCESS;
+        ret = read_info.offset_ < 0 || read_info.length_ < 0 ? EXIT_INVALID_ARGU : TFS_SUCCESS;
+        total_len += item.nbytes_;
+      }
+      if (TFS_SUCCESS == ret && total_len > MAX_BATCH_READ_SIZE)
+      {
+        ret = EXIT_INVALID_ARGU;
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "invalid batch read, file count: %u, total len: %" PRI64_PREFIX "d, peer ip: %s",
+            static_cast<uint32_t>(read_infos.size()), total_len, tbsys::CNetUtil::addrToString(peer_id).c_str());
+        return ret;
+      }
+
+      // files of all blocks are read into one reply packet
+      RespBatchReadDataMessage* resp_brd_msg = new RespBatchReadDataMessage();
+      char* packet_data = resp_brd_msg->alloc_data(total_len);
+      if (total_len > 0 && NULL == packet_data)
+      {
+        TBSYS_LOG(ERROR, "alloc data failed, total len: %" PRI64_PREFIX "d", total_len);
+        tbsys::gDelete(resp_brd_msg);
+        return TFS_ERROR;
+      }
+
+      std::map<uint32_t, std::vector<BatchReadItem*> > block_items;
+      for (uint32_t i = 0; i < items.size(); ++i)
+      {
+        items[i].buf_ = packet_data;
+        packet_data += items[i].nbytes_;
+        block_items[read_infos[i].block_id_].push_back(&items[i]);
+      }
+      for (std::map<uint32_t, std::vector<BatchReadItem*> >::iterator it = block_items.begin();
+          it != block_items.end(); ++it)
+      {
+        data_management_.batch_read_data(it->first, it->second, flag);
+      }
+
+      int32_t success_count = 0;
+      for (uint32_t i = 0; i < items.size(); ++i)
+      {
+        BatchReadItem& item = items[i];
+        if (TFS_SUCCESS != item.ret_)
+        {
+          try_add_repair_task(read_infos[i].block_id_, item.ret_);
+          resp_brd_msg->add_data(item.ret_, NULL);
+        }
+        else
+        {
+          int32_t head_len = 0 == item.offset_ ? FILEINFO_SIZE : 0;
+          int32_t visit_file_size = 0 == head_len ? 0 : reinterpret_cast<FileInfo*>(item.buf_)->size_;
+          resp_brd_msg->add_data(item.nbytes_ - head_len, item.buf_ + head_len,
+              0 == head_len ? 0 : visit_file_size - head_len);
+          do_stat(peer_id, visit_file_size, item.nbytes_ - head_len, item.offset_, AccessStat::READ_BYTES);
+          ++success_count;
+        }
+      }
+      message->reply(resp_brd_msg);
+
+      TIMER_END();
+      TBSYS_LOG(INFO, "batch read. file count: %u, success count: %d, peer ip: %s, cost time: %" PRI64_PREFIX "d",
+          static_cast<uint32_t>(items.size()), success_count, tbsys::CNetUtil::addrToString(peer_id).c_str(),
+          TIMER_DURATION());
+
+      stat_mgr_.update_entry(tfs_ds_stat_, "read-success", success_count);
+      stat_mgr_.update_entry(tfs_ds_stat_, "read-failed", items.size() - success_count);
+
+      read_stat_mutex_.lock();
+      for (uint32_t i = 0; i < read_infos.size(); ++i)
+      {
+        read_stat_buffer_.push_back(make_pair(read_infos[i].block_id_, read_infos[i].file_id_));
+      }
+      read_stat_mutex_.unlock();
+      return TFS_SUCCESS;
+    }
+
     int DataService::read_raw_data(ReadRawDataMessage* message)
     {
       RespReadRawDataMessage* resp_rrd_msg = new RespReadRawDataMessage();
@@ -1476,36 +1683,29 @@ namespace tfs
 
       TBSYS_LOG(DEBUG, "blockid: %u read data batch, read size: %d, offset: %d", block_id, read_len, read_offset);
 
-      char* tmp_data_buffer = new char[read_len];
+      // read straight into the reply packet, no intermediate buffer
       int32_t real_read_len = read_len;
-      int ret = data_management_.read_raw_data(block_id, read_offset, real_read_len, tmp_data_buffer);
+      int ret = TFS_SUCCESS;
+      char* packet_data = resp_rrd_msg->alloc_data(read_len);
+      if (0 != read_len && NULL == packet_data)
+      {
+        TBSYS_LOG(ERROR, "allocdata fail, blockid: %u, realreadlen: %d", block_id, read_len);
+        ret = TFS_ERROR;
+      }
+      else
+      {
+        ret = data_management_.read_raw_data(block_id, read_offset, real_read_len, packet_data);
+      }
       if (TFS_SUCCESS != ret)
       {
         try_add_repair_task(block_id, ret);
-        tbsys::gDeleteA(tmp_data_buffer);
         resp_rrd_msg->set_length(ret);
         message->reply(resp_rrd_msg);
         return ret;
       }
 
-      char* packet_data = resp_rrd_msg->alloc_data(real_read_len);
-      if (0 != real_read_len)
-      {
-        if (NULL == packet_data)
-        {
-          tbsys::gDelete(resp_rrd_msg);
-          tbsys::gDeleteA(tmp_data_buffer);
-          TBSYS_LOG(ERROR, "allocdata fail, blockid: %u, realreadlen: %" PRI64_PREFIX "d", block_id, real_read_len);
-          return TFS_ERROR;
-        }
-        else
-        {
-          memcpy(packet_data, tmp_data_buffer, real_read_len);
-        }
-      }
-      message->set_length(real_read_len);
+      resp_rrd_msg->set_length(real_read_len);
       message->reply(resp_rrd_msg);
-      tbsys::gDeleteA(tmp_data_buffer);
 
       do_stat(0, 0, real_read_len, read_offset, AccessStat::READ_COUNT);
 
@@ -1728,6 +1928,7 @@ namespace tfs
       cblk->block_id_ = message->get_block_id();
       cblk->owner_ = message->get_owner();
       cblk->preserve_time_ = message->get_preserve_time();
+      cblk->mode_ = message->get_mode();
       uint64_t peer_id = message->get_connection()->getPeerId();
 
       int ret = compact_block_->add_cpt_task(cblk);
@@ -1908,6 +2109,12 @@ namespace tfs
         return TFS_SUCCESS;
       }
 
+      else if (GSS_INDEX_MAP_INFO == type)
+      {
+        message->reply(new StatusMessage(STATUS_MESSAGE_OK, IndexMapManager::get_instance()->format_stat().c_str()));
+        return TFS_SUCCESS;
+      }
+
       return message->reply_error_packet(TBSYS_LOG_LEVEL(ERROR), STATUS_MESSAGE_ERROR,
           "get server status type unsupport: %d", type);
     }
@@ -1960,6 +2167,8 @@ namespace tfs
         {
           need_send_blockinfo_[0] = true;
           need_send_blockinfo_[1] = true;
+          block_reporter_.reset(0);
+          block_reporter_.reset(1);
         }
       }
       while (0);
@@ -2038,6 +2247,14 @@ namespace tfs
       TBSYS_LOG(DEBUG, "writeblockdatafile start, blockid: %u, len: %d, offset: %d, new flag: %d, peer id: %s",
           block_id, msg_len, data_offset, new_flag, tbsys::CNetUtil::addrToString(peer_id).c_str());
 
+      uint32_t data_crc = 0;
+      if (message->get_data_crc(data_crc) && Func::crc(0, data_buffer, msg_len) != data_crc)
+      {
+        return message->reply_error_packet(TBSYS_LOG_LEVEL(ERROR), EXIT_CHECK_CRC_ERROR,
+            "write data batch fail, crc error, blockid: %u, offset: %d, len: %d, crc: %u",
+            block_id, data_offset, msg_len, data_crc);
+      }
+
       int ret = 0;
       if (new_flag)
       {
@@ -2052,7 +2269,9 @@ namespace tfs
         repl_block_->add_cloned_block_map(block_id);
       }
 
-      ret = data_management_.write_raw_data(block_id, data_offset, msg_len, data_buffer);
+      // the replica being received is not read by clients yet
+      ret = data_management_.write_raw_data(block_id, data_offset, msg_len, data_buffer,
+          DiskManager::get_instance()->get_io_scheduler(block_id)->get_io_policy(IO_CLASS_REPLICATE));
       if (TFS_SUCCESS != ret)
       {
         return message->reply_error_packet(TBSYS_LOG_LEVEL(ERROR), ret,
@@ -2126,11 +2345,14 @@ namespace tfs
 
           SuperBlock block;
           memset(&block, 0, sizeof(block));
-          iret = BlockFileManager::get_instance()->query_super_block(block);
+          iret = DiskManager::get_instance()->query_super_block(block);
           if (TFS_SUCCESS == iret)
           {
             reply_msg->set_super_block(block);
             reply_msg->set_dataserver_stat_info(data_server_info_);
+            ReadCacheStat cache_stat;
+            FileCache::get_instance()->get_stat(cache_stat);
+            reply_msg->set_read_cache_stat(cache_stat);
             iret = packet->reply(reply_msg);
           }
           else
@@ -2156,18 +2378,23 @@ namespace tfs
       bool reset_need_send_blockinfo_flag = data_management_.get_all_logic_block_size() <= 0;
       SetDataserverMessage req_sds_msg;
       req_sds_msg.set_ds(&data_server_info_);
+      int64_t report_seq = 0;
       if (need_send_blockinfo_[who])
       {
         reset_need_send_blockinfo_flag = true;
-        req_sds_msg.set_has_block(HAS_BLOCK_FLAG_YES);
 
         list<LogicBlock*> logic_block_list;
         data_management_.get_all_logic_block(logic_block_list);
+        std::vector<BlockInfo> blocks;
+        blocks.reserve(logic_block_list.size());
         for (list<LogicBlock*>::iterator lit = logic_block_list.begin(); lit != logic_block_list.end(); ++lit)
         {
           TBSYS_LOG(DEBUG, "send block to ns: %d, blockid: %u\n", who, (*lit)->get_logic_block_id());
-          req_sds_msg.add_block((*lit)->get_block_info());
+          blocks.push_back(*(*lit)->get_block_info());
         }
+        // only the blocks changed since the report ns acked, if it still holds that one
+        block_reporter_.build_report(who, blocks, req_sds_msg);
+        report_seq = req_sds_msg.get_report_seq();
       }
       tbnet::Packet* message = NULL;
       NewClient* client = NewClientManager::get_instance().create_client();
@@ -2178,6 +2405,7 @@ namespace tfs
           if (RESP_HEART_MESSAGE == message->getPCode())
           {
             RespHeartMessage* resp_hb_msg = dynamic_cast<RespHeartMessage*>(message);
+            block_reporter_.on_response(who, report_seq, resp_hb_msg->get_report_seq());
             if (reset_need_send_blockinfo_flag
                 && need_send_blockinfo_[who])
             {
@@ -2321,11 +2549,22 @@ namespace tfs
       service_.compact_block_->run_compact_block();
     }
 
+    void DataService::ScrubBlockThreadHelper::run()
+    {
+      service_.block_scrubber_.run_scrub();
+    }
+
     void DataService::DoSyncMirrorThreadHelper::run()
     {
       service_.sync_mirror_->run_sync_mirror();
     }
 
+    void DataService::IOPacketTask::run()
+    {
+      service_.process_packet(packet_);
+      packet_->free();
+    }
+
     int ds_async_callback(common::NewClient* client)
     {
       DataService* service = dynamic_cast<DataService*>(BaseMain::instance());
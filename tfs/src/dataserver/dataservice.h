@@ -35,6 +35,10 @@
 #include "data_management.h"
 #include "requester.h"
 #include "block_checker.h"
+#include "io_scheduler.h"
+#include "index_map_manager.h"
+#include "block_scrubber.h"
+#include "block_reporter.h"
 
 namespace tfs
 {
@@ -112,6 +116,8 @@ namespace tfs
         int run_heart();
         int run_check();
 
+        int get_io_class(tbnet::Packet* packet, uint32_t& block_id) const;
+        int process_packet(tbnet::Packet* packet);
         int create_file_number(message::CreateFilenameMessage* message);
         int write_data(message::WriteDataMessage* message);
         int close_write_file(message::CloseFileMessage* message);
@@ -121,6 +127,7 @@ namespace tfs
 
         int read_data(message::ReadDataMessage* message);
         int read_data_extra(message::ReadDataMessageV2* message, int32_t version);
+        int batch_read_data(message::BatchReadDataMessage* message);
         int read_raw_data(message::ReadRawDataMessage* message);
         int read_file_info(message::FileInfoMessage* message);
 
@@ -225,6 +232,22 @@ namespace tfs
       };
       typedef tbutil::Handle<CompactBlockThreadHelper> CompactBlockThreadHelperPtr;
 
+      class ScrubBlockThreadHelper: public tbutil::Thread
+      {
+        public:
+          explicit ScrubBlockThreadHelper(DataService& service):
+              service_(service)
+          {
+            start();
+          }
+          virtual ~ScrubBlockThreadHelper(){}
+          void run();
+        private:
+          DISALLOW_COPY_AND_ASSIGN(ScrubBlockThreadHelper);
+          DataService& service_;
+      };
+      typedef tbutil::Handle<ScrubBlockThreadHelper> ScrubBlockThreadHelperPtr;
+
       class DoSyncMirrorThreadHelper: public tbutil::Thread
       {
         public:
@@ -241,6 +264,22 @@ namespace tfs
       };
       typedef tbutil::Handle<DoSyncMirrorThreadHelper> DoSyncMirrorThreadHelperPtr;
 
+      // packet processed in an io thread of IOScheduler
+      class IOPacketTask: public IOTask
+      {
+        public:
+          IOPacketTask(DataService& service, tbnet::Packet* packet):
+              service_(service), packet_(packet)
+          {
+          }
+          virtual ~IOPacketTask(){}
+          void run();
+        private:
+          DISALLOW_COPY_AND_ASSIGN(IOPacketTask);
+          DataService& service_;
+          tbnet::Packet* packet_;
+      };
+
       private:
         DISALLOW_COPY_AND_ASSIGN(DataService);
 
@@ -249,6 +288,8 @@ namespace tfs
         DataManagement data_management_;
         Requester ds_requester_;
         BlockChecker block_checker_;
+        BlockScrubber block_scrubber_;
+        BlockReporter block_reporter_;
 
         int32_t server_local_port_;
         bool need_send_blockinfo_[2];
@@ -287,7 +328,8 @@ namespace tfs
         HeartBeatThreadHelperPtr heartbeat_thread_;
         DoCheckThreadHelperPtr   do_check_thread_;
         ReplicateBlockThreadHelperPtr* replicate_block_threads_;
-        CompactBlockThreadHelperPtr  compact_block_thread_;
+        CompactBlockThreadHelperPtr* compact_block_threads_;
+        ScrubBlockThreadHelperPtr scrub_block_thread_;
         DoSyncMirrorThreadHelperPtr  do_sync_mirror_thread_;
 
         std::string read_stat_log_file_;
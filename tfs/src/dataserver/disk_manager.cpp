@@ -0,0 +1,348 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "disk_manager.h"
+#include <tbsys.h>
+#include <Memory.hpp>
+#include "common/error_msg.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+    using namespace std;
+
+    DiskManager::DiskManager()
+    {
+    }
+
+    DiskManager::~DiskManager()
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        tbsys::gDelete(disks_[i].io_scheduler_);
+        tbsys::gDelete(disks_[i].block_manager_);
+      }
+    }
+
+    int DiskManager::bootstrap(const FileSystemParameter& fs_param)
+    {
+      if (!disks_.empty())
+      {
+        return EXIT_INVALID_ARGU;
+      }
+      vector<FileSystemParameter> disk_params;
+      fs_param.get_disks(disk_params);
+      int ret = TFS_SUCCESS;
+      for (uint32_t i = 0; TFS_SUCCESS == ret && i < disk_params.size(); ++i)
+      {
+        Disk disk;
+        disk.fs_param_ = disk_params[i];
+        disk.block_manager_ = new BlockFileManager();
+        disk.io_scheduler_ = new IOScheduler();
+        disks_.push_back(disk);
+
+        TBSYS_LOG(INFO, "bootstrap disk %u, mount name: %s, index path: %s", i, disk.fs_param_.mount_name_.c_str(),
+            disk.fs_param_.get_index_path().c_str());
+        ret = disk.block_manager_->bootstrap(disk.fs_param_);
+        if (TFS_SUCCESS != ret)
+        {
+          TBSYS_LOG(ERROR, "bootstrap disk fail, mount name: %s, ret: %d", disk.fs_param_.mount_name_.c_str(), ret);
+        }
+      }
+      return ret;
+    }
+
+    int DiskManager::initialize_io(const int32_t thread_count, const int32_t max_queue_size)
+    {
+      int ret = TFS_SUCCESS;
+      for (uint32_t i = 0; TFS_SUCCESS == ret && i < disks_.size(); ++i)
+      {
+        ret = disks_[i].io_scheduler_->initialize(disks_[i].fs_param_.mount_name_, thread_count, max_queue_size);
+      }
+      return ret;
+    }
+
+    void DiskManager::stop_io()
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        disks_[i].io_scheduler_->stop();
+      }
+    }
+
+    void DiskManager::wait_io()
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        disks_[i].io_scheduler_->wait();
+      }
+    }
+
+    void DiskManager::set_io_policy(const IOClass io_class, const IOPolicy policy)
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        disks_[i].io_scheduler_->set_io_policy(io_class, policy);
+      }
+      inline_scheduler_.set_io_policy(io_class, policy);
+    }
+
+    void DiskManager::dump_io_stat()
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        if (disks_[i].io_scheduler_->enabled())
+        {
+          disks_[i].io_scheduler_->dump_stat();
+        }
+      }
+    }
+
+    void DiskManager::get_io_stat(const IOClass io_class, IOClassStat& stat)
+    {
+      memset(&stat, 0, sizeof(stat));
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        IOClassStat disk_stat;
+        disks_[i].io_scheduler_->get_stat(io_class, disk_stat);
+        stat.queue_depth_ += disk_stat.queue_depth_;
+        stat.count_ += disk_stat.count_;
+        stat.wait_time_ += disk_stat.wait_time_;
+        stat.service_time_ += disk_stat.service_time_;
+      }
+    }
+
+    IOScheduler* DiskManager::get_io_scheduler(const uint32_t logic_block_id)
+    {
+      int32_t index = find_disk(logic_block_id);
+      return index >= 0 ? disks_[index].io_scheduler_ : &inline_scheduler_;
+    }
+
+    int32_t DiskManager::find_disk(const uint32_t logic_block_id, const BlockType block_type)
+    {
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        if (disks_[i].block_manager_->has_logic_block(logic_block_id, block_type))
+        {
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    // the disk with the most free main blocks
+    int32_t DiskManager::choose_new_disk()
+    {
+      int32_t index = -1;
+      int32_t max_free = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        SuperBlock super_block;
+        disks_[i].block_manager_->query_super_block(super_block);
+        int32_t free_count = super_block.main_block_count_ - super_block.used_block_count_;
+        if (free_count > max_free)
+        {
+          max_free = free_count;
+          index = i;
+        }
+      }
+      return index;
+    }
+
+    int DiskManager::new_block(const uint32_t logic_block_id, uint32_t& physical_block_id, const BlockType block_type)
+    {
+      tbutil::Mutex::Lock lock(new_block_mutex_);
+      int32_t index = -1;
+      if (C_COMPACT_BLOCK == block_type)
+      {
+        // compacted to the disk of the block, it takes the place of the block when done
+        index = find_disk(logic_block_id, C_MAIN_BLOCK);
+        if (index < 0)
+        {
+          TBSYS_LOG(ERROR, "new compact block, logic block not found. logic blockid: %u", logic_block_id);
+          return EXIT_NO_LOGICBLOCK_ERROR;
+        }
+      }
+      else
+      {
+        // one that exists is refused by its disk
+        index = find_disk(logic_block_id, block_type);
+        if (index < 0)
+        {
+          index = choose_new_disk();
+        }
+        if (index < 0)
+        {
+          TBSYS_LOG(ERROR, "new block, no free block on any disk. logic blockid: %u", logic_block_id);
+          return EXIT_BLOCK_EXHAUST_ERROR;
+        }
+      }
+      return disks_[index].block_manager_->new_block(logic_block_id, physical_block_id, block_type);
+    }
+
+    int DiskManager::del_block(const uint32_t logic_block_id, const BlockType block_type)
+    {
+      int32_t index = find_disk(logic_block_id, block_type);
+      if (index < 0)
+      {
+        TBSYS_LOG(ERROR, "can not find logic blockid: %u. blocktype: %d when delete block", logic_block_id,
+            block_type);
+        return EXIT_NO_LOGICBLOCK_ERROR;
+      }
+      return disks_[index].block_manager_->del_block(logic_block_id, block_type);
+    }
+
+    LogicBlock* DiskManager::get_logic_block(const uint32_t logic_block_id, const BlockType block_type)
+    {
+      int32_t index = find_disk(logic_block_id, block_type);
+      return index >= 0 ? disks_[index].block_manager_->get_logic_block(logic_block_id, block_type) : NULL;
+    }
+
+    LogicBlock* DiskManager::scan_logic_block(const uint32_t logic_block_id, bool& loaded)
+    {
+      loaded = false;
+      int32_t index = find_disk(logic_block_id, C_MAIN_BLOCK);
+      return index >= 0 ? disks_[index].block_manager_->scan_logic_block(logic_block_id, loaded) : NULL;
+    }
+
+    int DiskManager::get_all_logic_block(list<LogicBlock*>& logic_block_list, const BlockType block_type)
+    {
+      logic_block_list.clear();
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        list<LogicBlock*> disk_blocks;
+        disks_[i].block_manager_->get_all_logic_block(disk_blocks, block_type);
+        logic_block_list.splice(logic_block_list.end(), disk_blocks);
+      }
+      return TFS_SUCCESS;
+    }
+
+    int64_t DiskManager::get_all_logic_block_size(const BlockType block_type)
+    {
+      int64_t size = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        size += disks_[i].block_manager_->get_all_logic_block_size(block_type);
+      }
+      return size;
+    }
+
+    int DiskManager::get_logic_block_ids(VUINT& logic_block_ids, const BlockType block_type)
+    {
+      logic_block_ids.clear();
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        VUINT disk_ids;
+        disks_[i].block_manager_->get_logic_block_ids(disk_ids, block_type);
+        logic_block_ids.insert(logic_block_ids.end(), disk_ids.begin(), disk_ids.end());
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::query_super_block(SuperBlock& super_block_info)
+    {
+      if (disks_.empty())
+      {
+        return EXIT_NO_LOGICBLOCK_ERROR;
+      }
+      disks_[0].block_manager_->query_super_block(super_block_info);
+      for (uint32_t i = 1; i < disks_.size(); ++i)
+      {
+        SuperBlock super_block;
+        disks_[i].block_manager_->query_super_block(super_block);
+        super_block_info.mount_point_use_space_ += super_block.mount_point_use_space_;
+        super_block_info.main_block_count_ += super_block.main_block_count_;
+        super_block_info.extend_block_count_ += super_block.extend_block_count_;
+        super_block_info.used_block_count_ += super_block.used_block_count_;
+        super_block_info.used_extend_block_count_ += super_block.used_extend_block_count_;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::query_approx_block_count(int32_t& block_count)
+    {
+      block_count = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        int32_t disk_count = 0;
+        disks_[i].block_manager_->query_approx_block_count(disk_count);
+        block_count += disk_count;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::query_bit_map(char** bit_map_buffer, int32_t& bit_map_len, int32_t& set_count,
+        const BitMapType bitmap_type)
+    {
+      vector<char*> buffers(disks_.size(), static_cast<char*>(NULL));
+      vector<int32_t> lens(disks_.size(), 0);
+      bit_map_len = 0;
+      set_count = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        int32_t disk_set_count = 0;
+        disks_[i].block_manager_->query_bit_map(&buffers[i], lens[i], disk_set_count, bitmap_type);
+        bit_map_len += lens[i];
+        set_count += disk_set_count;
+      }
+
+      *bit_map_buffer = new char[bit_map_len];
+      int32_t pos = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        memcpy(*bit_map_buffer + pos, buffers[i], lens[i]);
+        pos += lens[i];
+        tbsys::gDeleteA(buffers[i]);
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::query_space(int64_t& used_bytes, int64_t& total_bytes)
+    {
+      used_bytes = 0;
+      total_bytes = 0;
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        int64_t disk_used = 0, disk_total = 0;
+        disks_[i].block_manager_->query_space(disk_used, disk_total);
+        used_bytes += disk_used;
+        total_bytes += disk_total;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::switch_compact_blk(const uint32_t block_id)
+    {
+      int32_t index = find_disk(block_id, C_COMPACT_BLOCK);
+      return index >= 0 ? disks_[index].block_manager_->switch_compact_blk(block_id) : EXIT_COMPACT_BLOCK_ERROR;
+    }
+
+    int DiskManager::expire_compact_blk(const time_t time, set<uint32_t>& erase_blocks)
+    {
+      erase_blocks.clear();
+      for (uint32_t i = 0; i < disks_.size(); ++i)
+      {
+        set<uint32_t> disk_blocks;
+        disks_[i].block_manager_->expire_compact_blk(time, disk_blocks);
+        erase_blocks.insert(disk_blocks.begin(), disk_blocks.end());
+      }
+      return TFS_SUCCESS;
+    }
+
+    int DiskManager::set_error_bitmap(const uint32_t logic_block_id, const set<uint32_t>& error_blocks)
+    {
+      int32_t index = find_disk(logic_block_id, C_MAIN_BLOCK);
+      return index >= 0 ? disks_[index].block_manager_->set_error_bitmap(error_blocks) : EXIT_NO_LOGICBLOCK_ERROR;
+    }
+  }
+}
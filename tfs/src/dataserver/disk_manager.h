@@ -0,0 +1,108 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_DISKMANAGER_H_
+#define TFS_DATASERVER_DISKMANAGER_H_
+
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+#include <Mutex.h>
+#include "common/internal.h"
+#include "common/parameter.h"
+#include "blockfile_manager.h"
+#include "io_scheduler.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // the mount points served by this dataserver. every disk has its own BlockFileManager,
+    // super block and IOScheduler, so the io of one disk queues apart from the others.
+    // a block is on one disk, calls about it go to the disk it is on. a new block goes to
+    // the disk with the most free main blocks, its compact block to the same disk.
+    class DiskManager
+    {
+      public:
+        DiskManager();
+        ~DiskManager();
+
+        static DiskManager* get_instance()
+        {
+          static DiskManager s_disk_manager;
+          return &s_disk_manager;
+        }
+
+        // a disk for each mount point of fs_param, then load the blocks of all
+        int bootstrap(const common::FileSystemParameter& fs_param);
+        // an io scheduler for each disk, thread_count threads each
+        int initialize_io(const int32_t thread_count, const int32_t max_queue_size);
+        void stop_io();
+        void wait_io();
+        void set_io_policy(const IOClass io_class, const IOPolicy policy);
+        void dump_io_stat();
+        // stat of a class summed over the disks
+        void get_io_stat(const IOClass io_class, IOClassStat& stat);
+
+        inline int32_t get_disk_count() const
+        {
+          return static_cast<int32_t>(disks_.size());
+        }
+        // of the disk the block is on. a block on no disk gets a scheduler without
+        // io threads, its io runs in the calling thread
+        IOScheduler* get_io_scheduler(const uint32_t logic_block_id);
+        // the disk the block is on, -1 if none
+        int32_t find_disk(const uint32_t logic_block_id, const BlockType block_type = C_CONFUSE_BLOCK);
+
+        int new_block(const uint32_t logic_block_id, uint32_t& physical_block_id, const BlockType block_type =
+            C_MAIN_BLOCK);
+        int del_block(const uint32_t logic_block_id, const BlockType block_type = C_MAIN_BLOCK);
+
+        LogicBlock* get_logic_block(const uint32_t logic_block_id, const BlockType block_type = C_MAIN_BLOCK);
+        LogicBlock* scan_logic_block(const uint32_t logic_block_id, bool& loaded);
+        int get_all_logic_block(std::list<LogicBlock*>& logic_block_list, const BlockType block_type = C_MAIN_BLOCK);
+        int64_t get_all_logic_block_size(const BlockType block_type = C_MAIN_BLOCK);
+        int get_logic_block_ids(common::VUINT& logic_block_ids, const BlockType block_type = C_MAIN_BLOCK);
+
+        // counts and space are summed over the disks, the other fields are of the first disk
+        int query_super_block(common::SuperBlock& super_block_info);
+        int query_approx_block_count(int32_t& block_count);
+        // bitmaps of the disks one after another
+        int query_bit_map(char** bit_map_buffer, int32_t& bit_map_len, int32_t& set_count, const BitMapType bitmap_type =
+            C_ALLOCATE_BLOCK);
+        int query_space(int64_t& used_bytes, int64_t& total_bytes);
+
+        int switch_compact_blk(const uint32_t block_id);
+        int expire_compact_blk(const time_t time, std::set<uint32_t>& erase_blocks);
+
+        // physical blocks of logic block
+        int set_error_bitmap(const uint32_t logic_block_id, const std::set<uint32_t>& error_blocks);
+
+      private:
+        struct Disk
+        {
+          common::FileSystemParameter fs_param_;
+          BlockFileManager* block_manager_;
+          IOScheduler* io_scheduler_;
+        };
+
+        DISALLOW_COPY_AND_ASSIGN(DiskManager);
+        int32_t choose_new_disk();
+
+      private:
+        std::vector<Disk> disks_;
+        IOScheduler inline_scheduler_; // of blocks on no disk, never has io threads
+        tbutil::Mutex new_block_mutex_; // a block id is looked up on all disks before one creates it
+    };
+  }
+}
+#endif //TFS_DATASERVER_DISKMANAGER_H_
@@ -0,0 +1,226 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "file_cache.h"
+#include "dataserver_define.h"
+#include "common/error_msg.h"
+#include <tbsys.h>
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+
+    FileCache::FileCache() :
+      capacity_(0), shard_capacity_(0), max_file_size_(0), admit_visit_count_(0)
+    {
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        shards_[i].used_size_ = 0;
+        shards_[i].hit_count_ = 0;
+        shards_[i].miss_count_ = 0;
+        shards_[i].evict_count_ = 0;
+      }
+    }
+
+    FileCache::~FileCache()
+    {
+      clear();
+    }
+
+    int FileCache::initialize(const int64_t capacity, const int32_t max_file_size, const int32_t admit_visit_count)
+    {
+      if (capacity < 0 || max_file_size < 0)
+      {
+        TBSYS_LOG(ERROR, "invalid read cache parameter, capacity: %" PRI64_PREFIX "d, max file size: %d",
+            capacity, max_file_size);
+        return EXIT_INVALID_ARGU;
+      }
+      clear();
+      capacity_ = capacity;
+      shard_capacity_ = capacity / SHARD_COUNT;
+      max_file_size_ = max_file_size + FILEINFO_SIZE;
+      admit_visit_count_ = admit_visit_count;
+      TBSYS_LOG(INFO, "read cache %s, capacity: %" PRI64_PREFIX "d, max file size: %d, admit visit count: %d",
+          enabled() ? "enabled" : "disabled", capacity_, max_file_size, admit_visit_count_);
+      return TFS_SUCCESS;
+    }
+
+    int FileCache::get(const uint32_t block_id, const uint64_t file_id, const int32_t offset, char* buf,
+        int32_t& nbytes, uint64_t& generation)
+    {
+      CacheShard& shard = get_shard(block_id);
+      CacheKey key;
+      key.block_id_ = block_id;
+      key.file_id_ = file_id;
+
+      tbutil::Mutex::Lock lock(shard.mutex_);
+      CacheMap::iterator mit = shard.map_.find(key);
+      if (mit == shard.map_.end())
+      {
+        ++shard.miss_count_;
+        GenerationMap::const_iterator git = shard.generation_.find(block_id);
+        generation = git == shard.generation_.end() ? 0 : git->second;
+        return EXIT_META_NOT_FOUND_ERROR;
+      }
+
+      CacheList::iterator it = mit->second;
+      // truncate to right read length, the same as LogicBlock::read_file
+      if (offset > it->length_)
+      {
+        return EXIT_READ_OFFSET_ERROR;
+      }
+      if (offset + nbytes > it->length_)
+      {
+        nbytes = it->length_ - offset;
+      }
+      memcpy(buf, it->data_ + offset, nbytes);
+      ++shard.hit_count_;
+      if (it != shard.lru_.begin())
+      {
+        shard.lru_.splice(shard.lru_.begin(), shard.lru_, it);
+      }
+      return TFS_SUCCESS;
+    }
+
+    int FileCache::put(const uint32_t block_id, const uint64_t file_id, const char* data, const int32_t len,
+        const int32_t block_visit_count, const uint64_t generation)
+    {
+      if (!enabled() || len < FILEINFO_SIZE || len > max_file_size_ || len > shard_capacity_
+          || block_visit_count < admit_visit_count_)
+      {
+        return TFS_ERROR;
+      }
+      // only normal files, so a cached file always passes the FileInfo check of read
+      const FileInfo* finfo = reinterpret_cast<const FileInfo*>(data);
+      if (finfo->id_ != file_id || 0 != finfo->flag_ || finfo->size_ != len)
+      {
+        return TFS_ERROR;
+      }
+
+      CacheShard& shard = get_shard(block_id);
+      CacheKey key;
+      key.block_id_ = block_id;
+      key.file_id_ = file_id;
+
+      tbutil::Mutex::Lock lock(shard.mutex_);
+      GenerationMap::const_iterator git = shard.generation_.find(block_id);
+      if ((git == shard.generation_.end() ? 0 : git->second) != generation
+          || shard.map_.find(key) != shard.map_.end())
+      {
+        return TFS_ERROR;
+      }
+
+      while (shard.used_size_ + len > shard_capacity_ && !shard.lru_.empty())
+      {
+        CacheList::iterator last = shard.lru_.end();
+        remove(shard, --last);
+        ++shard.evict_count_;
+      }
+
+      CacheEntry entry;
+      entry.key_ = key;
+      entry.length_ = len;
+      entry.data_ = new char[len];
+      memcpy(entry.data_, data, len);
+      shard.lru_.push_front(entry);
+      shard.map_[key] = shard.lru_.begin();
+      shard.used_size_ += len;
+      return TFS_SUCCESS;
+    }
+
+    void FileCache::erase(const uint32_t block_id, const uint64_t file_id)
+    {
+      if (!enabled())
+      {
+        return;
+      }
+      CacheShard& shard = get_shard(block_id);
+      CacheKey key;
+      key.block_id_ = block_id;
+      key.file_id_ = file_id;
+
+      tbutil::Mutex::Lock lock(shard.mutex_);
+      bump_generation(shard, block_id);
+      CacheMap::iterator mit = shard.map_.find(key);
+      if (mit != shard.map_.end())
+      {
+        remove(shard, mit->second);
+      }
+    }
+
+    void FileCache::erase_block(const uint32_t block_id)
+    {
+      if (!enabled())
+      {
+        return;
+      }
+      CacheShard& shard = get_shard(block_id);
+      tbutil::Mutex::Lock lock(shard.mutex_);
+      bump_generation(shard, block_id);
+      CacheList::iterator it = shard.lru_.begin();
+      while (it != shard.lru_.end())
+      {
+        CacheList::iterator cur = it++;
+        if (cur->key_.block_id_ == block_id)
+        {
+          remove(shard, cur);
+        }
+      }
+    }
+
+    void FileCache::clear()
+    {
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        CacheShard& shard = shards_[i];
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        for (CacheList::iterator it = shard.lru_.begin(); it != shard.lru_.end(); ++it)
+        {
+          tbsys::gDeleteA(it->data_);
+        }
+        shard.lru_.clear();
+        shard.map_.clear();
+        shard.used_size_ = 0;
+      }
+    }
+
+    void FileCache::get_stat(ReadCacheStat& stat)
+    {
+      memset(&stat, 0, sizeof(stat));
+      stat.capacity_ = capacity_;
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        CacheShard& shard = shards_[i];
+        tbutil::Mutex::Lock lock(shard.mutex_);
+        stat.hit_count_ += shard.hit_count_;
+        stat.miss_count_ += shard.miss_count_;
+        stat.evict_count_ += shard.evict_count_;
+        stat.item_count_ += shard.map_.size();
+        stat.used_size_ += shard.used_size_;
+      }
+    }
+
+    void FileCache::remove(CacheShard& shard, CacheList::iterator it)
+    {
+      shard.used_size_ -= it->length_;
+      shard.map_.erase(it->key_);
+      tbsys::gDeleteA(it->data_);
+      shard.lru_.erase(it);
+    }
+
+    void FileCache::bump_generation(CacheShard& shard, const uint32_t block_id)
+    {
+      ++shard.generation_[block_id];
+    }
+  }
+}
@@ -0,0 +1,124 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_FILECACHE_H_
+#define TFS_DATASERVER_FILECACHE_H_
+
+#include <list>
+#include <ext/hash_map>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // cache of whole small files (FileInfo + data, the same bytes as on disk),
+    // keyed by (block id, file id). memory is bounded and split into shards,
+    // every shard has its own lru list and lock. a shard is chosen by block id,
+    // so all files of one block live in the same shard.
+    class FileCache
+    {
+      public:
+        FileCache();
+        ~FileCache();
+
+        static FileCache* get_instance()
+        {
+          static FileCache s_file_cache;
+          return &s_file_cache;
+        }
+
+        // capacity 0 disable the cache
+        int initialize(const int64_t capacity, const int32_t max_file_size, const int32_t admit_visit_count);
+        inline bool enabled() const
+        {
+          return capacity_ > 0;
+        }
+
+        // copy cached file from offset into buf, nbytes will be truncated to file size.
+        // on miss, EXIT_META_NOT_FOUND_ERROR is returned and generation is set for a later put
+        int get(const uint32_t block_id, const uint64_t file_id, const int32_t offset, char* buf, int32_t& nbytes,
+            uint64_t& generation);
+        // data is the whole file: FileInfo + data. the file is dropped if the block was
+        // changed since generation was taken, or is not allowed in by admission rules
+        int put(const uint32_t block_id, const uint64_t file_id, const char* data, const int32_t len,
+            const int32_t block_visit_count, const uint64_t generation);
+
+        void erase(const uint32_t block_id, const uint64_t file_id);
+        void erase_block(const uint32_t block_id);
+        void clear();
+
+        void get_stat(common::ReadCacheStat& stat);
+
+      private:
+        struct CacheKey
+        {
+          uint32_t block_id_;
+          uint64_t file_id_;
+          bool operator==(const CacheKey& rhs) const
+          {
+            return block_id_ == rhs.block_id_ && file_id_ == rhs.file_id_;
+          }
+        };
+
+        struct CacheKeyHash
+        {
+          size_t operator()(const CacheKey& key) const
+          {
+            return static_cast<size_t>(key.file_id_ ^ (key.file_id_ >> 32) ^ (static_cast<uint64_t>(key.block_id_) << 7));
+          }
+        };
+
+        struct CacheEntry
+        {
+          CacheKey key_;
+          char* data_;
+          int32_t length_;
+        };
+
+        typedef std::list<CacheEntry> CacheList;
+        typedef __gnu_cxx::hash_map<CacheKey, CacheList::iterator, CacheKeyHash> CacheMap;
+        typedef __gnu_cxx::hash_map<uint32_t, uint64_t> GenerationMap;
+
+        struct CacheShard
+        {
+          tbutil::Mutex mutex_;
+          CacheList lru_;          // front is the most recently used
+          CacheMap map_;
+          GenerationMap generation_; // bumped on every change of a block
+          int64_t used_size_;
+          int64_t hit_count_;
+          int64_t miss_count_;
+          int64_t evict_count_;
+        };
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(FileCache);
+        inline CacheShard& get_shard(const uint32_t block_id)
+        {
+          return shards_[block_id % SHARD_COUNT];
+        }
+        void remove(CacheShard& shard, CacheList::iterator it);
+        void bump_generation(CacheShard& shard, const uint32_t block_id);
+
+      private:
+        static const int32_t SHARD_COUNT = 32;
+
+        CacheShard shards_[SHARD_COUNT];
+        int64_t capacity_;          // total bytes
+        int64_t shard_capacity_;
+        int32_t max_file_size_;     // FileInfo included
+        int32_t admit_visit_count_; // block visit count needed before its files enter the cache
+    };
+  }
+}
+#endif //TFS_DATASERVER_FILECACHE_H_
@@ -17,6 +17,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#include <vector>
+#include <algorithm>
+#include <Mutex.h>
 #include "common/error_msg.h"
 #include "common/internal.h"
 #include <Memory.hpp>
@@ -27,8 +31,64 @@ namespace tfs
   {
     using namespace common;
 
+    // pool of aligned buffers for O_DIRECT io, a direct io larger than a buffer is done piece by piece
+    class AlignedBufferPool
+    {
+      public:
+        static const int32_t BUFFER_SIZE = 1024 * 1024;
+        static const size_t MAX_FREE_COUNT = 16;
+
+        ~AlignedBufferPool()
+        {
+          for (size_t i = 0; i < free_list_.size(); ++i)
+          {
+            ::free(free_list_[i]);
+          }
+          free_list_.clear();
+        }
+
+        static AlignedBufferPool* get_instance()
+        {
+          static AlignedBufferPool s_pool;
+          return &s_pool;
+        }
+
+        char* alloc(const int32_t align)
+        {
+          {
+            tbutil::Mutex::Lock lock(mutex_);
+            if (!free_list_.empty())
+            {
+              char* buf = free_list_.back();
+              free_list_.pop_back();
+              return buf;
+            }
+          }
+          void* buf = NULL;
+          return 0 == posix_memalign(&buf, align, BUFFER_SIZE) ? reinterpret_cast<char*>(buf) : NULL;
+        }
+
+        void free(char* buf)
+        {
+          {
+            tbutil::Mutex::Lock lock(mutex_);
+            if (free_list_.size() < MAX_FREE_COUNT)
+            {
+              free_list_.push_back(buf);
+              return;
+            }
+          }
+          ::free(buf);
+        }
+
+      private:
+        tbutil::Mutex mutex_;
+        std::vector<char*> free_list_;
+    };
+    const int32_t AlignedBufferPool::BUFFER_SIZE;
+
     FileOperation::FileOperation(const std::string& file_name, const int open_flags) :
-      fd_(-1), open_flags_(open_flags)
+      fd_(-1), open_flags_(open_flags), direct_fd_(-1), direct_disabled_(false)
     {
       file_name_ = strdup(file_name.c_str());
     }
@@ -40,6 +100,11 @@ namespace tfs
         ::close(fd_);
         fd_ = -1;
       }
+      if (direct_fd_ >= 0)
+      {
+        ::close(direct_fd_);
+        direct_fd_ = -1;
+      }
 
       if (NULL != file_name_)
       {
@@ -50,6 +115,14 @@ namespace tfs
 
     void FileOperation::close_file()
     {
+      {
+        tbutil::Mutex::Lock lock(direct_mutex_);
+        if (direct_fd_ >= 0)
+        {
+          ::close(direct_fd_);
+          direct_fd_ = -1;
+        }
+      }
       if (fd_ < 0)
       {
         return;
@@ -165,6 +238,199 @@ namespace tfs
       return TFS_SUCCESS;
     }
 
+    int FileOperation::pread_file_ex(char* buf, const int32_t nbytes, const int64_t offset, const IOPolicy policy)
+    {
+      int ret = TFS_SUCCESS;
+      if (IO_POLICY_DIRECT == policy && check_direct_file() >= 0)
+      {
+        ret = pread_direct(buf, nbytes, offset);
+      }
+      else
+      {
+        ret = pread_file(buf, nbytes, offset);
+        if (TFS_SUCCESS == ret && IO_POLICY_CACHED != policy)
+        {
+          drop_cache(nbytes, offset, false);
+        }
+      }
+      return ret;
+    }
+
+    int FileOperation::pwrite_file_ex(const char* buf, const int32_t nbytes, const int64_t offset,
+        const IOPolicy policy)
+    {
+      int ret = TFS_SUCCESS;
+      // O_DIRECT can not write part of a sector, such write goes through page cache
+      if (IO_POLICY_DIRECT == policy && 0 == (offset % DIRECT_IO_ALIGN) && 0 == (nbytes % DIRECT_IO_ALIGN)
+          && check_direct_file() >= 0)
+      {
+        ret = pwrite_direct(buf, nbytes, offset);
+      }
+      else
+      {
+        ret = pwrite_file(buf, nbytes, offset);
+        if (TFS_SUCCESS == ret && IO_POLICY_CACHED != policy)
+        {
+          drop_cache(nbytes, offset, true);
+        }
+      }
+      return ret;
+    }
+
+    // read the aligned range covering [offset, offset + nbytes) into pooled buffers,
+    // then copy the wanted part out
+    int FileOperation::pread_direct(char* buf, const int32_t nbytes, const int64_t offset)
+    {
+      char* align_buf = AlignedBufferPool::get_instance()->alloc(DIRECT_IO_ALIGN);
+      if (NULL == align_buf)
+      {
+        return EXIT_GENERAL_ERROR;
+      }
+      int ret = TFS_SUCCESS;
+      int32_t done = 0;
+      while (done < nbytes && TFS_SUCCESS == ret)
+      {
+        int64_t want_offset = offset + done;
+        int64_t read_offset = want_offset - want_offset % DIRECT_IO_ALIGN;
+        int32_t skip = static_cast<int32_t>(want_offset - read_offset);
+        int32_t want_len = std::min(nbytes - done, AlignedBufferPool::BUFFER_SIZE - skip);
+        int32_t read_len = (skip + want_len + DIRECT_IO_ALIGN - 1) / DIRECT_IO_ALIGN * DIRECT_IO_ALIGN;
+        int32_t len = ::pread64(direct_fd_, align_buf, read_len, read_offset);
+        if (len < 0)
+        {
+          if (EINTR == errno || EAGAIN == errno)
+          {
+            continue;
+          }
+          ret = -errno;
+        }
+        else if (len <= skip)
+        {
+          ret = EXIT_DISK_OPER_INCOMPLETE; // reach end
+        }
+        else
+        {
+          len = std::min(len - skip, want_len);
+          memcpy(buf + done, align_buf + skip, len);
+          done += len;
+        }
+      }
+      AlignedBufferPool::get_instance()->free(align_buf);
+      return ret;
+    }
+
+    int FileOperation::pwrite_direct(const char* buf, const int32_t nbytes, const int64_t offset)
+    {
+      char* align_buf = AlignedBufferPool::get_instance()->alloc(DIRECT_IO_ALIGN);
+      if (NULL == align_buf)
+      {
+        return EXIT_GENERAL_ERROR;
+      }
+      int ret = TFS_SUCCESS;
+      int32_t done = 0;
+      while (done < nbytes && TFS_SUCCESS == ret)
+      {
+        int32_t write_len = std::min(nbytes - done, AlignedBufferPool::BUFFER_SIZE);
+        memcpy(align_buf, buf + done, write_len);
+        int32_t len = ::pwrite64(direct_fd_, align_buf, write_len, offset + done);
+        if (len < 0)
+        {
+          if (EINTR == errno || EAGAIN == errno)
+          {
+            continue;
+          }
+          ret = -errno;
+        }
+        else if (len != write_len)
+        {
+          ret = EXIT_DISK_OPER_INCOMPLETE;
+        }
+        else
+        {
+          done += len;
+        }
+      }
+      AlignedBufferPool::get_instance()->free(align_buf);
+      return ret;
+    }
+
+    // drop the range from page cache, dirty pages are written back first or they would stay
+    int FileOperation::drop_cache(const int32_t nbytes, const int64_t offset, const bool dirty)
+    {
+      int fd = check_file();
+      if (fd < 0)
+        return fd;
+
+      if (dirty)
+      {
+        sync_file_range(fd, offset, nbytes,
+            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+      }
+      return posix_fadvise(fd, offset, nbytes, POSIX_FADV_DONTNEED);
+    }
+
+    int FileOperation::pwritev_file(const struct iovec* iov, const int32_t iovcnt, const int64_t offset)
+    {
+      std::vector<struct iovec> left_iov(iov, iov + iovcnt);
+      size_t index = 0;
+      int64_t write_offset = offset;
+      ssize_t written_len = 0;
+
+      int i = 0;
+      while (index < left_iov.size())
+      {
+        if (check_file() < 0)
+          return -errno;
+
+        int count = std::min(left_iov.size() - index, static_cast<size_t>(IOV_MAX));
+        if ((written_len = ::pwritev64(fd_, &left_iov[index], count, write_offset)) < 0)
+        {
+          written_len = -errno;
+          // disk io time over
+          if (++i >= MAX_DISK_TIMES)
+          {
+            break;
+          }
+          if (EINTR == -written_len || EAGAIN == -written_len)
+          {
+            continue;
+          }
+          if (EBADF == -written_len)
+          {
+            fd_ = -1;
+            continue;
+          }
+          else
+          {
+            return written_len;
+          }
+        }
+        else if (0 == written_len)
+        {
+          break;
+        }
+
+        write_offset += written_len;
+        // skip the written part
+        while (index < left_iov.size() && written_len >= static_cast<ssize_t>(left_iov[index].iov_len))
+        {
+          written_len -= left_iov[index].iov_len;
+          ++index;
+        }
+        if (written_len > 0)
+        {
+          left_iov[index].iov_base = reinterpret_cast<char*>(left_iov[index].iov_base) + written_len;
+          left_iov[index].iov_len -= written_len;
+        }
+      }
+
+      if (index < left_iov.size())
+      {
+        return EXIT_DISK_OPER_INCOMPLETE;
+      }
+      return TFS_SUCCESS;
+    }
+
     int FileOperation::write_file(const char* buf, const int32_t nbytes)
     {
       const char *p_tmp = buf;
@@ -302,5 +568,21 @@ namespace tfs
 
       return fd_;
     }
+
+    int FileOperation::check_direct_file()
+    {
+      tbutil::Mutex::Lock lock(direct_mutex_);
+      if (direct_fd_ < 0 && !direct_disabled_)
+      {
+        direct_fd_ = ::open(file_name_, (open_flags_ & ~(O_CREAT | O_TRUNC | O_SYNC)) | O_DIRECT, OPEN_MODE);
+        if (direct_fd_ < 0)
+        {
+          // tmpfs and some others refuse O_DIRECT, fall back to page cache
+          TBSYS_LOG(WARN, "open file %s with O_DIRECT fail, use page cache. error: %s", file_name_, strerror(errno));
+          direct_disabled_ = true;
+        }
+      }
+      return direct_fd_;
+    }
   }
 }
@@ -19,13 +19,23 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <string>
+#include <Mutex.h>
 #include "common/internal.h"
 
 namespace tfs
 {
   namespace dataserver
   {
+    // how a read/write of background work (replication, compaction, check) uses the page cache
+    enum IOPolicy
+    {
+      IO_POLICY_CACHED = 0,   // through page cache, as client reads
+      IO_POLICY_DONTNEED,     // through page cache, the range is dropped from it after the io
+      IO_POLICY_DIRECT        // O_DIRECT with aligned buffers, IO_POLICY_DONTNEED if not supported
+    };
+
     class FileOperation
     {
       public:
@@ -41,6 +51,12 @@ namespace tfs
 
         virtual int pread_file(char* buf, const int32_t nbytes, const int64_t offset);
         virtual int pwrite_file(const char* buf, const int32_t nbytes, const int64_t offset);
+        // gather write, iov is not changed
+        int pwritev_file(const struct iovec* iov, const int32_t iovcnt, const int64_t offset);
+
+        // read/write by io policy, IO_POLICY_CACHED is the same as pread_file/pwrite_file
+        int pread_file_ex(char* buf, const int32_t nbytes, const int64_t offset, const IOPolicy policy);
+        int pwrite_file_ex(const char* buf, const int32_t nbytes, const int64_t offset, const IOPolicy policy);
 
         int write_file(const char* buf, const int32_t nbytes);
 
@@ -58,15 +74,23 @@ namespace tfs
         DISALLOW_COPY_AND_ASSIGN(FileOperation);
 
         int check_file();
+        int check_direct_file();
+        int pread_direct(char* buf, const int32_t nbytes, const int64_t offset);
+        int pwrite_direct(const char* buf, const int32_t nbytes, const int64_t offset);
+        int drop_cache(const int32_t nbytes, const int64_t offset, const bool dirty);
 
       protected:
         static const int MAX_DISK_TIMES = 5;
         static const mode_t OPEN_MODE = 0644;
+        static const int32_t DIRECT_IO_ALIGN = 4096;
 
       protected:
         int fd_;                // file handle
         int open_flags_;        // open flags
         char* file_name_;       // file path name
+        int direct_fd_;         // O_DIRECT handle, opened on first direct io
+        bool direct_disabled_;  // file system refuses O_DIRECT
+        tbutil::Mutex direct_mutex_; // io threads of a block open direct_fd_ at once
     };
   }
 }
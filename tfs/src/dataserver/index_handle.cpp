@@ -19,6 +19,7 @@
 #include "dataserver_define.h"
 #include "common/error_msg.h"
 #include <tbsys.h>
+#include <map>
 
 namespace tfs
 {
@@ -27,6 +28,180 @@ namespace tfs
 
     using namespace common;
 
+    // key of the meta at offset, for MetaTable to confirm a fingerprint match
+    struct MetaKeyReader
+    {
+      explicit MetaKeyReader(MMapFileOperation* file_op) :
+        file_op_(file_op)
+      {
+      }
+      int operator()(const int32_t offset, uint64_t& key)
+      {
+        RawMeta raw_meta;
+        int ret = file_op_->pread_file(reinterpret_cast<char*> (&raw_meta), RAW_META_SIZE, offset);
+        key = raw_meta.get_key();
+        return ret;
+      }
+      MMapFileOperation* file_op_;
+    };
+
+    // the index as changed by a batch so far: changed nodes, bucket slots and header are kept
+    // here and read before the file, nothing is written till the whole batch is staged
+    struct StagedIndex
+    {
+      StagedIndex(MMapFileOperation* file_op, const IndexHeader* header, const int32_t* bucket_slot) :
+        file_op_(file_op), bucket_slot_(bucket_slot)
+      {
+        memcpy(&header_, header, sizeof(IndexHeader));
+      }
+
+      int read_node(const int32_t offset, MetaInfo& meta_info)
+      {
+        std::map<int32_t, MetaInfo>::const_iterator it = nodes_.find(offset);
+        if (it != nodes_.end())
+        {
+          meta_info = it->second;
+          return TFS_SUCCESS;
+        }
+        return file_op_->pread_file(reinterpret_cast<char*> (&meta_info), META_INFO_SIZE, offset);
+      }
+
+      void write_node(const int32_t offset, const MetaInfo& meta_info)
+      {
+        nodes_[offset] = meta_info;
+      }
+
+      int32_t slot_of(const uint64_t key) const
+      {
+        return static_cast<uint32_t> (key) % header_.bucket_size_;
+      }
+
+      int32_t get_slot(const int32_t slot) const
+      {
+        std::map<int32_t, int32_t>::const_iterator it = slots_.find(slot);
+        return it != slots_.end() ? it->second : bucket_slot_[slot];
+      }
+
+      // as IndexHandle::hash_find
+      int find(const uint64_t key, int32_t& current_offset, int32_t& previous_offset)
+      {
+        previous_offset = 0;
+        MetaInfo meta_info;
+        for (int32_t pos = get_slot(slot_of(key)); pos != 0;)
+        {
+          int ret = read_node(pos, meta_info);
+          if (TFS_SUCCESS != ret)
+            return ret;
+          if (key == meta_info.get_key())
+          {
+            current_offset = pos;
+            return TFS_SUCCESS;
+          }
+          previous_offset = pos;
+          pos = meta_info.get_next_meta_offset();
+        }
+        return EXIT_META_NOT_FOUND_ERROR;
+      }
+
+      // where the meta of key was before the batch and is now, 0 if none
+      void move_key(const uint64_t key, const int32_t from_offset, const int32_t to_offset)
+      {
+        std::map<uint64_t, std::pair<int32_t, int32_t> >::iterator it = keys_.find(key);
+        if (it == keys_.end())
+        {
+          keys_.insert(std::make_pair(key, std::make_pair(from_offset, to_offset)));
+        }
+        else
+        {
+          it->second.second = to_offset;
+        }
+      }
+
+      // as IndexHandle::hash_insert, at the tail of the chain
+      int insert(const int32_t previous_offset, const RawMeta& meta)
+      {
+        MetaInfo meta_info;
+        int32_t current_offset = 0;
+        int ret = TFS_SUCCESS;
+        if (0 != header_.free_head_offset_)
+        {
+          ret = read_node(header_.free_head_offset_, meta_info);
+          if (TFS_SUCCESS != ret)
+            return ret;
+          current_offset = header_.free_head_offset_;
+          header_.free_head_offset_ = meta_info.get_next_meta_offset();
+        }
+        else
+        {
+          current_offset = header_.index_file_size_;
+          header_.index_file_size_ += META_INFO_SIZE;
+        }
+        write_node(current_offset, MetaInfo(meta));
+
+        if (0 != previous_offset)
+        {
+          ret = read_node(previous_offset, meta_info);
+          if (TFS_SUCCESS != ret)
+            return ret;
+          meta_info.set_next_meta_offset(current_offset);
+          write_node(previous_offset, meta_info);
+        }
+        else
+        {
+          slots_[slot_of(meta.get_key())] = current_offset;
+        }
+        move_key(meta.get_key(), 0, current_offset);
+        return TFS_SUCCESS;
+      }
+
+      int update(const int32_t current_offset, const RawMeta& meta)
+      {
+        MetaInfo meta_info;
+        int ret = read_node(current_offset, meta_info);
+        if (TFS_SUCCESS == ret)
+        {
+          meta_info.set_raw_meta(meta);
+          write_node(current_offset, meta_info);
+        }
+        return ret;
+      }
+
+      // as IndexHandle::delete_segment_meta, the node goes to the head of free list
+      int remove(const uint64_t key, const int32_t current_offset, const int32_t previous_offset)
+      {
+        MetaInfo meta_info;
+        int ret = read_node(current_offset, meta_info);
+        if (TFS_SUCCESS != ret)
+          return ret;
+        int32_t next_offset = meta_info.get_next_meta_offset();
+        if (0 == previous_offset)
+        {
+          slots_[slot_of(key)] = next_offset;
+        }
+        else
+        {
+          MetaInfo pre_meta_info;
+          ret = read_node(previous_offset, pre_meta_info);
+          if (TFS_SUCCESS != ret)
+            return ret;
+          pre_meta_info.set_next_meta_offset(next_offset);
+          write_node(previous_offset, pre_meta_info);
+        }
+        meta_info.set_next_meta_offset(header_.free_head_offset_);
+        write_node(current_offset, meta_info);
+        header_.free_head_offset_ = current_offset;
+        move_key(key, current_offset, 0);
+        return TFS_SUCCESS;
+      }
+
+      MMapFileOperation* file_op_;
+      const int32_t* bucket_slot_;
+      IndexHeader header_;
+      std::map<int32_t, MetaInfo> nodes_;   // offset => node
+      std::map<int32_t, int32_t> slots_;    // slot => offset of the first node
+      std::map<uint64_t, std::pair<int32_t, int32_t> > keys_; // key => offset before, offset now
+    };
+
     IndexHandle::IndexHandle(const std::string& base_path, const uint32_t main_block_id)
     {
       //create file_op handle
@@ -36,6 +211,7 @@ namespace tfs
       tmp_stream >> index_path;
       file_op_ = new MMapFileOperation(index_path, O_RDWR | O_LARGEFILE | O_CREAT);
       is_load_ = false;
+      table_built_ = false;
     }
 
     IndexHandle::~IndexHandle()
@@ -148,6 +324,47 @@ namespace tfs
       if (TFS_SUCCESS != ret)
         return ret;
 
+      ret = check_header(logic_block_id, cfg_bucket_size, file_size);
+      if (TFS_SUCCESS != ret)
+        return ret;
+
+      is_load_ = true;
+      TBSYS_LOG(
+          INFO,
+          "load blockid: %u index successful. data file offset: %d, index file size: %d, bucket size: %d, free head offset: %d, seqno: %d, size: %d, filecount: %d, del size: %d, del file count: %d version: %d",
+          logic_block_id, index_header()->data_file_offset_, index_header()->index_file_size_, bucket_size(),
+          index_header()->free_head_offset_, block_info()->seq_no_, block_info()->size_, block_info()->file_count_,
+          block_info()->del_size_, block_info()->del_file_count_, block_info()->version_);
+      return TFS_SUCCESS;
+    }
+
+    int IndexHandle::load_header(const uint32_t logic_block_id, const int32_t cfg_bucket_size)
+    {
+      if (is_load_)
+      {
+        return EXIT_INDEX_ALREADY_LOADED_ERROR;
+      }
+
+      int64_t file_size = file_op_->get_file_size();
+      if (file_size < 0)
+      {
+        return file_size;
+      }
+      else if (file_size < static_cast<int64_t>(sizeof(IndexHeader))) // empty file
+      {
+        return EXIT_INDEX_CORRUPT_ERROR;
+      }
+
+      int ret = file_op_->pread_file(reinterpret_cast<char*> (&header_), sizeof(IndexHeader), 0);
+      // opened again when mapped
+      file_op_->close_file();
+      if (TFS_SUCCESS != ret)
+        return ret;
+      return check_header(logic_block_id, cfg_bucket_size, file_size);
+    }
+
+    int IndexHandle::check_header(const uint32_t logic_block_id, const int32_t cfg_bucket_size, const int64_t file_size)
+    {
       // check stored logic block id and bucket size
       // meta info corrupt, may be destroyed when created by unexpect interrupt
       if (0 == bucket_size() || 0 == block_info()->block_id_)
@@ -162,7 +379,7 @@ namespace tfs
       // uncomplete index file
       if (file_size < index_file_size)
       {
-        TBSYS_LOG(ERROR, "Index corrupt error. blockid: %u, bucket size: %d, file size: %d, index file size: %d",
+        TBSYS_LOG(ERROR, "Index corrupt error. blockid: %u, bucket size: %d, file size: %" PRI64_PREFIX "d, index file size: %d",
             block_info()->block_id_, bucket_size(), file_size, index_file_size);
         return EXIT_INDEX_CORRUPT_ERROR;
       }
@@ -195,13 +412,6 @@ namespace tfs
         //do nothing
       }
 
-      is_load_ = true;
-      TBSYS_LOG(
-          INFO,
-          "load blockid: %u index successful. data file offset: %d, index file size: %d, bucket size: %d, free head offset: %d, seqno: %d, size: %d, filecount: %d, del size: %d, del file count: %d version: %d",
-          logic_block_id, index_header()->data_file_offset_, index_header()->index_file_size_, bucket_size(),
-          index_header()->free_head_offset_, block_info()->seq_no_, block_info()->size_, block_info()->file_count_,
-          block_info()->del_size_, block_info()->del_file_count_, block_info()->version_);
       return TFS_SUCCESS;
     }
 
@@ -217,6 +427,8 @@ namespace tfs
         }
       }
 
+      meta_table_.clear();
+      table_built_ = false;
       int ret = file_op_->munmap_file();
       if (TFS_SUCCESS != ret)
         return ret;
@@ -225,6 +437,38 @@ namespace tfs
       return ret;
     }
 
+    int IndexHandle::build_meta_table()
+    {
+      meta_table_.clear();
+      table_built_ = false;
+      int ret = TFS_SUCCESS;
+      for (int32_t slot = 0; slot < bucket_size(); ++slot)
+      {
+        for (int32_t current_offset = bucket_slot()[slot]; current_offset != 0;)
+        {
+          if (current_offset >= index_header()->index_file_size_)
+          {
+            meta_table_.clear();
+            return EXIT_META_OFFSET_ERROR;
+          }
+
+          MetaInfo tmp_meta;
+          ret = file_op_->pread_file(reinterpret_cast<char*> (&tmp_meta), META_INFO_SIZE, current_offset);
+          if (TFS_SUCCESS != ret)
+          {
+            meta_table_.clear();
+            return ret;
+          }
+          meta_table_.insert(tmp_meta.get_key(), current_offset);
+          current_offset = tmp_meta.get_next_meta_offset();
+        }
+      }
+      table_built_ = true;
+      TBSYS_LOG(DEBUG, "build meta table. blockid: %u, meta count: %d, table capacity: %d", block_info()->block_id_,
+          meta_table_.size(), meta_table_.capacity());
+      return TFS_SUCCESS;
+    }
+
     int IndexHandle::flush()
     {
       int ret = file_op_->flush_file();
@@ -366,7 +610,7 @@ namespace tfs
     int IndexHandle::write_segment_meta(const uint64_t key, const RawMeta& meta)
     {
       int32_t current_offset = 0, previous_offset = 0;
-      int ret = hash_find(key, current_offset, previous_offset);
+      int ret = meta_find(key, current_offset);
       if (TFS_SUCCESS == ret) // check not exists
       {
         return EXIT_META_UNEXPECT_FOUND_ERROR;
@@ -376,15 +620,22 @@ namespace tfs
         return ret;
       }
 
+      // tail of the bucket list
+      ret = hash_find(key, current_offset, previous_offset);
+      if (EXIT_META_NOT_FOUND_ERROR != ret)
+      {
+        return TFS_SUCCESS == ret ? EXIT_META_UNEXPECT_FOUND_ERROR : ret;
+      }
+
       int32_t slot = static_cast<uint32_t> (key) % bucket_size();
       return hash_insert(slot, previous_offset, meta);
     }
 
     int IndexHandle::read_segment_meta(const uint64_t key, RawMeta& meta)
     {
-      int32_t current_offset = 0, previous_offset = 0;
+      int32_t current_offset = 0;
       // find
-      int ret = hash_find(key, current_offset, previous_offset);
+      int ret = meta_find(key, current_offset);
       if (TFS_SUCCESS == ret) //exist
       {
         ret = file_op_->pread_file(reinterpret_cast<char*> (&meta), RAW_META_SIZE, current_offset);
@@ -403,7 +654,7 @@ namespace tfs
     {
       // find
       int32_t current_offset = 0, previous_offset = 0;
-      int ret = hash_find(key, current_offset, previous_offset);
+      int ret = meta_find(key, current_offset);
       //exist, update
       if (TFS_SUCCESS == ret)
       {
@@ -424,6 +675,11 @@ namespace tfs
       }
       else if (EXIT_META_NOT_FOUND_ERROR == ret) // nonexists, insert
       {
+        // tail of the bucket list
+        ret = hash_find(key, current_offset, previous_offset);
+        if (EXIT_META_NOT_FOUND_ERROR != ret)
+          return TFS_SUCCESS == ret ? EXIT_META_UNEXPECT_FOUND_ERROR : ret;
+
         // insert
         int32_t slot = static_cast<uint32_t> (key) % bucket_size();
         ret = hash_insert(slot, previous_offset, meta);
@@ -435,23 +691,19 @@ namespace tfs
 
     int IndexHandle::batch_override_segment_meta(const RawMetaVec& meta_list)
     {
-      int ret = TFS_SUCCESS;
+      IndexBatch batch;
       for (RawMetaVecConstIter mit = meta_list.begin(); mit != meta_list.end(); ++mit)
       {
-        ret = override_segment_meta(mit->get_key(), *mit);
-        if (TFS_SUCCESS != ret)
-        {
-          return ret;
-        }
+        batch.override_meta(*mit);
       }
-      return TFS_SUCCESS;
+      return apply_batch(batch);
     }
 
     int IndexHandle::update_segment_meta(const uint64_t key, const RawMeta& meta)
     {
       // find
-      int32_t current_offset = 0, previous_offset = 0;
-      int ret = hash_find(key, current_offset, previous_offset);
+      int32_t current_offset = 0;
+      int ret = meta_find(key, current_offset);
       if (TFS_SUCCESS == ret) // exist
       {
         MetaInfo tmp_meta;
@@ -514,6 +766,161 @@ namespace tfs
       // add to free head list, if bread down at this time, current offset will not be used for ever
       index_header()->free_head_offset_ = current_offset;
 
+      if (table_built_)
+      {
+        MetaKeyReader key_reader(file_op_);
+        meta_table_.erase(key, key_reader);
+      }
+      return TFS_SUCCESS;
+    }
+
+    int IndexHandle::apply_batch(const IndexBatch& batch)
+    {
+      if (batch.empty())
+      {
+        return TFS_SUCCESS;
+      }
+
+      // 1. stage every change, the index is untouched if any of them fails
+      StagedIndex staged(file_op_, header(), bucket_slot());
+      int ret = TFS_SUCCESS;
+      if (batch.set_block_info_)
+      {
+        memcpy(&staged.header_.block_info_, &batch.block_info_, sizeof(BlockInfo));
+      }
+      for (uint32_t i = 0; TFS_SUCCESS == ret && i < batch.block_info_ops_.size(); ++i)
+      {
+        ret = update_block_info(&staged.header_.block_info_, batch.block_info_ops_[i].first,
+            batch.block_info_ops_[i].second);
+      }
+      for (std::vector<IndexBatch::Op>::const_iterator it = batch.ops_.begin(); TFS_SUCCESS == ret
+          && it != batch.ops_.end(); ++it)
+      {
+        const uint64_t key = it->meta_.get_key();
+        int32_t current_offset = 0, previous_offset = 0;
+        ret = staged.find(key, current_offset, previous_offset);
+        if (TFS_SUCCESS != ret && EXIT_META_NOT_FOUND_ERROR != ret)
+        {
+          break;
+        }
+        bool found = TFS_SUCCESS == ret;
+        switch (it->type_)
+        {
+        case INDEX_BATCH_WRITE:
+          ret = found ? EXIT_META_UNEXPECT_FOUND_ERROR : staged.insert(previous_offset, it->meta_);
+          break;
+        case INDEX_BATCH_UPDATE:
+          ret = found ? staged.update(current_offset, it->meta_) : EXIT_META_NOT_FOUND_ERROR;
+          break;
+        case INDEX_BATCH_OVERRIDE:
+          ret = found ? staged.update(current_offset, it->meta_) : staged.insert(previous_offset, it->meta_);
+          break;
+        case INDEX_BATCH_DELETE:
+          ret = found ? staged.remove(key, current_offset, previous_offset) : EXIT_META_NOT_FOUND_ERROR;
+          break;
+        default:
+          ret = TFS_ERROR;
+          break;
+        }
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "apply index batch fail, nothing changed. blockid: %u, ops: %d, ret: %d",
+            block_info()->block_id_, batch.size(), ret);
+        return ret;
+      }
+
+      // 2. nodes the file has now, put back if a write of step 3 fails. nodes past the end of
+      // the index are not reached from the header and buckets on disk, they need none
+      std::vector<std::pair<int32_t, MetaInfo> > undo;
+      std::map<int32_t, MetaInfo>::iterator nit = staged.nodes_.begin();
+      for (; TFS_SUCCESS == ret && nit != staged.nodes_.end() && nit->first < header()->index_file_size_; ++nit)
+      {
+        MetaInfo meta_info;
+        ret = file_op_->pread_file(reinterpret_cast<char*> (&meta_info), META_INFO_SIZE, nit->first);
+        undo.push_back(std::make_pair(nit->first, meta_info));
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "apply index batch fail, read meta fail, nothing changed. blockid: %u, ret: %d",
+            block_info()->block_id_, ret);
+        return ret;
+      }
+
+      // the table checks keys against the file, drop moved keys before their nodes change
+      MetaKeyReader key_reader(file_op_);
+      std::map<uint64_t, std::pair<int32_t, int32_t> >::const_iterator kit;
+      for (kit = staged.keys_.begin(); table_built_ && kit != staged.keys_.end(); ++kit)
+      {
+        if (0 != kit->second.first && kit->second.first != kit->second.second)
+        {
+          meta_table_.erase(kit->first, key_reader);
+        }
+      }
+
+      // 3. nodes, one gather write of each contiguous run
+      std::vector<struct iovec> iov;
+      int32_t run_offset = 0, run_end = 0, write_count = 0;
+      nit = staged.nodes_.begin();
+      while (TFS_SUCCESS == ret && nit != staged.nodes_.end())
+      {
+        if (!iov.empty() && nit->first != run_end)
+        {
+          ret = file_op_->pwritev_file(&iov[0], iov.size(), run_offset);
+          ++write_count;
+          iov.clear();
+        }
+        if (iov.empty())
+        {
+          run_offset = run_end = nit->first;
+        }
+        struct iovec node_iov;
+        node_iov.iov_base = &nit->second;
+        node_iov.iov_len = META_INFO_SIZE;
+        iov.push_back(node_iov);
+        run_end += META_INFO_SIZE;
+        ++nit;
+      }
+      if (TFS_SUCCESS == ret && !iov.empty())
+      {
+        ret = file_op_->pwritev_file(&iov[0], iov.size(), run_offset);
+        ++write_count;
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        // header and buckets still point to the old nodes, put the old nodes back under them.
+        // the table may miss keys now
+        int rollback_ret = TFS_SUCCESS;
+        for (uint32_t i = 0; i < undo.size(); ++i)
+        {
+          int tmp_ret = file_op_->pwrite_file(reinterpret_cast<char*> (&undo[i].second), META_INFO_SIZE,
+              undo[i].first);
+          rollback_ret = TFS_SUCCESS == rollback_ret ? tmp_ret : rollback_ret;
+        }
+        meta_table_.clear();
+        table_built_ = false;
+        TBSYS_LOG(ERROR, "apply index batch, write meta fail. blockid: %u, ret: %d, nodes put back: %d, ret: %d",
+            block_info()->block_id_, ret, static_cast<int32_t>(undo.size()), rollback_ret);
+        return ret;
+      }
+
+      // 4. buckets and header, the map may have moved by the writes above
+      int32_t* slots = bucket_slot();
+      for (std::map<int32_t, int32_t>::const_iterator sit = staged.slots_.begin(); sit != staged.slots_.end(); ++sit)
+      {
+        slots[sit->first] = sit->second;
+      }
+      memcpy(header(), &staged.header_, sizeof(IndexHeader));
+
+      for (kit = staged.keys_.begin(); table_built_ && kit != staged.keys_.end(); ++kit)
+      {
+        if (0 != kit->second.second && kit->second.first != kit->second.second)
+        {
+          meta_table_.insert(kit->first, kit->second.second);
+        }
+      }
+      TBSYS_LOG(DEBUG, "apply index batch. blockid: %u, ops: %d, nodes: %d, writes: %d", block_info()->block_id_,
+          batch.size(), static_cast<int32_t>(staged.nodes_.size()), write_count);
       return TFS_SUCCESS;
     }
 
@@ -555,7 +962,12 @@ namespace tfs
 
     int IndexHandle::update_block_info(const OperType oper_type, const uint32_t modify_size)
     {
-      if (0 == block_info()->block_id_)
+      return update_block_info(block_info(), oper_type, modify_size);
+    }
+
+    int IndexHandle::update_block_info(BlockInfo* blk_info, const OperType oper_type, const uint32_t modify_size)
+    {
+      if (0 == blk_info->block_id_)
       {
         return EXIT_BLOCKID_ZERO_ERROR;
       }
@@ -563,31 +975,31 @@ namespace tfs
       // to each operate type, update statistics eg, version count size stuff etc
       if (C_OPER_INSERT == oper_type)
       {
-        ++block_info()->version_;
-        ++block_info()->file_count_;
-        block_info()->size_ += modify_size;
+        ++blk_info->version_;
+        ++blk_info->file_count_;
+        blk_info->size_ += modify_size;
       }
       else if (C_OPER_DELETE == oper_type)
       {
-        ++block_info()->del_file_count_;
-        block_info()->del_size_ += modify_size;
+        ++blk_info->del_file_count_;
+        blk_info->del_size_ += modify_size;
       }
       else if (C_OPER_UNDELETE == oper_type)
       {
-        --block_info()->del_file_count_;
-        block_info()->del_size_ -= modify_size;
+        --blk_info->del_file_count_;
+        blk_info->del_size_ -= modify_size;
       }
       else if (C_OPER_UPDATE == oper_type)
       {
-        ++block_info()->version_;
-        block_info()->size_ += modify_size;
+        ++blk_info->version_;
+        blk_info->size_ += modify_size;
       }
 
       TBSYS_LOG(
           DEBUG,
           "update block info. blockid: %u, version: %u, file count: %u, size: %u, del file count: %u, del size: %u, seq no: %u, oper type: %d",
-          block_info()->block_id_, block_info()->version_, block_info()->file_count_, block_info()->size_,
-          block_info()->del_file_count_, block_info()->del_size_, block_info()->seq_no_, oper_type);
+          blk_info->block_id_, blk_info->version_, blk_info->file_count_, blk_info->size_,
+          blk_info->del_file_count_, blk_info->del_size_, blk_info->seq_no_, oper_type);
       return TFS_SUCCESS;
     }
 
@@ -674,8 +1086,25 @@ namespace tfs
       {
         bucket_slot()[slot] = current_offset;
       }
+
+      if (table_built_)
+      {
+        meta_table_.insert(meta.get_key(), current_offset);
+      }
       return TFS_SUCCESS;
     }
 
+    int IndexHandle::meta_find(const uint64_t key, int32_t& current_offset)
+    {
+      if (!table_built_)
+      {
+        int32_t previous_offset = 0;
+        return hash_find(key, current_offset, previous_offset);
+      }
+      MetaKeyReader key_reader(file_op_);
+      current_offset = meta_table_.find(key, key_reader);
+      return 0 == current_offset ? EXIT_META_NOT_FOUND_ERROR : TFS_SUCCESS;
+    }
+
   }
 }
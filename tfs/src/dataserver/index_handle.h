@@ -18,7 +18,9 @@
 #ifndef TFS_DATASERVER_INDEXHANDLE_H_
 #define TFS_DATASERVER_INDEXHANDLE_H_
 
+#include <vector>
 #include "mmap_file_op.h"
+#include "meta_table.h"
 #include "common/internal.h"
 
 namespace tfs
@@ -44,6 +46,93 @@ namespace tfs
         DISALLOW_COPY_AND_ASSIGN(IndexHeader);
     };
 
+    enum IndexBatchOpType
+    {
+      INDEX_BATCH_WRITE = 1, // key must not exist
+      INDEX_BATCH_UPDATE,    // key must exist
+      INDEX_BATCH_OVERRIDE,  // update if exists, or insert
+      INDEX_BATCH_DELETE
+    };
+
+    // a set of index changes applied together by IndexHandle::apply_batch, in the order staged
+    class IndexBatch
+    {
+      public:
+        IndexBatch() :
+          set_block_info_(false)
+        {
+          memset(&block_info_, 0, sizeof(block_info_));
+        }
+
+        void write_meta(const common::RawMeta& meta)
+        {
+          add_op(INDEX_BATCH_WRITE, meta);
+        }
+        void update_meta(const common::RawMeta& meta)
+        {
+          add_op(INDEX_BATCH_UPDATE, meta);
+        }
+        void override_meta(const common::RawMeta& meta)
+        {
+          add_op(INDEX_BATCH_OVERRIDE, meta);
+        }
+        void delete_meta(const uint64_t key)
+        {
+          common::RawMeta meta;
+          meta.set_key(key);
+          add_op(INDEX_BATCH_DELETE, meta);
+        }
+        // counters as IndexHandle::update_block_info, applied after set_block_info
+        void update_block_info(const OperType oper_type, const uint32_t modify_size)
+        {
+          block_info_ops_.push_back(std::make_pair(oper_type, modify_size));
+        }
+        // replace the block info, NULL to keep it
+        void set_block_info(const common::BlockInfo* blk_info)
+        {
+          set_block_info_ = NULL != blk_info;
+          if (set_block_info_)
+          {
+            block_info_ = *blk_info;
+          }
+        }
+
+        bool empty() const
+        {
+          return ops_.empty() && block_info_ops_.empty() && !set_block_info_;
+        }
+        int32_t size() const
+        {
+          return ops_.size();
+        }
+        void clear()
+        {
+          ops_.clear();
+          block_info_ops_.clear();
+          set_block_info_ = false;
+        }
+
+      private:
+        friend class IndexHandle;
+        struct Op
+        {
+          IndexBatchOpType type_;
+          common::RawMeta meta_;
+        };
+        void add_op(const IndexBatchOpType type, const common::RawMeta& meta)
+        {
+          Op op;
+          op.type_ = type;
+          op.meta_ = meta;
+          ops_.push_back(op);
+        }
+
+        std::vector<Op> ops_;
+        std::vector<std::pair<OperType, uint32_t> > block_info_ops_;
+        common::BlockInfo block_info_;
+        bool set_block_info_;
+    };
+
     class IndexHandle
     {
       public:
@@ -54,6 +143,7 @@ namespace tfs
         {
           file_op_ = mmap_op;
           is_load_ = false;
+          table_built_ = false;
         }
         ~IndexHandle();
 
@@ -62,8 +152,12 @@ namespace tfs
             const DirtyFlag dirty_flag);
         // load blockfile into memory, check block info
         int load(const uint32_t logic_block_id, const int32_t bucket_size, const common::MMapOption map_option);
+        // read and check only the header, block info is there till load
+        int load_header(const uint32_t logic_block_id, const int32_t bucket_size);
         // clear memory map, delete blockfile
         int remove(const uint32_t logic_block_id);
+        // build the in memory meta table from bucket chains, lookups use it from then on
+        int build_meta_table();
         // flush file to disk
         int flush();
         int set_block_dirty_type(const DirtyFlag dirty_flag);
@@ -87,27 +181,32 @@ namespace tfs
         int update_segment_meta(const uint64_t key, const common::RawMeta& meta);
         // delete meta(key) from metainfo list, add it to free list
         int delete_segment_meta(const uint64_t key);
+        // apply all changes of batch or none of them. the changed nodes are written by a gather
+        // write of each contiguous run, buckets and header after them, the caller flushes once.
+        // if a node write fails the nodes written are put back as they were
+        int apply_batch(const IndexBatch& batch);
         // put all meta info into param meta
         int traverse_segment_meta(common::RawMetaVec& raw_metas);
         int traverse_sorted_segment_meta(common::RawMetaVec& meta);
 
         // update block info after operation
         int update_block_info(const OperType oper_type, const uint32_t modify_size);
+        static int update_block_info(common::BlockInfo* blk_info, const OperType oper_type, const uint32_t modify_size);
         int copy_block_info(const common::BlockInfo* blk_info);
 
         int get_block_data_offset() const
         {
-          return reinterpret_cast<IndexHeader*> (file_op_->get_map_data())->data_file_offset_;
+          return header()->data_file_offset_;
         }
 
         void commit_block_data_offset(const int file_size)
         {
-          reinterpret_cast<IndexHeader*> (file_op_->get_map_data())->data_file_offset_ += file_size;
+          header()->data_file_offset_ += file_size;
         }
 
         IndexHeader* index_header()
         {
-          return reinterpret_cast<IndexHeader*> (file_op_->get_map_data());
+          return header();
         }
 
         int32_t* bucket_slot()
@@ -117,26 +216,57 @@ namespace tfs
 
         int32_t bucket_size() const
         {
-          return reinterpret_cast<IndexHeader*> (file_op_->get_map_data())->bucket_size_;
+          return header()->bucket_size_;
         }
 
         common::BlockInfo* block_info()
         {
-          return reinterpret_cast<common::BlockInfo*> (file_op_->get_map_data());
+          return &header()->block_info_;
         }
 
         int32_t data_file_size() const
         {
-          return reinterpret_cast<IndexHeader*> (file_op_->get_map_data())->data_file_offset_;
+          return header()->data_file_offset_;
+        }
+
+        // memory taken by the index map, see IndexMapManager
+        int32_t map_size() const
+        {
+          return file_op_->get_map_size();
+        }
+
+        int32_t resident_size() const
+        {
+          return file_op_->get_resident_size();
+        }
+
+        int release_map()
+        {
+          return file_op_->release_map_pages();
+        }
+
+        int lock_map(const bool lock)
+        {
+          return file_op_->lock_map_pages(lock);
         }
 
       private:
+        // the mapped header, or the one read by load_header before the file is mapped
+        IndexHeader* header() const
+        {
+          void* data = file_op_->get_map_data();
+          return NULL != data ? reinterpret_cast<IndexHeader*> (data) : const_cast<IndexHeader*> (&header_);
+        }
+        int check_header(const uint32_t logic_block_id, const int32_t cfg_bucket_size, const int64_t file_size);
+
         bool hash_compare(const uint64_t left_key, const uint64_t right_key)
         {
           return (left_key == right_key);
         }
 
         int hash_find(const uint64_t key, int32_t& current_offset, int32_t& previous_offset);
+        // find offset of meta, by meta table if built
+        int meta_find(const uint64_t key, int32_t& current_offset);
         int hash_insert(const int32_t slot, const int32_t previous_offset, const common::RawMeta& meta);
 
       private:
@@ -146,6 +276,9 @@ namespace tfs
       private:
         MMapFileOperation* file_op_;
         bool is_load_;
+        IndexHeader header_;
+        MetaTable meta_table_;
+        bool table_built_;
     };
 
     struct RawMetaSort
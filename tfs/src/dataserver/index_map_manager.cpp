@@ -0,0 +1,183 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "index_map_manager.h"
+#include <algorithm>
+#include <vector>
+#include "logic_block.h"
+#include "common/func.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+
+    IndexMapManager::IndexMapManager() :
+      pin_count_(0), mlock_(false)
+    {
+      memset(&stat_, 0, sizeof(stat_));
+    }
+
+    IndexMapManager::~IndexMapManager()
+    {
+    }
+
+    void IndexMapManager::initialize(const int64_t budget, const int32_t pin_count, const bool mlock)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      stat_.budget_ = budget > 0 ? budget : 0;
+      pin_count_ = pin_count > 0 ? pin_count : 0;
+      mlock_ = mlock;
+      TBSYS_LOG(INFO, "index map manager, budget: %" PRI64_PREFIX "d, pin count: %d, mlock: %d",
+          stat_.budget_, pin_count_, mlock_);
+    }
+
+    void IndexMapManager::check(const std::list<LogicBlock*>& logic_blocks)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      if (stat_.budget_ <= 0 && pin_count_ <= 0 && 0 == stat_.pinned_count_)
+      {
+        // nothing to enforce, count the mapped size only and leave the pages unscanned
+        int64_t map_size = 0;
+        int32_t block_count = 0;
+        for (std::list<LogicBlock*>::const_iterator it = logic_blocks.begin(); it != logic_blocks.end(); ++it)
+        {
+          int32_t size = (*it)->get_index_map_size();
+          if (size > 0)
+          {
+            map_size += size;
+            ++block_count;
+          }
+        }
+        states_.clear();
+        stat_.map_size_ = map_size;
+        stat_.resident_size_ = 0;
+        stat_.block_count_ = block_count;
+        return;
+      }
+
+      std::vector<BlockMapEntry> entries;
+      entries.reserve(logic_blocks.size());
+      BlockMapStateMap states;
+      int64_t map_size = 0;
+      int64_t resident_size = 0;
+      for (std::list<LogicBlock*>::const_iterator it = logic_blocks.begin(); it != logic_blocks.end(); ++it)
+      {
+        LogicBlock* logic_block = *it;
+        int32_t size = logic_block->get_index_map_size();
+        if (size <= 0) // index not loaded yet
+        {
+          continue;
+        }
+
+        BlockMapEntry entry;
+        entry.logic_block_ = logic_block;
+        entry.resident_size_ = logic_block->get_index_resident_size();
+        entry.last_access_ = logic_block->get_last_access();
+        entry.pinned_ = false;
+        BlockMapState state;
+        state.visit_count_ = logic_block->get_visit_count();
+        state.score_ = state.visit_count_;
+        BlockMapStateMapIter sit = states_.find(logic_block->get_logic_block_id());
+        if (sit != states_.end())
+        {
+          entry.pinned_ = sit->second.pinned_;
+          state.score_ = sit->second.score_ / 2;
+          if (state.visit_count_ >= sit->second.visit_count_)
+          {
+            state.score_ += state.visit_count_ - sit->second.visit_count_;
+          }
+        }
+        entry.score_ = state.score_;
+        state.pinned_ = entry.pinned_;
+        states[logic_block->get_logic_block_id()] = state;
+
+        map_size += size;
+        resident_size += entry.resident_size_;
+        entries.push_back(entry);
+      }
+
+      std::vector<BlockMapEntry*> sorted_entries;
+      sorted_entries.reserve(entries.size());
+      for (uint32_t i = 0; i < entries.size(); ++i)
+      {
+        sorted_entries.push_back(&entries[i]);
+      }
+
+      // pin the hottest, unpin those cooled down
+      std::sort(sorted_entries.begin(), sorted_entries.end(), ScoreSort());
+      int32_t pinned_count = 0;
+      for (uint32_t i = 0; i < sorted_entries.size(); ++i)
+      {
+        BlockMapEntry* entry = sorted_entries[i];
+        bool pin = static_cast<int32_t>(i) < pin_count_ && entry->score_ > 0;
+        if (pin != entry->pinned_ && mlock_)
+        {
+          entry->logic_block_->lock_index(pin);
+        }
+        entry->pinned_ = pin;
+        states[entry->logic_block_->get_logic_block_id()].pinned_ = pin;
+        if (pin)
+        {
+          ++pinned_count;
+        }
+      }
+
+      // release the least recently accessed till under the budget
+      int32_t release_count = 0;
+      if (stat_.budget_ > 0 && resident_size > stat_.budget_)
+      {
+        std::sort(sorted_entries.begin(), sorted_entries.end(), LastAccessSort());
+        for (uint32_t i = 0; i < sorted_entries.size() && resident_size > stat_.budget_; ++i)
+        {
+          BlockMapEntry* entry = sorted_entries[i];
+          if (entry->pinned_ || entry->resident_size_ <= 0)
+          {
+            continue;
+          }
+          if (TFS_SUCCESS == entry->logic_block_->release_index())
+          {
+            resident_size -= entry->resident_size_;
+            ++release_count;
+          }
+        }
+        TBSYS_LOG(INFO, "index memory over budget, released %d indexes, resident now: %" PRI64_PREFIX
+            "d, budget: %" PRI64_PREFIX "d", release_count, resident_size, stat_.budget_);
+      }
+
+      states_.swap(states);
+      stat_.map_size_ = map_size;
+      stat_.resident_size_ = resident_size;
+      stat_.block_count_ = entries.size();
+      stat_.pinned_count_ = pinned_count;
+      stat_.release_count_ += release_count;
+    }
+
+    void IndexMapManager::get_stat(IndexMapStat& stat)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      stat = stat_;
+    }
+
+    std::string IndexMapManager::format_stat()
+    {
+      IndexMapStat stat;
+      get_stat(stat);
+      char buf[256];
+      snprintf(buf, sizeof(buf), "index budget: %s, mapped: %s, resident: %s, blocks: %d, pinned: %d, released: %"
+          PRI64_PREFIX "d", stat.budget_ > 0 ? Func::format_size(stat.budget_).c_str() : "unlimited",
+          Func::format_size(stat.map_size_).c_str(), Func::format_size(stat.resident_size_).c_str(),
+          stat.block_count_, stat.pinned_count_, stat.release_count_);
+      return buf;
+    }
+  }
+}
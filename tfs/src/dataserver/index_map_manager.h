@@ -0,0 +1,107 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_INDEXMAPMANAGER_H_
+#define TFS_DATASERVER_INDEXMAPMANAGER_H_
+
+#include <list>
+#include <map>
+#include <string>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    class LogicBlock;
+
+    struct IndexMapStat
+    {
+      int64_t budget_;        // bytes of index pages allowed in memory, 0 no limit
+      int64_t map_size_;      // bytes mapped by all indexes
+      int64_t resident_size_; // bytes of index pages in memory, not measured with no budget nor pin
+      int32_t block_count_;   // blocks with the index mapped
+      int32_t pinned_count_;
+      int64_t release_count_; // indexes released since start
+    };
+
+    // node wide view of the memory taken by block indexes, updated by check() in the
+    // dataserver check thread. every check halves the visit score of a block and adds
+    // its visits since the last one; the indexes of the blocks with the highest scores
+    // are pinned (and mlocked if asked). when the index pages in memory are over
+    // the budget, the other indexes are released in the order of their last access till
+    // under it again. a released index stays mapped, as LogicBlock pointers are held
+    // without reference: its pages are written back and dropped, and fault in again
+    // at the next access.
+    class IndexMapManager
+    {
+      public:
+        IndexMapManager();
+        ~IndexMapManager();
+
+        static IndexMapManager* get_instance()
+        {
+          static IndexMapManager s_index_map_manager;
+          return &s_index_map_manager;
+        }
+
+        // budget in bytes, <= 0 no limit
+        void initialize(const int64_t budget, const int32_t pin_count, const bool mlock);
+        void check(const std::list<LogicBlock*>& logic_blocks);
+
+        void get_stat(IndexMapStat& stat);
+        std::string format_stat();
+
+      private:
+        struct BlockMapEntry
+        {
+          LogicBlock* logic_block_;
+          int32_t resident_size_;
+          int64_t score_;
+          time_t last_access_;
+          bool pinned_;
+        };
+        struct ScoreSort
+        {
+          bool operator()(const BlockMapEntry* left, const BlockMapEntry* right) const
+          {
+            return left->score_ > right->score_;
+          }
+        };
+        struct LastAccessSort
+        {
+          bool operator()(const BlockMapEntry* left, const BlockMapEntry* right) const
+          {
+            return left->last_access_ < right->last_access_;
+          }
+        };
+        struct BlockMapState
+        {
+          int32_t visit_count_; // at the last check
+          int64_t score_;
+          bool pinned_;
+        };
+        typedef std::map<uint32_t, BlockMapState> BlockMapStateMap;
+        typedef BlockMapStateMap::iterator BlockMapStateMapIter;
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(IndexMapManager);
+
+        tbutil::Mutex mutex_;
+        BlockMapStateMap states_;
+        IndexMapStat stat_;
+        int32_t pin_count_;
+        bool mlock_;
+    };
+  }
+}
+#endif //TFS_DATASERVER_INDEXMAPMANAGER_H_
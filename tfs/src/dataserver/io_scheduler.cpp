@@ -0,0 +1,295 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "io_scheduler.h"
+#include <tbsys.h>
+#include <Memory.hpp>
+#include "logic_block.h"
+#include "common/error_msg.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+
+    // share of io threads when all classes are busy
+    const int32_t IOScheduler::CLASS_WEIGHT[IO_CLASS_COUNT] = { 8, 4, 2, 1 };
+    static const char* CLASS_NAME[IO_CLASS_COUNT] = { "read", "write", "replicate", "compact" };
+
+    // runs a raw read/write of a logic block
+    class RawDataTask: public IOTask
+    {
+      public:
+        RawDataTask(LogicBlock* logic_block, char* buf, const int32_t nbytes, const int32_t offset, const bool write,
+            const IOPolicy policy) :
+          logic_block_(logic_block), buf_(buf), nbytes_(nbytes), offset_(offset), write_(write), policy_(policy),
+          ret_(TFS_SUCCESS)
+        {
+        }
+        virtual ~RawDataTask()
+        {
+        }
+        virtual void run()
+        {
+          ret_ = write_ ? logic_block_->write_raw_data(buf_, nbytes_, offset_, policy_)
+            : logic_block_->read_raw_data(buf_, nbytes_, offset_, policy_);
+        }
+
+      public:
+        LogicBlock* logic_block_;
+        char* buf_;
+        int32_t nbytes_;
+        int32_t offset_;
+        bool write_;
+        IOPolicy policy_;
+        int ret_;
+    };
+
+    IOScheduler::IOScheduler() :
+      threads_(NULL), thread_count_(0), max_queue_size_(0), stop_(false)
+    {
+      memset(credits_, 0, sizeof(credits_));
+      memset(stats_, 0, sizeof(stats_));
+      for (int32_t i = 0; i < IO_CLASS_COUNT; ++i)
+      {
+        io_policy_[i] = IO_POLICY_CACHED;
+      }
+    }
+
+    IOScheduler::~IOScheduler()
+    {
+      stop();
+      wait();
+    }
+
+    int IOScheduler::initialize(const std::string& device, const int32_t thread_count, const int32_t max_queue_size)
+    {
+      if (thread_count < 0 || NULL != threads_)
+      {
+        return EXIT_INVALID_ARGU;
+      }
+      device_ = device;
+      max_queue_size_ = max_queue_size;
+      stop_ = false;
+      if (thread_count > 0)
+      {
+        threads_ = new IOThreadHelperPtr[thread_count];
+        for (int32_t i = 0; i < thread_count; ++i)
+        {
+          threads_[i] = new IOThreadHelper(*this);
+        }
+      }
+      thread_count_ = thread_count;
+      TBSYS_LOG(INFO, "io scheduler of device: %s, io threads: %d, max queue size: %d", device_.c_str(), thread_count_,
+          max_queue_size_);
+      return TFS_SUCCESS;
+    }
+
+    void IOScheduler::stop()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      stop_ = true;
+      monitor_.notifyAll();
+    }
+
+    void IOScheduler::wait()
+    {
+      if (NULL != threads_)
+      {
+        for (int32_t i = 0; i < thread_count_; ++i)
+        {
+          threads_[i]->join();
+          threads_[i] = 0;
+        }
+        tbsys::gDeleteA(threads_);
+      }
+
+      // tasks left, run them here so that waiters are released and packets replied
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      thread_count_ = 0;
+      IOTask* task = NULL;
+      while (NULL != (task = pick_task()))
+      {
+        lock.release();
+        task->run();
+        lock.acquire();
+        if (task->detached_)
+        {
+          tbsys::gDelete(task);
+        }
+        else
+        {
+          task->done_ = true;
+        }
+      }
+      monitor_.notifyAll();
+    }
+
+    int IOScheduler::submit(IOTask* task, const IOClass io_class)
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      if (thread_count_ <= 0 || stop_
+          || (max_queue_size_ > 0 && static_cast<int32_t>(queues_[io_class].size()) >= max_queue_size_))
+      {
+        return EXIT_IO_QUEUE_FULL_ERROR;
+      }
+      task->detached_ = true;
+      enqueue(task, io_class);
+      return TFS_SUCCESS;
+    }
+
+    void IOScheduler::execute(IOTask& task, const IOClass io_class)
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      if (thread_count_ <= 0 || stop_)
+      {
+        lock.release();
+        task.run();
+        return;
+      }
+      task.detached_ = false;
+      task.done_ = false;
+      enqueue(&task, io_class);
+      while (!task.done_)
+      {
+        monitor_.wait();
+      }
+    }
+
+    void IOScheduler::set_io_policy(const IOClass io_class, const IOPolicy policy)
+    {
+      static const char* POLICY_NAME[] = { "cached", "dontneed", "direct" };
+      io_policy_[io_class] = policy;
+      TBSYS_LOG(INFO, "io policy of %s: %s", CLASS_NAME[io_class], POLICY_NAME[policy]);
+    }
+
+    int IOScheduler::read_raw_data(const IOClass io_class, LogicBlock* logic_block, char* buf, int32_t& nbytes,
+        const int32_t offset)
+    {
+      RawDataTask task(logic_block, buf, nbytes, offset, false, io_policy_[io_class]);
+      execute(task, io_class);
+      nbytes = task.nbytes_;
+      return task.ret_;
+    }
+
+    int IOScheduler::write_raw_data(const IOClass io_class, LogicBlock* logic_block, const char* buf,
+        const int32_t nbytes, const int32_t offset)
+    {
+      RawDataTask task(logic_block, const_cast<char*>(buf), nbytes, offset, true, io_policy_[io_class]);
+      execute(task, io_class);
+      return task.ret_;
+    }
+
+    void IOScheduler::get_stat(const IOClass io_class, IOClassStat& stat)
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      stat = stats_[io_class];
+      stat.queue_depth_ = queues_[io_class].size();
+    }
+
+    void IOScheduler::dump_stat()
+    {
+      for (int32_t i = 0; i < IO_CLASS_COUNT; ++i)
+      {
+        IOClassStat stat;
+        get_stat(static_cast<IOClass>(i), stat);
+        TBSYS_LOG(INFO, "io stat, device: %s, class: %s, queue depth: %" PRI64_PREFIX "d, count: %" PRI64_PREFIX
+            "d, avg wait: %" PRI64_PREFIX "d us, avg service: %" PRI64_PREFIX "d us", device_.c_str(), CLASS_NAME[i],
+            stat.queue_depth_, stat.count_, 0 == stat.count_ ? 0 : stat.wait_time_ / stat.count_,
+            0 == stat.count_ ? 0 : stat.service_time_ / stat.count_);
+      }
+    }
+
+    void IOScheduler::IOThreadHelper::run()
+    {
+      scheduler_.run_io_thread();
+    }
+
+    void IOScheduler::run_io_thread()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      while (!stop_)
+      {
+        IOTask* task = pick_task();
+        if (NULL == task)
+        {
+          monitor_.wait();
+          continue;
+        }
+
+        IOClass io_class = task->io_class_;
+        int64_t start = tbsys::CTimeUtil::getTime();
+        stats_[io_class].wait_time_ += start - task->enqueue_time_;
+        lock.release();
+        task->run();
+        int64_t end = tbsys::CTimeUtil::getTime();
+        lock.acquire();
+
+        stats_[io_class].service_time_ += end - start;
+        ++stats_[io_class].count_;
+        if (task->detached_)
+        {
+          // packet tasks reply in run(), nobody waits for them
+          lock.release();
+          tbsys::gDelete(task);
+          lock.acquire();
+        }
+        else
+        {
+          task->done_ = true;
+          monitor_.notifyAll();
+        }
+      }
+    }
+
+    // weighted round robin: a class takes at most its weight of tasks in a round,
+    // a new round starts when no class with waiting tasks has credit left
+    IOTask* IOScheduler::pick_task()
+    {
+      for (int32_t round = 0; round < 2; ++round)
+      {
+        bool waiting = false;
+        for (int32_t i = 0; i < IO_CLASS_COUNT; ++i)
+        {
+          if (!queues_[i].empty())
+          {
+            waiting = true;
+            if (credits_[i] > 0)
+            {
+              --credits_[i];
+              IOTask* task = queues_[i].front();
+              queues_[i].pop_front();
+              return task;
+            }
+          }
+        }
+        if (!waiting)
+        {
+          break;
+        }
+        for (int32_t i = 0; i < IO_CLASS_COUNT; ++i)
+        {
+          credits_[i] = CLASS_WEIGHT[i];
+        }
+      }
+      return NULL;
+    }
+
+    void IOScheduler::enqueue(IOTask* task, const IOClass io_class)
+    {
+      task->io_class_ = io_class;
+      task->enqueue_time_ = tbsys::CTimeUtil::getTime();
+      queues_[io_class].push_back(task);
+      monitor_.notifyAll();
+    }
+  }
+}
@@ -0,0 +1,144 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_IOSCHEDULER_H_
+#define TFS_DATASERVER_IOSCHEDULER_H_
+
+#include <deque>
+#include <string>
+#include <Monitor.h>
+#include <Mutex.h>
+#include <TbThread.h>
+#include <Handle.h>
+#include "common/internal.h"
+#include "file_op.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    class LogicBlock;
+
+    enum IOClass
+    {
+      IO_CLASS_READ = 0,   // client reads
+      IO_CLASS_WRITE,      // client writes
+      IO_CLASS_REPLICATE,  // block replication, both sides
+      IO_CLASS_COMPACT,    // block compaction
+      IO_CLASS_COUNT
+    };
+
+    struct IOClassStat
+    {
+      int64_t queue_depth_;  // tasks waiting now
+      int64_t count_;        // tasks done
+      int64_t wait_time_;    // total time in queue, us
+      int64_t service_time_; // total run time, us
+    };
+
+    class IOTask
+    {
+      public:
+        IOTask() : enqueue_time_(0), io_class_(IO_CLASS_READ), done_(false), detached_(false)
+        {
+        }
+        virtual ~IOTask()
+        {
+        }
+        virtual void run() = 0;
+
+      private:
+        friend class IOScheduler;
+        int64_t enqueue_time_;
+        IOClass io_class_;
+        bool done_;
+        bool detached_; // submitted, deleted by scheduler when done
+    };
+
+    // disk io queue of a device, DiskManager has one for each disk. every class of io has its own
+    // queue, io threads take tasks from the queues by weighted round robin, so a burst of one class
+    // (a replication, a compaction) can not starve the others.
+    // with no io thread, tasks are run in the calling thread.
+    class IOScheduler
+    {
+      public:
+        IOScheduler();
+        ~IOScheduler();
+
+        int initialize(const std::string& device, const int32_t thread_count, const int32_t max_queue_size);
+        void stop();
+        void wait();
+        inline bool enabled() const
+        {
+          return thread_count_ > 0;
+        }
+
+        // queue task, the scheduler deletes it when done.
+        // fail if not enabled or the class queue is full, the task is not taken then
+        int submit(IOTask* task, const IOClass io_class);
+        // run task in an io thread and wait for it
+        void execute(IOTask& task, const IOClass io_class);
+
+        // page cache policy of raw data io of a class, all classes are IO_POLICY_CACHED by default
+        void set_io_policy(const IOClass io_class, const IOPolicy policy);
+        inline IOPolicy get_io_policy(const IOClass io_class) const
+        {
+          return io_policy_[io_class];
+        }
+
+        int read_raw_data(const IOClass io_class, LogicBlock* logic_block, char* buf, int32_t& nbytes,
+            const int32_t offset);
+        int write_raw_data(const IOClass io_class, LogicBlock* logic_block, const char* buf, const int32_t nbytes,
+            const int32_t offset);
+
+        void get_stat(const IOClass io_class, IOClassStat& stat);
+        void dump_stat();
+
+      private:
+        class IOThreadHelper: public tbutil::Thread
+        {
+          public:
+            explicit IOThreadHelper(IOScheduler& scheduler):
+              scheduler_(scheduler)
+            {
+              start();
+            }
+            virtual ~IOThreadHelper(){}
+            void run();
+          private:
+            DISALLOW_COPY_AND_ASSIGN(IOThreadHelper);
+            IOScheduler& scheduler_;
+        };
+        typedef tbutil::Handle<IOThreadHelper> IOThreadHelperPtr;
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(IOScheduler);
+        void run_io_thread();
+        IOTask* pick_task();
+        void enqueue(IOTask* task, const IOClass io_class);
+
+      private:
+        static const int32_t CLASS_WEIGHT[IO_CLASS_COUNT];
+
+        tbutil::Monitor<tbutil::Mutex> monitor_;
+        std::deque<IOTask*> queues_[IO_CLASS_COUNT];
+        int32_t credits_[IO_CLASS_COUNT]; // tasks a class may still take in this round
+        IOClassStat stats_[IO_CLASS_COUNT];
+        IOPolicy io_policy_[IO_CLASS_COUNT];
+        IOThreadHelperPtr* threads_;
+        std::string device_;
+        int32_t thread_count_;
+        int32_t max_queue_size_;
+        bool stop_;
+    };
+  }
+}
+#endif //TFS_DATASERVER_IOSCHEDULER_H_
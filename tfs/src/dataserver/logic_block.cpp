@@ -16,7 +16,10 @@
  *
  */
 #include "logic_block.h"
+#include <algorithm>
 #include "blockfile_manager.h"
+#include "read_ahead.h"
+#include "common/parameter.h"
 
 namespace tfs
 {
@@ -27,8 +30,10 @@ namespace tfs
 
     LogicBlock::LogicBlock(const uint32_t logic_block_id, const uint32_t main_blk_key, const std::string& base_path) :
       logic_block_id_(logic_block_id), avail_data_size_(0), visit_count_(0), last_update_(time(NULL)),
-          last_abnorm_time_(0)
+          last_access_(last_update_), last_abnorm_time_(0), block_manager_(NULL), committing_(false), loaded_(true),
+          bucket_size_(0)
     {
+      memset(&mmap_option_, 0, sizeof(mmap_option_));
       data_handle_ = new DataHandle(this);
       index_handle_ = new IndexHandle(base_path, main_blk_key);
       physical_block_list_.clear();
@@ -36,8 +41,10 @@ namespace tfs
 
     LogicBlock::LogicBlock(const uint32_t logic_block_id) :
       logic_block_id_(logic_block_id), avail_data_size_(0), visit_count_(0),
-          last_update_(time(NULL)), last_abnorm_time_(0), data_handle_(NULL), index_handle_(NULL)
+          last_update_(time(NULL)), last_access_(last_update_), last_abnorm_time_(0), data_handle_(NULL), index_handle_(NULL),
+          block_manager_(NULL), committing_(false), loaded_(true), bucket_size_(0)
     {
+      memset(&mmap_option_, 0, sizeof(mmap_option_));
     }
 
     LogicBlock::~LogicBlock()
@@ -69,7 +76,12 @@ namespace tfs
       }
 
       // create index handle
-      return index_handle_->create(logic_block_id_, bucket_size, mmap_option, dirty_flag);
+      int ret = index_handle_->create(logic_block_id_, bucket_size, mmap_option, dirty_flag);
+      if (TFS_SUCCESS == ret)
+      {
+        ret = index_handle_->build_meta_table();
+      }
+      return ret;
     }
 
     int LogicBlock::load_block_file(const int32_t bucket_size, const MMapOption mmap_option)
@@ -80,7 +92,78 @@ namespace tfs
       }
 
       // startup, mmap index file
-      return index_handle_->load(logic_block_id_, bucket_size, mmap_option);
+      int ret = index_handle_->load(logic_block_id_, bucket_size, mmap_option);
+      if (TFS_SUCCESS == ret)
+      {
+        ret = index_handle_->build_meta_table();
+      }
+      return ret;
+    }
+
+    int LogicBlock::load_block_header(const int32_t bucket_size, const MMapOption mmap_option)
+    {
+      if (0 == logic_block_id_)
+      {
+        return EXIT_BLOCKID_ZERO_ERROR;
+      }
+
+      int ret = index_handle_->load_header(logic_block_id_, bucket_size);
+      if (TFS_SUCCESS == ret)
+      {
+        tbutil::Mutex::Lock lock(load_mutex_);
+        bucket_size_ = bucket_size;
+        mmap_option_ = mmap_option;
+        loaded_ = false;
+      }
+      return ret;
+    }
+
+    int LogicBlock::check_load()
+    {
+      int ret = TFS_SUCCESS;
+      // the flag is only read under the lock, so the index built by another thread is seen whole
+      tbutil::Mutex::Lock lock(load_mutex_);
+      if (!loaded_)
+      {
+        int64_t start = tbsys::CTimeUtil::getTime();
+        ret = load_block_file(bucket_size_, mmap_option_);
+        loaded_ = (TFS_SUCCESS == ret);
+        TBSYS_LOG(INFO, "lazy load blockid: %u, ret: %d, cost: %" PRI64_PREFIX "d(us)",
+            logic_block_id_, ret, tbsys::CTimeUtil::getTime() - start);
+      }
+      return ret;
+    }
+
+    bool LogicBlock::is_loaded() const
+    {
+      tbutil::Mutex::Lock lock(load_mutex_);
+      return loaded_;
+    }
+
+    int32_t LogicBlock::get_index_map_size()
+    {
+      ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
+      return index_handle_->map_size();
+    }
+
+    int32_t LogicBlock::get_index_resident_size()
+    {
+      // mincore over the map, it is not released or remapped meanwhile
+      ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
+      return index_handle_->resident_size();
+    }
+
+    int LogicBlock::release_index()
+    {
+      // the map is not moved by a remap meanwhile
+      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
+      return index_handle_->release_map();
+    }
+
+    int LogicBlock::lock_index(const bool lock)
+    {
+      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
+      return index_handle_->lock_map(lock);
     }
 
     int LogicBlock::delete_block_file()
@@ -125,250 +208,344 @@ namespace tfs
       return ret;
     }
 
+    // group commit: a closing thread queues its file, the first one finding no commit in
+    // progress becomes the leader, it waits at most group_commit_max_delay for more closes,
+    // then writes all queued files in one critical section and wakes up their threads.
     int LogicBlock::close_write_file(const uint64_t inner_file_id, DataFile* datafile, const uint32_t crc)
     {
-      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
-
-      RawMeta file_meta;
-      // check if exist
-      int ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
-      if (TFS_SUCCESS == ret)
+      CloseFileRequest request;
+      request.inner_file_id_ = inner_file_id;
+      request.datafile_ = datafile;
+      request.crc_ = crc;
+      request.ret_ = TFS_SUCCESS;
+      request.done_ = false;
+
+      const int32_t max_delay = SYSPARAM_DATASERVER.group_commit_max_delay_;
+      const int32_t max_count = std::max(SYSPARAM_DATASERVER.group_commit_max_count_, 1);
+      std::vector<CloseFileRequest*> requests;
+
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(commit_monitor_);
+      commit_queue_.push_back(&request);
+      if (committing_ && static_cast<int32_t>(commit_queue_.size()) >= max_count)
       {
-        TBSYS_LOG(INFO, "file exist, update! blockid: %u, fileid: %" PRI64_PREFIX "u", logic_block_id_, inner_file_id);
+        // group is full, no need to wait any longer
+        commit_monitor_.notifyAll();
       }
 
-      // save backup for roll back if update meta fail
-      RawMeta bak_file_meta(file_meta);
-
-      int32_t file_size = datafile->get_length();
-      FileInfo tfs_file_info, old_file_info;
-      tfs_file_info.id_ = inner_file_id;
-      tfs_file_info.size_ = file_size + sizeof(FileInfo);
-      tfs_file_info.flag_ = 0;
-      tfs_file_info.modify_time_ = time(NULL);
-      tfs_file_info.create_time_ = time(NULL);
-      tfs_file_info.crc_ = crc;
-
-      bool need_update_meta = true, commit_offset = true;
-      // commit
-      OperType oper_type = C_OPER_UPDATE;
-      int32_t old_size = 0, block_offset = 0;
-
-      // already exist
-      if (file_meta.get_file_id() == inner_file_id)
+      while (!request.done_)
       {
-        TBSYS_LOG(INFO, "write file. fileid equal. blockid: %u, fileid: %" PRI64_PREFIX "u", logic_block_id_,
-            inner_file_id);
-
-        ret = data_handle_->read_segment_info(&old_file_info, file_meta.get_offset());
-        if (TFS_SUCCESS != ret)
+        if (committing_)
         {
-          TBSYS_LOG(ERROR, "read FileInfo fail, blockid: %u, fileid: %" PRI64_PREFIX "u, ret: %d", logic_block_id_,
-              inner_file_id, ret);
+          commit_monitor_.wait();
+          continue;
         }
-        else // read successful
-        {
-          // use old time
-          tfs_file_info.create_time_ = old_file_info.create_time_;
-          // reallocate if require space is larger then origin space
-          int32_t require_size = file_size + sizeof(FileInfo);
-          if (require_size > old_file_info.usize_)
-          {
-            old_size = old_file_info.usize_;
-            block_offset = index_handle_->get_block_data_offset();
 
-            TBSYS_LOG(
-                INFO,
-                "update file. require size: %d > origin size: %d. need reallocate, blockid: %u, fileid: %" PRI64_PREFIX "u, offset: %d",
-                require_size, old_size, logic_block_id_, inner_file_id, block_offset);
+        committing_ = true;
+        if (max_delay > 0 && static_cast<int32_t>(commit_queue_.size()) < max_count)
+        {
+          commit_monitor_.timedWait(tbutil::Time::microSeconds(max_delay));
+        }
 
-            tfs_file_info.offset_ = block_offset;
-            tfs_file_info.usize_ = require_size;
-            file_meta.set_offset(block_offset);
-          }
-          else
+        // the same file closed twice in one group would see a stale meta, leave it to the next group
+        requests.clear();
+        while (!commit_queue_.empty() && static_cast<int32_t>(requests.size()) < max_count)
+        {
+          CloseFileRequest* next = commit_queue_.front();
+          std::vector<CloseFileRequest*>::iterator it = requests.begin();
+          for (; it != requests.end() && (*it)->inner_file_id_ != next->inner_file_id_; ++it)
+            ;
+          if (it != requests.end())
           {
-            // original space ok, just update, no need to commit block total data offset
-            commit_offset = false;
-            tfs_file_info.offset_ = file_meta.get_offset();
-            tfs_file_info.usize_ = old_file_info.usize_;
+            break;
           }
-          // modify meta size
-          file_meta.set_size(require_size);
-          index_handle_->update_segment_meta(file_meta.get_key(), file_meta);
+          requests.push_back(next);
+          commit_queue_.pop_front();
         }
-      }
 
-      // first allocate space or read fail
-      if (file_meta.get_file_id() != inner_file_id || ret)
-      {
-        need_update_meta = false;
-        oper_type = C_OPER_INSERT;
-        old_size = 0;
-        tfs_file_info.usize_ = file_size + sizeof(FileInfo);
-        block_offset = index_handle_->get_block_data_offset();
-        tfs_file_info.offset_ = block_offset;
-        file_meta.set_key(inner_file_id);
-        file_meta.set_size(file_size + sizeof(FileInfo));
-        file_meta.set_offset(block_offset);
+        lock.release();
+        commit_close_files(requests);
+        lock.acquire();
 
-        ret = index_handle_->write_segment_meta(file_meta.get_key(), file_meta);
-        if (TFS_SUCCESS != ret)
+        for (std::vector<CloseFileRequest*>::iterator it = requests.begin(); it != requests.end(); ++it)
         {
-          return ret;
+          (*it)->done_ = true;
         }
+        committing_ = false;
+        commit_monitor_.notifyAll();
       }
+      return request.ret_;
+    }
 
-      char* tmp_data_buffer = NULL;
-      int32_t read_len = 0, read_offset = 0;
-      int32_t write_len = 0, write_offset = 0;
+    // new files and files grown larger are laid out one after another from the end of block
+    // data and written by one gather write, files fitting their old space are rewritten in place.
+    // index is updated after the data is written and flushed once for the group.
+    int LogicBlock::commit_close_files(std::vector<CloseFileRequest*>& requests)
+    {
+      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
 
-      // if extend block
-      do
+      std::vector<CloseFileRequest*>::iterator it = requests.begin();
+      int32_t data_offset = index_handle_->get_block_data_offset();
+      int32_t append_offset = data_offset;
+      for (; it != requests.end(); ++it)
       {
-        ret = extend_block(file_meta.get_size(), file_meta.get_offset());
-        if (TFS_SUCCESS != ret)
-          break;
+        (*it)->ret_ = prepare_close_file(**it, append_offset);
+      }
 
-        // write data from datafile to block
-        while ((tmp_data_buffer = datafile->get_data(NULL, &read_len, read_offset)) != NULL)
+      int ret = TFS_SUCCESS;
+      if (append_offset > data_offset)
+      {
+        ret = extend_block(append_offset - data_offset, data_offset);
+        if (TFS_SUCCESS == ret)
         {
-          if (read_len < 0 || (read_len + read_offset) > file_size)
+          std::vector<struct iovec> append_iov;
+          for (it = requests.begin(); it != requests.end(); ++it)
           {
-            TBSYS_LOG(ERROR, "getdata fail, blockid: %u, fileid: %" PRI64_PREFIX "u, size: %d, offset: %d, rlen: %d",
-                logic_block_id_, inner_file_id, file_size, read_offset, read_len);
-            ret = TFS_ERROR;
-            break;
+            if (TFS_SUCCESS == (*it)->ret_ && (*it)->append_)
+            {
+              append_iov.insert(append_iov.end(), (*it)->iov_.begin(), (*it)->iov_.end());
+            }
           }
+          ret = data_handle_->write_segment_datav(&append_iov[0], append_iov.size(), data_offset);
+        }
 
-          // read finish
-          if (0 == read_len)
+        if (TFS_SUCCESS != ret)
+        {
+          TBSYS_LOG(ERROR, "blockid: %u write data error, offset: %d, size: %d, ret: %d", logic_block_id_,
+              data_offset, append_offset - data_offset, ret);
+          for (it = requests.begin(); it != requests.end(); ++it)
           {
-            break;
+            if (TFS_SUCCESS == (*it)->ret_ && (*it)->append_)
+            {
+              (*it)->ret_ = ret;
+            }
           }
+        }
+        else
+        {
+          index_handle_->commit_block_data_offset(append_offset - data_offset);
+        }
+      }
 
-          write_len = read_len;
-          // first read, write fileinfo
-          if (0 == read_offset)
+      IndexBatch batch;
+      for (it = requests.begin(); it != requests.end(); ++it)
+      {
+        CloseFileRequest& request = **it;
+        if (TFS_SUCCESS == request.ret_ && !request.append_)
+        {
+          request.ret_ = data_handle_->write_segment_datav(&request.iov_[0], request.iov_.size(),
+              request.file_info_.offset_);
+          if (TFS_SUCCESS != request.ret_)
           {
-            write_len += sizeof(FileInfo);
+            TBSYS_LOG(ERROR, "blockid: %u write data error, fileid: %" PRI64_PREFIX "u, size: %d, offset: %d, ret: %d",
+                logic_block_id_, request.inner_file_id_, request.file_info_.size_, request.file_info_.offset_,
+                request.ret_);
           }
+        }
+        if (TFS_SUCCESS == request.ret_)
+        {
+          stage_close_file(request, batch);
+        }
+      }
 
-          // write length corrupt
-          if (write_offset + write_len > file_meta.get_size())
-          {
-            ret = EXIT_WRITE_OFFSET_ERROR;
-            break;
-          }
+      // index of the group in one batch, if it fails apply one by one so that only the bad ones fail
+      bool batch_applied = TFS_SUCCESS == index_handle_->apply_batch(batch);
+      for (it = requests.begin(); it != requests.end(); ++it)
+      {
+        CloseFileRequest& request = **it;
+        if (TFS_SUCCESS == request.ret_ && !batch_applied)
+        {
+          request.ret_ = apply_close_file(request);
+        }
+        TBSYS_LOG(DEBUG, "close write file, blockid: %u, fileid: %" PRI64_PREFIX "u, group size: %d, batch: %d, ret: %d",
+            logic_block_id_, request.inner_file_id_, static_cast<int32_t>(requests.size()), batch_applied, request.ret_);
+      }
 
-          // write fileinfo
-          if (0 == read_offset)
-          {
-            char* tmp_write_buffer = new char[write_len];
-            memcpy(tmp_write_buffer, &tfs_file_info, sizeof(FileInfo));
-            memcpy(tmp_write_buffer + sizeof(FileInfo), tmp_data_buffer, read_len);
+      //flush index
+      index_handle_->flush();
+      return TFS_SUCCESS;
+    }
 
-            ret = data_handle_->write_segment_data(tmp_write_buffer, write_len, file_meta.get_offset() + write_offset);
-            delete[] tmp_write_buffer;
-          }
-          else                  // write real file data
-          {
-            ret = data_handle_->write_segment_data(tmp_data_buffer, write_len, file_meta.get_offset() + write_offset);
-          }
+    int LogicBlock::prepare_close_file(CloseFileRequest& request, int32_t& append_offset)
+    {
+      const uint64_t inner_file_id = request.inner_file_id_;
+      int32_t file_size = request.datafile_->get_length();
+      FileInfo& tfs_file_info = request.file_info_;
+      tfs_file_info.id_ = inner_file_id;
+      tfs_file_info.size_ = file_size + sizeof(FileInfo);
+      tfs_file_info.flag_ = 0;
+      tfs_file_info.modify_time_ = time(NULL);
+      tfs_file_info.create_time_ = time(NULL);
+      tfs_file_info.crc_ = request.crc_;
+      int32_t require_size = tfs_file_info.size_;
 
-          // check ret(if disk error)
-          if (TFS_SUCCESS != ret)
-          {
-            TBSYS_LOG(
-                ERROR,
-                "blockid: %u write data error, fileid: %" PRI64_PREFIX "u, size: %d offset: %d, rlen: %d, oldsize: %d, ret: %d",
-                logic_block_id_, inner_file_id, file_size, read_offset, read_len, old_size, ret);
-            break;
-          }
+      request.oper_type_ = C_OPER_INSERT;
+      request.old_size_ = 0;
+      request.append_ = true;
 
-          read_offset += read_len;
-          write_offset += write_len;
+      // check if exist
+      RawMeta& file_meta = request.file_meta_;
+      int ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
+      if (TFS_SUCCESS == ret && file_meta.get_file_id() == inner_file_id)
+      {
+        TBSYS_LOG(INFO, "file exist, update! blockid: %u, fileid: %" PRI64_PREFIX "u", logic_block_id_, inner_file_id);
+        FileInfo old_file_info;
+        ret = data_handle_->read_segment_info(&old_file_info, file_meta.get_offset());
+        if (TFS_SUCCESS != ret)
+        {
+          TBSYS_LOG(ERROR, "read FileInfo fail, blockid: %u, fileid: %" PRI64_PREFIX "u, ret: %d", logic_block_id_,
+              inner_file_id, ret);
+          return ret;
         }
 
-        if (TFS_SUCCESS != ret)
+        // save backup for roll back if update meta fail
+        request.old_file_meta_ = file_meta;
+        request.oper_type_ = C_OPER_UPDATE;
+        // use old time
+        tfs_file_info.create_time_ = old_file_info.create_time_;
+        // reallocate if require space is larger then origin space
+        if (require_size > old_file_info.usize_)
+        {
+          request.old_size_ = old_file_info.usize_;
+          TBSYS_LOG(INFO, "update file. require size: %d > origin size: %d. need reallocate, blockid: %u, fileid: %"
+              PRI64_PREFIX "u, offset: %d", require_size, old_file_info.usize_, logic_block_id_, inner_file_id,
+              append_offset);
+        }
+        else
+        {
+          // original space ok, just update, no need to commit block total data offset
+          request.append_ = false;
+          tfs_file_info.offset_ = file_meta.get_offset();
+          tfs_file_info.usize_ = old_file_info.usize_;
+        }
+      }
+
+      // data of datafile
+      request.iov_.clear();
+      struct iovec iov;
+      iov.iov_base = &tfs_file_info;
+      iov.iov_len = sizeof(FileInfo);
+      request.iov_.push_back(iov);
+      char* data = NULL;
+      int32_t read_len = 0, read_offset = 0;
+      while (read_offset < file_size && (data = request.datafile_->get_data(NULL, &read_len, read_offset)) != NULL)
+      {
+        if (read_len <= 0 || (read_len + read_offset) > file_size)
+        {
           break;
+        }
+        iov.iov_base = data;
+        iov.iov_len = read_len;
+        request.iov_.push_back(iov);
+        read_offset += read_len;
+      }
+      if (read_offset != file_size)
+      {
+        TBSYS_LOG(ERROR, "getdata fail, blockid: %u, fileid: %" PRI64_PREFIX "u, size: %d, offset: %d, rlen: %d",
+            logic_block_id_, inner_file_id, file_size, read_offset, read_len);
+        return TFS_ERROR;
+      }
+
+      if (request.append_)
+      {
+        tfs_file_info.offset_ = append_offset;
+        tfs_file_info.usize_ = require_size;
+        append_offset += require_size;
+      }
+      file_meta.set_key(inner_file_id);
+      file_meta.set_size(require_size);
+      file_meta.set_offset(tfs_file_info.offset_);
+      return TFS_SUCCESS;
+    }
 
-        // update index handle statistics
-        if (oper_type == C_OPER_INSERT)
+    void LogicBlock::stage_close_file(const CloseFileRequest& request, IndexBatch& batch)
+    {
+      const RawMeta& file_meta = request.file_meta_;
+      if (C_OPER_INSERT == request.oper_type_)
+      {
+        batch.write_meta(file_meta);
+        batch.update_block_info(C_OPER_INSERT, file_meta.get_size());
+      }
+      else
+      {
+        batch.update_meta(file_meta);
+        if (0 != request.old_size_)
         {
-          ret = index_handle_->update_block_info(C_OPER_INSERT, file_meta.get_size());
-          if (TFS_SUCCESS != ret)
-            break;
+          batch.update_block_info(C_OPER_DELETE, request.old_size_);
+          batch.update_block_info(C_OPER_UPDATE, file_meta.get_size());
         }
-        else if (oper_type == C_OPER_UPDATE)
+        else
         {
-          if (0 != old_size)
-          {
-            ret = index_handle_->update_block_info(C_OPER_DELETE, old_size);
-            if (TFS_SUCCESS != ret)
-              break;
-            ret = index_handle_->update_block_info(C_OPER_UPDATE, file_meta.get_size());
-            if (TFS_SUCCESS != ret)
-              break;
-          }
-          else
-          {
-            ret = index_handle_->update_block_info(C_OPER_UPDATE, 0);
-            if (TFS_SUCCESS != ret)
-              break;
-          }
+          batch.update_block_info(C_OPER_UPDATE, 0);
         }
       }
-      while (0);
+    }
 
-      TBSYS_LOG(DEBUG, "close write file, blockid: %u, fileid: %" PRI64_PREFIX "u, ret: %d", logic_block_id_,
-          inner_file_id, ret);
-      if (TFS_SUCCESS != ret) // error occur
+    int LogicBlock::apply_close_file(CloseFileRequest& request)
+    {
+      RawMeta& file_meta = request.file_meta_;
+      int ret = TFS_SUCCESS;
+      if (C_OPER_INSERT == request.oper_type_)
       {
-        if (need_update_meta)
+        ret = index_handle_->write_segment_meta(file_meta.get_key(), file_meta);
+        if (TFS_SUCCESS == ret)
         {
-          // rollback
-          index_handle_->update_segment_meta(bak_file_meta.get_key(), bak_file_meta);
+          ret = index_handle_->update_block_info(C_OPER_INSERT, file_meta.get_size());
         }
       }
       else
       {
-        if (commit_offset)
+        ret = index_handle_->update_segment_meta(file_meta.get_key(), file_meta);
+        if (TFS_SUCCESS == ret)
         {
-          index_handle_->commit_block_data_offset(file_size + sizeof(FileInfo));
+          if (0 != request.old_size_)
+          {
+            ret = index_handle_->update_block_info(C_OPER_DELETE, request.old_size_);
+            if (TFS_SUCCESS == ret)
+            {
+              ret = index_handle_->update_block_info(C_OPER_UPDATE, file_meta.get_size());
+            }
+          }
+          else
+          {
+            ret = index_handle_->update_block_info(C_OPER_UPDATE, 0);
+          }
+
+          if (TFS_SUCCESS != ret)
+          {
+            // rollback
+            index_handle_->update_segment_meta(request.old_file_meta_.get_key(), request.old_file_meta_);
+          }
         }
       }
-      //flush index
-      index_handle_->flush();
       return ret;
     }
 
     int LogicBlock::read_file(const uint64_t inner_file_id, char* buf, int32_t& nbytes, const int32_t offset, const int8_t flag)
     {
       RawMeta file_meta;
-      // 1. get file meta info(offset)
-      int ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
+      // 1. get file meta info(offset), truncate to right read length
+      int ret = TFS_SUCCESS;
+      {
+        // the meta table is moved by writes, the data is read out of the lock
+        ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
+        ret = get_read_offset(inner_file_id, nbytes, offset, file_meta);
+      }
       if (TFS_SUCCESS != ret)
       {
-        TBSYS_LOG(ERROR, "blockid: %u read file meta fail, fileid: %" PRI64_PREFIX "u, ret: %d", logic_block_id_,
-            inner_file_id, ret);
         return ret;
       }
 
-      // truncate to right read length
-      if (offset + nbytes > file_meta.get_size())
+      // 2. get file data
+      ReadAheadCache* read_ahead = ReadAheadCache::get_instance();
+      if (read_ahead->enabled())
       {
-        nbytes = file_meta.get_size() - offset;
+        ret = read_ahead->read(logic_block_id_, inner_file_id, file_meta.get_size(), data_handle_,
+            file_meta.get_offset(), buf, nbytes, offset);
       }
-      if (nbytes < 0)
+      else
       {
-        TBSYS_LOG(ERROR, "blockid: %u, fileid: %" PRI64_PREFIX "u, read offset: %d, file size: %d, ret: %d",
-            logic_block_id_, inner_file_id, offset, file_meta.get_size(), EXIT_READ_OFFSET_ERROR);
-        return EXIT_READ_OFFSET_ERROR;
+        ret = data_handle_->read_segment_data(buf, nbytes, file_meta.get_offset() + offset);
       }
-
-      // 2. get file data
-      ret = data_handle_->read_segment_data(buf, nbytes, file_meta.get_offset() + offset);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "blockid: %u read data error, fileid: %" PRI64_PREFIX "u, size: %d, offset: %d, ret: %d",
@@ -382,30 +559,91 @@ namespace tfs
       // 3. the first fragment, check fileinfo
       if (0 == offset)
       {
-        if ((flag & READ_DATA_OPTION_FLAG_FORCE))
+        ret = check_file_info(inner_file_id, buf, flag);
+      }
+      return ret;
+    }
+
+    struct BatchReadItemOffsetLess
+    {
+      bool operator()(const BatchReadItem* lhs, const BatchReadItem* rhs) const
+      {
+        return lhs->data_offset_ < rhs->data_offset_;
+      }
+    };
+
+    void LogicBlock::batch_read_file(std::vector<BatchReadItem*>& items, const int8_t flag)
+    {
+      std::vector<BatchReadItem*> reads;
+      {
+        ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
+        for (std::vector<BatchReadItem*>::iterator it = items.begin(); it != items.end(); ++it)
         {
-          if ((((FileInfo *) buf)->id_ != inner_file_id) 
-              || (((((FileInfo *) buf)->flag_) & (FI_DELETED | FI_INVALID )) != 0))
+          BatchReadItem* item = *it;
+          RawMeta file_meta;
+          item->ret_ = get_read_offset(item->inner_file_id_, item->nbytes_, item->offset_, file_meta);
+          if (TFS_SUCCESS == item->ret_)
           {
-            TBSYS_LOG(WARN,
-                "find FileInfo fail, blockid: %u, fileid: %" PRI64_PREFIX "u, id: %" PRI64_PREFIX "u, flag: %d",
-                logic_block_id_, inner_file_id, ((FileInfo *) buf)->id_, ((FileInfo *) buf)->flag_);
-            return EXIT_FILE_INFO_ERROR;
+            item->data_offset_ = file_meta.get_offset() + item->offset_;
+            reads.push_back(item);
           }
         }
-        else
+      }
+
+      // files of a page are usually written together, read them along the disk
+      std::sort(reads.begin(), reads.end(), BatchReadItemOffsetLess());
+      for (std::vector<BatchReadItem*>::iterator it = reads.begin(); it != reads.end(); ++it)
+      {
+        BatchReadItem* item = *it;
+        item->ret_ = data_handle_->read_segment_data(item->buf_, item->nbytes_, item->data_offset_);
+        if (TFS_SUCCESS != item->ret_)
         {
-          if ((((FileInfo *) buf)->id_ != inner_file_id) 
-              || (((((FileInfo *) buf)->flag_) & (FI_DELETED | FI_INVALID | FI_CONCEAL)) != 0))
-          {
-            TBSYS_LOG(WARN,
-                "find FileInfo fail, blockid: %u, fileid: %" PRI64_PREFIX "u, id: %" PRI64_PREFIX "u, flag: %d",
-                logic_block_id_, inner_file_id, ((FileInfo *) buf)->id_, ((FileInfo *) buf)->flag_);
-            return EXIT_FILE_INFO_ERROR;
-          }
+          TBSYS_LOG(ERROR, "blockid: %u batch read data error, fileid: %" PRI64_PREFIX "u, size: %d, offset: %d, ret: %d",
+              logic_block_id_, item->inner_file_id_, item->nbytes_, item->offset_, item->ret_);
+        }
+        else if (0 == item->offset_)
+        {
+          item->ret_ = check_file_info(item->inner_file_id_, item->buf_, flag);
         }
-     }
+      }
+    }
 
+    int LogicBlock::get_read_offset(const uint64_t inner_file_id, int32_t& nbytes, const int32_t offset,
+        RawMeta& file_meta)
+    {
+      int ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "blockid: %u read file meta fail, fileid: %" PRI64_PREFIX "u, ret: %d", logic_block_id_,
+            inner_file_id, ret);
+        return ret;
+      }
+
+      if (offset + nbytes > file_meta.get_size())
+      {
+        nbytes = file_meta.get_size() - offset;
+      }
+      if (nbytes < 0)
+      {
+        TBSYS_LOG(ERROR, "blockid: %u, fileid: %" PRI64_PREFIX "u, read offset: %d, file size: %d, ret: %d",
+            logic_block_id_, inner_file_id, offset, file_meta.get_size(), EXIT_READ_OFFSET_ERROR);
+        return EXIT_READ_OFFSET_ERROR;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int LogicBlock::check_file_info(const uint64_t inner_file_id, const char* buf, const int8_t flag)
+    {
+      const FileInfo* finfo = reinterpret_cast<const FileInfo*>(buf);
+      int32_t invalid_flag = (flag & READ_DATA_OPTION_FLAG_FORCE) ? (FI_DELETED | FI_INVALID)
+        : (FI_DELETED | FI_INVALID | FI_CONCEAL);
+      if (finfo->id_ != inner_file_id || 0 != (finfo->flag_ & invalid_flag))
+      {
+        TBSYS_LOG(WARN,
+            "find FileInfo fail, blockid: %u, fileid: %" PRI64_PREFIX "u, id: %" PRI64_PREFIX "u, flag: %d",
+            logic_block_id_, inner_file_id, finfo->id_, finfo->flag_);
+        return EXIT_FILE_INFO_ERROR;
+      }
       return TFS_SUCCESS;
     }
 
@@ -413,7 +651,11 @@ namespace tfs
     {
       RawMeta file_meta;
       // 1. get file meta info
-      int ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
+      int ret = TFS_SUCCESS;
+      {
+        ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
+        ret = index_handle_->read_segment_meta(inner_file_id, file_meta);
+      }
       if (TFS_SUCCESS != ret)
       {
         return ret;
@@ -473,17 +715,15 @@ namespace tfs
       if (TFS_SUCCESS != ret)
         return ret;
 
-      // 7. write new file meta info
-      ret = index_handle_->override_segment_meta(file_meta.get_key(), file_meta);
+      // 7. write new file meta info, delete old file meta info
+      IndexBatch batch;
+      batch.override_meta(file_meta);
+      batch.delete_meta(old_inner_file_id);
+      ret = index_handle_->apply_batch(batch);
       if (TFS_SUCCESS != ret)
         return ret;
 
-      // 8. delete old file meta info
-      ret = index_handle_->delete_segment_meta(old_inner_file_id);
-      if (TFS_SUCCESS != ret)
-        return ret;
-
-      // 9. flush
+      // 8. flush
       return index_handle_->flush();
     }
 
@@ -600,7 +840,7 @@ namespace tfs
     }
 
     // just read data, consider no data type
-    int LogicBlock::read_raw_data(char* buf, int32_t& nbytes, const int32_t offset)
+    int LogicBlock::read_raw_data(char* buf, int32_t& nbytes, const int32_t offset, const IOPolicy policy)
     {
       ScopedRWLock scoped_lock(rw_lock_, READ_LOCKER);
       if (offset + nbytes > index_handle_->get_block_data_offset())
@@ -614,7 +854,7 @@ namespace tfs
         return EXIT_READ_OFFSET_ERROR;
       }
 
-      int ret = data_handle_->read_segment_data(buf, nbytes, offset);
+      int ret = data_handle_->read_segment_data(buf, nbytes, offset, policy);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR,
@@ -639,7 +879,7 @@ namespace tfs
     }
 
     // just write data, consider no data type
-    int LogicBlock::write_raw_data(const char* buf, const int32_t nbytes, const int32_t offset)
+    int LogicBlock::write_raw_data(const char* buf, const int32_t nbytes, const int32_t offset, const IOPolicy policy)
     {
       if (NULL == buf)
       {
@@ -652,12 +892,17 @@ namespace tfs
       if (TFS_SUCCESS != ret)
         return ret;
 
-      ret = data_handle_->write_segment_data(buf, nbytes, offset);
+      ret = data_handle_->write_segment_data(buf, nbytes, offset, policy);
       if (TFS_SUCCESS != ret)
         return ret;
 
-      // update block total data offset(size)
-      index_handle_->commit_block_data_offset(nbytes);
+      // update block total data offset(size). replicate packets may come out of order or
+      // again after a retry, the size is the end of the farthest one
+      int32_t data_offset = index_handle_->get_block_data_offset();
+      if (offset + nbytes > data_offset)
+      {
+        index_handle_->commit_block_data_offset(offset + nbytes - data_offset);
+      }
       return index_handle_->flush();
     }
 
@@ -669,26 +914,140 @@ namespace tfs
       }
       // 1. ...
       ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
-      int ret = TFS_SUCCESS;
-      // 2. update index block info
-      ret = copy_block_info(blk_info);
-      if (TFS_SUCCESS != ret && EXIT_POINTER_NULL != ret)
+      TBSYS_LOG(DEBUG, "batch write meta list, blockid: %u, meta size: %d", logic_block_id_,
+          static_cast<int32_t>(meta_list->size()));
+      // 2. block info and file meta info, all or none
+      IndexBatch batch;
+      batch.set_block_info(blk_info);
+      for (RawMetaVecConstIter mit = meta_list->begin(); mit != meta_list->end(); ++mit)
       {
-        return ret;
+        batch.override_meta(*mit);
       }
-      TBSYS_LOG(DEBUG, "batch write meta list, blockid: %u, meta size: %d", logic_block_id_, meta_list->size());
-      // 3. write file meta info
-      ret = index_handle_->batch_override_segment_meta(*meta_list);
+      int ret = index_handle_->apply_batch(batch);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "batch override segment meta fail. blockid: %u, ret: %d", logic_block_id_, ret);
         return ret;
       }
 
-      // 4. flush
+      // 3. flush
       return index_handle_->flush();
     }
 
+    int LogicBlock::drop_deleted_files(const RawMetaVec& metas, int32_t& drop_count, int32_t& del_size)
+    {
+      drop_count = 0;
+      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
+      IndexBatch batch;
+      int32_t drop_size = 0;
+      int ret = TFS_SUCCESS;
+      for (RawMetaVec::const_iterator it = metas.begin(); TFS_SUCCESS == ret && it != metas.end(); ++it)
+      {
+        // undeleted or written again since found
+        RawMeta meta;
+        if (TFS_SUCCESS != index_handle_->read_segment_meta(it->get_key(), meta)
+            || meta.get_offset() != it->get_offset() || meta.get_size() != it->get_size())
+        {
+          continue;
+        }
+        FileInfo finfo;
+        ret = data_handle_->read_segment_info(&finfo, meta.get_offset());
+        if (TFS_SUCCESS == ret && finfo.id_ == meta.get_file_id() && (finfo.flag_ & (FI_DELETED | FI_INVALID)))
+        {
+          batch.delete_meta(meta.get_key());
+          ++drop_count;
+          drop_size += meta.get_size();
+        }
+      }
+
+      BlockInfo blk = *index_handle_->block_info();
+      if (TFS_SUCCESS == ret && drop_count > 0)
+      {
+        // their space is counted again as holes when the moves are done
+        blk.file_count_ = blk.file_count_ > drop_count ? blk.file_count_ - drop_count : 0;
+        blk.del_file_count_ = blk.del_file_count_ > drop_count ? blk.del_file_count_ - drop_count : 0;
+        blk.del_size_ = blk.del_size_ > drop_size ? blk.del_size_ - drop_size : 0;
+        batch.set_block_info(&blk);
+        ret = index_handle_->apply_batch(batch);
+        if (TFS_SUCCESS == ret)
+        {
+          ret = index_handle_->flush();
+        }
+      }
+      del_size = blk.del_size_;
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact in place, drop deleted files fail. blockid: %u, ret: %d", logic_block_id_, ret);
+      }
+      return ret;
+    }
+
+    int LogicBlock::commit_moved_files(const std::vector<MovedFile>& moves, const int32_t del_size, int32_t& move_size)
+    {
+      move_size = 0;
+      ScopedRWLock scoped_lock(rw_lock_, WRITE_LOCKER);
+      IndexBatch batch;
+      int ret = TFS_SUCCESS;
+      for (std::vector<MovedFile>::const_iterator it = moves.begin(); TFS_SUCCESS == ret && it != moves.end(); ++it)
+      {
+        // deleted, renamed or rewritten while copied, the copy is left in the hole
+        RawMeta meta;
+        if (TFS_SUCCESS != index_handle_->read_segment_meta(it->meta_.get_key(), meta)
+            || meta.get_offset() != it->meta_.get_offset() || meta.get_size() != it->meta_.get_size())
+        {
+          continue;
+        }
+        FileInfo finfo;
+        ret = data_handle_->read_segment_info(&finfo, meta.get_offset());
+        if (TFS_SUCCESS == ret && 0 == memcmp(&finfo, &it->info_, sizeof(FileInfo)))
+        {
+          // holes are never old places of moved files, so index of all moves can go at once.
+          // the old copy is only cut off by the new data size, a crash before it leaves both
+          meta.set_offset(it->to_offset_);
+          batch.update_meta(meta);
+          move_size += meta.get_size();
+          TBSYS_LOG(DEBUG, "compact in place, blockid: %u, fileid: %" PRI64_PREFIX "u, offset: %d => %d, size: %d",
+              logic_block_id_, meta.get_file_id(), it->meta_.get_offset(), it->to_offset_, meta.get_size());
+        }
+      }
+      if (TFS_SUCCESS == ret)
+      {
+        ret = index_handle_->apply_batch(batch);
+      }
+
+      // files moved down, cut the data off at the end of the last one
+      RawMetaVec metas;
+      if (TFS_SUCCESS == ret)
+      {
+        ret = index_handle_->traverse_segment_meta(metas);
+      }
+      if (TFS_SUCCESS == ret)
+      {
+        int32_t new_end = 0;
+        int32_t file_size = 0;
+        for (RawMetaVecIter it = metas.begin(); it != metas.end(); ++it)
+        {
+          new_end = std::max(new_end, it->get_offset() + it->get_size());
+          file_size += it->get_size();
+        }
+        IndexHeader* header = index_handle_->index_header();
+        if (new_end < header->data_file_offset_)
+        {
+          header->data_file_offset_ = new_end;
+        }
+        // holes left, and files deleted while the moves were made
+        BlockInfo* blk = index_handle_->block_info();
+        blk->size_ = header->data_file_offset_;
+        blk->del_size_ = std::max(blk->size_ - file_size, 0) + std::max(blk->del_size_ - del_size, 0);
+        ret = index_handle_->flush();
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "compact in place, move file fail. blockid: %u, ret: %d", logic_block_id_, ret);
+      }
+      return ret;
+    }
+
     int LogicBlock::copy_block_info(const BlockInfo* blk_info)
     {
       if (NULL == blk_info)
@@ -767,7 +1126,11 @@ namespace tfs
           physical_blockid = physcial_blk_list->back()->get_physic_block_id();
           // new one ext block
           PhysicalBlock* tmp_physic_block = NULL;
-          int ret = BlockFileManager::get_instance()->new_ext_block(logic_block_id_, physical_blockid,
+          if (NULL == block_manager_)
+          {
+            return EXIT_NO_LOGICBLOCK_ERROR;
+          }
+          int ret = block_manager_->new_ext_block(logic_block_id_, physical_blockid,
               physical_ext_blockid, &tmp_physic_block);
           if (TFS_SUCCESS != ret)
             return ret;
@@ -791,9 +1154,10 @@ namespace tfs
       return TFS_SUCCESS;
     }
 
-    FileIterator::FileIterator(LogicBlock* logic_block)
+    FileIterator::FileIterator(LogicBlock* logic_block, const IOPolicy policy)
     {
       logic_block_ = logic_block;
+      policy_ = policy;
       buf_ = new char[MAX_COMPACT_READ_SIZE];
       data_len_ = 0;
       data_offset_ = 0;
@@ -890,7 +1254,7 @@ namespace tfs
           else
           {
             int32_t read_len = sizeof(FileInfo);
-            ret = logic_block_->read_raw_data((char*) &cur_fileinfo_, read_len, file_offset);
+            ret = logic_block_->read_raw_data((char*) &cur_fileinfo_, read_len, file_offset, policy_);
             if (TFS_SUCCESS != ret)
               return ret;
           }
@@ -973,7 +1337,7 @@ namespace tfs
       }
 
       int32_t read_len = MAX_COMPACT_READ_SIZE - data_len_;
-      int ret = logic_block_->read_raw_data(buf_ + data_len_, read_len, read_offset_);
+      int ret = logic_block_->read_raw_data(buf_ + data_len_, read_len, read_offset_, policy_);
       if (TFS_SUCCESS != ret)
       {
         TBSYS_LOG(ERROR, "batch read data fail, blockid: %u, offset: %d, read len: %d, ret: %d",
@@ -20,6 +20,11 @@
 
 #include <string>
 #include <list>
+#include <deque>
+#include <vector>
+#include <sys/uio.h>
+#include <Monitor.h>
+#include <Mutex.h>
 #include "dataserver_define.h"
 #include "data_file.h"
 #include "physical_block.h"
@@ -33,7 +38,45 @@ namespace tfs
 {
   namespace dataserver
   {
+    // a file waiting in the group commit queue of a logic block
+    struct CloseFileRequest
+    {
+      uint64_t inner_file_id_;
+      DataFile* datafile_;
+      uint32_t crc_;
+      int ret_;
+      bool done_;
+
+      // filled in when committed
+      common::FileInfo file_info_;
+      common::RawMeta file_meta_;
+      common::RawMeta old_file_meta_;
+      OperType oper_type_;
+      int32_t old_size_;              // space of old file to release, 0 if rewritten in place
+      bool append_;                   // written at the end of block data
+      std::vector<struct iovec> iov_; // FileInfo + data
+    };
+
+    // one file of a batch read
+    struct BatchReadItem
+    {
+      uint64_t inner_file_id_;
+      char* buf_;
+      int32_t offset_;      // in file, FileInfo included
+      int32_t nbytes_;      // length to read, truncated to the file size
+      int32_t data_offset_; // where the read starts in the block
+      int ret_;
+    };
 
+    // a file of a compaction in place, copied to a hole before it
+    struct MovedFile
+    {
+      common::RawMeta meta_;   // where the file was
+      common::FileInfo info_;  // as it was when copied, the file changed since if it differs
+      int32_t to_offset_;
+    };
+
+    class BlockFileManager;
     class LogicBlock
     {
       public:
@@ -53,10 +96,20 @@ namespace tfs
         }
 
         int load_block_file(const int32_t bucket_size, const common::MMapOption mmap_option);
+        // lazy load: read only the index header, enough to report the block.
+        // the index is loaded by check_load at the first access
+        int load_block_header(const int32_t bucket_size, const common::MMapOption mmap_option);
+        int check_load();
+        bool is_loaded() const;
         int init_block_file(const int32_t bucket_size, const common::MMapOption mmap_option, const BlockType block_type);
         int delete_block_file();
 
         void add_physic_block(PhysicalBlock* physic_block);
+        // manager of the mount point the block is on, extend blocks are taken from it
+        void set_block_manager(BlockFileManager* block_manager)
+        {
+          block_manager_ = block_manager;
+        }
 
         int open_write_file(uint64_t& inner_file_id);
         int check_block_version(int32_t& remote_version, common::UpdateBlockType &repair);
@@ -64,11 +117,15 @@ namespace tfs
 
         int read_file(const uint64_t inner_file_id, char* buf, int32_t& nbytes, const int32_t offset, const int8_t flag);
         int read_file_info(const uint64_t inner_file_id, common::FileInfo& finfo);
+        // look up all files under one read lock, then read them in the order of disk offset.
+        // result of every file is in its ret_
+        void batch_read_file(std::vector<BatchReadItem*>& items, const int8_t flag);
 
         int rename_file(const uint64_t old_inner_file_id, const uint64_t new_inner_file_id);
         int unlink_file(const uint64_t inner_file_id, const int32_t action, int64_t& file_size);
-        int read_raw_data(char* buf, int32_t& nbyte, const int32_t offset);
-        int write_raw_data(const char* buf, const int32_t nbytes, const int32_t offset);
+        int read_raw_data(char* buf, int32_t& nbyte, const int32_t offset, const IOPolicy policy = IO_POLICY_CACHED);
+        int write_raw_data(const char* buf, const int32_t nbytes, const int32_t offset,
+            const IOPolicy policy = IO_POLICY_CACHED);
 
         void reset_seq_id(uint64_t file_id);
         int reset_block_version();
@@ -93,6 +150,12 @@ namespace tfs
 
         int batch_write_meta(const common::BlockInfo* blk_info, const common::RawMetaVec* meta_list);
         int set_block_dirty_type(DirtyFlag dirty_flag);
+        // steps of a compaction in place (see CompactBlock::compact_in_place), each under the write lock.
+        // drop the metas of files still deleted as they were found, del_size is the deleted size left
+        int drop_deleted_files(const common::RawMetaVec& metas, int32_t& drop_count, int32_t& del_size);
+        // point the files not changed while copied at their new place, cut the data size down to the
+        // end of the last file. del_size as given by drop_deleted_files
+        int commit_moved_files(const std::vector<MovedFile>& moves, const int32_t del_size, int32_t& move_size);
 
         uint32_t get_logic_block_id() const
         {
@@ -109,6 +172,25 @@ namespace tfs
           ++visit_count_;
         }
 
+        void set_last_access(time_t time)
+        {
+          last_access_ = time;
+        }
+
+        time_t get_last_access() const
+        {
+          return last_access_;
+        }
+
+        // memory of the index map, see IndexMapManager
+        int32_t get_index_map_size();
+        int32_t get_index_resident_size();
+
+        // write back and drop the index pages, they fault in again at the next access
+        int release_index();
+        // lock the index in memory, or unlock it
+        int lock_index(const bool lock);
+
         void set_last_update(time_t time)
         {
           last_update_ = time;
@@ -180,6 +262,17 @@ namespace tfs
         int copy_block_info(const common::BlockInfo* blk_info);
         int extend_block(const int32_t size, const int32_t offset);
 
+        // rw_lock_ held, read or write
+        int get_read_offset(const uint64_t inner_file_id, int32_t& nbytes, const int32_t offset,
+            common::RawMeta& file_meta);
+        int check_file_info(const uint64_t inner_file_id, const char* buf, const int8_t flag);
+
+        int commit_close_files(std::vector<CloseFileRequest*>& requests);
+        int prepare_close_file(CloseFileRequest& request, int32_t& append_offset);
+        // add the index changes of a close to batch, as apply_close_file does them
+        void stage_close_file(const CloseFileRequest& request, IndexBatch& batch);
+        int apply_close_file(CloseFileRequest& request);
+
       private:
         DISALLOW_COPY_AND_ASSIGN(LogicBlock);
 
@@ -192,14 +285,25 @@ namespace tfs
         int32_t avail_data_size_; // the data space of this logic block
         int32_t visit_count_;     // accumlating visit count
         time_t last_update_;      // last update time
+        time_t last_access_;      // last time got by BlockFileManager
         time_t last_abnorm_time_; // last abnormal time
         BlockStatus block_health_status; // block status info
 
         DataHandle* data_handle_;   // data operation handle
         IndexHandle* index_handle_; // associate index handle
         std::list<PhysicalBlock*> physical_block_list_; // the physical block list of this logic block
+        BlockFileManager* block_manager_; // manager of the mount point
         common::RWLock rw_lock_;   // read-write lock
 
+        tbutil::Monitor<tbutil::Mutex> commit_monitor_;
+        std::deque<CloseFileRequest*> commit_queue_; // closes waiting for group commit
+        bool committing_;                            // some thread is committing a group
+
+        bool loaded_;                   // false if only the index header is read, load_mutex_ held
+        int32_t bucket_size_;           // to load the index later
+        common::MMapOption mmap_option_;
+        mutable tbutil::Mutex load_mutex_;
+
         friend class FileIterator;
     };
 
@@ -207,7 +311,7 @@ namespace tfs
     class FileIterator
     {
       public:
-        FileIterator(LogicBlock* logic_block);
+        FileIterator(LogicBlock* logic_block, const IOPolicy policy = IO_POLICY_CACHED);
         ~FileIterator();
         bool has_next() const;
         int next();
@@ -227,6 +331,7 @@ namespace tfs
         bool is_big_file_;               // big file or not
         common::RawMetaVec meta_infos_;  // meta info vector
         common::RawMetaVecIter meta_it_; // meta info vector iterator
+        IOPolicy policy_;                // io policy of reading block data
     };
 
   }
@@ -0,0 +1,108 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "meta_table.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    MetaTable::MetaTable() :
+      mask_(0), shift_(32), size_(0)
+    {
+    }
+
+    MetaTable::~MetaTable()
+    {
+    }
+
+    void MetaTable::clear()
+    {
+      std::vector<Entry>().swap(entries_);
+      mask_ = 0;
+      shift_ = 32;
+      size_ = 0;
+    }
+
+    void MetaTable::insert(const uint64_t key, const int32_t meta_offset)
+    {
+      // keep load factor under 0.8, probe sequences stay within a cache line or two
+      if (static_cast<uint32_t>(size_ + 1) * 5 > entries_.size() * 4)
+      {
+        resize(entries_.empty() ? MIN_CAPACITY : entries_.size() * 2);
+      }
+      Entry entry;
+      entry.hash_ = hash(key);
+      entry.offset_ = meta_offset;
+      place(entry);
+    }
+
+    // backward shift the following entries, no tombstone is left
+    void MetaTable::erase_index(uint32_t index)
+    {
+      uint32_t next = (index + 1) & mask_;
+      while (0 != entries_[next].offset_ && distance(next, entries_[next].hash_) > 0)
+      {
+        entries_[index] = entries_[next];
+        index = next;
+        next = (next + 1) & mask_;
+      }
+      entries_[index].hash_ = 0;
+      entries_[index].offset_ = 0;
+      --size_;
+    }
+
+    void MetaTable::resize(const uint32_t capacity)
+    {
+      std::vector<Entry> old_entries(capacity);
+      old_entries.swap(entries_);
+      memset(&entries_[0], 0, capacity * sizeof(Entry));
+      mask_ = capacity - 1;
+      shift_ = 32;
+      for (uint32_t i = capacity; i > 1; i >>= 1)
+      {
+        --shift_;
+      }
+      size_ = 0;
+      for (size_t i = 0; i < old_entries.size(); ++i)
+      {
+        if (0 != old_entries[i].offset_)
+        {
+          place(old_entries[i]);
+        }
+      }
+    }
+
+    void MetaTable::place(Entry cur)
+    {
+      uint32_t index = home(cur.hash_);
+      for (uint32_t dist = 0; ; ++dist, index = (index + 1) & mask_)
+      {
+        Entry& entry = entries_[index];
+        if (0 == entry.offset_)
+        {
+          entry = cur;
+          break;
+        }
+        // robin hood: take the slot of an entry nearer to its home, go on placing that one
+        uint32_t entry_dist = distance(index, entry.hash_);
+        if (entry_dist < dist)
+        {
+          Entry tmp = entry;
+          entry = cur;
+          cur = tmp;
+          dist = entry_dist;
+        }
+      }
+      ++size_;
+    }
+  }
+}
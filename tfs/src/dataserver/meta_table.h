@@ -0,0 +1,131 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_METATABLE_H_
+#define TFS_DATASERVER_METATABLE_H_
+
+#include <vector>
+#include "common/internal.h"
+#include "common/error_msg.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // in memory index of a block: file key -> offset of its MetaInfo in the index file.
+    // open addressing with robin hood probing, an entry is a 32 bit fingerprint of the key
+    // and the meta offset, 8 entries in a cache line. a lookup compares fingerprints along
+    // a short probe sequence and reads only the meta whose fingerprint matches, instead of
+    // every node of a bucket chain.
+    // not thread safe: lookups are made under the LogicBlock read lock, changes under its write
+    // lock, as an insert may move every entry.
+    class MetaTable
+    {
+      public:
+        MetaTable();
+        ~MetaTable();
+
+        void clear();
+        inline int32_t size() const
+        {
+          return size_;
+        }
+        inline int32_t capacity() const
+        {
+          return static_cast<int32_t>(entries_.size());
+        }
+
+        // KeyOf: int operator()(const int32_t meta_offset, uint64_t& key), gives the key of the meta.
+        // return offset of the meta of key, 0 if not found
+        template <typename KeyOf>
+        int32_t find(const uint64_t key, KeyOf& key_of) const
+        {
+          int32_t index = find_index(key, key_of);
+          return index < 0 ? 0 : entries_[index].offset_;
+        }
+
+        // key must not exist
+        void insert(const uint64_t key, const int32_t meta_offset);
+
+        template <typename KeyOf>
+        int erase(const uint64_t key, KeyOf& key_of)
+        {
+          int32_t index = find_index(key, key_of);
+          if (index < 0)
+          {
+            return common::EXIT_META_NOT_FOUND_ERROR;
+          }
+          erase_index(index);
+          return common::TFS_SUCCESS;
+        }
+
+      private:
+        struct Entry
+        {
+          uint32_t hash_;   // fingerprint, its high bits are the home slot
+          int32_t offset_;  // 0: empty
+        };
+
+        DISALLOW_COPY_AND_ASSIGN(MetaTable);
+
+        static inline uint32_t hash(const uint64_t key)
+        {
+          return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+        }
+        inline uint32_t home(const uint32_t hash) const
+        {
+          return hash >> shift_;
+        }
+        inline uint32_t distance(const uint32_t index, const uint32_t hash) const
+        {
+          return (index - home(hash)) & mask_;
+        }
+
+        template <typename KeyOf>
+        int32_t find_index(const uint64_t key, KeyOf& key_of) const
+        {
+          if (0 == size_)
+          {
+            return -1;
+          }
+          uint32_t h = hash(key);
+          uint32_t index = home(h);
+          for (uint32_t dist = 0; ; ++dist, index = (index + 1) & mask_)
+          {
+            const Entry& entry = entries_[index];
+            // an entry nearer to its home than we are to ours: key would have taken its place
+            if (0 == entry.offset_ || distance(index, entry.hash_) < dist)
+            {
+              return -1;
+            }
+            uint64_t entry_key = 0;
+            if (entry.hash_ == h && common::TFS_SUCCESS == key_of(entry.offset_, entry_key) && entry_key == key)
+            {
+              return static_cast<int32_t>(index);
+            }
+          }
+        }
+
+        void erase_index(uint32_t index);
+        void resize(const uint32_t capacity);
+        void place(Entry entry);
+
+      private:
+        static const uint32_t MIN_CAPACITY = 64;
+
+        std::vector<Entry> entries_;
+        uint32_t mask_;
+        uint32_t shift_;
+        int32_t size_;
+    };
+  }
+}
+#endif //TFS_DATASERVER_METATABLE_H_
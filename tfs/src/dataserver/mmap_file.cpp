@@ -18,6 +18,8 @@
  *
  */
 #include "mmap_file.h"
+#include <fcntl.h>
+#include <vector>
 #include <tbsys.h>
 
 namespace tfs
@@ -186,6 +188,62 @@ namespace tfs
       }
     }
 
+    int32_t MMapFile::get_resident_size() const
+    {
+      if (NULL == data_ || size_ <= 0)
+      {
+        return 0;
+      }
+      int32_t page_size = getpagesize();
+      int32_t pages = (size_ + page_size - 1) / page_size;
+      std::vector<unsigned char> vec(pages);
+      if (mincore(data_, size_, &vec[0]) != 0)
+      {
+        TBSYS_LOG(WARN, "mincore fail, fd: %d, size: %d, error desc: %s", fd_, size_, strerror(errno));
+        return 0;
+      }
+      int32_t resident = 0;
+      for (int32_t i = 0; i < pages; ++i)
+      {
+        if (vec[i] & 0x1)
+        {
+          ++resident;
+        }
+      }
+      return resident * page_size;
+    }
+
+    bool MMapFile::release_pages()
+    {
+      if (NULL == data_ || size_ <= 0)
+      {
+        return true;
+      }
+      if (msync(data_, size_, MS_SYNC) != 0 || madvise(data_, size_, MADV_DONTNEED) != 0)
+      {
+        TBSYS_LOG(ERROR, "release map pages fail, fd: %d, size: %d, error desc: %s", fd_, size_, strerror(errno));
+        return false;
+      }
+      // the pages are clean now, drop them from page cache too
+      posix_fadvise(fd_, 0, size_, POSIX_FADV_DONTNEED);
+      return true;
+    }
+
+    bool MMapFile::lock_pages(const bool lock)
+    {
+      if (NULL == data_ || size_ <= 0)
+      {
+        return false;
+      }
+      int ret = lock ? mlock(data_, size_) : munlock(data_, size_);
+      if (ret != 0)
+      {
+        TBSYS_LOG(WARN, "%s map fail, fd: %d, size: %d, error desc: %s", lock ? "mlock" : "munlock", fd_, size_,
+            strerror(errno));
+      }
+      return 0 == ret;
+    }
+
     bool MMapFile::ensure_file_size(const int32_t size)
     {
       struct stat s;
@@ -43,6 +43,12 @@ namespace tfs
         void* get_data() const;
         int32_t get_size() const;
         bool munmap_file();
+        // bytes of the map in memory now
+        int32_t get_resident_size() const;
+        // write back and drop the pages of the map, it stays mapped and faults them in again
+        bool release_pages();
+        // lock the map in memory, or unlock it
+        bool lock_pages(const bool lock);
 
       private:
         bool ensure_file_size(const int32_t size);
@@ -78,6 +78,34 @@ namespace tfs
       return NULL;
     }
 
+    int32_t MMapFileOperation::get_map_size() const
+    {
+      return is_mapped_ ? map_file_->get_size() : 0;
+    }
+
+    int32_t MMapFileOperation::get_resident_size() const
+    {
+      return is_mapped_ ? map_file_->get_resident_size() : 0;
+    }
+
+    int MMapFileOperation::release_map_pages()
+    {
+      if (is_mapped_ && !map_file_->release_pages())
+      {
+        return TFS_ERROR;
+      }
+      return TFS_SUCCESS;
+    }
+
+    int MMapFileOperation::lock_map_pages(const bool lock)
+    {
+      if (!is_mapped_ || !map_file_->lock_pages(lock))
+      {
+        return TFS_ERROR;
+      }
+      return TFS_SUCCESS;
+    }
+
     int MMapFileOperation::pread_file(char* buf, const int32_t size, const int64_t offset)
     {
       if (is_mapped_ && (offset + size) >= map_file_->get_size())
@@ -130,6 +158,32 @@ namespace tfs
       return FileOperation::pwrite_file(buf, size, offset);
     }
 
+    int MMapFileOperation::pwritev_file(const struct iovec* iov, const int32_t iovcnt, const int64_t offset)
+    {
+      int64_t size = 0;
+      for (int32_t i = 0; i < iovcnt; ++i)
+      {
+        size += iov[i].iov_len;
+      }
+      if (is_mapped_ && (offset + size) > map_file_->get_size())
+      {
+        map_file_->remap_file();
+      }
+
+      if (is_mapped_ && (offset + size) <= map_file_->get_size())
+      {
+        char* data = reinterpret_cast<char*> (map_file_->get_data()) + offset;
+        for (int32_t i = 0; i < iovcnt; ++i)
+        {
+          memcpy(data, iov[i].iov_base, iov[i].iov_len);
+          data += iov[i].iov_len;
+        }
+        return TFS_SUCCESS;
+      }
+
+      return FileOperation::pwritev_file(iov, iovcnt, offset);
+    }
+
     int MMapFileOperation::flush_file()
     {
       if (is_mapped_)
@@ -96,10 +96,16 @@ namespace tfs
         int pread_file(char* buf, const int32_t size, const int64_t offset);
         int pread_file(ParaInfo& m_meta_info, const int32_t size, const int64_t offset);
         int pwrite_file(const char* buf, const int32_t size, const int64_t offset);
+        // gather write at offset, copied into the map if it fits there
+        int pwritev_file(const struct iovec* iov, const int32_t iovcnt, const int64_t offset);
 
         int mmap_file(const common::MMapOption& mmap_option);
         int munmap_file();
         void* get_map_data() const;
+        int32_t get_map_size() const;
+        int32_t get_resident_size() const;
+        int release_map_pages();
+        int lock_map_pages(const bool lock);
         int flush_file();
 
       private:
@@ -67,24 +67,25 @@ namespace tfs
       tbsys::gDelete(file_op_);
     }
 
-    int PhysicalBlock::pread_data(char* buf, const int32_t nbytes, const int32_t offset)
+    int PhysicalBlock::pread_data(char* buf, const int32_t nbytes, const int32_t offset, const IOPolicy policy)
     {
       if (offset + nbytes > total_data_len_)
       {
         return EXIT_PHYSIC_BLOCK_OFFSET_ERROR;
       }
       // converse reletive data offset to absolute offset in block
-      return file_op_->pread_file(buf, nbytes, data_start_ + offset);
+      return file_op_->pread_file_ex(buf, nbytes, data_start_ + offset, policy);
     }
 
-    int PhysicalBlock::pwrite_data(const char* buf, const int32_t nbytes, const int32_t offset)
+    int PhysicalBlock::pwrite_data(const char* buf, const int32_t nbytes, const int32_t offset,
+        const IOPolicy policy)
     {
       if (offset + nbytes > total_data_len_)
       {
         return EXIT_PHYSIC_BLOCK_OFFSET_ERROR;
       }
       int64_t time_start = tbsys::CTimeUtil::getTime();
-      int ret = file_op_->pwrite_file(buf, nbytes, data_start_ + offset);
+      int ret = file_op_->pwrite_file_ex(buf, nbytes, data_start_ + offset, policy);
       int64_t time_end = tbsys::CTimeUtil::getTime();
       if (time_end - time_start >= 1000000)
       {
@@ -96,6 +97,30 @@ namespace tfs
       return ret;
     }
 
+    int PhysicalBlock::pwritev_data(const struct iovec* iov, const int32_t iovcnt, const int32_t offset)
+    {
+      int32_t nbytes = 0;
+      for (int32_t i = 0; i < iovcnt; ++i)
+      {
+        nbytes += iov[i].iov_len;
+      }
+      if (offset + nbytes > total_data_len_)
+      {
+        return EXIT_PHYSIC_BLOCK_OFFSET_ERROR;
+      }
+      int64_t time_start = tbsys::CTimeUtil::getTime();
+      int ret = file_op_->pwritev_file(iov, iovcnt, data_start_ + offset);
+      int64_t time_end = tbsys::CTimeUtil::getTime();
+      if (time_end - time_start >= 1000000)
+      {
+        TBSYS_LOG(
+            WARN,
+            "physical blockid: %u, offset: %d, data len: %d, iov count: %d, time cost: %" PRI64_PREFIX "d",
+            physical_block_id_, offset, nbytes, iovcnt, time_end - time_start);
+      }
+      return ret;
+    }
+
     int PhysicalBlock::load_block_prefix()
     {
       memset(&block_prefix_, 0, sizeof(BlockPrefix));
@@ -45,8 +45,11 @@ namespace tfs
         int dump_block_prefix();
         void get_block_prefix(BlockPrefix& block_prefix);
 
-        int pread_data(char* buf, const int32_t nbytes, const int32_t offset);
-        int pwrite_data(const char* buf, const int32_t nbytes, const int32_t offset);
+        int pread_data(char* buf, const int32_t nbytes, const int32_t offset,
+            const IOPolicy policy = IO_POLICY_CACHED);
+        int pwrite_data(const char* buf, const int32_t nbytes, const int32_t offset,
+            const IOPolicy policy = IO_POLICY_CACHED);
+        int pwritev_data(const struct iovec* iov, const int32_t iovcnt, const int32_t offset);
 
         inline int32_t get_total_data_len() const
         {
@@ -0,0 +1,61 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "rate_limiter.h"
+#include "common/func.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+
+    RateLimiter::RateLimiter(const int64_t rate) :
+      rate_(rate), next_time_(0)
+    {
+    }
+
+    RateLimiter::~RateLimiter()
+    {
+    }
+
+    void RateLimiter::set_rate(const int64_t rate)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      rate_ = rate;
+      next_time_ = 0;
+    }
+
+    void RateLimiter::acquire(const int64_t bytes)
+    {
+      int64_t wait_time = 0;
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        if (rate_ <= 0 || bytes <= 0)
+        {
+          return;
+        }
+        // idle time is not saved up for a burst
+        int64_t now = Func::curr_time();
+        if (next_time_ < now)
+        {
+          next_time_ = now;
+        }
+        wait_time = next_time_ - now;
+        next_time_ += bytes * 1000000 / rate_;
+      }
+      if (wait_time > 0)
+      {
+        usleep(wait_time);
+      }
+    }
+  }
+}
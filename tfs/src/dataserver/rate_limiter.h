@@ -0,0 +1,50 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_RATELIMITER_H_
+#define TFS_DATASERVER_RATELIMITER_H_
+
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // bytes per second budget of a kind of background io, shared by the threads doing it.
+    // every caller books the time its bytes take at the rate and sleeps till its turn,
+    // so the threads together keep to the rate.
+    class RateLimiter
+    {
+      public:
+        explicit RateLimiter(const int64_t rate = 0);
+        ~RateLimiter();
+
+        // bytes per second, <= 0 no limit
+        void set_rate(const int64_t rate);
+        inline int64_t get_rate() const
+        {
+          return rate_;
+        }
+
+        // wait till bytes may be done
+        void acquire(const int64_t bytes);
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(RateLimiter);
+
+        tbutil::Mutex mutex_;
+        int64_t rate_;
+        int64_t next_time_; // us, when the bytes after those booked may go
+    };
+  }
+}
+#endif //TFS_DATASERVER_RATELIMITER_H_
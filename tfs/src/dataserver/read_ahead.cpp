@@ -0,0 +1,300 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "read_ahead.h"
+#include <tbsys.h>
+#include <Memory.hpp>
+#include "data_handle.h"
+#include "common/error_msg.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    using namespace common;
+
+    ReadAheadCache::ReadAheadCache() :
+      read_ahead_size_(0), max_window_count_(0)
+    {
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        shards_[i].hit_count_ = 0;
+        shards_[i].fill_count_ = 0;
+        shards_[i].direct_count_ = 0;
+        shards_[i].wait_count_ = 0;
+        shards_[i].window_count_ = 0;
+      }
+    }
+
+    ReadAheadCache::~ReadAheadCache()
+    {
+      clear();
+    }
+
+    int ReadAheadCache::initialize(const int64_t capacity, const int32_t read_ahead_size)
+    {
+      if (capacity < 0 || (capacity > 0 && read_ahead_size <= 0))
+      {
+        TBSYS_LOG(ERROR, "invalid read ahead parameter, capacity: %" PRI64_PREFIX "d, read ahead size: %d",
+            capacity, read_ahead_size);
+        return EXIT_INVALID_ARGU;
+      }
+      clear();
+      read_ahead_size_ = read_ahead_size;
+      max_window_count_ = 0;
+      if (capacity > 0)
+      {
+        max_window_count_ = std::max(static_cast<int64_t>(1), capacity / read_ahead_size / SHARD_COUNT);
+      }
+      TBSYS_LOG(INFO, "read ahead %s, capacity: %" PRI64_PREFIX "d, read ahead size: %d, max window count: %d, "
+          "max stream count: %d", enabled() ? "enabled" : "disabled", capacity, read_ahead_size_,
+          max_window_count_ * SHARD_COUNT, MAX_STREAM_COUNT * SHARD_COUNT);
+      return TFS_SUCCESS;
+    }
+
+    int ReadAheadCache::read(const uint32_t block_id, const uint64_t file_id, const int32_t file_size,
+        DataHandle* data_handle, const int32_t data_offset, char* buf, const int32_t nbytes, const int32_t offset)
+    {
+      StreamKey key;
+      key.block_id_ = block_id;
+      key.file_id_ = file_id;
+      StreamShard& shard = get_shard(key);
+
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(shard.monitor_);
+      if (0 == offset && nbytes >= file_size)
+      {
+        // nothing left to read ahead
+        ++shard.direct_count_;
+        lock.release();
+        return data_handle->read_segment_data(buf, nbytes, data_offset + offset);
+      }
+      StreamList::iterator it = get_stream(shard, key);
+      bool waited = false;
+      while (it->filling_ && in_window(*it, nbytes, offset))
+      {
+        waited = true;
+        shard.monitor_.wait();
+        it = get_stream(shard, key);
+      }
+
+      Stream& stream = *it;
+      if (!stream.filling_ && in_window(stream, nbytes, offset))
+      {
+        memcpy(buf, stream.data_ + offset - stream.data_offset_, nbytes);
+        stream.next_offset_ = offset + nbytes;
+        ++(waited ? shard.wait_count_ : shard.hit_count_);
+        return TFS_SUCCESS;
+      }
+
+      stream.seq_count_ = offset == stream.next_offset_ ? stream.seq_count_ + 1 : 1;
+      stream.next_offset_ = offset + nbytes;
+      int32_t window = std::min(read_ahead_size_, file_size - offset);
+      if (stream.filling_ || stream.seq_count_ < SEQUENTIAL_READ_COUNT || nbytes >= window
+          || !alloc_window(shard, stream))
+      {
+        ++shard.direct_count_;
+        lock.release();
+        return data_handle->read_segment_data(buf, nbytes, data_offset + offset);
+      }
+
+      // stream is not removed while filling, it is safe to use it after lock is released
+      stream.filling_ = true;
+      stream.stale_ = false;
+      stream.data_offset_ = offset;
+      stream.data_len_ = window;
+      ++shard.fill_count_;
+      lock.release();
+
+      int ret = data_handle->read_segment_data(stream.data_, window, data_offset + offset);
+      if (TFS_SUCCESS == ret)
+      {
+        memcpy(buf, stream.data_, nbytes);
+      }
+
+      lock.acquire();
+      if (TFS_SUCCESS != ret || stream.stale_)
+      {
+        stream.data_len_ = 0;
+      }
+      stream.filling_ = false;
+      stream.stale_ = false;
+      shard.monitor_.notifyAll();
+      return ret;
+    }
+
+    void ReadAheadCache::erase(const uint32_t block_id, const uint64_t file_id)
+    {
+      if (!enabled())
+      {
+        return;
+      }
+      StreamKey key;
+      key.block_id_ = block_id;
+      key.file_id_ = file_id;
+      StreamShard& shard = get_shard(key);
+
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(shard.monitor_);
+      StreamMap::iterator mit = shard.map_.find(key);
+      if (mit != shard.map_.end())
+      {
+        if (mit->second->filling_)
+        {
+          mit->second->stale_ = true;
+        }
+        else
+        {
+          remove(shard, mit->second);
+        }
+      }
+    }
+
+    void ReadAheadCache::erase_block(const uint32_t block_id)
+    {
+      if (!enabled())
+      {
+        return;
+      }
+      // files of a block are in all shards
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        StreamShard& shard = shards_[i];
+        tbutil::Monitor<tbutil::Mutex>::Lock lock(shard.monitor_);
+        StreamList::iterator it = shard.lru_.begin();
+        while (it != shard.lru_.end())
+        {
+          StreamList::iterator cur = it++;
+          if (cur->key_.block_id_ == block_id)
+          {
+            if (cur->filling_)
+            {
+              cur->stale_ = true;
+            }
+            else
+            {
+              remove(shard, cur);
+            }
+          }
+        }
+      }
+    }
+
+    void ReadAheadCache::clear()
+    {
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        StreamShard& shard = shards_[i];
+        tbutil::Monitor<tbutil::Mutex>::Lock lock(shard.monitor_);
+        StreamList::iterator it = shard.lru_.begin();
+        while (it != shard.lru_.end())
+        {
+          StreamList::iterator cur = it++;
+          if (cur->filling_)
+          {
+            cur->stale_ = true;
+          }
+          else
+          {
+            remove(shard, cur);
+          }
+        }
+      }
+    }
+
+    void ReadAheadCache::get_stat(ReadAheadStat& stat)
+    {
+      memset(&stat, 0, sizeof(stat));
+      for (int32_t i = 0; i < SHARD_COUNT; ++i)
+      {
+        StreamShard& shard = shards_[i];
+        tbutil::Monitor<tbutil::Mutex>::Lock lock(shard.monitor_);
+        stat.stream_count_ += shard.map_.size();
+        stat.window_count_ += shard.window_count_;
+        stat.hit_count_ += shard.hit_count_;
+        stat.fill_count_ += shard.fill_count_;
+        stat.direct_count_ += shard.direct_count_;
+        stat.wait_count_ += shard.wait_count_;
+      }
+    }
+
+    // find the stream of key, or start a new one. the least recently used stream
+    // not being filled is dropped when the shard is full
+    ReadAheadCache::StreamList::iterator ReadAheadCache::get_stream(StreamShard& shard, const StreamKey& key)
+    {
+      StreamMap::iterator mit = shard.map_.find(key);
+      if (mit != shard.map_.end())
+      {
+        if (mit->second != shard.lru_.begin())
+        {
+          shard.lru_.splice(shard.lru_.begin(), shard.lru_, mit->second);
+        }
+        return mit->second;
+      }
+
+      StreamList::iterator it = shard.lru_.end();
+      while (static_cast<int32_t>(shard.map_.size()) >= MAX_STREAM_COUNT && it != shard.lru_.begin())
+      {
+        StreamList::iterator cur = --it;
+        if (!cur->filling_)
+        {
+          ++it;
+          remove(shard, cur);
+        }
+      }
+
+      Stream stream;
+      memset(&stream, 0, sizeof(stream));
+      stream.key_ = key;
+      shard.lru_.push_front(stream);
+      shard.map_[key] = shard.lru_.begin();
+      return shard.lru_.begin();
+    }
+
+    // a window for stream, the window of the least recently used stream not being filled
+    // is taken when the shard has no room for one more
+    bool ReadAheadCache::alloc_window(StreamShard& shard, Stream& stream)
+    {
+      if (NULL != stream.data_)
+      {
+        return true;
+      }
+      StreamList::iterator it = shard.lru_.end();
+      while (shard.window_count_ >= max_window_count_ && it != shard.lru_.begin())
+      {
+        --it;
+        if (NULL != it->data_ && !it->filling_)
+        {
+          stream.data_ = it->data_;
+          it->data_ = NULL;
+          it->data_len_ = 0;
+          return true;
+        }
+      }
+      if (shard.window_count_ >= max_window_count_)
+      {
+        return false;
+      }
+      stream.data_ = new char[read_ahead_size_];
+      ++shard.window_count_;
+      return true;
+    }
+
+    void ReadAheadCache::remove(StreamShard& shard, StreamList::iterator it)
+    {
+      shard.map_.erase(it->key_);
+      if (NULL != it->data_)
+      {
+        --shard.window_count_;
+      }
+      tbsys::gDeleteA(it->data_);
+      shard.lru_.erase(it);
+    }
+  }
+}
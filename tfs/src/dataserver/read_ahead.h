@@ -0,0 +1,147 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_READAHEAD_H_
+#define TFS_DATASERVER_READAHEAD_H_
+
+#include <list>
+#include <ext/hash_map>
+#include <Monitor.h>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    class DataHandle;
+
+    struct ReadAheadStat
+    {
+      int64_t stream_count_; // streams tracked now
+      int64_t window_count_; // streams holding a window now
+      int64_t hit_count_;    // reads served from a window
+      int64_t fill_count_;   // windows read from disk
+      int64_t direct_count_; // reads gone to disk as they are
+      int64_t wait_count_;   // reads served by a fill in progress
+    };
+
+    // read ahead for segment reads of big files. reads of every (block id, file id)
+    // are tracked as a stream, when a stream reads on where its last read ended, a
+    // window of read_ahead_size is read from disk at once, the following reads of the
+    // stream are copied from the window. reads falling into a window being read wait
+    // for it, so reads of one stream queued together reach the disk as one read.
+    // streams are split into shards by key, every shard has its own lru list and lock.
+    // a stream costs a few bytes until it gets a window, so many more streams are tracked
+    // than windows fit the capacity, the least recently used window is dropped for a new one.
+    // a file read whole by one read, the common small file, is not tracked.
+    class ReadAheadCache
+    {
+      public:
+        ReadAheadCache();
+        ~ReadAheadCache();
+
+        static ReadAheadCache* get_instance()
+        {
+          static ReadAheadCache s_read_ahead_cache;
+          return &s_read_ahead_cache;
+        }
+
+        // capacity is the memory of all windows, 0 disable read ahead
+        int initialize(const int64_t capacity, const int32_t read_ahead_size);
+        inline bool enabled() const
+        {
+          return max_window_count_ > 0;
+        }
+
+        // read nbytes at offset of a file, nbytes is already truncated to the file size.
+        // data_offset is where the file starts in data_handle
+        int read(const uint32_t block_id, const uint64_t file_id, const int32_t file_size, DataHandle* data_handle,
+            const int32_t data_offset, char* buf, const int32_t nbytes, const int32_t offset);
+
+        void erase(const uint32_t block_id, const uint64_t file_id);
+        void erase_block(const uint32_t block_id);
+        void clear();
+
+        void get_stat(ReadAheadStat& stat);
+
+      private:
+        struct StreamKey
+        {
+          uint32_t block_id_;
+          uint64_t file_id_;
+          bool operator==(const StreamKey& rhs) const
+          {
+            return block_id_ == rhs.block_id_ && file_id_ == rhs.file_id_;
+          }
+        };
+
+        struct StreamKeyHash
+        {
+          size_t operator()(const StreamKey& key) const
+          {
+            return static_cast<size_t>(key.file_id_ ^ (key.file_id_ >> 32) ^ (static_cast<uint64_t>(key.block_id_) << 7));
+          }
+        };
+
+        struct Stream
+        {
+          StreamKey key_;
+          char* data_;            // window, read_ahead_size_ bytes
+          int32_t data_offset_;   // file offset of the window
+          int32_t data_len_;      // valid bytes in the window
+          int32_t next_offset_;   // where the last read ended
+          int32_t seq_count_;     // sequential reads in a row
+          bool filling_;          // window is being read, data_offset_/data_len_ is the range
+          bool stale_;            // file changed while filling, drop the window
+        };
+
+        typedef std::list<Stream> StreamList;
+        typedef __gnu_cxx::hash_map<StreamKey, StreamList::iterator, StreamKeyHash> StreamMap;
+
+        struct StreamShard
+        {
+          tbutil::Monitor<tbutil::Mutex> monitor_;
+          StreamList lru_; // front is the most recently used
+          StreamMap map_;
+          int64_t hit_count_;
+          int64_t fill_count_;
+          int64_t direct_count_;
+          int64_t wait_count_;
+          int32_t window_count_;
+        };
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(ReadAheadCache);
+        inline StreamShard& get_shard(const StreamKey& key)
+        {
+          return shards_[StreamKeyHash()(key) % SHARD_COUNT];
+        }
+        static inline bool in_window(const Stream& stream, const int32_t nbytes, const int32_t offset)
+        {
+          return offset >= stream.data_offset_ && offset + nbytes <= stream.data_offset_ + stream.data_len_;
+        }
+        StreamList::iterator get_stream(StreamShard& shard, const StreamKey& key);
+        bool alloc_window(StreamShard& shard, Stream& stream);
+        void remove(StreamShard& shard, StreamList::iterator it);
+
+      private:
+        static const int32_t SHARD_COUNT = 16;
+        static const int32_t SEQUENTIAL_READ_COUNT = 2; // reads in a row before read ahead
+        static const int32_t MAX_STREAM_COUNT = 1024;   // per shard
+
+        StreamShard shards_[SHARD_COUNT];
+        int32_t read_ahead_size_;
+        int32_t max_window_count_; // per shard, of the capacity
+    };
+  }
+}
+#endif //TFS_DATASERVER_READAHEAD_H_
@@ -55,6 +55,24 @@ namespace tfs
       expire_cloned_interval_ = SYSPARAM_DATASERVER.expire_cloned_block_time_;
       last_expire_cloned_block_time_ = 0;
       stop_ = 0;
+      chunk_size_ = SYSPARAM_DATASERVER.replicate_chunk_size_ > 0 ? SYSPARAM_DATASERVER.replicate_chunk_size_ : MAX_READ_SIZE;
+      window_size_ = SYSPARAM_DATASERVER.replicate_window_size_ > 0 ? SYSPARAM_DATASERVER.replicate_window_size_ : 1;
+      max_per_server_ = SYSPARAM_DATASERVER.replicate_max_per_server_;
+    }
+
+    ReplBlock* ReplicateBlock::pick_repl_block()
+    {
+      for (std::deque<ReplBlock*>::iterator it = repl_block_queue_.begin(); it != repl_block_queue_.end(); ++it)
+      {
+        std::map<uint64_t, int32_t>::const_iterator count = server_repl_count_.find((*it)->destination_id_);
+        if (max_per_server_ <= 0 || count == server_repl_count_.end() || count->second < max_per_server_)
+        {
+          ReplBlock* b = *it;
+          repl_block_queue_.erase(it);
+          return b;
+        }
+      }
+      return NULL;
     }
 
     int ReplicateBlock::run_replicate_block()
@@ -63,26 +81,31 @@ namespace tfs
       while (!stop_)
       {
         repl_block_monitor_.lock();
+        ReplBlock* b = NULL;
         while (!stop_)
         {
-          repl_block_monitor_.timedWait(timeout);
-          // wait the first one
-          if (!repl_block_queue_.empty())
+          // the first one whose destination is not busy with others
+          b = pick_repl_block();
+          if (NULL != b)
           {
             break;
           }
+          repl_block_monitor_.timedWait(timeout);
         }
 
         if (stop_)
         {
+          if (NULL != b)
+          {
+            tbsys::gDelete(b);
+          }
           repl_block_monitor_.unlock();
           break;
         }
 
-        TBSYS_LOG(INFO, "repl block blockid: %d", repl_block_queue_.front()->block_id_);
-        ReplBlock *b = repl_block_queue_.front();
-        repl_block_queue_.pop_front();
+        TBSYS_LOG(INFO, "repl block blockid: %u", b->block_id_);
         replicating_block_map_[b->block_id_] = b;
+        ++server_repl_count_[b->destination_id_];
         repl_block_monitor_.unlock();
 
         //replicate
@@ -104,6 +127,12 @@ namespace tfs
 
         repl_block_monitor_.lock();
         replicating_block_map_.erase(b->block_id_);
+        if (--server_repl_count_[b->destination_id_] <= 0)
+        {
+          server_repl_count_.erase(b->destination_id_);
+        }
+        // a block waiting for this destination may go now
+        repl_block_monitor_.notifyAll();
         repl_block_monitor_.unlock();
 
         tbsys::gDelete(b);
@@ -178,7 +207,7 @@ namespace tfs
 
       if (need_remove)
       {
-        int rm_ret = BlockFileManager::get_instance()->del_block(b->block_id_);
+        int rm_ret = DiskManager::get_instance()->del_block(b->block_id_);
         TBSYS_LOG(INFO, "send repl block complete info: del blockid: %u, result: %d\n", b->block_id_, rm_ret);
       }
       return ret;
@@ -193,7 +222,7 @@ namespace tfs
       TBSYS_LOG(INFO, "replicating now, blockid: %u, %s = >%s\n", b->block_id_, tbsys::CNetUtil::addrToString(
           b->source_id_).c_str(), tbsys::CNetUtil::addrToString(b->destination_id_).c_str());
 
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         TBSYS_LOG(ERROR, "block is not exist, blockid: %u, %s=>%s\n", b->block_id_, tbsys::CNetUtil::addrToString(
@@ -204,79 +233,21 @@ namespace tfs
       // send to port + 1
       //ds_ip = Func::addr_inc_port(ds_ip, 1);
 
-      //replicate block file
-      int32_t len = 0, offset = 0;
-      int ret = TFS_SUCCESS;
-      char tmp_data_buf[MAX_READ_SIZE];
-
+      //replicate block file, go on from the data written on failure
       //this block will not be write or update now, locked by ns
-      int32_t total_len = logic_block->get_data_file_size();
-      while (offset < total_len || 0 == total_len)
+      int32_t offset = 0;
+      int ret = replicate_data_to_server(logic_block, block_id, ds_ip, offset);
+      for (int32_t retry = 0; TFS_SUCCESS != ret && offset > 0 && retry < REPLICATE_RETRY_COUNT && !stop_; ++retry)
       {
-        int32_t read_len = MAX_READ_SIZE;
-        ret = logic_block->read_raw_data(tmp_data_buf, read_len, offset);
-        if (TFS_SUCCESS != ret)
-        {
-          TBSYS_LOG(ERROR, "read raw data fail, ip: %s, blockid: %u, offset: %d, reading len: %d, ret: %d",
-              tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, offset, read_len, ret);
-          break;
-        }
-        len = read_len;
-
-        TBSYS_LOG(DEBUG, "replicate read raw data blockid: %u, offset: %d, read len: %d, total len: %d\n", block_id,
-            offset, len, total_len);
-
-        WriteRawDataMessage req_wrd_msg;
-        req_wrd_msg.set_block_id(block_id);
-        req_wrd_msg.set_offset(offset);
-        req_wrd_msg.set_length(len);
-        req_wrd_msg.set_data(tmp_data_buf);
-
-        //new block		
-        if (0 == offset)
-        {
-          req_wrd_msg.set_new_block(1);
-        }
-        NewClient* client = NewClientManager::get_instance().create_client();
-        if (NULL != client)
-        {
-          tbnet::Packet* rsp_msg = NULL;
-          if (TFS_SUCCESS == send_msg_to_server(ds_ip, client, &req_wrd_msg, rsp_msg))
-          {
-            if (rsp_msg->getPCode() == STATUS_MESSAGE)
-            {
-              StatusMessage* sm = dynamic_cast<StatusMessage*> (rsp_msg);
-              if (STATUS_MESSAGE_OK != sm->get_status())
-              {
-                TBSYS_LOG(ERROR, "write raw data to %s fail, blockid: %u, offset:%d, reading len: %d",
-                    tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, offset, len);
-                ret = TFS_ERROR;
-              }
-            }
-          }
-          else
-          {
-            TBSYS_LOG(ERROR, "write raw data to %s fail, blockid: %u, offset: %u, reading len: %d",
-                tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, offset, len);
-            ret = TFS_ERROR;
-          }
-          NewClientManager::get_instance().destroy_client(client);
-        }
-        else
-        {
-          TBSYS_LOG(ERROR, "create client error");
-        }
-
-        if (TFS_SUCCESS != ret)
-        {
-          break;
-        }
-
-        offset += len;
-        if (len != MAX_READ_SIZE)
-        {
-          break;
-        }
+        TBSYS_LOG(WARN, "replicate data to %s fail, blockid: %u, ret: %d, retry from offset: %d",
+            tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, ret, offset);
+        ret = replicate_data_to_server(logic_block, block_id, ds_ip, offset);
+      }
+      if (TFS_SUCCESS != ret)
+      {
+        TBSYS_LOG(ERROR, "replicate data to %s fail, blockid: %u, written: %d, ret: %d",
+            tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, offset, ret);
+        return ret;
       }
 
       //use read index file direct maybe faster
@@ -341,6 +312,146 @@ namespace tfs
       return ret;
     }
 
+    // a window of packets is on the way, each waits for the answer of the first one only.
+    // the block is created by the first packet, the others are sent after it is answered.
+    // offset: in, where to start; out, the end of the data answered without error
+    int ReplicateBlock::replicate_data_to_server(LogicBlock* logic_block, const uint32_t block_id,
+        const uint64_t ds_ip, int32_t& offset)
+    {
+      int32_t total_len = logic_block->get_data_file_size();
+      int32_t send_offset = offset;
+      bool new_block = (0 == offset);
+      std::deque<ReplChunk> window;
+      char* buf = new char[chunk_size_];
+      IOScheduler* io_scheduler = DiskManager::get_instance()->get_io_scheduler(block_id);
+      int ret = TFS_SUCCESS;
+      while (TFS_SUCCESS == ret)
+      {
+        int32_t window_size = new_block ? 1 : window_size_;
+        while (TFS_SUCCESS == ret && !stop_ && static_cast<int32_t>(window.size()) < window_size
+            && (send_offset < total_len || (new_block && window.empty())))
+        {
+          int32_t len = std::min(chunk_size_, total_len - send_offset);
+          ret = io_scheduler->read_raw_data(IO_CLASS_REPLICATE, logic_block, buf, len, send_offset);
+          if (TFS_SUCCESS != ret)
+          {
+            TBSYS_LOG(ERROR, "read raw data fail, ip: %s, blockid: %u, offset: %d, reading len: %d, ret: %d",
+                tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, send_offset, len, ret);
+            break;
+          }
+          if (len <= 0 && send_offset < total_len)
+          {
+            TBSYS_LOG(ERROR, "read raw data nothing, blockid: %u, offset: %d, total len: %d",
+                block_id, send_offset, total_len);
+            ret = TFS_ERROR;
+            break;
+          }
+
+          WriteRawDataMessage req_wrd_msg;
+          req_wrd_msg.set_block_id(block_id);
+          req_wrd_msg.set_offset(send_offset);
+          req_wrd_msg.set_length(len);
+          req_wrd_msg.set_data(buf);
+          req_wrd_msg.set_data_crc(Func::crc(0, buf, len));
+          //new block
+          if (0 == send_offset)
+          {
+            req_wrd_msg.set_new_block(1);
+          }
+
+          ReplChunk chunk;
+          chunk.offset_ = send_offset;
+          chunk.length_ = len;
+          chunk.client_ = NewClientManager::get_instance().create_client();
+          if (NULL == chunk.client_)
+          {
+            TBSYS_LOG(ERROR, "create client error");
+            ret = TFS_ERROR;
+            break;
+          }
+          // the packet is copied when posted, buf is free for the next one
+          uint8_t send_id = 0;
+          ret = chunk.client_->post_request(ds_ip, &req_wrd_msg, send_id);
+          if (TFS_SUCCESS != ret)
+          {
+            TBSYS_LOG(ERROR, "write raw data to %s fail, blockid: %u, offset: %d, len: %d, ret: %d",
+                tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, send_offset, len, ret);
+            NewClientManager::get_instance().destroy_client(chunk.client_);
+            break;
+          }
+          TBSYS_LOG(DEBUG, "replicate raw data blockid: %u, offset: %d, len: %d, total len: %d, in flight: %d",
+              block_id, send_offset, len, total_len, static_cast<int32_t>(window.size()) + 1);
+          window.push_back(chunk);
+          send_offset += len;
+        }
+
+        if (window.empty())
+        {
+          break;
+        }
+        ReplChunk chunk = window.front();
+        window.pop_front();
+        int status = wait_write_status(chunk.client_);
+        NewClientManager::get_instance().destroy_client(chunk.client_);
+        if (TFS_SUCCESS != status)
+        {
+          TBSYS_LOG(ERROR, "write raw data to %s fail, blockid: %u, offset: %d, len: %d, ret: %d",
+              tbsys::CNetUtil::addrToString(ds_ip).c_str(), block_id, chunk.offset_, chunk.length_, status);
+          ret = status;
+          break;
+        }
+        // a failure of a later post leaves the answered ones good
+        offset = chunk.offset_ + chunk.length_;
+        new_block = false;
+        if (stop_ && TFS_SUCCESS == ret)
+        {
+          ret = TFS_ERROR;
+        }
+      }
+
+      if (TFS_SUCCESS == ret && (offset < total_len || new_block))
+      {
+        ret = TFS_ERROR;
+      }
+      // the answers of the rest are dropped with their clients
+      for (std::deque<ReplChunk>::iterator it = window.begin(); it != window.end(); ++it)
+      {
+        NewClientManager::get_instance().destroy_client(it->client_);
+      }
+      tbsys::gDeleteA(buf);
+      return ret;
+    }
+
+    int ReplicateBlock::wait_write_status(NewClient* client)
+    {
+      int ret = client->wait() ? TFS_SUCCESS : EXIT_TIMEOUT_ERROR;
+      if (TFS_SUCCESS == ret)
+      {
+        NewClient::RESPONSE_MSG_MAP* response = client->get_success_response();
+        ret = (NULL == response || response->empty() || NULL == response->begin()->second.second)
+          ? EXIT_TIMEOUT_ERROR : TFS_SUCCESS;
+        if (TFS_SUCCESS == ret)
+        {
+          tbnet::Packet* rsp_msg = response->begin()->second.second;
+          if (STATUS_MESSAGE != rsp_msg->getPCode())
+          {
+            TBSYS_LOG(ERROR, "unknow packet pcode: %d", rsp_msg->getPCode());
+            ret = TFS_ERROR;
+          }
+          else
+          {
+            StatusMessage* sm = dynamic_cast<StatusMessage*> (rsp_msg);
+            if (STATUS_MESSAGE_OK != sm->get_status())
+            {
+              TBSYS_LOG(ERROR, "write raw data fail: %s", sm->get_error());
+              ret = TFS_ERROR;
+            }
+          }
+        }
+      }
+      return ret;
+    }
+
     int ReplicateBlock::add_repl_task(ReplBlock* tmp_rep_blk)
     {
       int repl_exist = 0;
@@ -414,7 +525,7 @@ namespace tfs
       cloned_block_mutex_.lock();
       for (ClonedBlockMapIter mit = cloned_block_map_.begin(); mit != cloned_block_map_.end(); ++mit)
       {
-        ret = BlockFileManager::get_instance()->del_block(mit->first);
+        ret = DiskManager::get_instance()->del_block(mit->first);
         if (TFS_SUCCESS != ret)
         {
           TBSYS_LOG(ERROR, "in check thread: del blockid: %u error. ret: %d", mit->first, ret);
@@ -443,7 +554,7 @@ namespace tfs
             break;
           if (mit->second->start_time_ < now_time)
           {
-            ret = BlockFileManager::get_instance()->del_block(mit->first);
+            ret = DiskManager::get_instance()->del_block(mit->first);
             if (TFS_SUCCESS != ret)
             {
               TBSYS_LOG(ERROR, "in check thread: del blockid: %u error. ret: %d", mit->first, ret);
@@ -18,7 +18,7 @@
 
 #include "common/new_client.h"
 #include "dataserver_define.h"
-#include "blockfile_manager.h"
+#include "disk_manager.h"
 #include "logic_block.h"
 #include <Mutex.h>
 #include <Monitor.h>
@@ -43,17 +43,30 @@ namespace tfs
 
       private:
         void init();
+        common::ReplBlock* pick_repl_block();
         int replicate_block_to_server(const common::ReplBlock* b);
+        int replicate_data_to_server(LogicBlock* logic_block, const uint32_t block_id, const uint64_t ds_ip,
+            int32_t& offset);
+        int wait_write_status(common::NewClient* client);
         int send_repl_block_complete_info(const int status, const common::ReplBlock* b);
         int clear_cloned_block_map();
 
       private:
+        // a replicate packet waiting for its answer
+        struct ReplChunk
+        {
+          common::NewClient* client_;
+          int32_t offset_;
+          int32_t length_;
+        };
+
         ReplicateBlock();
         DISALLOW_COPY_AND_ASSIGN(ReplicateBlock);
 
         int stop_;
         std::deque<common::ReplBlock*> repl_block_queue_; // repl block queue
         ReplBlockMap replicating_block_map_; // replicating
+        std::map<uint64_t, int32_t> server_repl_count_; // destination => blocks replicating to it
         tbutil::Monitor<tbutil::Mutex> repl_block_monitor_;
 
         ClonedBlockMap cloned_block_map_;
@@ -62,6 +75,9 @@ namespace tfs
         int32_t last_expire_cloned_block_time_;
 
         uint64_t ns_ip_;
+        int32_t chunk_size_; // bytes of data in a packet
+        int32_t window_size_; // packets on the way
+        int32_t max_per_server_; // blocks to one destination at a time
     };
 
   }
@@ -27,7 +27,7 @@
 #include "new_client/fsname.h"
 #include "sync_backup.h"
 #include "logic_block.h"
-#include "blockfile_manager.h"
+#include "disk_manager.h"
 
 namespace tfs
 {
@@ -163,7 +163,7 @@ namespace tfs
 
     int NfsMirrorBackup::copy_file(const uint32_t block_id, const uint64_t file_id)
     {
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         return remote_copy_file(block_id, file_id);
@@ -607,7 +607,7 @@ namespace tfs
     int TfsMirrorBackup::copy_file(const uint32_t block_id, const uint64_t file_id)
     {
       int ret = TFS_SUCCESS;
-      LogicBlock* logic_block = BlockFileManager::get_instance()->get_logic_block(block_id);
+      LogicBlock* logic_block = DiskManager::get_instance()->get_logic_block(block_id);
       if (NULL == logic_block)
       {
         return remote_copy_file(block_id, file_id);
@@ -0,0 +1,102 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include "write_buffer_pool.h"
+#include <tbsys.h>
+#include <Memory.hpp>
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    WriteBufferPool::WriteBufferPool()
+    {
+      for (int32_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+      {
+        free_lists_[i].used_count_ = 0;
+      }
+    }
+
+    WriteBufferPool::~WriteBufferPool()
+    {
+      purge();
+    }
+
+    char* WriteBufferPool::alloc(const int32_t size_class)
+    {
+      assert(size_class >= 0 && size_class < SIZE_CLASS_COUNT);
+      char* chunk = NULL;
+      FreeList& list = free_lists_[size_class];
+      {
+        tbutil::Mutex::Lock lock(list.mutex_);
+        ++list.used_count_;
+        if (!list.chunks_.empty())
+        {
+          chunk = list.chunks_.back();
+          list.chunks_.pop_back();
+        }
+      }
+      if (NULL == chunk)
+      {
+        chunk = new char[get_chunk_size(size_class)];
+      }
+      return chunk;
+    }
+
+    void WriteBufferPool::free(char* chunk, const int32_t size_class)
+    {
+      assert(size_class >= 0 && size_class < SIZE_CLASS_COUNT);
+      if (NULL == chunk)
+      {
+        return;
+      }
+      FreeList& list = free_lists_[size_class];
+      {
+        tbutil::Mutex::Lock lock(list.mutex_);
+        --list.used_count_;
+        if (static_cast<int64_t>(list.chunks_.size() + 1) * get_chunk_size(size_class) <= MAX_FREE_SIZE)
+        {
+          list.chunks_.push_back(chunk);
+          chunk = NULL;
+        }
+      }
+      tbsys::gDeleteA(chunk);
+    }
+
+    void WriteBufferPool::purge()
+    {
+      for (int32_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+      {
+        std::vector<char*> chunks;
+        {
+          tbutil::Mutex::Lock lock(free_lists_[i].mutex_);
+          chunks.swap(free_lists_[i].chunks_);
+        }
+        for (std::vector<char*>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+        {
+          tbsys::gDeleteA(*it);
+        }
+      }
+    }
+
+    void WriteBufferPool::get_stat(int64_t& used_size, int64_t& cached_size)
+    {
+      used_size = 0;
+      cached_size = 0;
+      for (int32_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+      {
+        tbutil::Mutex::Lock lock(free_lists_[i].mutex_);
+        used_size += free_lists_[i].used_count_ * get_chunk_size(i);
+        cached_size += static_cast<int64_t>(free_lists_[i].chunks_.size()) * get_chunk_size(i);
+      }
+    }
+  }
+}
@@ -0,0 +1,71 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_DATASERVER_WRITEBUFFERPOOL_H_
+#define TFS_DATASERVER_WRITEBUFFERPOOL_H_
+
+#include <vector>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace dataserver
+  {
+    // pool of staging chunks for writing files. chunk sizes are powers of two,
+    // from MIN_CHUNK_SIZE(size class 0) to MIN_CHUNK_SIZE << (SIZE_CLASS_COUNT - 1).
+    // freed chunks are kept for reuse, up to MAX_FREE_SIZE bytes for every size class.
+    class WriteBufferPool
+    {
+      public:
+        WriteBufferPool();
+        ~WriteBufferPool();
+
+        static WriteBufferPool* get_instance()
+        {
+          static WriteBufferPool s_write_buffer_pool;
+          return &s_write_buffer_pool;
+        }
+
+        char* alloc(const int32_t size_class);
+        void free(char* chunk, const int32_t size_class);
+        // release all cached chunks
+        void purge();
+
+        // used: bytes held by writing files, cached: bytes kept in free lists
+        void get_stat(int64_t& used_size, int64_t& cached_size);
+
+        static inline int32_t get_chunk_size(const int32_t size_class)
+        {
+          return MIN_CHUNK_SIZE << size_class;
+        }
+
+      public:
+        static const int32_t MIN_CHUNK_SIZE = 16 * 1024;
+        static const int32_t SIZE_CLASS_COUNT = 7; // 16K .. 1M
+
+      private:
+        struct FreeList
+        {
+          tbutil::Mutex mutex_;
+          std::vector<char*> chunks_;
+          int64_t used_count_;
+        };
+
+      private:
+        DISALLOW_COPY_AND_ASSIGN(WriteBufferPool);
+        static const int64_t MAX_FREE_SIZE = 8 * 1024 * 1024;
+
+        FreeList free_lists_[SIZE_CLASS_COUNT];
+    };
+  }
+}
+#endif //TFS_DATASERVER_WRITEBUFFERPOOL_H_
@@ -20,7 +20,7 @@ namespace tfs
   namespace message
   {
     CompactBlockMessage::CompactBlockMessage() :
-      preserve_time_(0), block_id_(0)
+      preserve_time_(0), block_id_(0), is_owner_(0), mode_(common::COMPACT_MODE_FULL)
     {
       _packetHeader._pcode = common::COMPACT_BLOCK_MESSAGE;
     }
@@ -41,13 +41,19 @@ namespace tfs
       {
         iret = input.get_int32(&is_owner_);
       }
+      // older nameservers send no mode
+      if (common::TFS_SUCCESS == iret
+          && input.get_data_length() >= common::INT_SIZE)
+      {
+        iret = input.get_int32(&mode_);
+      }
       return iret;
     }
 
 
     int64_t CompactBlockMessage::length() const
     {
-      return common::INT_SIZE * 3;
+      return common::INT_SIZE * 4;
     }
 
     int CompactBlockMessage::serialize(common::Stream& output) const 
@@ -61,6 +67,10 @@ namespace tfs
       {
         iret = output.set_int32(is_owner_);
       }
+      if (common::TFS_SUCCESS == iret)
+      {
+        iret = output.set_int32(mode_);
+      }
       return iret;
     }
 
@@ -53,10 +53,19 @@ namespace tfs
         {
           return is_owner_;
         }
+        inline void set_mode(const int32_t mode)
+        {
+          mode_ = mode;
+        }
+        inline int32_t get_mode() const
+        {
+          return mode_;
+        }
       protected:
         int32_t preserve_time_;
         uint32_t block_id_;
         int32_t is_owner_;
+        int32_t mode_; // CompactMode
     };
 
     class CompactBlockCompleteMessage: public common::BasePacket 
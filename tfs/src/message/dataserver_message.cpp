@@ -19,7 +19,7 @@ namespace tfs
   namespace message
   {
     SetDataserverMessage::SetDataserverMessage() :
-      has_block_(common::HAS_BLOCK_FLAG_NO)
+      has_block_(common::HAS_BLOCK_FLAG_NO), report_seq_(0), base_seq_(0)
     {
       _packetHeader._pcode = common::SET_DATASERVER_MESSAGE;
       memset(&ds_, 0, sizeof(ds_));
@@ -41,7 +41,7 @@ namespace tfs
         iret = input.get_int32(reinterpret_cast<int32_t*> (&has_block_));
         if (common::TFS_SUCCESS == iret)
         {
-          if (has_block_  == common::HAS_BLOCK_FLAG_YES)
+          if (has_block_ != common::HAS_BLOCK_FLAG_NO)
           {
             int32_t size = 0;
             iret = input.get_int32(&size);
@@ -66,6 +66,22 @@ namespace tfs
           }
         }
       }
+      // older dataservers send no report seq
+      if (common::TFS_SUCCESS == iret
+          && has_block_ != common::HAS_BLOCK_FLAG_NO
+          && input.get_data_length() >= common::INT64_SIZE)
+      {
+        iret = input.get_int64(&report_seq_);
+        if (common::TFS_SUCCESS == iret
+            && has_block_ == common::HAS_BLOCK_FLAG_DELTA)
+        {
+          iret = input.get_int64(&base_seq_);
+          if (common::TFS_SUCCESS == iret)
+          {
+            iret = input.get_vint32(removed_blocks_);
+          }
+        }
+      }
       return iret;
     }
 
@@ -77,6 +93,11 @@ namespace tfs
         len += common::INT_SIZE;
         common::BlockInfo info;
         len += blocks_.size() * info.length();
+        len += common::INT64_SIZE;
+        if (has_block_ == common::HAS_BLOCK_FLAG_DELTA)
+        {
+          len += common::INT64_SIZE + common::Serialization::get_vint32_length(removed_blocks_);
+        }
       }
       return len;
     }
@@ -96,7 +117,7 @@ namespace tfs
       }
       if (common::TFS_SUCCESS == iret)
       {
-        if (has_block_ == common::HAS_BLOCK_FLAG_YES)
+        if (has_block_ != common::HAS_BLOCK_FLAG_NO)
         {
           iret = output.set_int32(blocks_.size());
           if (common::TFS_SUCCESS == iret)
@@ -112,6 +133,19 @@ namespace tfs
                 break;
             }
           }
+          if (common::TFS_SUCCESS == iret)
+          {
+            iret = output.set_int64(report_seq_);
+          }
+          if (common::TFS_SUCCESS == iret
+              && has_block_ == common::HAS_BLOCK_FLAG_DELTA)
+          {
+            iret = output.set_int64(base_seq_);
+            if (common::TFS_SUCCESS == iret)
+            {
+              iret = output.set_vint32(removed_blocks_);
+            }
+          }
         }
       }
       return iret;
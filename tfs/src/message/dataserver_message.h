@@ -46,10 +46,35 @@ namespace tfs
         {
           return blocks_;
         }
+        // seq of this block report, base_seq the report a delta is against
+        inline void set_report_seq(const int64_t report_seq, const int64_t base_seq)
+        {
+          report_seq_ = report_seq;
+          base_seq_ = base_seq;
+        }
+        inline int64_t get_report_seq() const
+        {
+          return report_seq_;
+        }
+        inline int64_t get_base_seq() const
+        {
+          return base_seq_;
+        }
+        inline void add_removed_block(const uint32_t block_id)
+        {
+          removed_blocks_.push_back(block_id);
+        }
+        inline const common::VUINT32& get_removed_blocks() const
+        {
+          return removed_blocks_;
+        }
       protected:
         common::DataServerStatInfo ds_;
         common::BLOCK_INFO_LIST blocks_;
         common::HasBlockFlag has_block_;
+        int64_t report_seq_;
+        int64_t base_seq_;
+        common::VUINT32 removed_blocks_;
     };
 
     /*class SuspectDataserverMessage: public common::BasePacket 
@@ -48,6 +48,7 @@ namespace tfs
       alloc_(false)
     {
       setPCode(common::GET_DATASERVER_INFORMATION_RESPONSE_MESSAGE);
+      memset(&cache_stat_, 0, sizeof(cache_stat_));
     }
     GetDataServerInformationResponseMessage::~GetDataServerInformationResponseMessage()
     {
@@ -81,6 +82,15 @@ namespace tfs
           iret = output.set_bytes(data_, data_length_);
         }
       }
+      if (common::TFS_SUCCESS == iret)
+      {
+        pos = 0;
+        iret = cache_stat_.serialize(output.get_free(), output.get_free_length(), pos);
+        if (common::TFS_SUCCESS == iret)
+        {
+          output.pour(cache_stat_.length());
+        }
+      }
       return iret;
     }
 
@@ -109,15 +119,28 @@ namespace tfs
           if (data_length_ > 0)
           {
             data_ = input.get_data();
+            input.drain(data_length_);
           }
         }
       }
+      //old dataserver does not carry the read cache stat
+      if (common::TFS_SUCCESS == iret
+          && input.get_data_length() >= cache_stat_.length())
+      {
+        pos = 0;
+        iret = cache_stat_.deserialize(input.get_data(), input.get_data_length(), pos);
+        if (common::TFS_SUCCESS == iret)
+        {
+          input.drain(cache_stat_.length());
+        }
+      }
       return iret;
     }
 
     int64_t GetDataServerInformationResponseMessage::length() const
     {
-      return sblock_.length() + info_.length() + common::INT16_SIZE + common::INT_SIZE * 2 + data_length_;
+      return sblock_.length() + info_.length() + common::INT16_SIZE + common::INT_SIZE * 2 + data_length_
+        + cache_stat_.length();
     }
 
     char* GetDataServerInformationResponseMessage::alloc_data(const int64_t length)
@@ -48,6 +48,8 @@ namespace tfs
         void set_dataserver_stat_info(const common::DataServerStatInfo& info) { info_ = info;}
         const common::SuperBlock& get_super_block() const { return sblock_;}
         const common::DataServerStatInfo& get_dataserver_stat_info() const { return info_;}
+        void set_read_cache_stat(const common::ReadCacheStat& stat) { cache_stat_ = stat;}
+        const common::ReadCacheStat& get_read_cache_stat() const { return cache_stat_;}
 
         int32_t& get_bit_map_element_count() {return  bit_map_element_count_;}
 
@@ -58,6 +60,7 @@ namespace tfs
       protected:
         common::SuperBlock sblock_;
         common::DataServerStatInfo info_;
+        common::ReadCacheStat cache_stat_;
         int32_t bit_map_element_count_;
         int32_t data_length_;
         char* data_;
@@ -22,7 +22,7 @@ namespace tfs
   namespace message
   {
     RespHeartMessage::RespHeartMessage() :
-      status_(0), sync_mirror_status_(0)
+      status_(0), sync_mirror_status_(0), report_seq_(0)
     {
       _packetHeader._pcode = common::RESP_HEART_MESSAGE;
       expire_blocks_.clear();
@@ -48,6 +48,12 @@ namespace tfs
       {
         iret = input.get_vint32(new_blocks_);
       }
+      // older nameservers send no report seq
+      if (common::TFS_SUCCESS == iret
+          && input.get_data_length() >= common::INT64_SIZE)
+      {
+        iret = input.get_int64(&report_seq_);
+      }
       return iret;
     }
 
@@ -55,7 +61,7 @@ namespace tfs
     {
       return common::INT_SIZE * 2 + 
                 common::Serialization::get_vint32_length(expire_blocks_) + 
-                  common::Serialization::get_vint32_length(new_blocks_);
+                  common::Serialization::get_vint32_length(new_blocks_) + common::INT64_SIZE;
     }
 
     int RespHeartMessage::serialize(common::Stream& output) const 
@@ -73,6 +79,10 @@ namespace tfs
       {
         iret = output.set_vint32(new_blocks_);
       }
+      if (common::TFS_SUCCESS == iret)
+      {
+        iret = output.set_int64(report_seq_);
+      }
       return iret;
     }
 
@@ -63,11 +63,21 @@ namespace tfs
         {
           return sync_mirror_status_;
         }
+        // the last block report nameserver applied, 0 if none
+        inline void set_report_seq(const int64_t report_seq)
+        {
+          report_seq_ = report_seq;
+        }
+        inline int64_t get_report_seq() const
+        {
+          return report_seq_;
+        }
       protected:
         int32_t status_;
         int32_t sync_mirror_status_;
         common::VUINT32 expire_blocks_;
         common::VUINT32 new_blocks_;
+        int64_t report_seq_;
     };
 
 #pragma pack(4)
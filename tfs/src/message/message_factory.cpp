@@ -216,6 +216,12 @@ namespace tfs
           case common::GET_DATASERVER_INFORMATION_RESPONSE_MESSAGE:
             packet = new GetDataServerInformationResponseMessage();
             break;
+          case common::BATCH_READ_DATA_MESSAGE:
+            packet = new BatchReadDataMessage();
+            break;
+          case common::RESP_BATCH_READ_DATA_MESSAGE:
+            packet = new RespBatchReadDataMessage();
+            break;
           default:
             TBSYS_LOG(ERROR, "pcode: %d not found in message factory", real_pcode);
             break;
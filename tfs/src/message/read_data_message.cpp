@@ -113,18 +113,25 @@ namespace tfs
     }
 
     RespReadDataMessage::RespReadDataMessage() :
-      data_(NULL), length_(-1), alloc_(false)
+      data_(NULL), length_(-1), head_len_(0), alloc_(false)
     {
       _packetHeader._pcode = common::RESP_READ_DATA_MESSAGE;
     }
 
     RespReadDataMessage::~RespReadDataMessage()
+    {
+      free_data();
+    }
+
+    void RespReadDataMessage::free_data()
     {
       if ((NULL != data_ ) && (alloc_))
       {
-        ::free(data_);
-        data_ = NULL;
+        ::free(data_ - head_len_);
       }
+      data_ = NULL;
+      head_len_ = 0;
+      alloc_ = false;
     }
 
     char* RespReadDataMessage::alloc_data(const int32_t len)
@@ -138,17 +145,31 @@ namespace tfs
         length_ = len;
         return NULL;
       }
-      if (data_ != NULL)
-      {
-        ::free(data_);
-        data_ = NULL;
-      }
+      free_data();
       length_ = len;
       data_ = (char*) malloc(len);
       alloc_ = true;
       return data_;
     }
 
+    char* RespReadDataMessage::alloc_data(const int32_t len, const int32_t head_len)
+    {
+      if (len < 0 || head_len < 0 || len + head_len == 0)
+      {
+        return NULL;
+      }
+      free_data();
+      char* head = (char*) malloc(len + head_len);
+      if (NULL != head)
+      {
+        length_ = len;
+        head_len_ = head_len;
+        data_ = head + head_len;
+        alloc_ = true;
+      }
+      return head;
+    }
+
     int RespReadDataMessage::deserialize(common::Stream& input)
     {
       int32_t iret = input.get_int32(&length_);
@@ -305,6 +326,154 @@ namespace tfs
 
     }
 
+    BatchReadDataMessage::BatchReadDataMessage():
+      flag_(common::READ_DATA_OPTION_FLAG_NORMAL)
+    {
+      _packetHeader._pcode = common::BATCH_READ_DATA_MESSAGE;
+    }
+
+    BatchReadDataMessage::~BatchReadDataMessage()
+    {
+    }
+
+    int BatchReadDataMessage::deserialize(common::Stream& input)
+    {
+      int32_t count = 0;
+      int32_t iret = input.get_int32(&count);
+      if (common::TFS_SUCCESS == iret)
+      {
+        iret = count >= 0 && count <= common::MAX_BATCH_READ_COUNT ? common::TFS_SUCCESS : common::TFS_ERROR;
+      }
+      for (int32_t i = 0; i < count && common::TFS_SUCCESS == iret; ++i)
+      {
+        int64_t pos = 0;
+        ReadDataInfo read_info;
+        iret = read_info.deserialize(input.get_data(), input.get_data_length(), pos);
+        if (common::TFS_SUCCESS == iret)
+        {
+          input.drain(read_info.length());
+          read_infos_.push_back(read_info);
+        }
+      }
+      if (common::TFS_SUCCESS == iret)
+      {
+        iret = input.get_int8(&flag_);
+      }
+      return iret;
+    }
+
+    int64_t BatchReadDataMessage::length() const
+    {
+      int64_t len = common::INT_SIZE + common::INT8_SIZE;
+      for (size_t i = 0; i < read_infos_.size(); ++i)
+      {
+        len += read_infos_[i].length();
+      }
+      return len;
+    }
+
+    int BatchReadDataMessage::serialize(common::Stream& output) const
+    {
+      int32_t iret = output.set_int32(read_infos_.size());
+      for (size_t i = 0; i < read_infos_.size() && common::TFS_SUCCESS == iret; ++i)
+      {
+        int64_t pos = 0;
+        iret = read_infos_[i].serialize(output.get_free(), output.get_free_length(), pos);
+        if (common::TFS_SUCCESS == iret)
+        {
+          output.pour(read_infos_[i].length());
+        }
+      }
+      if (common::TFS_SUCCESS == iret)
+      {
+        iret = output.set_int8(flag_);
+      }
+      return iret;
+    }
+
+    RespBatchReadDataMessage::RespBatchReadDataMessage():
+      buffer_(NULL)
+    {
+      _packetHeader._pcode = common::RESP_BATCH_READ_DATA_MESSAGE;
+    }
+
+    RespBatchReadDataMessage::~RespBatchReadDataMessage()
+    {
+      ::free(buffer_);
+    }
+
+    char* RespBatchReadDataMessage::alloc_data(const int64_t len)
+    {
+      ::free(buffer_);
+      buffer_ = len > 0 ? (char*) malloc(len) : NULL;
+      return buffer_;
+    }
+
+    int RespBatchReadDataMessage::deserialize(common::Stream& input)
+    {
+      int32_t count = 0;
+      int32_t iret = input.get_int32(&count);
+      for (int32_t i = 0; i < count && common::TFS_SUCCESS == iret; ++i)
+      {
+        int32_t len = 0;
+        int32_t file_size = 0;
+        iret = input.get_int32(&len);
+        if (common::TFS_SUCCESS == iret)
+        {
+          iret = input.get_int32(&file_size);
+        }
+        if (common::TFS_SUCCESS == iret)
+        {
+          const char* data = NULL;
+          if (len > 0)
+          {
+            iret = input.get_data_length() >= len ? common::TFS_SUCCESS : common::TFS_ERROR;
+            if (common::TFS_SUCCESS == iret)
+            {
+              data = input.get_data();
+              input.drain(len);
+            }
+          }
+          if (common::TFS_SUCCESS == iret)
+          {
+            add_data(len, data, file_size);
+          }
+        }
+      }
+      return iret;
+    }
+
+    int64_t RespBatchReadDataMessage::length() const
+    {
+      int64_t len = common::INT_SIZE * (lengths_.size() * 2 + 1);
+      for (size_t i = 0; i < lengths_.size(); ++i)
+      {
+        if (lengths_[i] > 0)
+        {
+          len += lengths_[i];
+        }
+      }
+      return len;
+    }
+
+    int RespBatchReadDataMessage::serialize(common::Stream& output) const
+    {
+      int32_t iret = output.set_int32(lengths_.size());
+      for (size_t i = 0; i < lengths_.size() && common::TFS_SUCCESS == iret; ++i)
+      {
+        iret = output.set_int32(lengths_[i]);
+        if (common::TFS_SUCCESS == iret)
+        {
+          iret = output.set_int32(file_sizes_[i]);
+        }
+        if (common::TFS_SUCCESS == iret && lengths_[i] > 0)
+        {
+          iret = output.set_bytes(datas_[i], lengths_[i]);
+        }
+      }
+      return iret;
+    }
+
     int ReadScaleImageMessage::ZoomData::deserialize(const char* data, const int64_t data_len, int64_t& pos)
     {
       int32_t iret = NULL != data && data_len - pos >= length() ? common::TFS_SUCCESS : common::TFS_ERROR;
@@ -15,6 +15,7 @@
  */
 #ifndef TFS_MESSAGE_READDATAMESSAGE_H_
 #define TFS_MESSAGE_READDATAMESSAGE_H_
+#include <vector>
 #include "common/base_packet.h"
 namespace tfs
 {
@@ -96,12 +97,18 @@ namespace tfs
         virtual int64_t length() const;
 
         char* alloc_data(const int32_t len);
+        // allocate head_len bytes in front of data, so the caller can read the
+        // FileInfo and the file data from disk into one buffer without copying.
+        // return the start of the head, get_data() still points to the data
+        char* alloc_data(const int32_t len, const int32_t head_len);
         inline void set_length(const int32_t len) { length_ = len;}
         inline char* get_data() const { return data_;}
         inline int32_t get_length() const { return length_;}
       protected:
+        void free_data();
         char* data_;
         int32_t length_;
+        int32_t head_len_;
         bool alloc_;
     };
 
@@ -162,6 +169,69 @@ namespace tfs
         virtual ~RespReadRawDataMessage();
     };
 
+    // read many files in one request, offset and length of every file
+    // mean the same as ReadDataMessage
+    class BatchReadDataMessage: public common::BasePacket
+    {
+      public:
+        BatchReadDataMessage();
+        virtual ~BatchReadDataMessage();
+        virtual int serialize(common::Stream& output) const ;
+        virtual int deserialize(common::Stream& input);
+        virtual int64_t length() const;
+        void add_read_info(const ReadDataInfo& read_info)
+        {
+          read_infos_.push_back(read_info);
+        }
+        const std::vector<ReadDataInfo>& get_read_infos() const
+        {
+          return read_infos_;
+        }
+        int8_t get_flag() const
+        {
+          return flag_;
+        }
+        void set_flag(const int8_t flag)
+        {
+          flag_ = flag;
+        }
+      protected:
+        std::vector<ReadDataInfo> read_infos_;
+        int8_t flag_;
+    };
+
+    // data of all files of a BatchReadDataMessage, in the same order.
+    // length of a file is its error code if it is failed to read
+    class RespBatchReadDataMessage: public common::BasePacket
+    {
+      public:
+        RespBatchReadDataMessage();
+        virtual ~RespBatchReadDataMessage();
+        virtual int serialize(common::Stream& output) const ;
+        virtual int deserialize(common::Stream& input);
+        virtual int64_t length() const;
+
+        // one buffer for data of all files
+        char* alloc_data(const int64_t len);
+        // data lies in the buffer of alloc_data. file_size is the size of the whole file when
+        // read from its start, so a reader knows its buffer was too small; 0 if not known
+        void add_data(const int32_t length, const char* data, const int32_t file_size = 0)
+        {
+          lengths_.push_back(length);
+          datas_.push_back(data);
+          file_sizes_.push_back(file_size);
+        }
+        inline int32_t get_count() const { return lengths_.size();}
+        inline int32_t get_length(const int32_t index) const { return lengths_[index];}
+        inline const char* get_data(const int32_t index) const { return datas_[index];}
+        inline int32_t get_file_size(const int32_t index) const { return file_sizes_[index];}
+      protected:
+        char* buffer_;
+        std::vector<int32_t> lengths_;
+        std::vector<const char*> datas_;
+        std::vector<int32_t> file_sizes_;
+    };
+
     class ReadScaleImageMessage: public ReadDataMessage
     {
       public:
@@ -125,7 +125,7 @@ namespace tfs
 #endif
 
     WriteRawDataMessage::WriteRawDataMessage() :
-      data_(NULL), flag_(0)
+      data_(NULL), flag_(0), data_crc_(0), has_data_crc_(false)
     {
       _packetHeader._pcode = common::WRITE_RAW_DATA_MESSAGE;
       memset(&write_data_info_, 0, sizeof(write_data_info_));
@@ -154,12 +154,23 @@ namespace tfs
       {
         iret = input.get_int32(&flag_);
       }
+      // older dataservers send no crc
+      if (common::TFS_SUCCESS == iret
+          && input.get_data_length() >= common::INT_SIZE)
+      {
+        iret = input.get_int32(reinterpret_cast<int32_t*>(&data_crc_));
+        has_data_crc_ = common::TFS_SUCCESS == iret;
+      }
       return iret;
     }
 
     int64_t WriteRawDataMessage::length() const
     {
       int64_t len = write_data_info_.length() + common::INT_SIZE;
+      if (has_data_crc_)
+      {
+        len += common::INT_SIZE;
+      }
       if (write_data_info_.length_ > 0)
       {
         len += write_data_info_.length_;
@@ -184,6 +195,10 @@ namespace tfs
       {
         iret = output.set_int32(flag_);
       }
+      if (common::TFS_SUCCESS == iret && has_data_crc_)
+      {
+        iret = output.set_int32(data_crc_);
+      }
       return iret;
     }
 
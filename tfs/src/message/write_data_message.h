@@ -205,10 +205,23 @@ namespace tfs
         {
           return flag_;
         }
+        inline void set_data_crc(const uint32_t crc)
+        {
+          data_crc_ = crc;
+          has_data_crc_ = true;
+        }
+        // crc of data, false if the sender is too old to send it
+        inline bool get_data_crc(uint32_t& crc) const
+        {
+          crc = data_crc_;
+          return has_data_crc_;
+        }
       protected:
         common::WriteDataInfo write_data_info_;
         const char* data_;
         int32_t flag_;
+        uint32_t data_crc_;
+        bool has_data_crc_;
     };
 
     class WriteInfoBatchMessage:  public common::BasePacket
@@ -18,13 +18,15 @@
 #include "block_chunk.h"
 #include "block_collect.h"
 #include "global_factory.h"
+#include "epoch.h"
 using namespace tfs::common;
 
 namespace tfs
 {
   namespace nameserver
   {
-    BlockChunk::BlockChunk()
+    BlockChunk::BlockChunk(const int32_t stride):
+      block_map_(stride)
     {
 
     }
@@ -35,7 +37,8 @@ namespace tfs
       BLOCK_MAP::iterator iter = block_map_.begin();
       for (; iter != block_map_.end(); ++iter)
       {
-        tbsys::gDelete(iter->second);
+        BlockCollect* block = iter->second;
+        tbsys::gDelete(block);
       }
       block_map_.clear();
     }
@@ -91,6 +94,13 @@ namespace tfs
       return iter == block_map_.end() ? NULL : iter->second;
     }
 
+    int BlockChunk::get_readable_servers(const uint32_t block_id, VUINT64& servers) const
+    {
+      EpochManager::Guard guard(EpochManager::instance());
+      BlockCollect* block = block_map_.get(block_id);
+      return NULL == block ? EXIT_BLOCK_NOT_FOUND : block->get_readable_servers(servers);
+    }
+
     bool BlockChunk::exist(const uint32_t block_id) const
     {
       BLOCK_MAP::const_iterator iter = block_map_.find(block_id);
@@ -21,6 +21,7 @@
 #include <Shared.h>
 #include <Handle.h>
 #include "ns_define.h"
+#include "block_table.h"
 #include "common/lock.h"
 #include "common/internal.h"
 
@@ -33,7 +34,8 @@ namespace tfs
     {
       friend class LayoutManager;
       public:
-      BlockChunk();
+      // stride: number of chunks, ids of a chunk are block_id % stride
+      explicit BlockChunk(const int32_t stride = 1);
       virtual ~BlockChunk();
       BlockCollect* add(const uint32_t block_id, const time_t now);
       static bool connect(BlockCollect* block, ServerCollect* server, const time_t now, const bool force, bool& writable);
@@ -42,8 +44,13 @@ namespace tfs
 
       BlockCollect* find(const uint32_t block_id);
 
+      // no lock: the servers of block_id from what is published to readers
+      int get_readable_servers(const uint32_t block_id, common::VUINT64& servers) const;
+
       bool exist(const uint32_t block_id) const;
 
+      inline const BLOCK_MAP& get_blocks() const { return block_map_;}
+
       uint32_t calc_max_block_id() const;
       int64_t  calc_all_block_bytes() const;
       uint32_t calc_size() const;
@@ -17,6 +17,7 @@
 #include "common/parameter.h"
 #include "block_collect.h"
 #include "server_collect.h"
+#include "common/atomic.h"
 
 using namespace tfs::common;
 using namespace tbsys;
@@ -32,9 +33,64 @@ namespace nameserver
   const int8_t BlockCollect::BLOCK_IN_MASTER_SET_NO = 0x00;
   const int8_t BlockCollect::BLOCK_IN_MASTER_SET_YES = 0x01;
   const int8_t BlockCollect::VERSION_AGREED_MASK = 2;
+
+  ServerSlots::~ServerSlots()
+  {
+    if (data_ != inline_)
+    {
+      delete [] data_;
+    }
+  }
+
+  ServerSlots::iterator ServerSlots::insert(iterator where, ServerCollect* server)
+  {
+    int32_t index = where - data_;
+    if (size_ >= capacity_)
+    {
+      ServerCollect** data = new ServerCollect*[capacity_ * 2];
+      memcpy(data, data_, size_ * sizeof(ServerCollect*));
+      if (data_ != inline_)
+      {
+        delete [] data_;
+      }
+      data_ = data;
+      capacity_ *= 2;
+    }
+    memmove(data_ + index + 1, data_ + index, (size_ - index) * sizeof(ServerCollect*));
+    data_[index] = server;
+    ++size_;
+    return data_ + index;
+  }
+
+  ServerSlots::iterator ServerSlots::erase(iterator where)
+  {
+    int32_t index = where - data_;
+    memmove(data_ + index, data_ + index + 1, (size_ - index - 1) * sizeof(ServerCollect*));
+    --size_;
+    if (data_ != inline_ && size_ <= INLINE_SIZE)
+    {
+      memcpy(inline_, data_, size_ * sizeof(ServerCollect*));
+      delete [] data_;
+      data_ = inline_;
+      capacity_ = INLINE_SIZE;
+    }
+    return data_ + index;
+  }
+
+  void ServerSlots::clear()
+  {
+    if (data_ != inline_)
+    {
+      delete [] data_;
+      data_ = inline_;
+      capacity_ = INLINE_SIZE;
+    }
+    size_ = 0;
+  }
  
   BlockCollect::BlockCollect(const uint32_t block_id, const time_t now):
     GCObject(now),
+    readable_(NULL),
     last_update_time_(now),
     hold_master_(HOLD_MASTER_FLAG_NO),
     create_flag_(BLOCK_CREATE_FLAG_NO),
@@ -46,6 +102,13 @@ namespace nameserver
     info_.seq_no_ = 1;
   }
 
+  BlockCollect::~BlockCollect()
+  {
+    // freed by gc long after it left the read index, no reader on it
+    ReadableServers* readable = readable_;
+    tbsys::gDelete(readable);
+  }
+
   bool BlockCollect::add(ServerCollect* server, const time_t now, const bool force, bool& writable)
   {
     bool bret = server != NULL;
@@ -57,7 +120,7 @@ namespace nameserver
       bool can_be_master = ((writable && hold_master_ == HOLD_MASTER_FLAG_NO 
                 && server->can_be_master(SYSPARAM_NAMESERVER.max_write_file_count_)) );
       TBSYS_LOG(DEBUG, "server: %s can_be_master: %d, block: %u writable: %d", tbsys::CNetUtil::addrToString(server->id()).c_str(), can_be_master, id(), writable);
-      std::vector<ServerCollect*>::iterator where = 
+      ServerSlots::iterator where = 
           std::find(hold_.begin(), hold_.end(), server);
       if (force 
           && (!hold_.empty())
@@ -97,6 +160,7 @@ namespace nameserver
         hold_[0]->add_master(this);
         in_master_set_ = BLOCK_IN_MASTER_SET_YES;
       }
+      publish_readable();
     }
     return bret;
   }
@@ -106,7 +170,7 @@ namespace nameserver
     TBSYS_LOG(DEBUG, "remove block: %u" , info_.block_id_);
     if (server != NULL && !hold_.empty())
     {
-      std::vector<ServerCollect*>::iterator where = find(hold_.begin(), hold_.end(), server);
+      ServerSlots::iterator where = std::find(hold_.begin(), hold_.end(), server);
       if (where == hold_.end())
       {
         TBSYS_LOG(WARN, "dataserver: %s not found in hold_", CNetUtil::addrToString(server->id()).c_str());
@@ -135,6 +199,7 @@ namespace nameserver
 
         hold_.erase(where);
         last_update_time_ = now;
+        publish_readable();
 
         if (is_relieve_writable_relation())
         {
@@ -148,7 +213,7 @@ namespace nameserver
   bool BlockCollect::exist(const ServerCollect* const server) const
   {
     if (server == NULL) return false;
-    std::vector<ServerCollect*>::const_iterator iter = 
+    ServerSlots::const_iterator iter = 
       std::find(hold_.begin(), hold_.end(), server);
     return iter != hold_.end();
   }
@@ -182,7 +247,7 @@ namespace nameserver
         && (static_cast<int32_t>(hold_.size()) >= common::SYSPARAM_NAMESERVER.min_replication_));
     /*if (bret)
     {
-      std::vector<ServerCollect*>::const_iterator iter = hold_.begin();
+      ServerSlots::const_iterator iter = hold_.begin();
       for (; iter != hold_.end(); ++iter)
       {
         assert ((*iter) != NULL);
@@ -204,7 +269,7 @@ namespace nameserver
     /*if (!bret)
     {
       bool all_server_writable = true;
-      std::vector<ServerCollect*>::const_iterator iter = hold_.begin();
+      ServerSlots::const_iterator iter = hold_.begin();
       for (; iter != hold_.end(); ++iter)
       {
         assert(*iter != NULL);
@@ -222,7 +287,7 @@ namespace nameserver
 
   bool BlockCollect::relieve_relation(const bool remove)
   {
-    std::vector<ServerCollect*>::iterator iter = hold_.begin();
+    ServerSlots::iterator iter = hold_.begin();
     for (; iter != hold_.end(); ++iter)
     {
       if (remove)
@@ -258,7 +323,7 @@ namespace nameserver
     {
       const int32_t ds_size = static_cast<int32_t>(hold_.size()); 
       if ((ds_size > SYSPARAM_NAMESERVER.min_replication_)
-          && (find(hold_.begin(), hold_.end(), server) == hold_.end()))
+          && (std::find(hold_.begin(), hold_.end(), server) == hold_.end()))
       {
         if ((info_.file_count_ > new_block_info.file_count_)
             || (info_.size_ != new_block_info.size_)) 
@@ -330,6 +395,7 @@ namespace nameserver
               }
               hold_master_ = HOLD_MASTER_FLAG_NO;
               hold_.clear();
+              publish_readable();
               last_update_time_ = now;
             }
           }
@@ -465,6 +531,23 @@ namespace nameserver
     return bret;
   }
 
+  // a block of few deleted bytes has few files behind its holes to move,
+  // cheaper than copying the whole block
+  CompactMode BlockCollect::get_compact_mode() const
+  {
+    CompactMode mode = COMPACT_MODE_FULL;
+    if (info_.size_ > 0)
+    {
+      int32_t delete_size_ratio = 
+        static_cast<int32_t>(100 * static_cast<float>(info_.del_size_) / static_cast<float>(info_.size_));
+      if (delete_size_ratio <= SYSPARAM_NAMESERVER.compact_incremental_ratio_)
+      {
+        mode = COMPACT_MODE_INCREMENTAL;
+      }
+    }
+    return mode;
+  }
+
   int BlockCollect::check_redundant() const
   {
     return hold_.size() - SYSPARAM_NAMESERVER.max_replication_;
@@ -477,6 +560,38 @@ namespace nameserver
         && (is_full()));
   }
 
+  int BlockCollect::get_readable_servers(VUINT64& servers) const
+  {
+    ReadableServers* readable = readable_;
+    if (NULL != readable)
+    {
+      servers.insert(servers.end(), readable->servers_.begin(), readable->servers_.end());
+    }
+    return NULL == readable || readable->servers_.empty() ? EXIT_NO_DATASERVER : TFS_SUCCESS;
+  }
+
+  void BlockCollect::publish_readable()
+  {
+    ReadableServers* old = readable_;
+    bool changed = NULL == old ? !hold_.empty() : old->servers_.size() != hold_.size();
+    for (uint32_t i = 0; !changed && i < hold_.size(); ++i)
+    {
+      changed = old->servers_[i] != hold_[i]->id();
+    }
+    if (changed)
+    {
+      ReadableServers* readable = new ReadableServers();
+      readable->servers_.reserve(hold_.size());
+      ServerSlots::const_iterator iter = hold_.begin();
+      for (; iter != hold_.end(); ++iter)
+      {
+        readable->servers_.push_back((*iter)->id());
+      }
+      atomic_exchange_pointer(reinterpret_cast<volatile pvoid*>(&readable_), readable);
+      EpochManager::instance().retire(old);
+    }
+  }
+
   int BlockCollect::scan(SSMScanParameter& param) const
   {
     int16_t child_type = param.child_type_;
@@ -490,7 +605,7 @@ namespace nameserver
       if (child_type & SSM_CHILD_BLOCK_TYPE_SERVER)
       {
         param.data_.writeInt8(hold_.size());
-        std::vector<ServerCollect*>::const_iterator iter = hold_.begin();
+        ServerSlots::const_iterator iter = hold_.begin();
         for (; iter != hold_.end(); ++iter)
         {
           param.data_.writeInt64((*iter)->id());
@@ -504,7 +619,7 @@ namespace nameserver
   {
 #ifndef TFS_NS_DEBUG
     std::string str;
-    std::vector<ServerCollect*>::const_iterator iter = hold_.begin();
+    ServerSlots::const_iterator iter = hold_.begin();
     for (; iter != hold_.end(); ++iter)
     {
       str += CNetUtil::addrToString((*iter)->id());
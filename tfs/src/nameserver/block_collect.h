@@ -21,6 +21,7 @@
 #include <time.h>
 #include <vector>
 #include "ns_define.h"
+#include "epoch.h"
 #include "common/parameter.h"
 
 namespace tfs
@@ -30,10 +31,51 @@ namespace nameserver
   class ServerCollect;
   class BlockCollect;
   typedef std::map<ServerCollect*, std::vector<BlockCollect*> > EXPIRE_BLOCK_LIST;
+
+  // ids of the servers hold a block, never changed once published
+  struct ReadableServers : public EpochObject
+  {
+    common::VUINT64 servers_;
+  };
+
+  // servers hold a block, master first. up to INLINE_SIZE in place, no heap
+  // node and no pointer to chase, more (over replicated) go to the heap
+  class ServerSlots
+  {
+  public:
+    typedef ServerCollect** iterator;
+    typedef ServerCollect* const* const_iterator;
+    ServerSlots(): data_(inline_), size_(0), capacity_(INLINE_SIZE) {}
+    ~ServerSlots();
+
+    inline iterator begin() { return data_;}
+    inline iterator end() { return data_ + size_;}
+    inline const_iterator begin() const { return data_;}
+    inline const_iterator end() const { return data_ + size_;}
+    inline uint32_t size() const { return size_;}
+    inline bool empty() const { return 0 == size_;}
+    inline ServerCollect*& operator[](const int32_t index) { return data_[index];}
+    inline ServerCollect* operator[](const int32_t index) const { return data_[index];}
+    inline void push_back(ServerCollect* server) { insert(end(), server);}
+    iterator insert(iterator where, ServerCollect* server);
+    iterator erase(iterator where);
+    void clear();
+    operator std::vector<ServerCollect*>() const { return std::vector<ServerCollect*>(begin(), end());}
+
+    static const int32_t INLINE_SIZE = 4;
+  private:
+    DISALLOW_COPY_AND_ASSIGN(ServerSlots);
+    ServerCollect** data_;
+    uint16_t size_;
+    uint16_t capacity_;
+    ServerCollect* inline_[INLINE_SIZE];
+  };
+
   class BlockCollect : public virtual GCObject
   {
  public:
     BlockCollect(const uint32_t block_id, const time_t now);
+    virtual ~BlockCollect();
     bool add(ServerCollect* server, const time_t now, const bool force, bool& writable);
     bool remove(ServerCollect* server, const time_t now, const bool remove = true);
     bool exist(const ServerCollect* const server) const;
@@ -48,14 +90,16 @@ namespace nameserver
     common::PlanPriority check_replicate(const time_t now) const;
     bool check_balance() const;
     bool check_compact() const;
+    common::CompactMode get_compact_mode() const;
     int check_redundant() const;
     bool is_relieve_writable_relation() const;
     bool relieve_relation(const bool remove = true);
 
     inline int32_t size() const { return info_.size_;}
-    inline std::vector<ServerCollect*>& get_hold() { return hold_;}
+    inline ServerSlots& get_hold() { return hold_;}
     inline int32_t get_hold_size() const { return hold_.size();}
     inline void update(const common::BlockInfo& info) { memcpy(&info_, &info, sizeof(info_));} 
+    inline const common::BlockInfo& get_block_info() const { return info_;}
     inline bool is_full() const { return info_.size_ >= common::SYSPARAM_NAMESERVER.max_block_size_; }
     static bool is_full(int64_t size) { return size >= common::SYSPARAM_NAMESERVER.max_block_size_;}
     inline uint32_t id() const { return info_.block_id_;}
@@ -64,6 +108,9 @@ namespace nameserver
     inline int8_t get_creating_flag() const { return create_flag_;}
     inline bool in_master_set() const { return BLOCK_IN_MASTER_SET_YES == in_master_set_;}
 
+    // read path with no lock, in an epoch (EpochManager::Guard)
+    int get_readable_servers(common::VUINT64& servers) const;
+
     int scan(common::SSMScanParameter& param) const;
     void dump() const;
 
@@ -76,6 +123,8 @@ namespace nameserver
     static const int8_t VERSION_AGREED_MASK;
   private:
     static uint32_t register_expire_block(EXPIRE_BLOCK_LIST& result, ServerCollect* server, BlockCollect* block);
+    // hold_ changed, publish a new ReadableServers if the ids differ
+    void publish_readable();
 
   private:
     BlockCollect();
@@ -86,7 +135,8 @@ namespace nameserver
 #else
   private:
 #endif
-    std::vector<ServerCollect*> hold_;
+    ServerSlots hold_;
+    ReadableServers* volatile readable_;
     common::BlockInfo info_;
     time_t last_update_time_;
     int8_t hold_master_;
@@ -0,0 +1,195 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <stdlib.h>
+#include <tbsys.h>
+#include "block_table.h"
+#include "common/atomic.h"
+
+using namespace tfs::common;
+namespace tfs
+{
+  namespace nameserver
+  {
+    BlockTable::const_iterator::const_iterator(const BlockTable* table, const uint64_t index):
+      table_(table),
+      index_(index)
+    {
+      seek();
+    }
+
+    BlockTable::const_iterator& BlockTable::const_iterator::operator++()
+    {
+      ++index_;
+      seek();
+      return *this;
+    }
+
+    void BlockTable::const_iterator::seek()
+    {
+      const uint64_t end = table_->end_index();
+      while (index_ < end)
+      {
+        Slot* segment = table_->get_segment(index_);
+        if (NULL == segment)
+        {
+          index_ = ((index_ >> SEGMENT_SHIFT) + 1) << SEGMENT_SHIFT;
+          continue;
+        }
+        const uint64_t segment_end = ((index_ >> SEGMENT_SHIFT) + 1) << SEGMENT_SHIFT;
+        for (; index_ < segment_end; ++index_)
+        {
+          BlockCollect* block = segment[index_ & SEGMENT_MASK];
+          if (NULL != block)
+          {
+            value_.first = table_->to_block_id(index_);
+            value_.second = block;
+            return;
+          }
+        }
+      }
+      index_ = end;
+      value_ = value_type();
+    }
+
+    BlockTable::BlockTable(const uint32_t stride):
+      directory_(NULL),
+      stride_(0 == stride ? 1 : stride),
+      remainder_(0),
+      directory_size_(0),
+      max_segment_(0),
+      size_(0),
+      segment_count_(0)
+    {
+      directory_size_ = ((0xFFFFFFFFULL / stride_) >> SEGMENT_SHIFT) + 1;
+      // pages of the directory never used are never touched
+      directory_ = static_cast<Slot**>(calloc(directory_size_, sizeof(Slot*)));
+      assert(NULL != directory_);
+    }
+
+    BlockTable::~BlockTable()
+    {
+      for (uint32_t i = 0; i < max_segment_; ++i)
+      {
+        free(const_cast<BlockCollect**>(directory_[i]));
+      }
+      free(directory_);
+    }
+
+    std::pair<BlockTable::iterator, bool> BlockTable::insert(const value_type& value)
+    {
+      const uint32_t block_id = value.first;
+      if (0 == size_ && 0 == segment_count_)
+      {
+        remainder_ = block_id % stride_;
+      }
+      if (block_id % stride_ != remainder_ || NULL == value.second)
+      {
+        TBSYS_LOG(ERROR, "block: %u not of this table, stride: %u, remainder: %u", block_id, stride_, remainder_);
+        return std::make_pair(end(), false);
+      }
+      const uint64_t index = to_index(block_id);
+      Slot* segment = get_segment(index);
+      if (NULL == segment)
+      {
+        BlockCollect** slots = static_cast<BlockCollect**>(calloc(SEGMENT_SIZE, sizeof(Slot)));
+        assert(NULL != slots);
+        atomic_exchange_pointer(static_cast<volatile pvoid*>(static_cast<void*>(&directory_[index >> SEGMENT_SHIFT])), slots);
+        segment = slots;
+        ++segment_count_;
+        if ((index >> SEGMENT_SHIFT) >= max_segment_)
+        {
+          max_segment_ = (index >> SEGMENT_SHIFT) + 1;
+        }
+      }
+      Slot& slot = segment[index & SEGMENT_MASK];
+      bool inserted = NULL == slot;
+      if (inserted)
+      {
+        // the block is made before readers see it
+        atomic_exchange_pointer(reinterpret_cast<volatile pvoid*>(&slot), value.second);
+        ++size_;
+      }
+      return std::make_pair(const_iterator(this, index), inserted);
+    }
+
+    void BlockTable::erase(const iterator& iter)
+    {
+      if (iter.table_ == this && iter.index_ < end_index())
+      {
+        Slot* segment = get_segment(iter.index_);
+        if (NULL != segment && NULL != segment[iter.index_ & SEGMENT_MASK])
+        {
+          atomic_exchange_pointer(reinterpret_cast<volatile pvoid*>(&segment[iter.index_ & SEGMENT_MASK]), NULL);
+          --size_;
+        }
+      }
+    }
+
+    BlockTable::iterator BlockTable::find(const uint32_t block_id) const
+    {
+      if (block_id % stride_ == remainder_)
+      {
+        const uint64_t index = to_index(block_id);
+        if (index < end_index())
+        {
+          Slot* segment = get_segment(index);
+          if (NULL != segment && NULL != segment[index & SEGMENT_MASK])
+          {
+            return const_iterator(this, index);
+          }
+        }
+      }
+      return end();
+    }
+
+    BlockCollect* BlockTable::get(const uint32_t block_id) const
+    {
+      BlockCollect* block = NULL;
+      const uint64_t index = to_index(block_id);
+      if (block_id % stride_ == remainder_ && (index >> SEGMENT_SHIFT) < directory_size_)
+      {
+        Slot* segment = get_segment(index);
+        if (NULL != segment)
+        {
+          block = segment[index & SEGMENT_MASK];
+        }
+      }
+      return block;
+    }
+
+    BlockTable::iterator BlockTable::begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    BlockTable::iterator BlockTable::end() const
+    {
+      return const_iterator(this, end_index());
+    }
+
+    void BlockTable::clear()
+    {
+      for (uint32_t i = 0; i < max_segment_; ++i)
+      {
+        Slot* segment = directory_[i];
+        if (NULL != segment)
+        {
+          for (int32_t j = 0; j < SEGMENT_SIZE; ++j)
+          {
+            segment[j] = NULL;
+          }
+        }
+      }
+      size_ = 0;
+    }
+  }//end namespace nameserver
+}//end namespace tfs
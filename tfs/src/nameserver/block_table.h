@@ -0,0 +1,106 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_NAMESERVER_BLOCK_TABLE_H_
+#define TFS_NAMESERVER_BLOCK_TABLE_H_
+
+#include <stdint.h>
+#include <utility>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace nameserver
+  {
+    class BlockCollect;
+
+    /**
+     * blocks of a chunk by id. block ids are given out in order, the ids of a chunk
+     * are those of one remainder of stride (the chunk number), so block_id / stride
+     * is a dense index: slots of one pointer in segments of SEGMENT_SIZE, allocated
+     * when first used. iterates in id order, a slot and its segment take the place
+     * of a hash node, and a full scan reads the slots in line.
+     * changed under the chunk write lock. get() takes no lock: a segment is never
+     * freed before the table, a slot is set after its block is made, and a block
+     * removed is freed by gc long after.
+     */
+    class BlockTable
+    {
+    public:
+      struct value_type
+      {
+        value_type(): first(0), second(NULL) {}
+        value_type(const uint32_t block_id, BlockCollect* block): first(block_id), second(block) {}
+        uint32_t first;
+        BlockCollect* second;
+      };
+
+      class const_iterator
+      {
+      public:
+        const_iterator(): table_(NULL), index_(0) {}
+        const_iterator(const BlockTable* table, const uint64_t index);
+        inline const value_type& operator*() const { return value_;}
+        inline const value_type* operator->() const { return &value_;}
+        const_iterator& operator++();
+        inline bool operator==(const const_iterator& rhs) const { return index_ == rhs.index_;}
+        inline bool operator!=(const const_iterator& rhs) const { return index_ != rhs.index_;}
+      private:
+        friend class BlockTable;
+        void seek();// to the first block at or after index_
+        const BlockTable* table_;
+        uint64_t index_;
+        value_type value_;
+      };
+      typedef const_iterator iterator;
+
+      explicit BlockTable(const uint32_t stride = 1);
+      virtual ~BlockTable();
+
+      std::pair<iterator, bool> insert(const value_type& value);
+      void erase(const iterator& iter);
+      iterator find(const uint32_t block_id) const;
+      iterator begin() const;
+      iterator end() const;
+      void clear();
+      inline uint32_t size() const { return size_;}
+      inline bool empty() const { return 0 == size_;}
+      inline int64_t get_segment_count() const { return segment_count_;}
+
+      // no lock
+      BlockCollect* get(const uint32_t block_id) const;
+
+      static const int32_t SEGMENT_SHIFT = 12;
+      static const int32_t SEGMENT_SIZE = 1 << SEGMENT_SHIFT;
+      static const int32_t SEGMENT_MASK = SEGMENT_SIZE - 1;
+
+    private:
+      DISALLOW_COPY_AND_ASSIGN(BlockTable);
+      typedef BlockCollect* volatile Slot;
+      inline uint64_t to_index(const uint32_t block_id) const { return block_id / stride_;}
+      inline uint32_t to_block_id(const uint64_t index) const { return index * stride_ + remainder_;}
+      Slot* get_segment(const uint64_t index) const { return directory_[index >> SEGMENT_SHIFT];}
+      uint64_t end_index() const { return static_cast<uint64_t>(max_segment_) << SEGMENT_SHIFT;}
+
+      Slot** directory_;
+      uint32_t stride_;
+      uint32_t remainder_;// ids of this table, set by the first block
+      uint32_t directory_size_;
+      uint32_t max_segment_;// segments in use are below
+      uint32_t size_;
+      int64_t segment_count_;
+    };
+
+    typedef BlockTable BLOCK_MAP;
+    typedef BLOCK_MAP::iterator BLOCK_MAP_ITER;
+  }//end namespace nameserver
+}//end namespace tfs
+#endif
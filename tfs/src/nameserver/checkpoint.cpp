@@ -0,0 +1,229 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <tbsys.h>
+#include "checkpoint.h"
+#include "layout_manager.h"
+#include "oplog_sync_manager.h"
+#include "global_factory.h"
+#include "common/func.h"
+#include "common/stream.h"
+#include "common/error_msg.h"
+
+using namespace tfs::common;
+namespace tfs
+{
+  namespace nameserver
+  {
+    CheckpointTimerTask::CheckpointTimerTask(OpLogSyncManager& manager) :
+      manager_(manager)
+    {
+
+    }
+
+    void CheckpointTimerTask::runTimerTask()
+    {
+      NsRuntimeGlobalInformation& ngi = GFactory::get_runtime_info();
+      if (ngi.owner_status_ == NS_STATUS_INITIALIZED
+          && ngi.destroy_flag_ != NS_DESTROY_FLAGS_YES)
+      {
+        int32_t iret = manager_.checkpoint();
+        if (TFS_SUCCESS != iret)
+        {
+          TBSYS_LOG(ERROR, "write checkpoint failed, iret: %d", iret);
+        }
+      }
+    }
+
+    Checkpoint::Checkpoint(LayoutManager& manager) :
+      manager_(manager), interval_(0)
+    {
+
+    }
+
+    Checkpoint::~Checkpoint()
+    {
+
+    }
+
+    void Checkpoint::initialize(const std::string& path, const int32_t interval)
+    {
+      path_ = path;
+      interval_ = interval;
+      TBSYS_LOG(INFO, "checkpoint: %s, interval: %d", path_.c_str(), interval_);
+    }
+
+    int Checkpoint::save(const OpLogRotateHeader& pos)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      int64_t start = tbsys::CTimeUtil::getTime();
+      Stream body(1024 * 1024);
+      int32_t server_count = 0;
+      int32_t block_count = 0;
+      int32_t iret = manager_.snapshot(body, server_count, block_count);
+      if (TFS_SUCCESS == iret)
+      {
+        iret = write_file(path_, pos, server_count, block_count, body);
+      }
+      TBSYS_LOG(INFO, "write checkpoint: %s, servers: %d, blocks: %d, oplog seqno: %d, offset: %d, cost: %"
+          PRI64_PREFIX "d(us), iret: %d", path_.c_str(), server_count, block_count, pos.rotate_seqno_,
+          pos.rotate_offset_, tbsys::CTimeUtil::getTime() - start, iret);
+      return iret;
+    }
+
+    int Checkpoint::load(OpLogRotateHeader& pos, uint32_t& max_block_id)
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      int64_t start = tbsys::CTimeUtil::getTime();
+      max_block_id = 0;
+      int32_t server_count = 0;
+      int32_t block_count = 0;
+      Stream input;
+      int32_t iret = read_file(path_, pos, server_count, block_count, input);
+      if (TFS_SUCCESS == iret)
+      {
+        iret = manager_.restore(input, server_count, block_count, max_block_id, time(NULL));
+      }
+      TBSYS_LOG(INFO, "load checkpoint: %s, servers: %d, blocks: %d, oplog seqno: %d, offset: %d, cost: %"
+          PRI64_PREFIX "d(us), iret: %d", path_.c_str(), server_count, block_count, pos.rotate_seqno_,
+          pos.rotate_offset_, tbsys::CTimeUtil::getTime() - start, iret);
+      return iret;
+    }
+
+    int Checkpoint::write_file(const std::string& path, const OpLogRotateHeader& pos,
+        const int32_t server_count, const int32_t block_count, const Stream& body)
+    {
+      int64_t length = body.get_data_length();
+      uint32_t crc = Func::crc(0, body.get_data(), length);
+      Stream output(length + 64);
+      int32_t iret = output.set_int32(CHECKPOINT_MAGIC);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(CHECKPOINT_VERSION);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(pos.rotate_seqno_);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(pos.rotate_offset_);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int64(time(NULL));
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(server_count);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(block_count);
+      if (TFS_SUCCESS == iret)
+        iret = output.set_int32(crc);
+      if (TFS_SUCCESS == iret && length > 0)
+        iret = output.set_bytes(body.get_data(), length);
+      if (TFS_SUCCESS != iret)
+        return iret;
+
+      // write a new one then rename, never a half written checkpoint
+      const char* data = output.get_data();
+      length = output.get_data_length();
+      std::string tmp_path = path + ".tmp";
+      int32_t fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+      iret = fd < 0 ? EXIT_GENERAL_ERROR : TFS_SUCCESS;
+      if (TFS_SUCCESS == iret)
+      {
+        int64_t offset = 0;
+        while (TFS_SUCCESS == iret && offset < length)
+        {
+          int64_t ret = ::write(fd, data + offset, length - offset);
+          if (ret < 0 && EINTR == errno)
+            continue;
+          iret = ret <= 0 ? EXIT_GENERAL_ERROR : TFS_SUCCESS;
+          offset += ret;
+        }
+        if (TFS_SUCCESS == iret && 0 != fsync(fd))
+        {
+          iret = EXIT_GENERAL_ERROR;
+        }
+        ::close(fd);
+      }
+      if (TFS_SUCCESS == iret && 0 != ::rename(tmp_path.c_str(), path.c_str()))
+      {
+        iret = EXIT_GENERAL_ERROR;
+      }
+      if (TFS_SUCCESS != iret)
+      {
+        TBSYS_LOG(ERROR, "write checkpoint file: %s failed, errors: %s", tmp_path.c_str(), strerror(errno));
+      }
+      return iret;
+    }
+
+    int Checkpoint::read_file(const std::string& path, OpLogRotateHeader& pos,
+        int32_t& server_count, int32_t& block_count, Stream& input)
+    {
+      server_count = 0;
+      block_count = 0;
+      int32_t fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0)
+      {
+        TBSYS_LOG(INFO, "open checkpoint file: %s failed, errors: %s", path.c_str(), strerror(errno));
+        return EXIT_GENERAL_ERROR;
+      }
+      struct stat st;
+      int32_t iret = 0 == fstat(fd, &st) ? TFS_SUCCESS : EXIT_GENERAL_ERROR;
+      if (TFS_SUCCESS == iret)
+      {
+        input.get_buffer().clear();
+        input.get_buffer().expand(st.st_size + 1);
+        int64_t offset = 0;
+        while (TFS_SUCCESS == iret && offset < st.st_size)
+        {
+          int64_t ret = ::read(fd, input.get_free() + offset, st.st_size - offset);
+          if (ret < 0 && EINTR == errno)
+            continue;
+          iret = ret <= 0 ? EXIT_GENERAL_ERROR : TFS_SUCCESS;
+          offset += ret;
+        }
+        if (TFS_SUCCESS == iret)
+        {
+          input.pour(st.st_size);
+        }
+      }
+      ::close(fd);
+
+      int32_t magic = 0;
+      int32_t version = 0;
+      int64_t checkpoint_time = 0;
+      uint32_t crc = 0;
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&magic);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&version);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&pos.rotate_seqno_);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&pos.rotate_offset_);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int64(&checkpoint_time);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&server_count);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(&block_count);
+      if (TFS_SUCCESS == iret)
+        iret = input.get_int32(reinterpret_cast<int32_t*>(&crc));
+      if (TFS_SUCCESS == iret)
+      {
+        iret = CHECKPOINT_MAGIC == magic && CHECKPOINT_VERSION == version
+          && crc == Func::crc(0, input.get_data(), input.get_data_length()) ? TFS_SUCCESS : EXIT_CHECK_CRC_ERROR;
+      }
+      TBSYS_LOG(INFO, "read checkpoint file: %s, written at: %s, iret: %d", path.c_str(),
+          Func::time_to_str(checkpoint_time).c_str(), iret);
+      return iret;
+    }
+  }//end namespace nameserver
+}//end namespace tfs
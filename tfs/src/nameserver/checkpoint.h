@@ -0,0 +1,80 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_NAMESERVER_CHECKPOINT_H_
+#define TFS_NAMESERVER_CHECKPOINT_H_
+
+#include <string>
+#include <Mutex.h>
+#include <Timer.h>
+#include "ns_define.h"
+#include "oplog.h"
+#include "common/stream.h"
+
+namespace tfs
+{
+  namespace nameserver
+  {
+    class LayoutManager;
+    class OpLogSyncManager;
+
+    class CheckpointTimerTask: public tbutil::TimerTask
+    {
+    public:
+      CheckpointTimerTask(OpLogSyncManager& manager);
+      virtual void runTimerTask();
+    private:
+      DISALLOW_COPY_AND_ASSIGN(CheckpointTimerTask);
+      OpLogSyncManager& manager_;
+    };
+    typedef tbutil::Handle<CheckpointTimerTask> CheckpointTimerTaskPtr;
+
+    /**
+     * checkpoint of the block table: the alive dataservers, every block's info and
+     * the servers hold it. written every checkpoint_interval seconds with the oplog
+     * position it is taken at, loaded at startup before the oplog after that position
+     * is replayed, so blocks can be read before the dataservers report them.
+     * the table is copied one block chunk at a time under its read lock and
+     * written to a new file out of any lock, then renamed over the last one.
+     */
+    class Checkpoint
+    {
+    public:
+      explicit Checkpoint(LayoutManager& manager);
+      virtual ~Checkpoint();
+      void initialize(const std::string& path, const int32_t interval);
+      inline bool enabled() const { return interval_ > 0;}
+      inline int32_t get_interval() const { return interval_;}
+      // pos: where the replay of oplog starts, when this checkpoint is loaded
+      int save(const OpLogRotateHeader& pos);
+      // pos: where this checkpoint is taken at
+      int load(OpLogRotateHeader& pos, uint32_t& max_block_id);
+
+      // the file: magic, version, pos, time, server and block count, crc of the body, body.
+      // written to path.tmp then renamed over path
+      static int write_file(const std::string& path, const OpLogRotateHeader& pos,
+          const int32_t server_count, const int32_t block_count, const common::Stream& body);
+      // input holds the body once the header and crc are checked
+      static int read_file(const std::string& path, OpLogRotateHeader& pos,
+          int32_t& server_count, int32_t& block_count, common::Stream& input);
+
+      static const int32_t CHECKPOINT_MAGIC = 0x4e534350;//NSCP
+      static const int32_t CHECKPOINT_VERSION = 1;
+    private:
+      DISALLOW_COPY_AND_ASSIGN(Checkpoint);
+      LayoutManager& manager_;
+      tbutil::Mutex mutex_;
+      std::string path_;
+      int32_t interval_;
+    };
+  }//end namespace nameserver
+}//end namespace tfs
+#endif
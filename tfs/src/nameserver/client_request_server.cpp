@@ -37,8 +37,9 @@ namespace tfs
 
     int ClientRequestServer::keepalive(const common::DataServerStatInfo& ds_info,
         const common::HasBlockFlag flag,
-        common::BLOCK_INFO_LIST& blocks, common::VUINT32& expires,
-        bool& need_sent_block)
+        common::BLOCK_INFO_LIST& blocks, const common::VUINT32& removed_blocks,
+        const int64_t report_seq, const int64_t base_seq,
+        common::VUINT32& expires, bool& need_sent_block, int64_t& applied_seq)
     {
       int32_t iret = TFS_ERROR;
       time_t now = time(NULL);
@@ -58,7 +59,7 @@ namespace tfs
           {
             TBSYS_LOG(INFO, "dataserver: %s join: use capacity: %" PRI64_PREFIX "u, total capacity: %" PRI64_PREFIX "u, has_block: %s",
                 tbsys::CNetUtil::addrToString(ds_info.id_).c_str(), ds_info.use_capacity_,
-                ds_info.total_capacity_,flag == HAS_BLOCK_FLAG_YES ? "Yes" : "No");
+                ds_info.total_capacity_,flag != HAS_BLOCK_FLAG_NO ? "Yes" : "No");
             lay_out_manager_.interrupt(INTERRUPT_ALL, now);//interrupt
           }
           ServerCollect* server = lay_out_manager_.get_server(ds_info.id_);
@@ -72,7 +73,7 @@ namespace tfs
             if (flag == HAS_BLOCK_FLAG_NO)
             {
               int32_t block_count = server->block_count();
-              need_sent_block = (isnew || block_count <= 0);
+              need_sent_block = (isnew || block_count <= 0 || server->need_report());
 
               //switching occurred between master and slave
               if ((!need_sent_block)
@@ -90,11 +91,41 @@ namespace tfs
               //update all relations of blocks belongs to it
               EXPIRE_BLOCK_LIST current_expires;
               #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
-              TBSYS_LOG(DEBUG, "server: %s update_relation, flag: %s", tbsys::CNetUtil::addrToString(ds_info.id_).c_str(), flag == HAS_BLOCK_FLAG_YES ? "Yes" : "No");
+              TBSYS_LOG(DEBUG, "server: %s update_relation, flag: %d", tbsys::CNetUtil::addrToString(ds_info.id_).c_str(), flag);
               #endif
-              iret = lay_out_manager_.update_relation(server, blocks, current_expires, now);
-              if (TFS_SUCCESS == iret)
+              bool apply = true;
+              if (flag == HAS_BLOCK_FLAG_DELTA)
+              {
+                //a delta applies only on the report it is against, else ask for all blocks
+                apply = base_seq > 0 && base_seq == server->get_report_seq();
+                if (apply)
+                {
+                  iret = lay_out_manager_.update_relation(server, blocks, removed_blocks, current_expires, now);
+                }
+                else
+                {
+                  TBSYS_LOG(INFO, "dataserver: %s delta report base seq: %" PRI64_PREFIX "d not match: %" PRI64_PREFIX "d, need all blocks",
+                      tbsys::CNetUtil::addrToString(ds_info.id_).c_str(), base_seq, server->get_report_seq());
+                  server->set_report_seq(0);
+                  need_sent_block = true;
+                }
+              }
+              else
+              {
+                iret = lay_out_manager_.update_relation(server, blocks, current_expires, now);
+              }
+              if (TFS_SUCCESS == iret && apply)
               {
+                server->set_report_seq(report_seq);
+                server->set_need_report(false);
+                //blocks still not match after a delta, the next report will be all of them
+                if (flag == HAS_BLOCK_FLAG_DELTA
+                    && server->block_count() != ds_info.block_count_)
+                {
+                  TBSYS_LOG(INFO, "dataserver: %s block count: %d not match: %d after delta report",
+                      tbsys::CNetUtil::addrToString(ds_info.id_).c_str(), server->block_count(), ds_info.block_count_);
+                  server->set_report_seq(0);
+                }
                 if (ngi.owner_role_ == NS_ROLE_MASTER)//i'm master, we're going to expire blocks
                 {
                   std::vector<uint32_t> rm_list;
@@ -134,11 +165,13 @@ namespace tfs
                   #endif
                 }
               }
-              else
+              else if (TFS_SUCCESS != iret)
               {
+                server->set_report_seq(0);
                 TBSYS_LOG(ERROR, "%s", "update relationship failed between block and dataserver");
               }
             }
+            applied_seq = server->get_report_seq();
           }
           else
           {
@@ -201,32 +234,15 @@ namespace tfs
       int32_t iret = 0 == block_id  ? EXIT_BLOCK_NOT_FOUND : TFS_SUCCESS;
       if (TFS_SUCCESS == iret)
       {
-        BlockChunkPtr ptr = lay_out_manager_.get_chunk(block_id);
-        RWLock::Lock lock(*ptr, READ_LOCKER);
-        BlockCollect* block = ptr->find(block_id);
-        iret = NULL == block ? EXIT_BLOCK_NOT_FOUND : TFS_SUCCESS;
-        if (TFS_SUCCESS == iret)
+        // no chunk lock, the servers are those last published of this block
+        iret = lay_out_manager_.get_readable_servers(block_id, readable_list);
+        if (EXIT_BLOCK_NOT_FOUND == iret)
         {
-          std::vector<ServerCollect*>& readable = block->get_hold();
-          iret = readable.empty() ? EXIT_NO_DATASERVER : TFS_SUCCESS;
-          if (TFS_SUCCESS == iret)
-          {
-            std::vector<ServerCollect*>::iterator iter = readable.begin();
-            for (; iter != readable.end(); ++iter)
-            {
-              readable_list.push_back((*iter)->id());
-            }
-            if (readable_list.empty())
-              iret = EXIT_NO_DATASERVER;
-          }
-          if (TFS_SUCCESS != iret)
-          {
-            TBSYS_LOG(ERROR, "block: %u hold not any dataserver when open this block with read mode", block_id);
-          }
+          TBSYS_LOG(ERROR, "block: %u not exist when open this block with read mode", block_id);
         }
-        else
+        else if (TFS_SUCCESS != iret)
         {
-          TBSYS_LOG(ERROR, "block: %u not exist when open this block with read mode", block_id);
+          TBSYS_LOG(ERROR, "block: %u hold not any dataserver when open this block with read mode", block_id);
         }
       }
       return iret;
@@ -449,8 +465,8 @@ namespace tfs
               if (TFS_SUCCESS == iret)
               {
                 version = block->version();
-                std::vector<ServerCollect*>& hold = block->get_hold();
-                std::vector<ServerCollect*>::iterator iter = hold.begin();
+                ServerSlots& hold = block->get_hold();
+                ServerSlots::iterator iter = hold.begin();
                 for (; iter != hold.end(); ++iter)
                 {
                   servers.push_back((*iter)->id());
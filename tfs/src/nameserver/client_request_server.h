@@ -44,7 +44,9 @@ namespace nameserver
       explicit ClientRequestServer(LayoutManager& lay_out_manager);
 
       int keepalive(const common::DataServerStatInfo&, const common::HasBlockFlag flag,
-          common::BLOCK_INFO_LIST& blocks, common::VUINT32& expires, bool& need_sent_block);
+          common::BLOCK_INFO_LIST& blocks, const common::VUINT32& removed_blocks,
+          const int64_t report_seq, const int64_t base_seq,
+          common::VUINT32& expires, bool& need_sent_block, int64_t& applied_seq);
       int open(uint32_t& block_id, const int32_t mode, uint32_t& lease_id, int32_t& version, common::VUINT64& ds_list);
       int batch_open(const common::VUINT32& blocks, const int32_t mode, const int32_t block_count, std::map<uint32_t, common::BlockInfoSeg>& out);
 
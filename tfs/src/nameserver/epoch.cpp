@@ -0,0 +1,176 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <pthread.h>
+#include <vector>
+#include <tbsys.h>
+#include <Memory.hpp>
+#include "epoch.h"
+#include "common/atomic.h"
+
+using namespace tfs::common;
+namespace tfs
+{
+  namespace nameserver
+  {
+    EpochManager EpochManager::instance_;
+
+    namespace
+    {
+      __thread int32_t tls_slot = -1;
+      __thread int32_t tls_depth = 0;
+      pthread_key_t slot_key;
+      pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+    }
+
+    EpochManager::EpochManager():
+      epoch_(1),
+      overflow_(0)
+    {
+      memset(slots_, 0, sizeof(slots_));
+    }
+
+    EpochManager::~EpochManager()
+    {
+      std::deque<std::pair<uint64_t, EpochObject*> >::iterator iter = retired_.begin();
+      for (; iter != retired_.end(); ++iter)
+      {
+        tbsys::gDelete(iter->second);
+      }
+      retired_.clear();
+    }
+
+    void EpochManager::enter()
+    {
+      if (0 == tls_depth++)
+      {
+        int32_t slot = tls_slot < 0 ? acquire_slot() : tls_slot;
+        if (slot >= 0)
+        {
+          // xchg is a full barrier, the announce is seen before any pointer is loaded
+          atomic_exchange(&slots_[slot].epoch_, epoch_);
+        }
+        else
+        {
+          atomic_inc(&overflow_);
+        }
+      }
+    }
+
+    void EpochManager::leave()
+    {
+      if (0 == --tls_depth)
+      {
+        if (tls_slot >= 0)
+        {
+          // loads are not passed by a later store on x86, only keep the compiler from moving them
+          __asm__ __volatile__("" ::: "memory");
+          slots_[tls_slot].epoch_ = 0;
+        }
+        else
+        {
+          atomic_dec(&overflow_);
+        }
+      }
+    }
+
+    void EpochManager::retire(EpochObject* object)
+    {
+      if (NULL != object)
+      {
+        bool need_reclaim = false;
+        {
+          tbutil::Mutex::Lock lock(mutex_);
+          // the epoch is read after the object is unpublished, readers may see it entered no later
+          uint64_t epoch = atomic_inc(&epoch_) - 1;
+          retired_.push_back(std::make_pair(epoch, object));
+          need_reclaim = 0 == (retired_.size() % RECLAIM_BATCH);
+        }
+        if (need_reclaim)
+        {
+          reclaim();
+        }
+      }
+    }
+
+    void EpochManager::reclaim()
+    {
+      std::vector<EpochObject*> objects;
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        uint64_t min_epoch = calc_min_epoch();
+        while (!retired_.empty() && retired_.front().first < min_epoch)
+        {
+          objects.push_back(retired_.front().second);
+          retired_.pop_front();
+        }
+      }
+      std::vector<EpochObject*>::iterator iter = objects.begin();
+      for (; iter != objects.end(); ++iter)
+      {
+        tbsys::gDelete((*iter));
+      }
+    }
+
+    int64_t EpochManager::get_retired_size()
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      return retired_.size();
+    }
+
+    uint64_t EpochManager::calc_min_epoch() const
+    {
+      uint64_t min_epoch = overflow_ > 0 ? 0 : ~0ULL;
+      for (int32_t i = 0; i < MAX_READER_SLOT && min_epoch > 0; ++i)
+      {
+        uint64_t epoch = slots_[i].epoch_;
+        if (epoch > 0 && epoch < min_epoch)
+        {
+          min_epoch = epoch;
+        }
+      }
+      return min_epoch;
+    }
+
+    void EpochManager::create_slot_key()
+    {
+      pthread_key_create(&slot_key, EpochManager::release_slot);
+    }
+
+    int32_t EpochManager::acquire_slot()
+    {
+      pthread_once(&slot_key_once, create_slot_key);
+      for (int32_t i = 0; i < MAX_READER_SLOT; ++i)
+      {
+        if (0 == slots_[i].used_
+            && 0 == atomic_compare_exchange(&slots_[i].used_, 1, 0))
+        {
+          tls_slot = i;
+          pthread_setspecific(slot_key, reinterpret_cast<void*>(i + 1));
+          return i;
+        }
+      }
+      TBSYS_LOG(WARN, "all %d epoch reader slots used, read with no slot", MAX_READER_SLOT);
+      return -1;
+    }
+
+    // thread exit
+    void EpochManager::release_slot(void* value)
+    {
+      int32_t slot = static_cast<int32_t>(reinterpret_cast<intptr_t>(value)) - 1;
+      if (slot >= 0 && slot < MAX_READER_SLOT)
+      {
+        instance_.slots_[slot].epoch_ = 0;
+        atomic_exchange(&instance_.slots_[slot].used_, 0);
+      }
+    }
+  }//end namespace nameserver
+}//end namespace tfs
@@ -0,0 +1,96 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_NAMESERVER_EPOCH_H_
+#define TFS_NAMESERVER_EPOCH_H_
+
+#include <stdint.h>
+#include <deque>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace nameserver
+  {
+    // what is published to readers out of any lock
+    class EpochObject
+    {
+    public:
+      EpochObject() {}
+      virtual ~EpochObject() {}
+    };
+
+    /**
+     * epoch based reclamation of the objects the read path walks with no lock.
+     * a reader announces the epoch it enters in its own slot (one cache line each,
+     * no line written by all the readers), a writer unpublishes an object then
+     * retires it with the epoch of that time, and the object is freed once every
+     * reader in the slots has entered a later epoch.
+     * one per process: the slot of a thread is kept in thread local storage.
+     */
+    class EpochManager
+    {
+    public:
+      EpochManager();
+      virtual ~EpochManager();
+
+      // reader side, may nest
+      void enter();
+      void leave();
+
+      // writer side, object must not be reachable by any new reader
+      void retire(EpochObject* object);
+      // free what no reader can see any more
+      void reclaim();
+      int64_t get_retired_size();
+
+      static EpochManager& instance()
+      {
+        return instance_;
+      }
+
+      class Guard
+      {
+      public:
+        explicit Guard(EpochManager& manager) : manager_(manager) { manager_.enter();}
+        ~Guard() { manager_.leave();}
+      private:
+        DISALLOW_COPY_AND_ASSIGN(Guard);
+        EpochManager& manager_;
+      };
+
+      static const int32_t MAX_READER_SLOT = 256;
+      static const int32_t RECLAIM_BATCH = 64;
+
+    private:
+      DISALLOW_COPY_AND_ASSIGN(EpochManager);
+      int32_t acquire_slot();
+      uint64_t calc_min_epoch() const;
+      static void create_slot_key();
+      static void release_slot(void* value);
+
+      struct ReaderSlot
+      {
+        volatile uint64_t epoch_;// 0: not in a read
+        volatile uint32_t used_;
+        char reserve_[64 - sizeof(uint64_t) - sizeof(uint32_t)];
+      };
+      ReaderSlot slots_[MAX_READER_SLOT];
+      volatile uint64_t epoch_;
+      volatile uint32_t overflow_;// readers got no slot, nothing is freed while any
+      tbutil::Mutex mutex_;
+      std::deque<std::pair<uint64_t, EpochObject*> > retired_;
+      static EpochManager instance_;
+    };
+  }//end namespace nameserver
+}//end namespace tfs
+#endif
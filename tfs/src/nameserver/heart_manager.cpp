@@ -128,9 +128,13 @@ namespace tfs
         const DataServerStatInfo& ds_info = message->get_ds();
 			  VUINT32 expires;
 			  bool need_sent_block = false;
+			  int64_t applied_seq = 0;
 			  const HasBlockFlag flag = message->get_has_block();
 
-			  int32_t iret = meta_mgr_.get_client_request_server().keepalive(ds_info, flag, message->get_blocks(), expires, need_sent_block); 
+			  int32_t iret = meta_mgr_.get_client_request_server().keepalive(ds_info, flag, message->get_blocks(),
+            message->get_removed_blocks(), message->get_report_seq(), message->get_base_seq(),
+            expires, need_sent_block, applied_seq);
+        result_msg->set_report_seq(applied_seq);
         if (TFS_SUCCESS == iret)
         {
 			    //dataserver dead
@@ -143,7 +147,11 @@ namespace tfs
 
           if (TFS_SUCCESS == iret)
           {
-			      if (flag == HAS_BLOCK_FLAG_YES)
+			      if (flag != HAS_BLOCK_FLAG_NO && need_sent_block)
+			      {
+            	result_msg->set_status(HEART_NEED_SEND_BLOCK_INFO);
+			      }
+			      else if (flag != HAS_BLOCK_FLAG_NO)
 			      {
 			      	if (!expires.empty())
 			      	{
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <functional>
 #include <numeric>
+#include <algorithm>
 #include <tbsys.h>
 #include <Memory.hpp>
 #include "strategy.h"
@@ -177,7 +178,7 @@ namespace tfs
       block_chunk_ = new BlockChunkPtr[block_chunk_num_];
       for (int32_t i = 0; i < block_chunk_num_; i++)
       {
-        block_chunk_[i] = new BlockChunk();
+        block_chunk_[i] = new BlockChunk(block_chunk_num_);
       }
       int32_t iret = TFS_ERROR;
 
@@ -208,6 +209,13 @@ namespace tfs
       return block_chunk_[block_id % block_chunk_num_];
     }
 
+    int LayoutManager::get_readable_servers(const uint32_t block_id, VUINT64& servers) const
+    {
+      assert(block_chunk_num_ > 0);
+      assert(block_chunk_ != NULL);
+      return block_chunk_[block_id % block_chunk_num_].get()->get_readable_servers(block_id, servers);
+    }
+
     ServerCollect* LayoutManager::get_server(const uint64_t server)
     {
       RWLock::Lock lock(server_mutex_, READ_LOCKER);
@@ -368,6 +376,7 @@ namespace tfs
           {
             block->relieve_relation();
           }
+          plan_queue_.push(block, now);
         }
       }
       if (TFS_SUCCESS == iret)
@@ -1309,7 +1318,8 @@ namespace tfs
     }
     /**
      * dsataserver start, send heartbeat message to nameserver.
-     * update all relations of blocks belongs to it
+     * update all relations of blocks belongs to it. the relations of blocks
+     * still in the report are kept, only those not reported any more are relieved
      * @param [in] dsInfo: dataserver system info , like capacity, load, etc..
      * @param [in] blocks: data blocks' info which belongs to dataserver.
      * @param [out] expires: need expire blocks
@@ -1320,52 +1330,116 @@ namespace tfs
       int32_t iret = ((server != NULL && server->is_alive())) ? TFS_SUCCESS : TFS_ERROR;
       if (TFS_SUCCESS == iret)
       {
-        //release relation
-        iret = relieve_relation(server, now) ? TFS_SUCCESS : TFS_ERROR;
-        if (TFS_SUCCESS != iret)
+        std::set<uint32_t> reported;
+        for (uint32_t i = 0; i < blocks.size(); ++i)
         {
-          TBSYS_LOG(WARN, "relieve relation failed in dataserver: %s", CNetUtil::addrToString(server->id()).c_str());
+          reported.insert(blocks[i].block_id_);
         }
-        else
+        std::vector<uint32_t> gone;
         {
-          uint32_t blocks_size = blocks.size();
-          NsRuntimeGlobalInformation& ngi = GFactory::get_runtime_info();
-          for (uint32_t i = 0; i < blocks_size; ++i)
+          RWLock::Lock lock(*server, READ_LOCKER);
+          std::vector<BlockCollect*>::const_iterator iter = server->hold_.begin();
+          for (; iter != server->hold_.end(); ++iter)
           {
-            if (blocks[i].block_id_ == 0)
+            if (reported.find((*iter)->id()) == reported.end())
             {
-              TBSYS_LOG(WARN, "dataserver: %s report, block == 0", tbsys::CNetUtil::addrToString(server->id()).c_str());
-              continue;
+              gone.push_back((*iter)->id());
             }
+          }
+        }
+        relieve_relation(server, gone, now);
+        iret = report_blocks(server, blocks, expires, now);
+      }
+      return iret;
+    }
 
-            bool first = false;
-            bool force_be_master = false;
+    /**
+     * dataserver reports the blocks added, changed or removed since a report
+     * we applied. relations of the other blocks are kept as they are
+     * @param [in] blocks: data blocks' info added or changed
+     * @param [in] removed: data blocks not on dataserver any more
+     * @param [out] expires: need expire blocks
+     * @return success or failure
+     */
+    int LayoutManager::update_relation(ServerCollect* server, const std::vector<BlockInfo>& blocks,
+        const VUINT32& removed, EXPIRE_BLOCK_LIST& expires, const time_t now)
+    {
+      int32_t iret = ((server != NULL && server->is_alive())) ? TFS_SUCCESS : TFS_ERROR;
+      if (TFS_SUCCESS == iret)
+      {
+        relieve_relation(server, removed, now);
+        iret = report_blocks(server, blocks, expires, now);
+      }
+      return iret;
+    }
 
-            // check block version, rebuilding relation.
-            BlockChunkPtr ptr = get_chunk(blocks[i].block_id_);
-            RWLock::Lock lock(*ptr, WRITE_LOCKER);
-            BlockCollect* block = ptr->find(blocks[i].block_id_);
-            if (block == NULL)
-            {
-              TBSYS_LOG(INFO, "block: %u not found in dataserver: %s, must be create",
-                  blocks[i].block_id_, tbsys::CNetUtil::addrToString(server->id()).c_str());
-              block = ptr->add(blocks[i].block_id_, now);
-              first = true;
-            }
-            if (!block->check_version(server, ngi.owner_role_, first,
-                  blocks[i], expires, force_be_master, now))
-            {
-              continue;//version error, not argeed
-            }
+    void LayoutManager::relieve_relation(ServerCollect* server, const std::vector<uint32_t>& blocks, const time_t now)
+    {
+      std::vector<uint32_t>::const_iterator iter = blocks.begin();
+      for (; iter != blocks.end(); ++iter)
+      {
+        BlockChunkPtr ptr = get_chunk((*iter));
+        RWLock::Lock lock(*ptr, WRITE_LOCKER);
+        BlockCollect* block = ptr->find((*iter));
+        if (NULL != block
+            && block->exist(server))
+        {
+          relieve_relation(block, server, now);
+        }
+      }
+    }
 
-            //build relation
-            iret = build_relation(block, server, force_be_master);
-            if (iret != TFS_SUCCESS)
-            {
-              TBSYS_LOG(WARN, "build relation fail between dataserver: %s and block: %u", CNetUtil::addrToString(server->id()).c_str(), block->id());
-              break;
-            }
+    int LayoutManager::report_blocks(ServerCollect* server, const std::vector<BlockInfo>& blocks, EXPIRE_BLOCK_LIST& expires, const time_t now)
+    {
+      int32_t iret = TFS_SUCCESS;
+      uint32_t blocks_size = blocks.size();
+      NsRuntimeGlobalInformation& ngi = GFactory::get_runtime_info();
+      for (uint32_t i = 0; i < blocks_size; ++i)
+      {
+        if (blocks[i].block_id_ == 0)
+        {
+          TBSYS_LOG(WARN, "dataserver: %s report, block == 0", tbsys::CNetUtil::addrToString(server->id()).c_str());
+          continue;
+        }
+
+        bool first = false;
+        bool force_be_master = false;
+
+        // check block version, rebuilding relation.
+        BlockChunkPtr ptr = get_chunk(blocks[i].block_id_);
+        RWLock::Lock lock(*ptr, WRITE_LOCKER);
+        BlockCollect* block = ptr->find(blocks[i].block_id_);
+        if (block == NULL)
+        {
+          TBSYS_LOG(INFO, "block: %u not found in dataserver: %s, must be create",
+              blocks[i].block_id_, tbsys::CNetUtil::addrToString(server->id()).c_str());
+          block = ptr->add(blocks[i].block_id_, now);
+          first = true;
+        }
+        bool exist = block->exist(server);
+        if (!block->check_version(server, ngi.owner_role_, first,
+              blocks[i], expires, force_be_master, now))
+        {
+          if (exist)
+          {
+            relieve_relation(block, server, now);
           }
+          plan_queue_.push(block, now);
+          continue;//version error, not argeed
+        }
+
+        //build relation, kept if it is there
+        if (exist
+            && !force_be_master
+            && block->exist(server))
+        {
+          continue;
+        }
+        iret = build_relation(block, server, now, force_be_master);
+        if (iret != TFS_SUCCESS)
+        {
+          TBSYS_LOG(WARN, "build relation fail between dataserver: %s and block: %u", CNetUtil::addrToString(server->id()).c_str(), block->id());
+          break;
         }
       }
       return iret;
@@ -1389,6 +1463,7 @@ namespace tfs
           //build relation between dataserver and block
           //add to dataserver's all kind of list
           iret = server->add(block, writable) ? TFS_SUCCESS : TFS_ERROR;
+          plan_queue_.push(block, now);
         }
       }
       return iret;
@@ -1413,6 +1488,7 @@ namespace tfs
               block->id(), CNetUtil::addrToString(server->id()).c_str());
         }
         bret = bremove && sremove;
+        plan_queue_.push(block, now);
       }
       return bret;
     }
@@ -1423,6 +1499,123 @@ namespace tfs
       return bret ? server->clear(*this, now) : bret;
     }
 
+    int LayoutManager::snapshot(Stream& output, int32_t& server_count, int32_t& block_count)
+    {
+      int32_t iret = TFS_SUCCESS;
+      server_count = 0;
+      block_count = 0;
+      {
+        RWLock::Lock lock(server_mutex_, READ_LOCKER);
+        SERVER_MAP::const_iterator iter = servers_.begin();
+        for (; iter != servers_.end() && TFS_SUCCESS == iret; ++iter)
+        {
+          const ServerCollect* server = iter->second;
+          if (NULL == server || !server->is_alive())
+            continue;
+          iret = output.set_int64(server->id());
+          if (TFS_SUCCESS == iret)
+            iret = output.set_int64(server->use_capacity());
+          if (TFS_SUCCESS == iret)
+            iret = output.set_int64(server->total_capacity());
+          if (TFS_SUCCESS == iret)
+            iret = output.set_int32(server->load());
+          if (TFS_SUCCESS == iret)
+            iret = output.set_int32(server->block_count());
+          ++server_count;
+        }
+      }
+
+      for (int32_t i = 0; i < block_chunk_num_ && TFS_SUCCESS == iret; ++i)
+      {
+        RWLock::Lock lock(*block_chunk_[i], READ_LOCKER);
+        BLOCK_MAP::const_iterator iter = block_chunk_[i]->block_map_.begin();
+        for (; iter != block_chunk_[i]->block_map_.end() && TFS_SUCCESS == iret; ++iter)
+        {
+          BlockCollect* block = iter->second;
+          iret = output.set_bytes(&block->get_block_info(), sizeof(BlockInfo));
+          if (TFS_SUCCESS == iret)
+          {
+            ServerSlots& hold = block->get_hold();
+            iret = output.set_int32(hold.size());
+            ServerSlots::const_iterator s_iter = hold.begin();
+            for (; s_iter != hold.end() && TFS_SUCCESS == iret; ++s_iter)
+            {
+              iret = output.set_int64((*s_iter)->id());
+            }
+          }
+          ++block_count;
+        }
+      }
+      return iret;
+    }
+
+    int LayoutManager::restore(Stream& input, const int32_t server_count, const int32_t block_count,
+        uint32_t& max_block_id, const time_t now)
+    {
+      int32_t iret = TFS_SUCCESS;
+      max_block_id = 0;
+      for (int32_t i = 0; i < server_count && TFS_SUCCESS == iret; ++i)
+      {
+        DataServerStatInfo info;
+        memset(&info, 0, sizeof(info));
+        iret = input.get_int64(reinterpret_cast<int64_t*>(&info.id_));
+        if (TFS_SUCCESS == iret)
+          iret = input.get_int64(&info.use_capacity_);
+        if (TFS_SUCCESS == iret)
+          iret = input.get_int64(&info.total_capacity_);
+        if (TFS_SUCCESS == iret)
+          iret = input.get_int32(&info.current_load_);
+        if (TFS_SUCCESS == iret)
+          iret = input.get_int32(&info.block_count_);
+        if (TFS_SUCCESS == iret)
+        {
+          info.status_ = DATASERVER_STATUS_ALIVE;
+          bool isnew = false;
+          iret = add_server(info, now, isnew);
+          ServerCollect* server = TFS_SUCCESS == iret ? get_server(info.id_) : NULL;
+          if (NULL != server)
+          {
+            //relations are the checkpoint's, till the dataserver reports its blocks
+            server->set_need_report(true);
+          }
+        }
+      }
+
+      BlockInfo info;
+      int32_t size = 0;
+      uint64_t server_id = 0;
+      for (int32_t i = 0; i < block_count && TFS_SUCCESS == iret; ++i)
+      {
+        iret = input.get_bytes(&info, sizeof(info));
+        if (TFS_SUCCESS == iret)
+          iret = input.get_int32(&size);
+        if (TFS_SUCCESS != iret)
+          break;
+        max_block_id = std::max(max_block_id, info.block_id_);
+        BlockChunkPtr ptr = get_chunk(info.block_id_);
+        RWLock::Lock lock(*ptr, WRITE_LOCKER);
+        BlockCollect* block = ptr->find(info.block_id_);
+        if (NULL == block)
+        {
+          block = ptr->add(info.block_id_, now);
+        }
+        block->update(info);
+        for (int32_t j = 0; j < size && TFS_SUCCESS == iret; ++j)
+        {
+          iret = input.get_int64(reinterpret_cast<int64_t*>(&server_id));
+          ServerCollect* server = TFS_SUCCESS == iret ? get_server(server_id) : NULL;
+          if (NULL != server
+              && !block->exist(server)
+              && TFS_SUCCESS != build_relation(block, server, now))
+          {
+            TBSYS_LOG(WARN, "build relation between block: %u and server: %s failed",
+                info.block_id_, CNetUtil::addrToString(server_id).c_str());
+          }
+        }
+      }
+      return iret;
+    }
+
     void LayoutManager::rotate(time_t now)
     {
       if ((now % 86400 >= zonesec_)
@@ -1498,7 +1691,8 @@ namespace tfs
           index = write_index_;
         }
         server = servers_index_[index];
-        block = server->elect_write_block();
+        //blocks restored from the checkpoint are not written till the server reports them
+        block = server->need_report() ? NULL : server->elect_write_block();
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
         TBSYS_LOG(DEBUG, "block: %u server: %s, write_index: %"PRI64_PREFIX"d, count: %u", block != NULL ? block->id() : 1, tbsys::CNetUtil::addrToString(server->id()).c_str(), index, count);
 #endif
@@ -1516,7 +1710,7 @@ namespace tfs
           index = write_second_index_;
         }
         server = servers_index_[index];
-        block = server->force_elect_write_block();
+        block = server->need_report() ? NULL : server->force_elect_write_block();
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
         TBSYS_LOG(DEBUG, "block: %u server: %s, second_write_index: %"PRI64_PREFIX"d, count: %u", block != NULL ? block->id() : 0, tbsys::CNetUtil::addrToString(server->id()).c_str(), index, count);
 #endif
@@ -1755,6 +1949,7 @@ namespace tfs
       bool interrupt = true;
       int64_t emergency_replicate_count = 0;
       int64_t current_plan_seqno = 1;
+      time_t last_scan_time = 0;
       const NsRuntimeGlobalInformation& ngi = GFactory::get_runtime_info();
       {
 #if !defined(TFS_NS_GTEST) && !defined(TFS_NS_INTEGRATION)
@@ -1777,6 +1972,7 @@ namespace tfs
           if (ngi.owner_role_ == NS_ROLE_SLAVE)
           {
             build_plan_monitor_.wait();
+            last_scan_time = 0;// relations of a slave are not checked, scan all once master
           }
 
           time_t wait_time = interrupt ? 0 : !bwait ? SYSPARAM_NAMESERVER.build_plan_default_wait_time_ : ngi.switch_time_ > now ? ngi.switch_time_ - now : SYSPARAM_NAMESERVER.build_plan_interval_;
@@ -1809,6 +2005,15 @@ namespace tfs
         TBSYS_LOG(INFO, "current plan size: %"PRI64_PREFIX"d, should: %"PRI64_PREFIX"d, need: %"PRI64_PREFIX"d",
             current, should, need);
 
+        // changed blocks are queued as they change, the full scan catches what is missed
+        if ((need > 0)
+            && (!(interrupt_ & INTERRUPT_ALL))
+            && (now - last_scan_time >= SYSPARAM_NAMESERVER.build_plan_full_scan_interval_))
+        {
+          scan_all_blocks(now);
+          last_scan_time = now;
+        }
+
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION)
         std::vector<uint32_t> blocks;
         bool bret = false;
@@ -2024,23 +2229,77 @@ namespace tfs
         int64_t& emergency_replicate_count,
         std::multimap<PlanPriority, BlockCollect*>& middle)
     {
-      for (int32_t i = 0; i < block_chunk_num_ && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++i)
+      std::vector<uint32_t> queue;
+      plan_queue_.get(PlanQueue::PLAN_QUEUE_REPLICATE, queue);
+      std::vector<uint32_t>::const_iterator iter = queue.begin();
+      for (; iter != queue.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
       {
-        RWLock::Lock lock(*block_chunk_[i], READ_LOCKER);
-        const BLOCK_MAP& blocks = block_chunk_[i]->block_map_;
-        BLOCK_MAP::const_iterator iter = blocks.begin();
-        for (; iter != blocks.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
+        BlockChunkPtr ptr = get_chunk((*iter));
+        RWLock::Lock lock(*ptr, READ_LOCKER);
+        BlockCollect* block = ptr->find((*iter));
+        if ((NULL == block)
+            || (!(PlanQueue::check(block, now) & (1 << PlanQueue::PLAN_QUEUE_REPLICATE))))
+        {
+          plan_queue_.erase(PlanQueue::PLAN_QUEUE_REPLICATE, (*iter));
+          continue;
+        }
+        PlanPriority level = PLAN_PRIORITY_NONE;
+        if ((level = block->check_replicate(now)) >= PLAN_PRIORITY_NORMAL)
         {
-          PlanPriority level = PLAN_PRIORITY_NONE;
-          if ((level = iter->second->check_replicate(now)) >= PLAN_PRIORITY_NORMAL)
+          if (level == PLAN_PRIORITY_EMERGENCY)
           {
-            if (level == PLAN_PRIORITY_EMERGENCY)
+            ++emergency_replicate_count;
+          }
+          middle.insert(std::pair<PlanPriority, BlockCollect*>(level, block));
+        }
+      }
+    }
+
+    void LayoutManager::scan_all_blocks(const time_t now)
+    {
+      int64_t start = tbsys::CTimeUtil::getTime();
+      int32_t count = static_cast<int32_t>(std::min(static_cast<int64_t>(SYSPARAM_NAMESERVER.build_plan_scan_thread_num_), block_chunk_num_));
+      std::vector<ScanBlockThreadHelperPtr> threads;
+      for (int32_t i = 0; i < count; ++i)
+      {
+        threads.push_back(new ScanBlockThreadHelper(*this, i, count, now));
+      }
+      std::vector<ScanBlockThreadHelperPtr>::iterator iter = threads.begin();
+      for (; iter != threads.end(); ++iter)
+      {
+        (*iter)->join();
+      }
+      TBSYS_LOG(INFO, "scan all blocks by %d threads, cost: %"PRI64_PREFIX"d(us), queued replicate: %"PRI64_PREFIX"d, redundant: %"PRI64_PREFIX"d, compact: %"PRI64_PREFIX"d",
+          count, tbsys::CTimeUtil::getTime() - start, plan_queue_.size(PlanQueue::PLAN_QUEUE_REPLICATE),
+          plan_queue_.size(PlanQueue::PLAN_QUEUE_REDUNDANT), plan_queue_.size(PlanQueue::PLAN_QUEUE_COMPACT));
+    }
+
+    void LayoutManager::scan_block_chunks(const int32_t index, const int32_t count, const time_t now)
+    {
+      std::vector<uint32_t> blocks[PlanQueue::PLAN_QUEUE_MAX];
+      for (int32_t i = index; i < block_chunk_num_ && !(interrupt_ & INTERRUPT_ALL); i += count)
+      {
+        {
+          RWLock::Lock lock(*block_chunk_[i], READ_LOCKER);
+          const BLOCK_MAP& chunk = block_chunk_[i]->block_map_;
+          BLOCK_MAP::const_iterator iter = chunk.begin();
+          for (; iter != chunk.end(); ++iter)
+          {
+            int32_t types = PlanQueue::check(iter->second, now);
+            for (int32_t type = 0; 0 != types && type < PlanQueue::PLAN_QUEUE_MAX; ++type)
             {
-              ++emergency_replicate_count;
+              if (types & (1 << type))
+              {
+                blocks[type].push_back(iter->first);
+              }
             }
-            middle.insert(std::pair<PlanPriority, BlockCollect*>(level, iter->second));
           }
         }
+        for (int32_t type = 0; type < PlanQueue::PLAN_QUEUE_MAX; ++type)
+        {
+          plan_queue_.push(type, blocks[type]);
+          blocks[type].clear();
+        }
       }
     }
 
@@ -2158,36 +2417,42 @@ namespace tfs
         bool has_compact = false;
         bool all_find_flag = false;
         std::vector<ServerCollect*> except;
-        for (int32_t i = 0; i < block_chunk_num_ && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++i)
-        {
-          RWLock::Lock lock(*block_chunk_[i], READ_LOCKER);
-          const BLOCK_MAP& blocks = block_chunk_[i]->block_map_;
-          BLOCK_MAP::const_iterator iter = blocks.begin();
-          for (; iter != blocks.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
+        std::vector<uint32_t> queue;
+        plan_queue_.get(PlanQueue::PLAN_QUEUE_COMPACT, queue);
+        std::vector<uint32_t>::const_iterator iter = queue.begin();
+        for (; iter != queue.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
+        {
+          BlockChunkPtr ptr = get_chunk((*iter));
+          RWLock::Lock lock(*ptr, READ_LOCKER);
+          BlockCollect* block = ptr->find((*iter));
+          if ((NULL == block)
+              || (!block->check_compact()))
           {
-            {
-              has_compact = ((iter->second->check_compact())
-                  && (!find_block_in_plan(iter->second->id()))
-                  && (!find_server_in_plan(iter->second->get_hold(), all_find_flag, except)));
-            }
+            plan_queue_.erase(PlanQueue::PLAN_QUEUE_COMPACT, (*iter));
+            continue;
+          }
+          {
+            has_compact = ((!find_block_in_plan(block->id()))
+                && (!find_server_in_plan(block->get_hold(), all_find_flag, except)));
+          }
 
-            if (has_compact)
+          if (has_compact)
+          {
+            CompactTaskPtr task = new CompactTask(this, PLAN_PRIORITY_NORMAL, block->id(), now, now,
+                block->get_hold(), plan_seqno, block->get_compact_mode());
+            if (!add_task(task))
             {
-              CompactTaskPtr task = new CompactTask(this, PLAN_PRIORITY_NORMAL, iter->second->id(), now, now, iter->second->get_hold(), plan_seqno);
-              if (!add_task(task))
-              {
-                task = 0;
-                TBSYS_LOG(ERROR, "add task(compact) fail, block: %u", iter->second->id());
-                continue;
-              }
+              task = 0;
+              TBSYS_LOG(ERROR, "add task(compact) fail, block: %u", block->id());
+              continue;
+            }
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
-              TBSYS_LOG(DEBUG, "add task, type: %d", task->type_);
+            TBSYS_LOG(DEBUG, "add task, type: %d", task->type_);
 #endif
-              --need;
+            --need;
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION)
-              plans.push_back(task->block_id_);
+            plans.push_back(task->block_id_);
 #endif
-            }
           }
         }
         return true;
@@ -2248,6 +2513,7 @@ namespace tfs
         {
           RWLock::Lock tlock(maping_mutex_, READ_LOCKER);
           has_move = ((iter->second->is_alive())
+              && (!iter->second->need_report())
               && (!find_server_in_plan(iter->second)));
 
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
@@ -2322,10 +2588,10 @@ namespace tfs
             for (; it != source.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0 && !target.empty(); ++it)
             {
               (*it)->rdlock();
-              std::set<BlockCollect*, ServerCollect::BlockIdComp> blocks((*it)->hold_);
+              std::vector<BlockCollect*> blocks((*it)->hold_);
               (*it)->unlock();
 
-              std::set<BlockCollect*, ServerCollect::BlockIdComp>::const_iterator cn_iter = blocks.begin();
+              std::vector<BlockCollect*>::const_iterator cn_iter = blocks.begin();
               for (; cn_iter != blocks.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++cn_iter)
               {
                 except.clear();
@@ -2419,47 +2685,51 @@ namespace tfs
       int32_t  count = 0;
       std::vector<ServerCollect*> except;
       std::vector<ServerCollect*> servers;
-      for (int32_t i = 0; i < block_chunk_num_ && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++i)
+      std::vector<uint32_t> queue;
+      plan_queue_.get(PlanQueue::PLAN_QUEUE_REDUNDANT, queue);
+      std::vector<uint32_t>::const_iterator iter = queue.begin();
+      for (; iter != queue.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
       {
-        RWLock::Lock lock(*block_chunk_[i], READ_LOCKER);
-        const BLOCK_MAP& blocks = block_chunk_[i]->block_map_;
-        BLOCK_MAP::const_iterator iter = blocks.begin();
-        for (; iter != blocks.end() && !(interrupt_ & INTERRUPT_ALL) && need > 0; ++iter)
+        BlockChunkPtr ptr = get_chunk((*iter));
+        RWLock::Lock lock(*ptr, READ_LOCKER);
+        BlockCollect* block = ptr->find((*iter));
+        count = NULL == block ? 0 : block->check_redundant();
+        if (count <= 0)
         {
-          except.clear();
-          count = iter->second->check_redundant();
+          plan_queue_.erase(PlanQueue::PLAN_QUEUE_REDUNDANT, (*iter));
+          continue;
+        }
+        except.clear();
+        {
+          has_delete = ((!find_block_in_plan(block->id()))
+              && (!find_server_in_plan(block->get_hold(), all_find_flag, except)));
+          if (has_delete)
           {
-            has_delete = ((count > 0)
-                && (!find_block_in_plan(iter->second->id()))
-                && (!find_server_in_plan(iter->second->get_hold(), all_find_flag, except)));
-            if (has_delete)
-            {
-              servers = iter->second->get_hold();
-            }
+            servers = block->get_hold();
           }
-          if (has_delete)
+        }
+        if (has_delete)
+        {
+          std::vector<ServerCollect*> result;
+          find_server_in_plan_helper(servers, except);
+          if ((delete_excess_backup(servers, count, result) > 0)
+              && (!result.empty()))
           {
-            std::vector<ServerCollect*> result;
-            find_server_in_plan_helper(servers, except);
-            if ((delete_excess_backup(servers, count, result) > 0)
-                && (!result.empty()))
+            TBSYS_LOG(INFO, "we will need delete less than block: %u", block->id());
+            DeleteBlockTaskPtr task = new DeleteBlockTask(this, PLAN_PRIORITY_NORMAL, block->id(), now, now, result, plan_seqno);
+            if (!add_task(task))
             {
-              TBSYS_LOG(INFO, "we will need delete less than block: %u", iter->second->id());
-              DeleteBlockTaskPtr task = new DeleteBlockTask(this, PLAN_PRIORITY_NORMAL, iter->second->id(), now, now, result, plan_seqno);
-              if (!add_task(task))
-              {
-                task = 0;
-                TBSYS_LOG(ERROR, "add task(delete) fail, block: %u", iter->second->id());
-                continue;
-              }
-              --need;
+              task = 0;
+              TBSYS_LOG(ERROR, "add task(delete) fail, block: %u", block->id());
+              continue;
+            }
+            --need;
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
-              TBSYS_LOG(DEBUG, "add task, type: %d", task->type_);
+            TBSYS_LOG(DEBUG, "add task, type: %d", task->type_);
 #endif
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION)
-              plans.push_back(task->block_id_);
+            plans.push_back(task->block_id_);
 #endif
-            }
           }
         }
       }
@@ -2537,10 +2807,10 @@ namespace tfs
       return (server_to_task_.end() != server_to_task_.find(server));
     }
 
-    bool LayoutManager::find_server_in_plan(const std::vector<ServerCollect*> & servers, bool all_find, std::vector<ServerCollect*>& result)
+    bool LayoutManager::find_server_in_plan(const ServerSlots& servers, bool all_find, std::vector<ServerCollect*>& result)
     {
       RWLock::Lock tlock(maping_mutex_, READ_LOCKER);
-      std::vector<ServerCollect*>::const_iterator iter = servers.begin();
+      ServerSlots::const_iterator iter = servers.begin();
       for (; iter != servers.end(); ++iter)
       {
         std::map<ServerCollect*, TaskPtr>::iterator it = server_to_task_.find((*iter));
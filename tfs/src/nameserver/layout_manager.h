@@ -22,6 +22,7 @@
 #include "common/lock.h"
 #include "block_chunk.h"
 #include "block_collect.h"
+#include "plan_queue.h"
 #include "server_collect.h"
 #include "lease_clerk.h"
 #include "common/base_packet.h"
@@ -47,11 +48,15 @@ namespace nameserver
     ClientRequestServer& get_client_request_server();
 
     BlockChunkPtr get_chunk(const uint32_t block_id) const;
+    // read path, takes no lock and no reference of the chunk
+    int get_readable_servers(const uint32_t block_id, common::VUINT64& servers) const;
     ServerCollect* get_server(const uint64_t server_id);
 
     int add_server(const common::DataServerStatInfo& info, const time_t now, bool& isnew);
     int remove_server(const uint64_t id, const time_t now);
     int update_relation(ServerCollect* server, const std::vector<common::BlockInfo>& blocks, EXPIRE_BLOCK_LIST& expires, const time_t now);
+    int update_relation(ServerCollect* server, const std::vector<common::BlockInfo>& blocks,
+        const common::VUINT32& removed, EXPIRE_BLOCK_LIST& expires, const time_t now);
     int build_relation(BlockCollect* block, ServerCollect* server, const time_t now, const bool force = false);
 
     BlockCollect* elect_write_block();
@@ -73,6 +78,12 @@ namespace nameserver
     int rm_block_from_ds(const uint64_t server_id, const uint32_t block_id);
     int rm_block_from_ds(const uint64_t server_id, const std::vector<uint32_t>& block_ids);
 
+    // copy of the block table for a checkpoint, one block chunk at a time
+    int snapshot(common::Stream& output, int32_t& server_count, int32_t& block_count);
+    // rebuild the block table from a checkpoint, max_block_id the largest block id in it
+    int restore(common::Stream& input, const int32_t server_count, const int32_t block_count,
+        uint32_t& max_block_id, const time_t now);
+
     inline void get_alive_server(common::VUINT64& servers)
     {
       common::RWLock::Lock lock(server_mutex_, common::READ_LOCKER);
@@ -81,13 +92,15 @@ namespace nameserver
 
     bool find_block_in_plan(const uint32_t block_id);
     bool find_server_in_plan(ServerCollect* server);
-    bool find_server_in_plan(const std::vector<ServerCollect*> & servers, bool all_find, std::vector<ServerCollect*>& result);
+    bool find_server_in_plan(const ServerSlots& servers, bool all_find, std::vector<ServerCollect*>& result);
 
     int touch(const uint64_t server, const time_t now = time(NULL), const bool promote = true);
     int touch(ServerCollect* server, const time_t now, const bool promote = false);
 
     int open_helper_create_new_block_by_id(const uint32_t block_id);
 
+    inline PlanQueue& get_plan_queue() { return plan_queue_;}
+
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION)
   public:
 #else
@@ -107,8 +120,10 @@ namespace nameserver
     int add_new_block_helper_build_relation(const uint32_t block_id, const std::vector<ServerCollect*>& server);
     ServerCollect* find_server_in_vec(const std::vector<ServerCollect*>& servers, const uint64_t server_id);
 
-    static bool relieve_relation(BlockCollect* block, ServerCollect* server, const time_t now);
+    bool relieve_relation(BlockCollect* block, ServerCollect* server, const time_t now);
     bool relieve_relation(ServerCollect* server, const time_t now);
+    void relieve_relation(ServerCollect* server, const std::vector<uint32_t>& blocks, const time_t now);
+    int report_blocks(ServerCollect* server, const std::vector<common::BlockInfo>& blocks, EXPIRE_BLOCK_LIST& expires, const time_t now);
 
     void rotate(const time_t now);
 
@@ -218,7 +233,7 @@ namespace nameserver
         CompactTask(LayoutManager* manager, const common::PlanPriority priority,
                     const uint32_t block_id, const time_t begin, const time_t end,
                     const std::vector<ServerCollect*>& runer,
-                    const int64_t seqno);
+                    const int64_t seqno, const common::CompactMode mode = common::COMPACT_MODE_FULL);
         virtual ~CompactTask(){}
         virtual int handle();
         virtual int handle_complete(common::BasePacket* msg, bool& all_complete_flag);
@@ -243,6 +258,7 @@ namespace nameserver
         static const int8_t INVALID_BLOCK_ID;
         std::vector< std::pair <uint64_t, common::PlanStatus> > complete_status_;
         common::BlockInfo block_info_;
+        common::CompactMode mode_;
       private:
         DISALLOW_COPY_AND_ASSIGN(CompactTask);
     };
@@ -354,6 +370,29 @@ namespace nameserver
         DISALLOW_COPY_AND_ASSIGN(CheckDataServerThreadHelper);
     };
     typedef tbutil::Handle<CheckDataServerThreadHelper> CheckDataServerThreadHelperPtr;
+
+    // scans the block chunks of index, index + count ... into the plan queue
+    class ScanBlockThreadHelper: public tbutil::Thread
+    {
+      public:
+        ScanBlockThreadHelper(LayoutManager& manager, const int32_t index, const int32_t count, const time_t now):
+          manager_(manager),
+          index_(index),
+          count_(count),
+          now_(now)
+      {
+        start();
+      }
+        virtual ~ScanBlockThreadHelper(){}
+        void run();
+      private:
+        DISALLOW_COPY_AND_ASSIGN(ScanBlockThreadHelper);
+        LayoutManager& manager_;
+        int32_t index_;
+        int32_t count_;
+        time_t now_;
+    };
+    typedef tbutil::Handle<ScanBlockThreadHelper> ScanBlockThreadHelperPtr;
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION)
   public:
 #else
@@ -387,6 +426,10 @@ namespace nameserver
         int64_t& emergency_replicate_count,
         std::multimap<common::PlanPriority, BlockCollect*>& middle);
 
+    // full scan of all blocks into the plan queue, chunks split among build_plan_scan_thread_num_ threads
+    void scan_all_blocks(const time_t now);
+    void scan_block_chunks(const int32_t index, const int32_t count, const time_t now);
+
     int64_t calc_average_block_size();
 
     void statistic_all_server_info(const int64_t need,
@@ -460,6 +503,7 @@ namespace nameserver
     static const std::string dynamic_parameter_str[];
     tbutil::Mutex elect_index_mutex_;
     ClientRequestServer client_request_server_;
+    PlanQueue plan_queue_;
   };
 }
 }
@@ -149,8 +149,6 @@ namespace tfs
     class ServerCollect;
     typedef __gnu_cxx ::hash_map<uint64_t, nameserver::ServerCollect*, __gnu_cxx ::hash<uint64_t> > SERVER_MAP;
     typedef SERVER_MAP::iterator SERVER_MAP_ITER;
-    typedef __gnu_cxx ::hash_map<uint32_t, nameserver::BlockCollect*, __gnu_cxx ::hash<uint32_t> > BLOCK_MAP;
-    typedef BLOCK_MAP::iterator BLOCK_MAP_ITER;
 
     extern int ns_async_callback(common::NewClient* client);
     extern void print_servers(const std::vector<ServerCollect*>& servers, std::string& result);
@@ -70,7 +70,8 @@ namespace tfs
     }
 
     OpLogSyncManager::OpLogSyncManager(LayoutManager& mm) :
-      is_destroy_(false), meta_mgr_(mm), oplog_(NULL), file_queue_(NULL), file_queue_thread_(NULL)
+      is_destroy_(false), meta_mgr_(mm), oplog_(NULL), file_queue_(NULL), file_queue_thread_(NULL),
+      checkpoint_(mm)
     {
 
     }
@@ -117,10 +118,27 @@ namespace tfs
         }
       }
 
+      // load the checkpoint, the oplog is replayed from where it is taken
+      bool rewind = false;
+      if (TFS_SUCCESS == iret)
+      {
+        checkpoint_.initialize(std::string(work_dir) + "/nameserver/checkpoint",
+            TBSYS_CONFIG.getInt(CONF_SN_NAMESERVER, CONF_CHECKPOINT_INTERVAL, 0));
+        OpLogRotateHeader pos;
+        uint32_t max_block_id = 0;
+        if (checkpoint_.enabled()
+            && TFS_SUCCESS == checkpoint_.load(pos, max_block_id))
+        {
+          id_factory_.generation(max_block_id);
+          oplog_->update_oplog_rotate_header(pos);
+          rewind = true;
+        }
+      }
+
       // replay all oplog
       if (TFS_SUCCESS == iret)
       {
-        iret = replay_all();
+        iret = replay_all(rewind);
         if (TFS_SUCCESS != iret)
         {
           TBSYS_LOG(ERROR, "replay all oplogs failed, iret: %d", iret);
@@ -140,6 +158,14 @@ namespace tfs
 
         //update rotate header information
         oplog_->update_oplog_rotate_header(rotmp);
+
+        //the oplog before is cleared, a checkpoint of now is the one to load next time
+        if (checkpoint_.enabled()
+            && TFS_SUCCESS != checkpoint_.save(rotmp))
+        {
+          std::string checkpoint_path = std::string(work_dir) + "/nameserver/checkpoint";
+          ::unlink(checkpoint_path.c_str());
+        }
       }
 
       // add flush oplog timer
@@ -148,6 +174,11 @@ namespace tfs
         FlushOpLogTimerTaskPtr foltt = new FlushOpLogTimerTask(*this);
         GFactory::get_timer()->scheduleRepeated(foltt, tbutil::Time::seconds(
             SYSPARAM_NAMESERVER.heart_interval_));
+        if (checkpoint_.enabled())
+        {
+          CheckpointTimerTaskPtr ctt = new CheckpointTimerTask(*this);
+          GFactory::get_timer()->scheduleRepeated(ctt, tbutil::Time::seconds(checkpoint_.get_interval()));
+        }
       }
 
       if (TFS_SUCCESS == iret)
@@ -282,6 +313,20 @@ namespace tfs
       return iret;
     }
 
+    int OpLogSyncManager::checkpoint()
+    {
+      OpLogRotateHeader pos;
+      {
+        //oplogs after this position are replayed on the checkpoint, those applied
+        //to the table before it is copied are replayed again and do nothing
+        tbutil::Mutex::Lock lock(mutex_);
+        const QueueInformationHeader* head = file_queue_->get_queue_information_header();
+        pos.rotate_seqno_ = head->write_seqno_;
+        pos.rotate_offset_ = head->write_filesize_;
+      }
+      return checkpoint_.save(pos);
+    }
+
     int OpLogSyncManager::push(common::BasePacket* msg, int32_t max_queue_size, bool block)
     {
       return  work_thread_.push(msg, max_queue_size, block);
@@ -658,7 +703,7 @@ namespace tfs
       return iret;
     }
 
-    int OpLogSyncManager::replay_all()
+    int OpLogSyncManager::replay_all(const bool rewind)
     {
       bool has_log = false;
       file_queue_->set_delete_file_flag(true);
@@ -679,7 +724,9 @@ namespace tfs
         if (qhead->read_seqno_ > 0x01 && qhead->write_seqno_ > 0x01 && head.rotate_seqno_ > 0)
         {
           has_log = true;
-          if (tmp.read_seqno_ <= head.rotate_seqno_)
+          //a checkpoint is loaded, all oplogs after it are replayed
+          if (rewind
+              || tmp.read_seqno_ <= head.rotate_seqno_)
           {
             tmp.read_seqno_ = head.rotate_seqno_;
             if (tmp.read_seqno_ == head.rotate_seqno_)
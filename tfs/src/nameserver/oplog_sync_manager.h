@@ -31,6 +31,7 @@
 
 #include "oplog.h"
 #include "block_id_factory.h"
+#include "checkpoint.h"
 
 namespace tfs
 {
@@ -70,6 +71,8 @@ namespace tfs
       int replay_helper_do_oplog(const int32_t type, const char* const data, const int64_t data_len, int64_t& pos, time_t now);
 
       inline uint32_t generation(const uint32_t id = 0) { return id_factory_.generation(id);}
+      // write a checkpoint of the block table at the current oplog position
+      int checkpoint();
     private:
       DISALLOW_COPY_AND_ASSIGN( OpLogSyncManager);
       virtual bool handlePacketQueue(tbnet::Packet *packet, void *args);
@@ -79,7 +82,7 @@ namespace tfs
       int do_master_msg(const common::BasePacket* msg, const void* args);
       int do_slave_msg(const common::BasePacket* msg, const void* args);
       int do_sync_oplog(const common::BasePacket* msg, const void* args);
-      int replay_all();
+      int replay_all(const bool rewind = false);
     private:
       bool is_destroy_;
       LayoutManager& meta_mgr_;
@@ -87,6 +90,7 @@ namespace tfs
       common::FileQueue* file_queue_;
       common::FileQueueThread* file_queue_thread_;
       BlockIdFactory id_factory_;
+      Checkpoint checkpoint_;
       tbutil::Mutex mutex_;
       tbutil::Monitor<tbutil::Mutex> monitor_;
       tbnet::PacketQueueThread work_thread_;
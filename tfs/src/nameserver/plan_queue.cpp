@@ -0,0 +1,114 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <tbsys.h>
+#include "plan_queue.h"
+#include "block_collect.h"
+#include "common/parameter.h"
+
+using namespace tfs::common;
+namespace tfs
+{
+  namespace nameserver
+  {
+    PlanQueue::PlanQueue()
+    {
+
+    }
+
+    PlanQueue::~PlanQueue()
+    {
+
+    }
+
+    void PlanQueue::push(const BlockCollect* block, const time_t now)
+    {
+      int32_t types = NULL == block ? 0 : check(block, now);
+      if (0 != types)
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        for (int32_t i = 0; i < PLAN_QUEUE_MAX; ++i)
+        {
+          if (types & (1 << i))
+          {
+            queues_[i].insert(block->id());
+          }
+        }
+      }
+    }
+
+    void PlanQueue::push(const int32_t type, const std::vector<uint32_t>& blocks)
+    {
+      if (type >= 0 && type < PLAN_QUEUE_MAX && !blocks.empty())
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        queues_[type].insert(blocks.begin(), blocks.end());
+      }
+    }
+
+    void PlanQueue::erase(const int32_t type, const uint32_t block_id)
+    {
+      if (type >= 0 && type < PLAN_QUEUE_MAX)
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        queues_[type].erase(block_id);
+      }
+    }
+
+    void PlanQueue::get(const int32_t type, std::vector<uint32_t>& blocks) const
+    {
+      if (type >= 0 && type < PLAN_QUEUE_MAX)
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        blocks.assign(queues_[type].begin(), queues_[type].end());
+      }
+    }
+
+    int64_t PlanQueue::size(const int32_t type) const
+    {
+      int64_t size = 0;
+      if (type >= 0 && type < PLAN_QUEUE_MAX)
+      {
+        tbutil::Mutex::Lock lock(mutex_);
+        size = queues_[type].size();
+      }
+      return size;
+    }
+
+    void PlanQueue::clear()
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      for (int32_t i = 0; i < PLAN_QUEUE_MAX; ++i)
+      {
+        queues_[i].clear();
+      }
+    }
+
+    int32_t PlanQueue::check(const BlockCollect* block, const time_t now)
+    {
+      int32_t types = 0;
+      // replicated once replicate_wait_time_ passes with no change
+      if (PLAN_PRIORITY_NONE != block->check_replicate(now + SYSPARAM_NAMESERVER.replicate_wait_time_))
+      {
+        types |= 1 << PLAN_QUEUE_REPLICATE;
+      }
+      if (block->check_redundant() > 0)
+      {
+        types |= 1 << PLAN_QUEUE_REDUNDANT;
+      }
+      if (block->check_compact())
+      {
+        types |= 1 << PLAN_QUEUE_COMPACT;
+      }
+      return types;
+    }
+  }//end namespace nameserver
+}//end namespace tfs
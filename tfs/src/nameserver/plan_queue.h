@@ -0,0 +1,66 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#ifndef TFS_NAMESERVER_PLAN_QUEUE_H_
+#define TFS_NAMESERVER_PLAN_QUEUE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <set>
+#include <vector>
+#include <Mutex.h>
+#include "common/internal.h"
+
+namespace tfs
+{
+  namespace nameserver
+  {
+    class BlockCollect;
+
+    /**
+     * blocks that need a plan, so build_plan looks at them instead of at all blocks.
+     * a block is pushed when its relations or info change, and whenever a full scan
+     * finds it. it stays until build_plan finds it fine: a block waiting for
+     * replicate_wait_time_ or whose task failed is looked at again next time.
+     */
+    class PlanQueue
+    {
+    public:
+      enum PlanQueueType
+      {
+        PLAN_QUEUE_REPLICATE = 0,
+        PLAN_QUEUE_REDUNDANT,
+        PLAN_QUEUE_COMPACT,
+        PLAN_QUEUE_MAX
+      };
+
+      PlanQueue();
+      virtual ~PlanQueue();
+
+      // the chunk lock of block held
+      void push(const BlockCollect* block, const time_t now);
+      void push(const int32_t type, const std::vector<uint32_t>& blocks);
+      void erase(const int32_t type, const uint32_t block_id);
+      void get(const int32_t type, std::vector<uint32_t>& blocks) const;
+      int64_t size(const int32_t type) const;
+      void clear();
+
+      // types block is queued for, a bit for each PlanQueueType
+      static int32_t check(const BlockCollect* block, const time_t now);
+
+    private:
+      DISALLOW_COPY_AND_ASSIGN(PlanQueue);
+      mutable tbutil::Mutex mutex_;
+      std::set<uint32_t> queues_[PLAN_QUEUE_MAX];
+    };
+  }//end namespace nameserver
+}//end namespace tfs
+#endif
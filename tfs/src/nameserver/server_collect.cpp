@@ -57,13 +57,15 @@ namespace tfs
       total_capacity_(info.total_capacity_),
       elect_num_(NsGlobalStatisticsInfo::ELECT_SEQ_NO_INITIALIZE),
       elect_seq_(NsGlobalStatisticsInfo::ELECT_SEQ_NO_INITIALIZE),
+      report_seq_(0),
       startup_time_(now),
       last_update_time_(now),
       current_load_(info.current_load_ <= 0 ? 1 : info.current_load_),
       block_count_(info.block_count_),
       write_index_(0),
       status_(info.status_),
-      elect_flag_(1)
+      elect_flag_(1),
+      need_report_(false)
       {
       }
 
@@ -73,11 +75,20 @@ namespace tfs
       if (bret)
       {
         RWLock::Lock lock(*this, WRITE_LOCKER);
-        std::pair<std::set<BlockCollect*>::iterator, bool> res = hold_.insert(block);
-        if (!res.second)
+        // blocks are reported in id order, new blocks have the largest id: mostly appended
+        std::vector<BlockCollect*>::iterator where = hold_.end();
+        if (!hold_.empty() && !BlockIdComp()(hold_.back(), block))
+        {
+          where = std::lower_bound(hold_.begin(), hold_.end(), block, BlockIdComp());
+        }
+        if (where != hold_.end() && (*where)->id() == block->id())
         {
           TBSYS_LOG(WARN, "block: %u is exist", block->id());
         }
+        else
+        {
+          hold_.insert(where, block);
+        }
 
         if (writable)
         {
@@ -98,7 +109,12 @@ namespace tfs
       {
         TBSYS_LOG(DEBUG, "server: %s remove block: %u", CNetUtil::addrToString(id_).c_str(), block->id());
         RWLock::Lock lock(*this, WRITE_LOCKER);
-        hold_.erase(block);
+        std::vector<BlockCollect*>::iterator where =
+          std::lower_bound(hold_.begin(), hold_.end(), block, BlockIdComp());
+        if (where != hold_.end() && (*where) == block)
+        {
+          hold_.erase(where);
+        }
         writable_.erase(block);
       }
       return bret;
@@ -183,16 +199,16 @@ namespace tfs
     {
       bool remove = false;
       //release any of blocks relation with this dataserver
-      std::set<BlockCollect*, BlockIdComp> tmp;
+      std::vector<BlockCollect*> tmp;
       {
         RWLock::Lock lock(*this, WRITE_LOCKER);
-        tmp = hold_;
-        hold_.clear();
+        tmp.swap(hold_);
+        report_seq_ = 0;
         hold_master_.clear();
         writable_.clear();
       }
 
-      std::set<BlockCollect*>::const_iterator iter = tmp.begin();
+      std::vector<BlockCollect*>::const_iterator iter = tmp.begin();
       for (; iter != tmp.end(); ++iter)
       {
         BlockChunkPtr ptr = manager.get_chunk((*iter)->id());
@@ -205,6 +221,7 @@ namespace tfs
           TBSYS_LOG(ERROR, "failed when relieve between block: %u and dataserver: %s",
               block->id(), CNetUtil::addrToString(id()).c_str());
         }
+        manager.get_plan_queue().push(block, now);
       }
       return true;
     }
@@ -284,7 +301,7 @@ namespace tfs
       if (scan_flag & SSM_CHILD_SERVER_TYPE_HOLD)
       {
         param.data_.writeInt32(hold_.size());
-        std::set<BlockCollect*>::const_iterator iter = hold_.begin();
+        std::vector<BlockCollect*>::const_iterator iter = hold_.begin();
         for (; iter != hold_.end(); ++iter)
         {
           param.data_.writeInt32((*iter)->id());
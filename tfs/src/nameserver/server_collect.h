@@ -87,6 +87,12 @@ namespace tfs
 #endif
       inline int64_t get_elect_num() const { return elect_num_;}
       inline int32_t get_hold_master_size() const { return hold_master_.size();}
+      // seq of the last block report applied, 0 if none
+      inline int64_t get_report_seq() const { return report_seq_;}
+      inline void set_report_seq(const int64_t report_seq) { report_seq_ = report_seq;}
+      // loaded from a checkpoint, relations are not confirmed by a block report yet
+      inline bool need_report() const { return need_report_;}
+      inline void set_need_report(const bool need_report) { need_report_ = need_report;}
 
       void callback(LayoutManager* manager);
 
@@ -106,7 +112,7 @@ namespace tfs
 #endif
       const uint8_t DEAD_TIME;
       ServerCollect();
-      std::set<BlockCollect*, BlockIdComp> hold_;
+      std::vector<BlockCollect*> hold_;// sorted by BlockIdComp, all blocks of the server
       std::set<BlockCollect*, BlockIdComp> writable_;
       std::vector<BlockCollect*> hold_master_;
 #ifdef TFS_NS_DEBUG
@@ -122,6 +128,7 @@ namespace tfs
       int64_t total_capacity_;
       int64_t elect_num_;
       int64_t elect_seq_;
+      int64_t report_seq_;
       time_t  startup_time_;
       time_t  last_update_time_;
       int32_t current_load_;
@@ -129,6 +136,7 @@ namespace tfs
       int32_t write_index_;
       int8_t  status_;
       volatile uint8_t  elect_flag_;
+      bool need_report_;
     };
   }/** nameserver **/
 }/** tfs **/
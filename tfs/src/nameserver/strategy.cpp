@@ -79,6 +79,18 @@ namespace tfs
 #if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
           TBSYS_LOG(DEBUG, "dataserver: %s is dead, can't join ",
             CNetUtil::addrToString(server->id()).c_str());
+#endif
+        }
+      }
+      if (bret)
+      {
+        //relations restored from the checkpoint are not trusted till its first report
+        bret = !server->need_report();
+        if (!bret)
+        {
+#if defined(TFS_NS_GTEST) || defined(TFS_NS_INTEGRATION) || defined(TFS_NS_DEBUG)
+          TBSYS_LOG(DEBUG, "dataserver: %s not reported yet, can't join ",
+            CNetUtil::addrToString(server->id()).c_str());
 #endif
         }
       }
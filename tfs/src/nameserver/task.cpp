@@ -131,8 +131,9 @@ namespace tfs
     }
 
     LayoutManager::CompactTask::CompactTask(LayoutManager* manager, const PlanPriority priority,
-      uint32_t block_id, time_t begin, time_t end, const std::vector<ServerCollect*>& runer, const int64_t seqno):
-      Task(manager, PLAN_TYPE_COMPACT, priority, block_id, begin, end, runer, seqno)
+      uint32_t block_id, time_t begin, time_t end, const std::vector<ServerCollect*>& runer, const int64_t seqno,
+      const CompactMode mode):
+      Task(manager, PLAN_TYPE_COMPACT, priority, block_id, begin, end, runer, seqno), mode_(mode)
     {
       memset(&block_info_, 0, sizeof(block_info_));
     }
@@ -241,6 +242,7 @@ namespace tfs
       CompactBlockMessage msg;
       msg.set_block_id(block_id_);
       msg.set_preserve_time(SYSPARAM_NAMESERVER.run_plan_expire_interval_);
+      msg.set_mode(mode_);
       std::pair<uint64_t, PlanStatus> res;
       std::vector<ServerCollect*>::iterator iter = runer_.begin();
       for (; iter != runer_.end(); ++iter, ++index)
@@ -421,7 +423,7 @@ namespace tfs
         BlockCollect* block = ptr->find(value.block_id_);
         if (block != NULL)
         {
-          std::vector<ServerCollect*>::iterator iter = block->get_hold().begin();
+          ServerSlots::iterator iter = block->get_hold().begin();
           for (; iter !=  block->get_hold().end(); ++iter)
           {
             (*iter)->add_writable(block);
@@ -639,7 +641,7 @@ namespace tfs
         std::vector<ServerCollect*>::iterator iter = runer_.begin();
         for (; iter != runer_.end(); ++iter)
         {
-          iret = LayoutManager::relieve_relation(block, (*iter), now) ? TFS_SUCCESS : TFS_ERROR;
+          iret = manager_->relieve_relation(block, (*iter), now) ? TFS_SUCCESS : TFS_ERROR;
           if (TFS_SUCCESS != iret)
           {
             TBSYS_LOG(ERROR, "remove block: %u no server: %s relieve relation failed", block_id_, tbsys::CNetUtil::addrToString((*iter)->id()).c_str());
@@ -733,6 +735,22 @@ namespace tfs
         TBSYS_LOG(ERROR, "%s", "catch exception, unknow message");
       }
     }
+
+    void LayoutManager::ScanBlockThreadHelper::run()
+    {
+      try
+      {
+        manager_.scan_block_chunks(index_, count_, now_);
+      }
+      catch(std::exception& e)
+      {
+        TBSYS_LOG(ERROR, "catch exception: %s", e.what());
+      }
+      catch(...)
+      {
+        TBSYS_LOG(ERROR, "%s", "catch exception, unknow message");
+      }
+    }
   }
 }
 
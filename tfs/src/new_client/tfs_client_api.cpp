@@ -297,6 +297,12 @@ int TfsClient::fetch_file(const char* tfs_name, const char* suffix, char*& buf,
   return TfsClientImpl::Instance()->fetch_file(tfs_name, suffix, buf, count, ns_addr);
 }
 
+int TfsClient::batch_fetch_file(const int32_t file_count, const char* const tfs_names[], const char* suffix,
+                                char* bufs[], int64_t counts[], int rets[], const char* ns_addr)
+{
+  return TfsClientImpl::Instance()->batch_fetch_file(file_count, tfs_names, suffix, bufs, counts, rets, ns_addr);
+}
+
 int TfsClient::stat_file(const char* tfs_name, const char* suffix,
                          TfsFileStat* file_stat, const TfsStatType stat_type, const char* ns_addr)
 {
@@ -204,6 +204,12 @@ namespace tfs
                         const int32_t flag = common::T_DEFAULT, const char* key = NULL);
       int fetch_file(const char* local_file, const char* tfs_name, const char* suffix, const char* ns_addr = NULL);
       int fetch_file(const char* tfs_name, const char* suffix, char*& buf, int64_t& count, const char* ns_addr = NULL);
+      // fetch many small files in one round trip per dataserver.
+      // counts[i] is the capacity of bufs[i] on input and the length read on output,
+      // rets[i] is the result of every file. a file larger than bufs[i] fails with
+      // EXIT_BUFFER_TOO_SMALL_ERROR, counts[i] is then the size it needs
+      int batch_fetch_file(const int32_t file_count, const char* const tfs_names[], const char* suffix,
+                           char* bufs[], int64_t counts[], int rets[], const char* ns_addr = NULL);
       int stat_file(const char* tfs_name, const char* suffix,
                     common::TfsFileStat* file_stat, const common::TfsStatType stat_type = common::NORMAL_STAT,
                     const char* ns_addr = NULL);
@@ -14,11 +14,13 @@
  *
  */
 #include <stdarg.h>
+#include <map>
 #include <string>
 #include <Memory.hpp>
 #include "common/base_packet_factory.h"
 #include "common/base_packet_streamer.h"
 #include "common/client_manager.h"
+#include "common/status_message.h"
 #include "message/message_factory.h"
 #include "tfs_client_impl.h"
 #include "tfs_large_file.h"
@@ -999,6 +1001,160 @@ int TfsClientImpl::fetch_file(const char* tfs_name, const char* suffix, char*& b
   return ret;
 }
 
+// fetch small files to user buffers, files on the same dataserver are read by one request.
+// counts[i] is the capacity of bufs[i] on input and the length read on output, or the size
+// needed if the file is larger than bufs[i].
+int TfsClientImpl::batch_fetch_file(const int32_t file_count, const char* const tfs_names[], const char* suffix,
+                                    char* bufs[], int64_t counts[], int rets[], const char* ns_addr)
+{
+  int ret = TFS_SUCCESS;
+  TfsSession* tfs_session = NULL;
+  if (file_count <= 0 || NULL == tfs_names || NULL == bufs || NULL == counts || NULL == rets)
+  {
+    TBSYS_LOG(ERROR, "invalid batch fetch parameter, file count: %d", file_count);
+    ret = EXIT_INVALID_ARGU;
+  }
+  else if (NULL == (tfs_session = get_session(ns_addr)))
+  {
+    TBSYS_LOG(ERROR, "can not get tfs session: %s.", NULL == ns_addr ? "default" : ns_addr);
+    ret = TFS_ERROR;
+  }
+  else
+  {
+    // group files by the dataserver to read from
+    std::map<uint64_t, std::vector<int32_t> > server_files;
+    for (int32_t i = 0; i < file_count; ++i)
+    {
+      rets[i] = TFS_ERROR;
+      FSName fsname(tfs_names[i], suffix, tfs_session->get_cluster_id());
+      uint32_t block_id = fsname.get_block_id();
+      VUINT64 ds_list;
+      if (!fsname.is_valid() || SMALL_TFS_FILE_TYPE != FSName::check_file_type(tfs_names[i])
+          || counts[i] < 0 || counts[i] > MAX_READ_SIZE)
+      {
+        TBSYS_LOG(ERROR, "invalid tfs name or buffer size, tfsname: %s, count: %"PRI64_PREFIX"d",
+                  tfs_names[i], counts[i]);
+        rets[i] = EXIT_INVALID_ARGU;
+      }
+      else if ((rets[i] = tfs_session->get_block_info(block_id, ds_list, T_READ)) != TFS_SUCCESS
+               || ds_list.empty())
+      {
+        TBSYS_LOG(ERROR, "get block info fail, tfsname: %s, blockid: %u, ret: %d", tfs_names[i], block_id, rets[i]);
+        rets[i] = TFS_SUCCESS == rets[i] ? EXIT_NO_DATASERVER : rets[i];
+      }
+      else
+      {
+        server_files[ds_list[fsname.get_file_id() % ds_list.size()]].push_back(i);
+      }
+    }
+
+    for (std::map<uint64_t, std::vector<int32_t> >::iterator it = server_files.begin();
+         it != server_files.end(); ++it)
+    {
+      std::vector<int32_t>& files = it->second;
+      size_t start = 0;
+      while (start < files.size())
+      {
+        // split into requests limited by file count and total size
+        BatchReadDataMessage brd_msg;
+        brd_msg.set_flag(READ_DATA_OPTION_FLAG_NORMAL);
+        int64_t total_len = 0;
+        size_t end = start;
+        for (; end < files.size() && end - start < static_cast<size_t>(MAX_BATCH_READ_COUNT); ++end)
+        {
+          int32_t index = files[end];
+          if (end > start && total_len + counts[index] + FILEINFO_SIZE > MAX_BATCH_READ_SIZE)
+          {
+            break;
+          }
+          FSName fsname(tfs_names[index], suffix, tfs_session->get_cluster_id());
+          ReadDataInfo read_info;
+          read_info.block_id_ = fsname.get_block_id();
+          read_info.file_id_ = fsname.get_file_id();
+          read_info.offset_ = 0;
+          read_info.length_ = static_cast<int32_t>(counts[index]);
+          brd_msg.add_read_info(read_info);
+          total_len += counts[index] + FILEINFO_SIZE;
+        }
+
+        tbnet::Packet* rsp = NULL;
+        NewClient* client = NewClientManager::get_instance().create_client();
+        int send_ret = NULL == client ? TFS_ERROR :
+          send_msg_to_server(it->first, client, &brd_msg, rsp, ClientConfig::wait_timeout_);
+        if (TFS_SUCCESS != send_ret || NULL == rsp)
+        {
+          TBSYS_LOG(ERROR, "batch read fail, server: %s, ret: %d",
+                    tbsys::CNetUtil::addrToString(it->first).c_str(), send_ret);
+          send_ret = TFS_SUCCESS == send_ret ? TFS_ERROR : send_ret;
+        }
+        else if (RESP_BATCH_READ_DATA_MESSAGE != rsp->getPCode())
+        {
+          send_ret = STATUS_MESSAGE == rsp->getPCode() ? dynamic_cast<StatusMessage*>(rsp)->get_status() : TFS_ERROR;
+          TBSYS_LOG(ERROR, "batch read fail, server: %s, pcode: %d, ret: %d",
+                    tbsys::CNetUtil::addrToString(it->first).c_str(), rsp->getPCode(), send_ret);
+          send_ret = TFS_SUCCESS == send_ret ? TFS_ERROR : send_ret;
+        }
+        else
+        {
+          RespBatchReadDataMessage* resp_brd_msg = dynamic_cast<RespBatchReadDataMessage*>(rsp);
+          if (resp_brd_msg->get_count() != static_cast<int32_t>(end - start))
+          {
+            TBSYS_LOG(ERROR, "batch read response count %d, request count %d",
+                      resp_brd_msg->get_count(), static_cast<int32_t>(end - start));
+            send_ret = TFS_ERROR;
+          }
+          for (int32_t i = 0; TFS_SUCCESS == send_ret && i < resp_brd_msg->get_count(); ++i)
+          {
+            int32_t index = files[start + i];
+            int32_t length = resp_brd_msg->get_length(i);
+            int32_t file_size = resp_brd_msg->get_file_size(i);
+            if (length < 0)
+            {
+              rets[index] = length;
+            }
+            else if (file_size > counts[index])
+            {
+              TBSYS_LOG(ERROR, "batch fetch, buffer too small, tfsname: %s, buffer: %"PRI64_PREFIX"d, file size: %d",
+                        tfs_names[index], counts[index], file_size);
+              counts[index] = file_size;
+              rets[index] = EXIT_BUFFER_TOO_SMALL_ERROR;
+            }
+            else
+            {
+              memcpy(bufs[index], resp_brd_msg->get_data(i), length);
+              counts[index] = length;
+              rets[index] = TFS_SUCCESS;
+            }
+          }
+        }
+
+        if (TFS_SUCCESS != send_ret)
+        {
+          for (size_t i = start; i < end; ++i)
+          {
+            rets[files[i]] = send_ret;
+            tfs_session->remove_block_cache(brd_msg.get_read_infos()[i - start].block_id_);
+          }
+        }
+        if (NULL != client)
+        {
+          NewClientManager::get_instance().destroy_client(client);
+        }
+        start = end;
+      }
+    }
+
+    for (int32_t i = 0; i < file_count; ++i)
+    {
+      if (TFS_SUCCESS != rets[i])
+      {
+        ret = TFS_ERROR;
+      }
+    }
+  }
+  return ret;
+}
+
 int TfsClientImpl::stat_file(const char* tfs_name, const char* suffix,
                              TfsFileStat* file_stat, const TfsStatType stat_type, const char* ns_addr)
 {
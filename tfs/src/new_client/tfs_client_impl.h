@@ -136,6 +136,8 @@ namespace tfs
                         const int32_t flag, const char* key);
       int fetch_file(const char* local_file, const char* tfs_name, const char* suffix, const char* ns_addr);
       int fetch_file(const char* tfs_name, const char* suffix, char*& buf, int64_t& count, const char* ns_addr);
+      int batch_fetch_file(const int32_t file_count, const char* const tfs_names[], const char* suffix,
+                           char* bufs[], int64_t counts[], int rets[], const char* ns_addr);
       int stat_file(const char* tfs_name, const char* suffix,
                     common::TfsFileStat* file_stat, const common::TfsStatType stat_type, const char* ns_addr);
 
@@ -74,11 +74,18 @@ int main(int argc, char* argv[])
     return ret;
   }
 
-  ret = BlockFileManager::get_instance()->clear_block_file_system(SYSPARAM_FILESYSPARAM);
-  if (ret)
+  vector<FileSystemParameter> disks;
+  SYSPARAM_FILESYSPARAM.get_disks(disks);
+  for (uint32_t i = 0; i < disks.size(); ++i)
   {
-    fprintf(stderr, "clear tfs file system fail. ret: %d, error: %d, desc: %s\n", ret, errno, strerror(errno));
-    return ret;
+    BlockFileManager manager;
+    ret = manager.clear_block_file_system(disks[i]);
+    if (ret)
+    {
+      fprintf(stderr, "clear tfs file system fail. mount name: %s, ret: %d, error: %d, desc: %s\n",
+          disks[i].mount_name_.c_str(), ret, errno, strerror(errno));
+      return ret;
+    }
   }
   return 0;
 }
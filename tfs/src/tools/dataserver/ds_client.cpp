@@ -41,6 +41,7 @@ enum CmdSet
 {
   CMD_GET_SERVER_STATUS,
   CMD_GET_PING_STATUS,
+  CMD_GET_INDEX_MAP_INFO,
   CMD_NEW_BLOCK,
   CMD_REMOVE_BlOCK,
   CMD_LIST_BLOCK,
@@ -190,6 +191,7 @@ int main(int argc, char* argv[])
 void init()
 {
   cmd_map["get_server_status"] = CMD_GET_SERVER_STATUS;
+  cmd_map["get_index_map_info"] = CMD_GET_INDEX_MAP_INFO;
   cmd_map["get_ping_status"] = CMD_GET_PING_STATUS;
   cmd_map["new_block"] = CMD_NEW_BLOCK;
   cmd_map["remove_block"] = CMD_REMOVE_BlOCK;
@@ -309,6 +311,17 @@ int switch_cmd(const int cmd, VSTRING & param)
       ret = DsLib::get_server_status(ds_task);
       break;
     }
+  case CMD_GET_INDEX_MAP_INFO:
+    {
+      if (param.size() != 0)
+      {
+        printf("Usage:get_index_map_info \n");
+        printf("get the memory taken by block indexes in dataserver.\n");
+        break;
+      }
+      ret = DsLib::get_index_map_info(ds_task);
+      break;
+    }
   case CMD_GET_PING_STATUS:
     {
       if (param.size() != 0)
@@ -619,6 +632,7 @@ int show_help(VSTRING &)
   printf("COMMAND SET:\n"
     "get_server_status            get the information of blocks that were visited most frequently in dataserver.\n"
     "get_ping_status              get the ping status of dataServer.\n"
+    "get_index_map_info           get the memory taken by block indexes in dataserver.\n"
     "list_block                   list all the blocks in a dataserver.\n"
     "get_block_info               get the information of a block in the dataserver.\n"
     "list_file                    list all the files in a block.\n"
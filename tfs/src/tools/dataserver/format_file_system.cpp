@@ -70,7 +70,8 @@ int main(int argc, char* argv[])
     return ret;
   }
   
-  cout << "mount name: " << SYSPARAM_FILESYSPARAM.mount_name_ << " max mount size: "
+  cout << "mount name: " << SYSPARAM_FILESYSPARAM.mount_name_ << " index path: "
+      << SYSPARAM_FILESYSPARAM.get_index_path() << " max mount size: "
       << SYSPARAM_FILESYSPARAM.max_mount_size_ << " base fs type: "
       << SYSPARAM_FILESYSPARAM.base_fs_type_ << " superblock reserve offset: "
       << SYSPARAM_FILESYSPARAM.super_block_reserve_offset_ << " main block size: "
@@ -81,11 +82,19 @@ int main(int argc, char* argv[])
       << SYSPARAM_FILESYSPARAM.avg_segment_size_ << " hash slot ratio: "
       << SYSPARAM_FILESYSPARAM.hash_slot_ratio_ << endl;
 
-  ret = BlockFileManager::get_instance()->format_block_file_system(SYSPARAM_FILESYSPARAM);
-  if (ret)
+  // every mount point is a disk with a file system of its own
+  vector<FileSystemParameter> disks;
+  SYSPARAM_FILESYSPARAM.get_disks(disks);
+  for (uint32_t i = 0; i < disks.size(); ++i)
   {
-    fprintf(stderr, "create tfs file system fail. ret: %d\n", ret);
-    return ret;
+    BlockFileManager manager;
+    ret = manager.format_block_file_system(disks[i]);
+    if (ret)
+    {
+      fprintf(stderr, "create tfs file system fail. mount name: %s, ret: %d\n", disks[i].mount_name_.c_str(), ret);
+      return ret;
+    }
+    cout << "create tfs file system success. mount name: " << disks[i].mount_name_ << endl;
   }
   return 0;
 }
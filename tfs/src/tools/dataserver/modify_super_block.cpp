@@ -74,6 +74,7 @@ int main(int argc, char* argv[])
   }
 
   cout << "mount name: " << SYSPARAM_FILESYSPARAM.mount_name_
+    << " index path: " << SYSPARAM_FILESYSPARAM.get_index_path()
     << " max mount size: " << SYSPARAM_FILESYSPARAM.max_mount_size_
     << " base fs type: " << SYSPARAM_FILESYSPARAM.base_fs_type_
     << " superblock reserve offset: " << SYSPARAM_FILESYSPARAM.super_block_reserve_offset_
@@ -85,21 +86,25 @@ int main(int argc, char* argv[])
     << " hash slot ratio: " << SYSPARAM_FILESYSPARAM.hash_slot_ratio_
     << endl;
 
-  SuperBlock super_block;
-  SuperBlockImpl* super_block_impl_ = new SuperBlockImpl(SYSPARAM_FILESYSPARAM.mount_name_
-      , SYSPARAM_FILESYSPARAM.super_block_reserve_offset_);
-  ret = super_block_impl_->read_super_blk(super_block);
-  if (ret)
-  {    
-    TBSYS_LOG(ERROR, "read super block error. ret: %d, desc: %s\n", ret, strerror(errno));
-    return ret;
-  }
-  super_block.mmap_option_.first_mmap_size_ = 122880;
-  ret = super_block_impl_->write_super_blk(super_block);
-  if (ret)
-  {    
-    TBSYS_LOG(ERROR, "write super block error. ret: %d, desc: %s\n", ret, strerror(errno));
-    return ret;
+  vector<FileSystemParameter> disks;
+  SYSPARAM_FILESYSPARAM.get_disks(disks);
+  for (uint32_t i = 0; i < disks.size(); ++i)
+  {
+    SuperBlock super_block;
+    SuperBlockImpl super_block_impl(disks[i].get_index_path(), disks[i].super_block_reserve_offset_);
+    ret = super_block_impl.read_super_blk(super_block);
+    if (ret)
+    {    
+      TBSYS_LOG(ERROR, "read super block error. ret: %d, desc: %s\n", ret, strerror(errno));
+      return ret;
+    }
+    super_block.mmap_option_.first_mmap_size_ = 122880;
+    ret = super_block_impl.write_super_blk(super_block);
+    if (ret)
+    {    
+      TBSYS_LOG(ERROR, "write super block error. ret: %d, desc: %s\n", ret, strerror(errno));
+      return ret;
+    }
   }
   return 0;
 }
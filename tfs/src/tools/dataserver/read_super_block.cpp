@@ -72,6 +72,7 @@ int main(int argc,char* argv[])
   }
 
   cout << "mount name: " << SYSPARAM_FILESYSPARAM.mount_name_
+    << " index path: " << SYSPARAM_FILESYSPARAM.get_index_path()
     << " max mount size: " << SYSPARAM_FILESYSPARAM.max_mount_size_
     << " base fs type: " << SYSPARAM_FILESYSPARAM.base_fs_type_
     << " superblock reserve offset: " << SYSPARAM_FILESYSPARAM.super_block_reserve_offset_
@@ -82,21 +83,28 @@ int main(int argc,char* argv[])
     << " hash slot ratio: " << SYSPARAM_FILESYSPARAM.hash_slot_ratio_
     << endl;
 
-  ret = BlockFileManager::get_instance()->load_super_blk(SYSPARAM_FILESYSPARAM);
-  if (ret)
-  {	
-    fprintf(stderr, "load tfs file system superblock fail. ret: %d\n",ret);
-    return ret;
-  }
+  vector<FileSystemParameter> disks;
+  SYSPARAM_FILESYSPARAM.get_disks(disks);
+  for (uint32_t i = 0; i < disks.size(); ++i)
+  {
+    BlockFileManager manager;
+    ret = manager.load_super_blk(disks[i]);
+    if (ret)
+    {	
+      fprintf(stderr, "load tfs file system superblock fail. mount name: %s, ret: %d\n",
+          disks[i].mount_name_.c_str(), ret);
+      return ret;
+    }
 
-  SuperBlock super_block;
-  ret = BlockFileManager::get_instance()->query_super_block(super_block);
-  if (ret)
-  {	
-    fprintf(stderr, "query superblock fail. ret: %d\n",ret);
-    return ret;
-  }
+    SuperBlock super_block;
+    ret = manager.query_super_block(super_block);
+    if (ret)
+    {	
+      fprintf(stderr, "query superblock fail. ret: %d\n",ret);
+      return ret;
+    }
 
-  super_block.display();
+    super_block.display();
+  }
   return 0;
 }
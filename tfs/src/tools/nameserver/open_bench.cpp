@@ -0,0 +1,386 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <vector>
+#include <algorithm>
+#include <tbsys.h>
+#include <Memory.hpp>
+#include "common/internal.h"
+#include "common/error_msg.h"
+#include "common/parameter.h"
+#include "nameserver/block_chunk.h"
+#include "nameserver/block_collect.h"
+#include "nameserver/server_collect.h"
+#include "nameserver/epoch.h"
+#include "nameserver/plan_queue.h"
+
+using namespace tfs::common;
+using namespace tfs::nameserver;
+
+// the block table of nameserver in process, no network: memory of a block with
+// its relations, a full scan of the table like build_plan does, and open with read
+// mode by the chunk read lock path before and the path with no lock now, QPS by threads.
+// -w keeps a writer changing the servers of blocks under the chunk write lock.
+// at last a server is lost: replicate candidates from the plan queue against a full scan.
+
+static const int32_t CHUNK_NUM = 32;
+static BlockChunkPtr gchunks[CHUNK_NUM];
+static std::vector<ServerCollect*> gservers;
+static volatile bool gstop = false;
+static int32_t gblock_count = 1000000;
+
+enum OpenMode
+{
+  OPEN_WITH_LOCK = 0,
+  OPEN_WITHOUT_LOCK = 1
+};
+
+struct BenchParam
+{
+  OpenMode mode_;
+  uint32_t seed_;
+  int64_t count_;
+  int64_t fail_count_;
+  char reserve_[64];// keep counters of threads in their own cache lines
+};
+
+static int open_with_lock(const uint32_t block_id, VUINT64& servers)
+{
+  BlockChunkPtr ptr = gchunks[block_id % CHUNK_NUM];
+  RWLock::Lock lock(*ptr, READ_LOCKER);
+  BlockCollect* block = ptr->find(block_id);
+  int32_t iret = NULL == block ? EXIT_BLOCK_NOT_FOUND : TFS_SUCCESS;
+  if (TFS_SUCCESS == iret)
+  {
+    ServerSlots& hold = block->get_hold();
+    ServerSlots::iterator iter = hold.begin();
+    for (; iter != hold.end(); ++iter)
+    {
+      servers.push_back((*iter)->id());
+    }
+    iret = servers.empty() ? EXIT_NO_DATASERVER : TFS_SUCCESS;
+  }
+  return iret;
+}
+
+static int open_without_lock(const uint32_t block_id, VUINT64& servers)
+{
+  return gchunks[block_id % CHUNK_NUM].get()->get_readable_servers(block_id, servers);
+}
+
+static void* reader(void* arg)
+{
+  BenchParam* param = reinterpret_cast<BenchParam*>(arg);
+  VUINT64 servers;
+  servers.reserve(8);
+  while (!gstop)
+  {
+    param->seed_ = param->seed_ * 1103515245 + 12345;
+    uint32_t block_id = (param->seed_ >> 8) % gblock_count + 1;
+    servers.clear();
+    int32_t iret = OPEN_WITH_LOCK == param->mode_ ? open_with_lock(block_id, servers)
+      : open_without_lock(block_id, servers);
+    if (TFS_SUCCESS == iret)
+      ++param->count_;
+    else
+      ++param->fail_count_;
+  }
+  return NULL;
+}
+
+static void* writer(void* arg)
+{
+  int64_t* count = reinterpret_cast<int64_t*>(arg);
+  uint32_t seed = 7;
+  time_t now = time(NULL);
+  while (!gstop)
+  {
+    seed = seed * 1103515245 + 12345;
+    uint32_t block_id = (seed >> 8) % gblock_count + 1;
+    ServerCollect* server = gservers[(seed >> 4) % gservers.size()];
+    BlockChunkPtr ptr = gchunks[block_id % CHUNK_NUM];
+    RWLock::Lock lock(*ptr, WRITE_LOCKER);
+    BlockCollect* block = ptr->find(block_id);
+    if (NULL != block)
+    {
+      bool writable = false;
+      if (block->exist(server))
+      {
+        block->remove(server, now, false);
+        server->remove(block);
+      }
+      else if (BlockChunk::connect(block, server, now, false, writable))
+      {
+        server->add(block, writable);
+      }
+      ++(*count);
+    }
+  }
+  return NULL;
+}
+
+static int64_t run(const OpenMode mode, const int32_t thread_count, const int32_t seconds,
+    const bool with_writer, int64_t& fail_count, int64_t& write_count)
+{
+  std::vector<BenchParam> params(thread_count);
+  std::vector<pthread_t> threads(thread_count);
+  gstop = false;
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    memset(&params[i], 0, sizeof(BenchParam));
+    params[i].mode_ = mode;
+    params[i].seed_ = i * 7919 + 1;
+    pthread_create(&threads[i], NULL, reader, &params[i]);
+  }
+  pthread_t writer_thread;
+  write_count = 0;
+  if (with_writer)
+  {
+    pthread_create(&writer_thread, NULL, writer, &write_count);
+  }
+  sleep(seconds);
+  gstop = true;
+  int64_t count = 0;
+  fail_count = 0;
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    pthread_join(threads[i], NULL);
+    count += params[i].count_;
+    fail_count += params[i].fail_count_;
+  }
+  if (with_writer)
+  {
+    pthread_join(writer_thread, NULL);
+  }
+  return count;
+}
+
+static int64_t get_resident_bytes()
+{
+  int64_t size = 0;
+  int64_t resident = 0;
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (NULL != file)
+  {
+    if (2 != fscanf(file, "%" PRI64_PREFIX "d %" PRI64_PREFIX "d", &size, &resident))
+      resident = 0;
+    fclose(file);
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// what build_plan looks at of every block, chunk by chunk under its read lock
+static int64_t scan(const time_t now, int64_t& selected)
+{
+  int64_t count = 0;
+  selected = 0;
+  for (int32_t i = 0; i < CHUNK_NUM; ++i)
+  {
+    RWLock::Lock lock(*gchunks[i], READ_LOCKER);
+    const BLOCK_MAP& blocks = gchunks[i]->get_blocks();
+    BLOCK_MAP::const_iterator iter = blocks.begin();
+    for (; iter != blocks.end(); ++iter, ++count)
+    {
+      BlockCollect* block = iter->second;
+      if (PLAN_PRIORITY_NONE != block->check_replicate(now)
+          || block->check_compact()
+          || block->check_redundant() > 0)
+      {
+        ++selected;
+      }
+    }
+  }
+  return count;
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [-b block_count] [-s server_count] [-r replicas] [-t max_thread_count] "
+      "[-d seconds] [-w] [-h]\n", name);
+  fprintf(stderr, "  -w  change the servers of blocks in a writer thread while reading\n");
+}
+
+int main(int argc, char* argv[])
+{
+  int32_t server_count = 100;
+  int32_t replicas = 3;
+  int32_t max_thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  int32_t seconds = 3;
+  bool with_writer = false;
+  int32_t index = 0;
+  while ((index = getopt(argc, argv, "b:s:r:t:d:wh")) != EOF)
+  {
+    switch (index)
+    {
+      case 'b':
+        gblock_count = atoi(optarg);
+        break;
+      case 's':
+        server_count = atoi(optarg);
+        break;
+      case 'r':
+        replicas = atoi(optarg);
+        break;
+      case 't':
+        max_thread_count = atoi(optarg);
+        break;
+      case 'd':
+        seconds = atoi(optarg);
+        break;
+      case 'w':
+        with_writer = true;
+        break;
+      case 'h':
+      default:
+        usage(argv[0]);
+        return TFS_ERROR;
+    }
+  }
+  if (gblock_count <= 0 || server_count <= 0 || replicas <= 0 || max_thread_count <= 0 || seconds <= 0)
+  {
+    usage(argv[0]);
+    return TFS_ERROR;
+  }
+  TBSYS_LOGGER.setLogLevel("error");
+  // blocks full, relations are built with no master and no writable
+  SYSPARAM_NAMESERVER.max_block_size_ = 1;
+  SYSPARAM_NAMESERVER.min_replication_ = replicas;
+  SYSPARAM_NAMESERVER.max_replication_ = replicas;
+
+  time_t now = time(NULL);
+  for (int32_t i = 0; i < CHUNK_NUM; ++i)
+  {
+    gchunks[i] = new BlockChunk(CHUNK_NUM);
+  }
+  for (int32_t i = 0; i < server_count; ++i)
+  {
+    DataServerStatInfo info;
+    memset(&info, 0, sizeof(info));
+    info.id_ = 0x100000000ULL * (i + 1) + 0x0100007f;
+    info.status_ = DATASERVER_STATUS_ALIVE;
+    gservers.push_back(new ServerCollect(info, now));
+  }
+  int64_t resident = get_resident_bytes();
+  int64_t start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 1; i <= gblock_count; ++i)
+  {
+    BlockCollect* block = gchunks[i % CHUNK_NUM]->add(i, now);
+    BlockInfo info;
+    memset(&info, 0, sizeof(info));
+    info.block_id_ = i;
+    info.size_ = 1;
+    block->update(info);
+    for (int32_t j = 0; j < replicas; ++j)
+    {
+      bool writable = false;
+      ServerCollect* server = gservers[(i + j) % server_count];
+      if (BlockChunk::connect(block, server, now, false, writable))
+      {
+        server->add(block, writable);
+      }
+    }
+  }
+  int64_t load_cost = tbsys::CTimeUtil::getTime() - start;
+  resident = get_resident_bytes() - resident;
+  fprintf(stdout, "blocks: %d, servers: %d, replicas: %d, load cost: %" PRI64_PREFIX "d(ms), "
+      "memory: %" PRI64_PREFIX "d(MB), %" PRI64_PREFIX "d bytes per block\n", gblock_count, server_count,
+      replicas, load_cost / 1000, resident >> 20, resident / gblock_count);
+
+  int64_t selected = 0;
+  int64_t scanned = 0;
+  const int32_t SCAN_ROUND = 5;
+  start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < SCAN_ROUND; ++i)
+  {
+    scanned += scan(now, selected);
+  }
+  int64_t scan_cost = tbsys::CTimeUtil::getTime() - start;
+  fprintf(stdout, "scan %" PRI64_PREFIX "d blocks: %" PRI64_PREFIX "d(ms) a round, %.1f ns per block, selected: %"
+      PRI64_PREFIX "d\n", scanned / SCAN_ROUND, scan_cost / SCAN_ROUND / 1000,
+      scanned > 0 ? scan_cost * 1000.0 / scanned : 0.0, selected);
+  fprintf(stdout, "%8s %16s %16s %10s %12s\n", "threads", "lock(qps)", "no lock(qps)", "speedup", "writes/s");
+
+  for (int32_t thread_count = 1; thread_count <= max_thread_count;
+      thread_count = thread_count >= max_thread_count ? max_thread_count + 1
+        : std::min(thread_count * 2, max_thread_count))
+  {
+    int64_t fail_count = 0;
+    int64_t write_count = 0;
+    int64_t lock_count = run(OPEN_WITH_LOCK, thread_count, seconds, with_writer, fail_count, write_count);
+    int64_t lock_fail = fail_count;
+    int64_t free_count = run(OPEN_WITHOUT_LOCK, thread_count, seconds, with_writer, fail_count, write_count);
+    fprintf(stdout, "%8d %16" PRI64_PREFIX "d %16" PRI64_PREFIX "d %9.2fx %12" PRI64_PREFIX "d\n",
+        thread_count, lock_count / seconds, free_count / seconds,
+        lock_count > 0 ? static_cast<double>(free_count) / lock_count : 0.0, write_count / seconds);
+    if (lock_fail + fail_count > 0)
+    {
+      fprintf(stdout, "%8s failed opens, lock: %" PRI64_PREFIX "d, no lock: %" PRI64_PREFIX "d\n",
+          "", lock_fail, fail_count);
+    }
+  }
+  fprintf(stdout, "retired objects not freed yet: %" PRI64_PREFIX "d\n", EpochManager::instance().get_retired_size());
+
+  // the blocks of a lost server are queued as their relations go
+  PlanQueue queue;
+  ServerCollect* lost = gservers[0];
+  for (int32_t i = 0; i < CHUNK_NUM; ++i)
+  {
+    RWLock::Lock lock(*gchunks[i], WRITE_LOCKER);
+    const BLOCK_MAP& blocks = gchunks[i]->get_blocks();
+    BLOCK_MAP::const_iterator iter = blocks.begin();
+    for (; iter != blocks.end(); ++iter)
+    {
+      if (iter->second->exist(lost))
+      {
+        iter->second->remove(lost, now);
+        lost->remove(iter->second);
+        queue.push(iter->second, now);
+      }
+    }
+  }
+  const time_t later = now + SYSPARAM_NAMESERVER.replicate_wait_time_;
+  start = tbsys::CTimeUtil::getTime();
+  std::vector<uint32_t> queued;
+  queue.get(PlanQueue::PLAN_QUEUE_REPLICATE, queued);
+  int64_t found = 0;
+  std::vector<uint32_t>::const_iterator q_iter = queued.begin();
+  for (; q_iter != queued.end(); ++q_iter)
+  {
+    BlockChunkPtr ptr = gchunks[(*q_iter) % CHUNK_NUM];
+    RWLock::Lock lock(*ptr, READ_LOCKER);
+    BlockCollect* block = ptr->find((*q_iter));
+    if (NULL != block && PLAN_PRIORITY_NONE != block->check_replicate(later))
+    {
+      ++found;
+    }
+  }
+  int64_t queue_cost = tbsys::CTimeUtil::getTime() - start;
+  start = tbsys::CTimeUtil::getTime();
+  scan(later, selected);
+  scan_cost = tbsys::CTimeUtil::getTime() - start;
+  fprintf(stdout, "server lost, replicate candidates: %" PRI64_PREFIX "d, from queue: %" PRI64_PREFIX "d(us), "
+      "full scan: %" PRI64_PREFIX "d(us), selected: %" PRI64_PREFIX "d\n", found, queue_cost, scan_cost, selected);
+
+  for (int32_t i = 0; i < CHUNK_NUM; ++i)
+  {
+    gchunks[i] = 0;
+  }
+  std::vector<ServerCollect*>::iterator iter = gservers.begin();
+  for (; iter != gservers.end(); ++iter)
+  {
+    tbsys::gDelete((*iter));
+  }
+  return TFS_SUCCESS;
+}
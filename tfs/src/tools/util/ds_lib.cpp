@@ -95,6 +95,39 @@ namespace tfs
       return ret_status;
     }
 
+    int DsLib::get_index_map_info(DsTask& ds_task)
+    {
+      uint64_t server_id = ds_task.server_id_;
+      int ret_status = TFS_ERROR;
+
+      GetServerStatusMessage req_gss_msg;
+      req_gss_msg.set_status_type(GSS_INDEX_MAP_INFO);
+
+      NewClient* client = NewClientManager::get_instance().create_client();
+      tbnet::Packet* ret_msg = NULL;
+      if (TFS_SUCCESS == send_msg_to_server(server_id, client, &req_gss_msg, ret_msg))
+      {
+        if (ret_msg->getPCode() != STATUS_MESSAGE
+            || STATUS_MESSAGE_OK != dynamic_cast<StatusMessage*> (ret_msg)->get_status())
+        {
+          fprintf(stderr, "Can't get index map info from dataserver.\n");
+          ret_status = TFS_ERROR;
+        }
+        else
+        {
+          printf("%s\n", dynamic_cast<StatusMessage*> (ret_msg)->get_error());
+          ret_status = TFS_SUCCESS;
+        }
+      }
+      else
+      {
+        fprintf(stderr, "Get server status message send failure.\n");
+        ret_status = TFS_ERROR;
+      }
+      NewClientManager::get_instance().destroy_client(client);
+      return ret_status;
+    }
+
     int DsLib::get_ping_status(DsTask& ds_task)
     {
       uint64_t server_id = ds_task.server_id_;
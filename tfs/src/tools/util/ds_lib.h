@@ -39,6 +39,7 @@ namespace tfs
 
       static int get_server_status(common::DsTask& ds_task);
       static int get_ping_status(common::DsTask& ds_task);
+      static int get_index_map_info(common::DsTask& ds_task);
       static int new_block(common::DsTask& ds_task);
       static int remove_block(common::DsTask& ds_task);
       static int list_block(common::DsTask& list_block_task);
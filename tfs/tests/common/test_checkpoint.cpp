@@ -0,0 +1,227 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "common/internal.h"
+#include "common/error_msg.h"
+#include "common/stream.h"
+#include "nameserver/checkpoint.h"
+
+using namespace tfs::common;
+using namespace tfs::nameserver;
+
+static const char* CHECKPOINT_PATH = "./test_checkpoint.dat";
+static const int32_t SERVER_COUNT = 3;
+static const int32_t BLOCK_COUNT = 100;
+// magic, version, oplog seqno and offset, time, server and block count, crc
+static const int32_t HEADER_LENGTH = 36;
+
+class CheckpointTest: public ::testing::Test
+{
+  public:
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      unlink(CHECKPOINT_PATH);
+      // as LayoutManager::snapshot: the servers, then the blocks with the servers hold them
+      for (int32_t i = 0; i < SERVER_COUNT; ++i)
+      {
+        body_.set_int64(server_id(i));
+        body_.set_int64(1024 * i);
+        body_.set_int64(0xFFFFFFFFFFLL);
+        body_.set_int32(i);
+        body_.set_int32(BLOCK_COUNT);
+      }
+      for (int32_t id = 1; id <= BLOCK_COUNT; ++id)
+      {
+        BlockInfo info;
+        memset(&info, 0, sizeof(info));
+        info.block_id_ = id;
+        info.version_ = id;
+        info.size_ = id * 1024;
+        body_.set_bytes(&info, sizeof(info));
+        body_.set_int32(SERVER_COUNT);
+        for (int32_t i = 0; i < SERVER_COUNT; ++i)
+        {
+          body_.set_int64(server_id(i));
+        }
+      }
+    }
+    virtual void TearDown()
+    {
+      unlink(CHECKPOINT_PATH);
+    }
+
+    static uint64_t server_id(const int32_t i)
+    {
+      return 0x0100000AULL | (static_cast<uint64_t>(3200 + i) << 32);
+    }
+
+    static OpLogRotateHeader make_pos(const int32_t seqno, const int32_t offset)
+    {
+      OpLogRotateHeader pos;
+      memset(&pos, 0, sizeof(pos));
+      pos.rotate_seqno_ = seqno;
+      pos.rotate_offset_ = offset;
+      return pos;
+    }
+
+    static int64_t file_size()
+    {
+      struct stat st;
+      return 0 == stat(CHECKPOINT_PATH, &st) ? st.st_size : -1;
+    }
+
+    // overwrites the checkpoint file at offset with length bytes of data
+    static void patch_file(const int64_t offset, const void* data, const int32_t length)
+    {
+      int fd = open(CHECKPOINT_PATH, O_WRONLY);
+      ASSERT_GE(fd, 0);
+      EXPECT_EQ(length, pwrite(fd, data, length, offset));
+      close(fd);
+    }
+
+    int save(const OpLogRotateHeader& pos)
+    {
+      return Checkpoint::write_file(CHECKPOINT_PATH, pos, SERVER_COUNT, BLOCK_COUNT, body_);
+    }
+
+    static int load(OpLogRotateHeader& pos)
+    {
+      int32_t server_count = 0;
+      int32_t block_count = 0;
+      Stream input;
+      return Checkpoint::read_file(CHECKPOINT_PATH, pos, server_count, block_count, input);
+    }
+
+  protected:
+    Stream body_;
+};
+
+TEST_F(CheckpointTest, testRoundTrip)
+{
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 123456)));
+  EXPECT_EQ(HEADER_LENGTH + body_.get_data_length(), file_size());
+
+  OpLogRotateHeader pos = make_pos(0, 0);
+  int32_t server_count = 0;
+  int32_t block_count = 0;
+  Stream input;
+  ASSERT_EQ(TFS_SUCCESS, Checkpoint::read_file(CHECKPOINT_PATH, pos, server_count, block_count, input));
+  EXPECT_EQ(7, pos.rotate_seqno_);
+  EXPECT_EQ(123456, pos.rotate_offset_);
+  EXPECT_EQ(SERVER_COUNT, server_count);
+  EXPECT_EQ(BLOCK_COUNT, block_count);
+  ASSERT_EQ(body_.get_data_length(), input.get_data_length());
+  EXPECT_EQ(0, memcmp(body_.get_data(), input.get_data(), body_.get_data_length()));
+
+  // the body reads back as it is written
+  int64_t id = 0;
+  EXPECT_EQ(TFS_SUCCESS, input.get_int64(&id));
+  EXPECT_EQ(server_id(0), static_cast<uint64_t>(id));
+}
+
+TEST_F(CheckpointTest, testEmpty)
+{
+  Stream empty;
+  ASSERT_EQ(TFS_SUCCESS, Checkpoint::write_file(CHECKPOINT_PATH, make_pos(1, 0), 0, 0, empty));
+  EXPECT_EQ(HEADER_LENGTH, file_size());
+
+  OpLogRotateHeader pos = make_pos(0, 0);
+  int32_t server_count = -1;
+  int32_t block_count = -1;
+  Stream input;
+  EXPECT_EQ(TFS_SUCCESS, Checkpoint::read_file(CHECKPOINT_PATH, pos, server_count, block_count, input));
+  EXPECT_EQ(1, pos.rotate_seqno_);
+  EXPECT_EQ(0, server_count);
+  EXPECT_EQ(0, block_count);
+  EXPECT_EQ(0, input.get_data_length());
+}
+
+TEST_F(CheckpointTest, testNoFile)
+{
+  OpLogRotateHeader pos = make_pos(0, 0);
+  EXPECT_EQ(EXIT_GENERAL_ERROR, load(pos));
+}
+
+TEST_F(CheckpointTest, testBadMagic)
+{
+  OpLogRotateHeader pos = make_pos(0, 0);
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 0)));
+  int32_t magic = 0x12345678;
+  patch_file(0, &magic, sizeof(magic));
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 0)));
+  int32_t version = Checkpoint::CHECKPOINT_VERSION + 1;
+  patch_file(sizeof(int32_t), &version, sizeof(version));
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+}
+
+TEST_F(CheckpointTest, testCrcMismatch)
+{
+  OpLogRotateHeader pos = make_pos(0, 0);
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 0)));
+  // a byte of the body changed
+  int64_t offset = HEADER_LENGTH + body_.get_data_length() / 2;
+  char data = ~body_.get_data()[body_.get_data_length() / 2];
+  patch_file(offset, &data, 1);
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+
+  // the crc itself changed
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 0)));
+  uint32_t crc = 0;
+  patch_file(HEADER_LENGTH - sizeof(crc), &crc, sizeof(crc));
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+}
+
+TEST_F(CheckpointTest, testTruncated)
+{
+  OpLogRotateHeader pos = make_pos(0, 0);
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 0)));
+
+  // in the body, the crc does not match
+  ASSERT_EQ(0, truncate(CHECKPOINT_PATH, file_size() - 1));
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+  ASSERT_EQ(0, truncate(CHECKPOINT_PATH, HEADER_LENGTH));
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, load(pos));
+
+  // in the header
+  ASSERT_EQ(0, truncate(CHECKPOINT_PATH, HEADER_LENGTH - 1));
+  EXPECT_NE(TFS_SUCCESS, load(pos));
+  ASSERT_EQ(0, truncate(CHECKPOINT_PATH, 0));
+  EXPECT_NE(TFS_SUCCESS, load(pos));
+}
+
+TEST_F(CheckpointTest, testReplace)
+{
+  // a later checkpoint replaces the last one, and leaves no temporary file
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(7, 100)));
+  ASSERT_EQ(TFS_SUCCESS, save(make_pos(8, 200)));
+  EXPECT_NE(0, access((std::string(CHECKPOINT_PATH) + ".tmp").c_str(), F_OK));
+  OpLogRotateHeader pos = make_pos(0, 0);
+  EXPECT_EQ(TFS_SUCCESS, load(pos));
+  EXPECT_EQ(8, pos.rotate_seqno_);
+  EXPECT_EQ(200, pos.rotate_offset_);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include <tbtimeutil.h>
+#include "common/func.h"
+
+using namespace tfs::common;
+
+// the byte at a time crc the stored FileInfo crcs were made with
+static uint32_t reference_crc(uint32_t crc, const char* data, const int32_t len)
+{
+  for (int32_t i = 0; i < len; ++i)
+  {
+    uint32_t c = (crc ^ static_cast<unsigned char>(data[i])) & 0xff;
+    for (int32_t k = 0; k < 8; ++k)
+    {
+      c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+    }
+    crc = (crc >> 8) ^ c;
+  }
+  return crc;
+}
+
+class CrcTest: public ::testing::Test
+{
+  public:
+    CrcTest()
+    {
+    }
+    ~CrcTest()
+    {
+    }
+    virtual void SetUp()
+    {
+      srand(1234);
+      for (int32_t i = 0; i < BUF_LEN; ++i)
+      {
+        buf_[i] = static_cast<char>(rand());
+      }
+    }
+    virtual void TearDown()
+    {
+    }
+  protected:
+    static const int32_t BUF_LEN = 1024 * 1024;
+    char buf_[BUF_LEN + 64];
+};
+
+TEST_F(CrcTest, testCompatible)
+{
+  EXPECT_EQ(0U, Func::crc(0, buf_, 0));
+  EXPECT_EQ(0x1234U, Func::crc(0x1234, buf_, 0));
+  // the check value of crc32 is 0xcbf43926, with pre and post inversion
+  EXPECT_EQ(0xcbf43926U, ~Func::crc(0xffffffff, "123456789", 9));
+
+  // every alignment and the lengths around the 8, 16 and 64 byte steps
+  for (int32_t offset = 0; offset < 16; ++offset)
+  {
+    for (int32_t len = 0; len < 300; ++len)
+    {
+      ASSERT_EQ(reference_crc(offset, buf_ + offset, len), Func::crc(offset, buf_ + offset, len))
+        << "offset: " << offset << ", len: " << len;
+    }
+  }
+  const int32_t lens[] = { 4095, 4096, 65537, BUF_LEN };
+  for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i)
+  {
+    EXPECT_EQ(reference_crc(0, buf_ + 3, lens[i]), Func::crc(0, buf_ + 3, lens[i]));
+  }
+
+  // continued in pieces as DataFile::get_crc does
+  uint32_t crc = 0;
+  for (int32_t offset = 0; offset < BUF_LEN; offset += 1000)
+  {
+    crc = Func::crc(crc, buf_ + offset, std::min(1000, BUF_LEN - offset));
+  }
+  EXPECT_EQ(reference_crc(0, buf_, BUF_LEN), crc);
+}
+
+TEST_F(CrcTest, testCombine)
+{
+  const int32_t splits[] = { 0, 1, 7, 64, 1000, 65536, BUF_LEN - 1, BUF_LEN };
+  uint32_t whole = Func::crc(0, buf_, BUF_LEN);
+  for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); ++i)
+  {
+    int32_t len1 = splits[i];
+    uint32_t crc1 = Func::crc(0, buf_, len1);
+    uint32_t crc2 = Func::crc(0, buf_ + len1, BUF_LEN - len1);
+    EXPECT_EQ(whole, Func::crc_combine(crc1, crc2, BUF_LEN - len1)) << "split: " << len1;
+  }
+
+  // segments of a large file merged in order
+  uint32_t crc = 0;
+  for (int32_t offset = 0; offset < BUF_LEN; offset += 300000)
+  {
+    int32_t len = std::min(300000, BUF_LEN - offset);
+    crc = Func::crc_combine(crc, Func::crc(0, buf_ + offset, len), len);
+  }
+  EXPECT_EQ(whole, crc);
+}
+
+TEST_F(CrcTest, testBenchmark)
+{
+  const int32_t rounds = 256;
+  uint32_t crc = 0;
+  int64_t start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < rounds / 16; ++i)
+  {
+    crc = reference_crc(crc, buf_, BUF_LEN);
+  }
+  int64_t bytewise = tbsys::CTimeUtil::getTime() - start;
+
+  uint32_t fast = 0;
+  start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < rounds; ++i)
+  {
+    fast = Func::crc(fast, buf_, BUF_LEN);
+  }
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  printf("crc MB/s bit wise reference: %" PRI64_PREFIX "d, Func::crc: %" PRI64_PREFIX "d\n",
+      bytewise > 0 ? static_cast<int64_t>(rounds / 16) * 1000000 / bytewise : 0,
+      cost > 0 ? static_cast<int64_t>(rounds) * 1000000 / cost : 0);
+  EXPECT_NE(0U, crc + fast);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,273 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <tbsys.h>
+#include "common/stream.h"
+#include "common/error_msg.h"
+#include "message/read_data_message.h"
+#include "logic_block.h"
+#include "physical_block.h"
+
+using namespace tfs::message;
+using namespace tfs::common;
+using namespace tfs::dataserver;
+
+static const char* MOUNT_PATH = "./batch_read_mount";
+static const int32_t BLOCK_LENGTH = 4 * 1024 * 1024;
+static const uint32_t BLOCK_ID = 100;
+
+class BatchReadMessageTest: public ::testing::Test
+{
+  public:
+    BatchReadMessageTest()
+    {
+    }
+    ~BatchReadMessageTest()
+    {
+    }
+    virtual void SetUp()
+    {
+    }
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(BatchReadMessageTest, testRequest)
+{
+  BatchReadDataMessage msg;
+  msg.set_flag(READ_DATA_OPTION_FLAG_FORCE);
+  for (int32_t i = 0; i < 3; ++i)
+  {
+    ReadDataInfo read_info;
+    read_info.block_id_ = 100 + i;
+    read_info.file_id_ = 1000 + i;
+    read_info.offset_ = i;
+    read_info.length_ = 4096 * (i + 1);
+    msg.add_read_info(read_info);
+  }
+
+  Stream stream(msg.length());
+  ASSERT_EQ(TFS_SUCCESS, msg.serialize(stream));
+  EXPECT_EQ(msg.length(), stream.get_data_length());
+
+  BatchReadDataMessage other;
+  ASSERT_EQ(TFS_SUCCESS, other.deserialize(stream));
+  EXPECT_EQ(0, stream.get_data_length());
+  EXPECT_EQ(READ_DATA_OPTION_FLAG_FORCE, other.get_flag());
+  ASSERT_EQ(3U, other.get_read_infos().size());
+  EXPECT_EQ(102U, other.get_read_infos()[2].block_id_);
+  EXPECT_EQ(1002U, other.get_read_infos()[2].file_id_);
+  EXPECT_EQ(2, other.get_read_infos()[2].offset_);
+  EXPECT_EQ(4096 * 3, other.get_read_infos()[2].length_);
+}
+
+TEST_F(BatchReadMessageTest, testTooManyFiles)
+{
+  Stream stream(64);
+  stream.set_int32(MAX_BATCH_READ_COUNT + 1);
+  BatchReadDataMessage msg;
+  EXPECT_NE(TFS_SUCCESS, msg.deserialize(stream));
+}
+
+TEST_F(BatchReadMessageTest, testResponse)
+{
+  RespBatchReadDataMessage msg;
+  char* data = msg.alloc_data(10);
+  ASSERT_TRUE(NULL != data);
+  memcpy(data, "abcdefghij", 10);
+  msg.add_data(4, data, 4);
+  msg.add_data(EXIT_META_NOT_FOUND_ERROR, NULL);
+  msg.add_data(0, data + 4);
+  msg.add_data(6, data + 4, 100);
+
+  Stream stream(msg.length());
+  ASSERT_EQ(TFS_SUCCESS, msg.serialize(stream));
+  EXPECT_EQ(msg.length(), stream.get_data_length());
+
+  RespBatchReadDataMessage other;
+  ASSERT_EQ(TFS_SUCCESS, other.deserialize(stream));
+  ASSERT_EQ(4, other.get_count());
+  EXPECT_EQ(4, other.get_length(0));
+  EXPECT_EQ(4, other.get_file_size(0));
+  EXPECT_EQ(0, memcmp("abcd", other.get_data(0), 4));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, other.get_length(1));
+  EXPECT_EQ(0, other.get_length(2));
+  EXPECT_EQ(6, other.get_length(3));
+  // the buffer of the reader holds 6 bytes of the 100
+  EXPECT_EQ(100, other.get_file_size(3));
+  EXPECT_EQ(0, memcmp("efghij", other.get_data(3), 6));
+
+  // truncated packet
+  Stream short_stream(msg.length());
+  ASSERT_EQ(TFS_SUCCESS, msg.serialize(short_stream));
+  Stream broken(msg.length());
+  broken.set_bytes(short_stream.get_data(), msg.length() - 1);
+  RespBatchReadDataMessage bad;
+  EXPECT_NE(TFS_SUCCESS, bad.deserialize(broken));
+}
+
+class BatchReadBlockTest: public ::testing::Test
+{
+  public:
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      int fd = open(path, O_RDWR | O_CREAT, 0644);
+      EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+      close(fd);
+
+      physical_ = new PhysicalBlock(BLOCK_ID, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+      block_ = new LogicBlock(BLOCK_ID, BLOCK_ID, MOUNT_PATH);
+      block_->add_physic_block(physical_);
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = 64 * 1024;
+      op.per_mmap_size_ = 64 * 1024;
+      ASSERT_EQ(TFS_SUCCESS, block_->init_block_file(64, op, C_MAIN_BLOCK));
+      memset(&info_, 0, sizeof(info_));
+      info_.block_id_ = BLOCK_ID;
+    }
+    virtual void TearDown()
+    {
+      delete block_;
+      delete physical_;
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      unlink(path);
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), BLOCK_ID);
+      unlink(path);
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+    }
+
+    // appends a file of size bytes, each byte its id
+    void add_file(const uint64_t id, const int32_t size, const int32_t flag)
+    {
+      FileInfo finfo;
+      memset(&finfo, 0, sizeof(finfo));
+      finfo.id_ = id;
+      finfo.offset_ = block_->get_data_file_size();
+      finfo.size_ = size + sizeof(FileInfo);
+      finfo.flag_ = flag;
+      std::vector<char> buf(finfo.size_, static_cast<char>(id));
+      memcpy(&buf[0], &finfo, sizeof(FileInfo));
+      EXPECT_EQ(TFS_SUCCESS, block_->write_raw_data(&buf[0], finfo.size_, finfo.offset_));
+      metas_.push_back(RawMeta(id, finfo.offset_, finfo.size_));
+      info_.file_count_++;
+      info_.size_ += finfo.size_;
+      if (flag & FI_DELETED)
+      {
+        info_.del_file_count_++;
+        info_.del_size_ += finfo.size_;
+      }
+    }
+
+    // as DataService::batch_read_data, a read from the start takes the FileInfo too
+    static void make_item(BatchReadItem& item, const uint64_t id, const int32_t offset, const int32_t length,
+        std::vector<char>& buf)
+    {
+      item.inner_file_id_ = id;
+      item.offset_ = 0 == offset ? 0 : offset + sizeof(FileInfo);
+      item.nbytes_ = 0 == offset ? length + sizeof(FileInfo) : length;
+      item.data_offset_ = 0;
+      item.ret_ = TFS_ERROR;
+      buf.assign(item.nbytes_, 0);
+      item.buf_ = &buf[0];
+    }
+
+  protected:
+    PhysicalBlock* physical_;
+    LogicBlock* block_;
+    BlockInfo info_;
+    RawMetaVec metas_;
+};
+
+TEST_F(BatchReadBlockTest, testBatchReadFile)
+{
+  add_file(1, 1000, 0);
+  add_file(2, 2000, 0);
+  add_file(3, 3000, FI_DELETED);
+  add_file(4, 4000, 0);
+  add_file(5, 500, FI_CONCEAL);
+  ASSERT_EQ(TFS_SUCCESS, block_->batch_write_meta(&info_, &metas_));
+
+  const int32_t COUNT = 7;
+  BatchReadItem items[COUNT];
+  std::vector<char> bufs[COUNT];
+  // asked in the reverse order of the disk
+  make_item(items[0], 4, 0, 4000, bufs[0]);
+  make_item(items[1], 2, 0, 2000, bufs[1]);
+  // not there
+  make_item(items[2], 9, 0, 100, bufs[2]);
+  // buffer too small, the head of the file is read and FileInfo tells its size
+  make_item(items[3], 1, 0, 300, bufs[3]);
+  // deleted
+  make_item(items[4], 3, 0, 3000, bufs[4]);
+  // from the middle of a file, past its end is cut
+  make_item(items[5], 2, 1500, 1000, bufs[5]);
+  // past the end of a file
+  make_item(items[6], 1, 2000, 10, bufs[6]);
+  std::vector<BatchReadItem*> reads;
+  for (int32_t i = 0; i < COUNT; ++i)
+  {
+    reads.push_back(&items[i]);
+  }
+  block_->batch_read_file(reads, READ_DATA_OPTION_FLAG_NORMAL);
+
+  EXPECT_EQ(TFS_SUCCESS, items[0].ret_);
+  EXPECT_EQ(static_cast<int32_t>(4000 + sizeof(FileInfo)), items[0].nbytes_);
+  EXPECT_EQ(4U, reinterpret_cast<FileInfo*>(items[0].buf_)->id_);
+  EXPECT_EQ(std::string(4000, 4), std::string(items[0].buf_ + sizeof(FileInfo), 4000));
+  EXPECT_EQ(TFS_SUCCESS, items[1].ret_);
+  EXPECT_EQ(std::string(2000, 2), std::string(items[1].buf_ + sizeof(FileInfo), 2000));
+
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, items[2].ret_);
+
+  EXPECT_EQ(TFS_SUCCESS, items[3].ret_);
+  EXPECT_EQ(static_cast<int32_t>(300 + sizeof(FileInfo)), items[3].nbytes_);
+  EXPECT_EQ(static_cast<int32_t>(1000 + sizeof(FileInfo)), reinterpret_cast<FileInfo*>(items[3].buf_)->size_);
+  EXPECT_EQ(std::string(300, 1), std::string(items[3].buf_ + sizeof(FileInfo), 300));
+
+  EXPECT_EQ(EXIT_FILE_INFO_ERROR, items[4].ret_);
+  // a concealed file is read with force only
+  std::vector<char> buf;
+  BatchReadItem item;
+  make_item(item, 5, 0, 500, buf);
+  std::vector<BatchReadItem*> concealed(1, &item);
+  block_->batch_read_file(concealed, READ_DATA_OPTION_FLAG_NORMAL);
+  EXPECT_EQ(EXIT_FILE_INFO_ERROR, item.ret_);
+  make_item(item, 5, 0, 500, buf);
+  block_->batch_read_file(concealed, READ_DATA_OPTION_FLAG_FORCE);
+  EXPECT_EQ(TFS_SUCCESS, item.ret_);
+
+  EXPECT_EQ(TFS_SUCCESS, items[5].ret_);
+  EXPECT_EQ(500, items[5].nbytes_);
+  EXPECT_EQ(std::string(500, 2), std::string(items[5].buf_, 500));
+
+  EXPECT_EQ(EXIT_READ_OFFSET_ERROR, items[6].ret_);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include "block_reporter.h"
+#include "message/heart_message.h"
+#include "common/stream.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+using namespace tfs::message;
+
+class BlockReporterTest: public ::testing::Test
+{
+  public:
+    BlockReporterTest()
+    {
+    }
+    ~BlockReporterTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      for (uint32_t i = 1; i <= 5; ++i)
+      {
+        blocks_.push_back(make_block(i, 1));
+      }
+    }
+    virtual void TearDown()
+    {
+    }
+
+    static BlockInfo make_block(const uint32_t block_id, const int32_t version)
+    {
+      BlockInfo info;
+      memset(&info, 0, sizeof(info));
+      info.block_id_ = block_id;
+      info.version_ = version;
+      info.file_count_ = version;
+      info.size_ = version * 1024;
+      return info;
+    }
+
+  protected:
+    std::vector<BlockInfo> blocks_;
+};
+
+TEST_F(BlockReporterTest, testDeltaReport)
+{
+  BlockReporter reporter;
+  SetDataserverMessage msg;
+  reporter.build_report(0, blocks_, msg);
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, msg.get_has_block());
+  EXPECT_EQ(5U, msg.get_blocks().size());
+  int64_t seq = msg.get_report_seq();
+  EXPECT_GT(seq, 0);
+  reporter.on_response(0, seq, seq);
+
+  // block 2 written, 4 removed, 6 added
+  blocks_[1] = make_block(2, 2);
+  blocks_.erase(blocks_.begin() + 3);
+  blocks_.push_back(make_block(6, 1));
+  SetDataserverMessage delta;
+  reporter.build_report(0, blocks_, delta);
+  EXPECT_EQ(HAS_BLOCK_FLAG_DELTA, delta.get_has_block());
+  EXPECT_EQ(seq, delta.get_base_seq());
+  EXPECT_GT(delta.get_report_seq(), seq);
+  ASSERT_EQ(2U, delta.get_blocks().size());
+  EXPECT_EQ(2U, delta.get_blocks()[0].block_id_);
+  EXPECT_EQ(2, delta.get_blocks()[0].version_);
+  EXPECT_EQ(6U, delta.get_blocks()[1].block_id_);
+  ASSERT_EQ(1U, delta.get_removed_blocks().size());
+  EXPECT_EQ(4U, delta.get_removed_blocks()[0]);
+
+  // the other nameserver has no report of us
+  SetDataserverMessage other;
+  reporter.build_report(1, blocks_, other);
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, other.get_has_block());
+  EXPECT_EQ(5U, other.get_blocks().size());
+
+  // delta acked, nothing changed since
+  reporter.on_response(0, delta.get_report_seq(), delta.get_report_seq());
+  SetDataserverMessage empty;
+  reporter.build_report(0, blocks_, empty);
+  EXPECT_EQ(HAS_BLOCK_FLAG_DELTA, empty.get_has_block());
+  EXPECT_EQ(delta.get_report_seq(), empty.get_base_seq());
+  EXPECT_EQ(0U, empty.get_blocks().size());
+  EXPECT_EQ(0U, empty.get_removed_blocks().size());
+
+  BlockReportStat stat;
+  reporter.get_stat(stat);
+  EXPECT_EQ(2, stat.full_count_);
+  EXPECT_EQ(10, stat.full_block_count_);
+  EXPECT_EQ(2, stat.delta_count_);
+  EXPECT_EQ(3, stat.delta_block_count_);
+}
+
+TEST_F(BlockReporterTest, testFullReportFallback)
+{
+  BlockReporter reporter;
+  SetDataserverMessage msg;
+  reporter.build_report(0, blocks_, msg);
+  int64_t seq = msg.get_report_seq();
+  // report not applied (nameserver restarted, or an old one)
+  reporter.on_response(0, seq, 0);
+  SetDataserverMessage again;
+  reporter.build_report(0, blocks_, again);
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, again.get_has_block());
+  reporter.on_response(0, again.get_report_seq(), again.get_report_seq());
+
+  // nameserver holds a report we do not know
+  reporter.on_response(0, 0, again.get_report_seq() - 1);
+  SetDataserverMessage unknown;
+  reporter.build_report(0, blocks_, unknown);
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, unknown.get_has_block());
+  reporter.on_response(0, unknown.get_report_seq(), unknown.get_report_seq());
+
+  // forced
+  reporter.reset(0);
+  SetDataserverMessage forced;
+  reporter.build_report(0, blocks_, forced);
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, forced.get_has_block());
+  EXPECT_EQ(5U, forced.get_blocks().size());
+}
+
+TEST_F(BlockReporterTest, testMessage)
+{
+  DataServerStatInfo ds;
+  memset(&ds, 0, sizeof(ds));
+  ds.id_ = 12345;
+  SetDataserverMessage msg;
+  msg.set_ds(&ds);
+  msg.set_has_block(HAS_BLOCK_FLAG_DELTA);
+  msg.set_report_seq(100, 99);
+  msg.add_block(&blocks_[0]);
+  msg.add_removed_block(7);
+  msg.add_removed_block(8);
+
+  Stream stream(msg.length());
+  ASSERT_EQ(TFS_SUCCESS, msg.serialize(stream));
+  EXPECT_EQ(msg.length(), stream.get_data_length());
+  SetDataserverMessage other;
+  ASSERT_EQ(TFS_SUCCESS, other.deserialize(stream));
+  EXPECT_EQ(0, stream.get_data_length());
+  EXPECT_EQ(HAS_BLOCK_FLAG_DELTA, other.get_has_block());
+  EXPECT_EQ(100, other.get_report_seq());
+  EXPECT_EQ(99, other.get_base_seq());
+  ASSERT_EQ(1U, other.get_blocks().size());
+  EXPECT_EQ(1U, other.get_blocks()[0].block_id_);
+  ASSERT_EQ(2U, other.get_removed_blocks().size());
+  EXPECT_EQ(8U, other.get_removed_blocks()[1]);
+
+  // a full report of an older dataserver has no seq
+  SetDataserverMessage full;
+  full.set_ds(&ds);
+  full.set_has_block(HAS_BLOCK_FLAG_YES);
+  full.add_block(&blocks_[0]);
+  Stream full_stream(full.length());
+  ASSERT_EQ(TFS_SUCCESS, full.serialize(full_stream));
+  Stream old_stream(full.length());
+  old_stream.set_bytes(full_stream.get_data(), full.length() - INT64_SIZE);
+  SetDataserverMessage old;
+  ASSERT_EQ(TFS_SUCCESS, old.deserialize(old_stream));
+  EXPECT_EQ(HAS_BLOCK_FLAG_YES, old.get_has_block());
+  EXPECT_EQ(1U, old.get_blocks().size());
+  EXPECT_EQ(0, old.get_report_seq());
+
+  RespHeartMessage resp;
+  resp.set_status(HEART_NEED_SEND_BLOCK_INFO);
+  resp.set_report_seq(100);
+  Stream resp_stream(resp.length());
+  ASSERT_EQ(TFS_SUCCESS, resp.serialize(resp_stream));
+  EXPECT_EQ(resp.length(), resp_stream.get_data_length());
+  RespHeartMessage other_resp;
+  ASSERT_EQ(TFS_SUCCESS, other_resp.deserialize(resp_stream));
+  EXPECT_EQ(HEART_NEED_SEND_BLOCK_INFO, other_resp.get_status());
+  EXPECT_EQ(100, other_resp.get_report_seq());
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include "block_scrubber.h"
+#include "physical_block.h"
+#include "common/func.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATH = "./scrub_mount";
+static const char* CURSOR_FILE = "./scrub_cursor";
+static const int32_t BLOCK_LENGTH = 32 * 1024 * 1024;
+static const uint32_t BLOCK_ID = 100;
+
+class BlockScrubberTest: public ::testing::Test
+{
+  public:
+    BlockScrubberTest()
+    {
+    }
+    ~BlockScrubberTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      int fd = open(path, O_RDWR | O_CREAT, 0644);
+      EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+      close(fd);
+
+      physical_ = new PhysicalBlock(BLOCK_ID, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+      block_ = new LogicBlock(BLOCK_ID, BLOCK_ID, MOUNT_PATH);
+      block_->add_physic_block(physical_);
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = 64 * 1024;
+      op.per_mmap_size_ = 64 * 1024;
+      EXPECT_EQ(TFS_SUCCESS, block_->init_block_file(64, op, C_MAIN_BLOCK));
+      memset(&info_, 0, sizeof(info_));
+      info_.block_id_ = BLOCK_ID;
+      scrubber_.initialize(CURSOR_FILE, 3600, 0, IO_POLICY_CACHED, NULL, NULL);
+    }
+    virtual void TearDown()
+    {
+      delete block_;
+      delete physical_;
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      unlink(path);
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), BLOCK_ID);
+      unlink(path);
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+      unlink(CURSOR_FILE);
+    }
+
+    // appends a file of size bytes, returns where its data is
+    int32_t add_file(const uint64_t id, const int32_t size, const int32_t flag)
+    {
+      FileInfo info;
+      memset(&info, 0, sizeof(info));
+      info.id_ = id;
+      info.offset_ = block_->get_data_file_size();
+      info.size_ = size + sizeof(FileInfo);
+      info.usize_ = info.size_;
+      info.flag_ = flag;
+      char* buf = new char[info.size_];
+      for (int32_t i = 0; i < size; ++i)
+      {
+        buf[sizeof(FileInfo) + i] = static_cast<char>(id * 31 + i / 7);
+      }
+      info.crc_ = Func::crc(0, buf + sizeof(FileInfo), size);
+      memcpy(buf, &info, sizeof(FileInfo));
+      EXPECT_EQ(TFS_SUCCESS, block_->write_raw_data(buf, info.size_, info.offset_));
+      delete []buf;
+
+      metas_.push_back(RawMeta(id, info.offset_, info.size_));
+      info_.file_count_++;
+      info_.size_ += info.size_;
+      return info.offset_ + sizeof(FileInfo);
+    }
+
+    // flip a byte of data at offset of block
+    void corrupt(const int32_t offset)
+    {
+      char c = 0;
+      int32_t len = 1;
+      EXPECT_EQ(TFS_SUCCESS, block_->read_raw_data(&c, len, offset));
+      c = ~c;
+      EXPECT_EQ(TFS_SUCCESS, block_->write_raw_data(&c, 1, offset));
+    }
+
+  protected:
+    LogicBlock* block_;
+    PhysicalBlock* physical_;
+    BlockInfo info_;
+    RawMetaVec metas_;
+    BlockScrubber scrubber_;
+};
+
+TEST_F(BlockScrubberTest, testScrubBlock)
+{
+  add_file(1, 1000, 0);
+  int32_t bad_offset = add_file(2, 64 * 1024, 0);
+  int32_t deleted_offset = add_file(3, 5000, FI_DELETED);
+  add_file(4, 100, 0);
+  // larger than a read of scrub, read in pieces
+  int32_t big_offset = add_file(5, 9 * 1024 * 1024, 0);
+  add_file(6, 300, 0);
+  ASSERT_EQ(TFS_SUCCESS, block_->batch_write_meta(&info_, &metas_));
+
+  std::vector<FileInfo> bad_files;
+  EXPECT_EQ(TFS_SUCCESS, scrubber_.scrub_block(block_, bad_files));
+  EXPECT_EQ(0U, bad_files.size());
+
+  corrupt(bad_offset + 100);
+  corrupt(big_offset + 8 * 1024 * 1024 + 1);
+  // a deleted file is not checked
+  corrupt(deleted_offset + 10);
+  EXPECT_EQ(TFS_SUCCESS, scrubber_.scrub_block(block_, bad_files));
+  ASSERT_EQ(2U, bad_files.size());
+  EXPECT_EQ(2U, bad_files[0].id_);
+  EXPECT_EQ(5U, bad_files[1].id_);
+
+  ScrubStat stat;
+  scrubber_.get_stat(stat);
+  EXPECT_EQ(2, stat.block_count_);
+  EXPECT_EQ(10, stat.file_count_);
+  EXPECT_EQ(2, stat.error_count_);
+  EXPECT_EQ(2 * static_cast<int64_t>(info_.size_), stat.scrub_size_);
+}
+
+TEST_F(BlockScrubberTest, testCursor)
+{
+  EXPECT_NE(TFS_SUCCESS, scrubber_.load_cursor());
+  ScrubCursor cursor;
+  cursor.block_id_ = 12345;
+  cursor.round_start_ = 1300000000;
+  scrubber_.set_cursor(cursor);
+  EXPECT_EQ(TFS_SUCCESS, scrubber_.save_cursor());
+
+  // as after a restart
+  BlockScrubber other;
+  other.initialize(CURSOR_FILE, 3600, 0, IO_POLICY_CACHED, NULL, NULL);
+  EXPECT_EQ(TFS_SUCCESS, other.load_cursor());
+  EXPECT_EQ(12345U, other.get_cursor().block_id_);
+  EXPECT_EQ(1300000000, other.get_cursor().round_start_);
+
+  FILE* fp = fopen(CURSOR_FILE, "w");
+  fputs("broken", fp);
+  fclose(fp);
+  EXPECT_NE(TFS_SUCCESS, other.load_cursor());
+  EXPECT_EQ(12345U, other.get_cursor().block_id_);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,359 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <tbsys.h>
+#include <tbtimeutil.h>
+#include "blockfile_manager.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATH = "./bootstrap_disk";
+static const char* INDEX_PATH = "./bootstrap_ssd";
+static const int32_t BLOCK_COUNT = 1000;
+static const int32_t FILE_COUNT = 800; // files in a block
+
+// each bootstrap runs in a child process like a restart
+class BootstrapTest: public ::testing::Test
+{
+  public:
+    BootstrapTest()
+    {
+    }
+    ~BootstrapTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      set_fs_param(fs_param_, 1, 0);
+      ASSERT_EQ(0, run_child(create_blocks, fs_param_, NULL));
+    }
+    virtual void TearDown()
+    {
+      BlockFileManager().clear_block_file_system(fs_param_);
+    }
+
+    static void set_fs_param(FileSystemParameter& fs_param, const int32_t thread_count, const int32_t lazy)
+    {
+      fs_param.mount_name_.assign(MOUNT_PATH);
+      // in KB, 4G of sparse blocks, more than 1000 main blocks of 2M
+      fs_param.max_mount_size_ = 4 * 1024 * 1024 + 128 * 1024;
+      fs_param.base_fs_type_ = EXT3_FTRUN;
+      fs_param.super_block_reserve_offset_ = 0;
+      fs_param.avg_segment_size_ = 4 * 1024;
+      fs_param.main_block_size_ = 2 * 1024 * 1024;
+      fs_param.extend_block_size_ = 1024 * 1024;
+      fs_param.block_type_ratio_ = 0.5;
+      fs_param.file_system_version_ = 1;
+      fs_param.hash_slot_ratio_ = 0.5;
+      fs_param.bootstrap_thread_count_ = thread_count;
+      fs_param.lazy_load_index_ = lazy;
+    }
+
+    // runs func in a child, its cost in us by cost
+    typedef int (*ChildFunc)(const FileSystemParameter& fs_param, int64_t& cost);
+    static int run_child(ChildFunc func, const FileSystemParameter& fs_param, int64_t* cost)
+    {
+      int fds[2];
+      if (0 != pipe(fds))
+      {
+        return -1;
+      }
+      pid_t pid = fork();
+      if (0 == pid)
+      {
+        close(fds[0]);
+        int64_t child_cost = 0;
+        int ret = func(fs_param, child_cost);
+        ssize_t len = write(fds[1], &child_cost, sizeof(child_cost));
+        _exit(TFS_SUCCESS == ret && sizeof(child_cost) == static_cast<size_t>(len) ? 0 : 1);
+      }
+      close(fds[1]);
+      int64_t child_cost = 0;
+      ssize_t len = read(fds[0], &child_cost, sizeof(child_cost));
+      close(fds[0]);
+      int status = 0;
+      waitpid(pid, &status, 0);
+      if (NULL != cost && sizeof(child_cost) == static_cast<size_t>(len))
+      {
+        *cost = child_cost;
+      }
+      return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    // blocks 1 ~ BLOCK_COUNT, FILE_COUNT files in each
+    static int create_blocks(const FileSystemParameter& fs_param, int64_t&)
+    {
+      BlockFileManager manager;
+      int ret = manager.format_block_file_system(fs_param);
+      if (TFS_SUCCESS == ret)
+      {
+        ret = manager.bootstrap(fs_param);
+      }
+      for (uint32_t id = 1; TFS_SUCCESS == ret && id <= static_cast<uint32_t>(BLOCK_COUNT); ++id)
+      {
+        uint32_t physical_id = 0;
+        ret = manager.new_block(id, physical_id);
+        LogicBlock* logic_block = manager.get_logic_block(id);
+        if (TFS_SUCCESS == ret && NULL != logic_block)
+        {
+          BlockInfo info;
+          memset(&info, 0, sizeof(info));
+          info.block_id_ = id;
+          info.file_count_ = FILE_COUNT;
+          info.size_ = FILE_COUNT * 1024;
+          RawMetaVec metas;
+          for (int32_t i = 1; i <= FILE_COUNT; ++i)
+          {
+            metas.push_back(RawMeta(i, (i - 1) * 1024, 1024));
+          }
+          ret = logic_block->batch_write_meta(&info, &metas);
+        }
+      }
+      return ret;
+    }
+
+    static int bootstrap(const FileSystemParameter& fs_param, int64_t& cost)
+    {
+      BlockFileManager manager;
+      int64_t start = tbsys::CTimeUtil::getTime();
+      int ret = manager.bootstrap(fs_param);
+      cost = tbsys::CTimeUtil::getTime() - start;
+      if (TFS_SUCCESS != ret)
+      {
+        return ret;
+      }
+
+      // block infos are there to report, lazy or not
+      std::list<LogicBlock*> blocks;
+      manager.get_all_logic_block(blocks);
+      if (BLOCK_COUNT != static_cast<int32_t>(blocks.size()))
+      {
+        return TFS_ERROR;
+      }
+      for (std::list<LogicBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+      {
+        if (FILE_COUNT != (*it)->get_block_info()->file_count_
+            || (*it)->get_logic_block_id() != (*it)->get_block_info()->block_id_
+            || (*it)->is_loaded() == (0 != fs_param.lazy_load_index_))
+        {
+          return TFS_ERROR;
+        }
+      }
+
+      // the index is there at the first access
+      LogicBlock* logic_block = manager.get_logic_block(BLOCK_COUNT / 2);
+      RawMetaVec metas;
+      if (NULL == logic_block || !logic_block->is_loaded()
+          || TFS_SUCCESS != logic_block->get_meta_infos(metas) || FILE_COUNT != static_cast<int32_t>(metas.size()))
+      {
+        return TFS_ERROR;
+      }
+      return TFS_SUCCESS;
+    }
+
+    // an index broken after the lazy bootstrap read its header is dropped at the first access
+    static int lazy_load_corrupt(const FileSystemParameter& fs_param, int64_t&)
+    {
+      BlockFileManager manager;
+      int ret = manager.bootstrap(fs_param);
+      if (TFS_SUCCESS != ret)
+      {
+        return ret;
+      }
+      std::list<LogicBlock*> blocks;
+      manager.get_all_logic_block(blocks);
+      LogicBlock* logic_block = NULL;
+      for (std::list<LogicBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+      {
+        if (static_cast<uint32_t>(BLOCK_COUNT / 2) == (*it)->get_logic_block_id())
+        {
+          logic_block = *it;
+        }
+      }
+      if (NULL == logic_block || logic_block->is_loaded())
+      {
+        return TFS_ERROR;
+      }
+
+      char path[256];
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(),
+          logic_block->get_physic_block_list()->front()->get_physic_block_id());
+      int fd = open(path, O_WRONLY);
+      char zero[sizeof(IndexHeader)];
+      memset(zero, 0, sizeof(zero));
+      ssize_t len = fd < 0 ? -1 : pwrite(fd, zero, sizeof(zero), 0);
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      if (static_cast<ssize_t>(sizeof(zero)) != len)
+      {
+        return TFS_ERROR;
+      }
+
+      // gone as a confused block at bootstrap would be, neither served nor reported
+      if (NULL != manager.get_logic_block(BLOCK_COUNT / 2)
+          || NULL != manager.get_logic_block(BLOCK_COUNT / 2))
+      {
+        return TFS_ERROR;
+      }
+      manager.get_all_logic_block(blocks);
+      if (BLOCK_COUNT - 1 != static_cast<int32_t>(blocks.size()) || NULL == manager.get_logic_block(1))
+      {
+        return TFS_ERROR;
+      }
+      return TFS_SUCCESS;
+    }
+
+    // a scan loads a lazy index without counting a visit
+    static int scan_no_visit(const FileSystemParameter& fs_param, int64_t&)
+    {
+      BlockFileManager manager;
+      int ret = manager.bootstrap(fs_param);
+      if (TFS_SUCCESS != ret)
+      {
+        return ret;
+      }
+      bool loaded = false;
+      LogicBlock* logic_block = manager.scan_logic_block(BLOCK_COUNT / 2, loaded);
+      if (NULL == logic_block || !loaded || !logic_block->is_loaded() || 0 != logic_block->get_visit_count())
+      {
+        return TFS_ERROR;
+      }
+      logic_block = manager.scan_logic_block(BLOCK_COUNT / 2, loaded);
+      if (NULL == logic_block || loaded || 0 != logic_block->get_visit_count()
+          || NULL != manager.scan_logic_block(BLOCK_COUNT + 1, loaded))
+      {
+        return TFS_ERROR;
+      }
+      logic_block = manager.get_logic_block(BLOCK_COUNT / 2);
+      return NULL != logic_block && 1 == logic_block->get_visit_count() ? TFS_SUCCESS : TFS_ERROR;
+    }
+
+    static int count_blocks(const FileSystemParameter& fs_param, int64_t&)
+    {
+      BlockFileManager manager;
+      int ret = manager.bootstrap(fs_param);
+      std::list<LogicBlock*> blocks;
+      manager.get_all_logic_block(blocks);
+      return TFS_SUCCESS == ret && BLOCK_COUNT - 1 == static_cast<int32_t>(blocks.size()) ? TFS_SUCCESS : TFS_ERROR;
+    }
+
+    static int32_t count_files(const std::string& dir)
+    {
+      DIR* dp = opendir(dir.c_str());
+      if (NULL == dp)
+      {
+        return -1;
+      }
+      int32_t count = 0;
+      struct dirent* entry = NULL;
+      while (NULL != (entry = readdir(dp)))
+      {
+        if ('.' != entry->d_name[0])
+        {
+          ++count;
+        }
+      }
+      closedir(dp);
+      return count;
+    }
+
+  protected:
+    FileSystemParameter fs_param_;
+};
+
+TEST_F(BootstrapTest, testIndexPath)
+{
+  BlockFileManager().clear_block_file_system(fs_param_);
+  FileSystemParameter fs_param;
+  set_fs_param(fs_param, 8, 0);
+  fs_param.index_path_.assign(INDEX_PATH);
+  ASSERT_EQ(0, run_child(create_blocks, fs_param, NULL));
+
+  // super block and indexes on index path, only block data on mount point
+  EXPECT_EQ(0, access((std::string(INDEX_PATH) + SUPERBLOCK_NAME).c_str(), F_OK));
+  EXPECT_EQ(BLOCK_COUNT, count_files(std::string(INDEX_PATH) + INDEX_DIR_PREFIX));
+  EXPECT_NE(0, access((std::string(MOUNT_PATH) + SUPERBLOCK_NAME).c_str(), F_OK));
+  EXPECT_EQ(-1, count_files(std::string(MOUNT_PATH) + INDEX_DIR_PREFIX));
+  EXPECT_LT(BLOCK_COUNT, count_files(MOUNT_PATH));
+
+  EXPECT_EQ(0, run_child(bootstrap, fs_param, NULL));
+  set_fs_param(fs_param, 8, 1);
+  fs_param.index_path_.assign(INDEX_PATH);
+  EXPECT_EQ(0, run_child(bootstrap, fs_param, NULL));
+  // not from the mount point alone
+  EXPECT_NE(0, run_child(bootstrap, fs_param_, NULL));
+  // nor without the data
+  std::string moved_path = std::string(MOUNT_PATH) + ".moved";
+  ASSERT_EQ(0, rename(MOUNT_PATH, moved_path.c_str()));
+  EXPECT_NE(0, run_child(bootstrap, fs_param, NULL));
+  ASSERT_EQ(0, rename(moved_path.c_str(), MOUNT_PATH));
+
+  EXPECT_EQ(TFS_SUCCESS, BlockFileManager().clear_block_file_system(fs_param));
+  // both emptied, the paths themselves are kept as mount points are
+  EXPECT_EQ(0, count_files(INDEX_PATH));
+  EXPECT_EQ(0, count_files(MOUNT_PATH));
+  rmdir(INDEX_PATH);
+}
+
+TEST_F(BootstrapTest, testLazyLoadCorrupt)
+{
+  FileSystemParameter fs_param;
+  set_fs_param(fs_param, 8, 1);
+  EXPECT_EQ(0, run_child(lazy_load_corrupt, fs_param, NULL));
+  // the block is deleted for good
+  set_fs_param(fs_param, 8, 0);
+  EXPECT_EQ(0, run_child(count_blocks, fs_param, NULL));
+}
+
+TEST_F(BootstrapTest, testScanNoVisit)
+{
+  FileSystemParameter fs_param;
+  set_fs_param(fs_param, 8, 1);
+  EXPECT_EQ(0, run_child(scan_no_visit, fs_param, NULL));
+}
+
+TEST_F(BootstrapTest, testBenchmark)
+{
+  struct Mode
+  {
+    const char* name_;
+    int32_t thread_count_;
+    int32_t lazy_;
+  };
+  const Mode modes[] = { { "serial", 1, 0 }, { "parallel", 8, 0 }, { "lazy", 8, 1 } };
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+  {
+    FileSystemParameter fs_param;
+    set_fs_param(fs_param, modes[i].thread_count_, modes[i].lazy_);
+    int64_t cost = 0;
+    EXPECT_EQ(0, run_child(bootstrap, fs_param, &cost)) << modes[i].name_;
+    printf("bootstrap %d blocks of %d files, %-8s threads: %d, cost: %8" PRI64_PREFIX "d(us)\n",
+        BLOCK_COUNT, FILE_COUNT, modes[i].name_, modes[i].thread_count_, cost);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
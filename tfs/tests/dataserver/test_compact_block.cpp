@@ -0,0 +1,347 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include <tbtimeutil.h>
+#include "compact_block.h"
+#include "rate_limiter.h"
+#include "logic_block.h"
+#include "physical_block.h"
+#include "common/func.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATH = "./compact_mount";
+static const int32_t BLOCK_LENGTH = 32 * 1024 * 1024;
+static const uint32_t SRC_ID = 100;
+static const uint32_t DEST_ID = 101;
+
+class CompactBlockTest: public ::testing::Test
+{
+  public:
+    CompactBlockTest()
+    {
+    }
+    ~CompactBlockTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      src_ = make_block(SRC_ID, C_MAIN_BLOCK, src_physical_);
+      memset(&src_info_, 0, sizeof(src_info_));
+      src_info_.block_id_ = SRC_ID;
+      dest_ = make_block(DEST_ID, C_COMPACT_BLOCK, dest_physical_);
+    }
+    virtual void TearDown()
+    {
+      delete src_;
+      delete dest_;
+      delete src_physical_;
+      delete dest_physical_;
+      const uint32_t ids[] = { SRC_ID, DEST_ID };
+      for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); ++i)
+      {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, ids[i]);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), ids[i]);
+        unlink(path);
+      }
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+    }
+
+    static LogicBlock* make_block(const uint32_t id, const BlockType type, PhysicalBlock*& physical)
+    {
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, id);
+      int fd = open(path, O_RDWR | O_CREAT, 0644);
+      EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+      close(fd);
+
+      physical = new PhysicalBlock(id, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+      LogicBlock* block = new LogicBlock(SRC_ID, id, MOUNT_PATH);
+      block->add_physic_block(physical);
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = 64 * 1024;
+      op.per_mmap_size_ = 64 * 1024;
+      EXPECT_EQ(TFS_SUCCESS, block->init_block_file(64, op, type));
+      return block;
+    }
+
+    // appends a file of size bytes to src, its data is a pattern of its id
+    void add_file(const uint64_t id, const int32_t size, const int32_t flag)
+    {
+      FileInfo info;
+      memset(&info, 0, sizeof(info));
+      info.id_ = id;
+      info.offset_ = src_->get_data_file_size();
+      info.size_ = size + sizeof(FileInfo);
+      info.usize_ = info.size_;
+      info.flag_ = flag;
+      char* buf = new char[info.size_];
+      fill_data(id, buf + sizeof(FileInfo), size);
+      info.crc_ = Func::crc(0, buf + sizeof(FileInfo), size);
+      memcpy(buf, &info, sizeof(FileInfo));
+      EXPECT_EQ(TFS_SUCCESS, src_->write_raw_data(buf, info.size_, info.offset_));
+      delete []buf;
+
+      RawMeta meta(id, info.offset_, info.size_);
+      metas_.push_back(meta);
+      src_info_.file_count_++;
+      src_info_.size_ += info.size_;
+      if (flag & FI_DELETED)
+      {
+        src_info_.del_file_count_++;
+        src_info_.del_size_ += info.size_;
+      }
+    }
+
+    static void fill_data(const uint64_t id, char* data, const int32_t size)
+    {
+      for (int32_t i = 0; i < size; ++i)
+      {
+        data[i] = static_cast<char>(id * 31 + i / 7);
+      }
+    }
+
+    // the file is in dest with its data
+    void check_file(const uint64_t id, const int32_t size)
+    {
+      check_file(dest_, id, size);
+    }
+
+    static void check_file(LogicBlock* block, const uint64_t id, const int32_t size)
+    {
+      RawMetaVec metas;
+      EXPECT_EQ(TFS_SUCCESS, block->get_meta_infos(metas));
+      RawMetaVecIter it = metas.begin();
+      while (it != metas.end() && it->get_file_id() != id)
+      {
+        ++it;
+      }
+      ASSERT_TRUE(it != metas.end()) << "fileid: " << id;
+      ASSERT_EQ(static_cast<int32_t>(size + sizeof(FileInfo)), it->get_size());
+
+      char* buf = new char[it->get_size()];
+      int32_t len = it->get_size();
+      EXPECT_EQ(TFS_SUCCESS, block->read_raw_data(buf, len, it->get_offset()));
+      EXPECT_EQ(it->get_size(), len);
+      FileInfo info;
+      memcpy(&info, buf, sizeof(FileInfo));
+      EXPECT_EQ(id, info.id_);
+      EXPECT_EQ(it->get_offset(), info.offset_);
+      char* expect = new char[size];
+      fill_data(id, expect, size);
+      EXPECT_EQ(0, memcmp(expect, buf + sizeof(FileInfo), size));
+      EXPECT_EQ(Func::crc(0, expect, size), info.crc_);
+      delete []expect;
+      delete []buf;
+    }
+
+  protected:
+    LogicBlock* src_;
+    LogicBlock* dest_;
+    PhysicalBlock* src_physical_;
+    PhysicalBlock* dest_physical_;
+    RawMetaVec metas_;
+    BlockInfo src_info_;
+};
+
+TEST_F(CompactBlockTest, testCompact)
+{
+  // small files filling more than one write buffer, some deleted, and a big file
+  // copied in chunks between them
+  const int32_t small_size = 300 * 1024;
+  const int32_t big_size = MAX_COMPACT_READ_SIZE + 1024 * 1024;
+  for (uint64_t id = 1; id <= 40; ++id)
+  {
+    add_file(id, small_size + static_cast<int32_t>(id), 0 == id % 3 ? FI_DELETED : 0);
+    if (20 == id)
+    {
+      add_file(1000, big_size, 0);
+    }
+  }
+  ASSERT_EQ(TFS_SUCCESS, src_->batch_write_meta(&src_info_, &metas_));
+
+  CompactBlock compact_block;
+  ASSERT_EQ(TFS_SUCCESS, compact_block.real_compact(src_, dest_));
+
+  BlockInfo* blk = dest_->get_block_info();
+  EXPECT_EQ(SRC_ID, blk->block_id_);
+  EXPECT_EQ(28, blk->file_count_);
+  EXPECT_EQ(0, blk->del_file_count_);
+  EXPECT_EQ(blk->size_, dest_->get_data_file_size());
+  for (uint64_t id = 1; id <= 40; ++id)
+  {
+    if (0 != id % 3)
+    {
+      check_file(id, small_size + static_cast<int32_t>(id));
+    }
+  }
+  check_file(1000, big_size);
+}
+
+TEST_F(CompactBlockTest, testCrcError)
+{
+  for (uint64_t id = 1; id <= 10; ++id)
+  {
+    add_file(id, 4096, 0);
+  }
+  ASSERT_EQ(TFS_SUCCESS, src_->batch_write_meta(&src_info_, &metas_));
+  // a flipped byte in the data of the 5th file
+  char c = 0;
+  int32_t offset = metas_[4].get_offset() + sizeof(FileInfo) + 100;
+  ASSERT_EQ(TFS_SUCCESS, src_physical_->pread_data(&c, 1, offset));
+  c = ~c;
+  ASSERT_EQ(TFS_SUCCESS, src_physical_->pwrite_data(&c, 1, offset));
+
+  CompactBlock compact_block;
+  EXPECT_EQ(EXIT_CHECK_CRC_ERROR, compact_block.real_compact(src_, dest_));
+}
+
+TEST_F(CompactBlockTest, testRateLimit)
+{
+  const int32_t size = 256 * 1024;
+  for (uint64_t id = 1; id <= 8; ++id)
+  {
+    add_file(id, size, 0);
+  }
+  ASSERT_EQ(TFS_SUCCESS, src_->batch_write_meta(&src_info_, &metas_));
+
+  // 2M read and 2M written at 8M/s, the last write may start at 250ms
+  CompactBlock compact_block;
+  compact_block.get_rate_limiter().set_rate(8 * 1024 * 1024);
+  int64_t start = tbsys::CTimeUtil::getTime();
+  ASSERT_EQ(TFS_SUCCESS, compact_block.real_compact(src_, dest_));
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  EXPECT_GE(cost, 240000);
+  EXPECT_EQ(8, dest_->get_block_info()->file_count_);
+}
+
+TEST_F(CompactBlockTest, testIncremental)
+{
+  // deleted files near the front, files of the tail move into their space
+  const int32_t size = 64 * 1024;
+  for (uint64_t id = 1; id <= 10; ++id)
+  {
+    add_file(id, size + static_cast<int32_t>(id), (2 == id || 3 == id || 5 == id) ? FI_DELETED : 0);
+  }
+  ASSERT_EQ(TFS_SUCCESS, src_->batch_write_meta(&src_info_, &metas_));
+  int32_t old_size = src_->get_data_file_size();
+
+  CompactBlock compact_block;
+  int32_t moved = 0;
+  ASSERT_EQ(TFS_SUCCESS, compact_block.compact_in_place(src_, moved));
+  EXPECT_GT(moved, 0);
+  EXPECT_LT(src_->get_data_file_size(), old_size);
+
+  BlockInfo* blk = src_->get_block_info();
+  EXPECT_EQ(7, blk->file_count_);
+  EXPECT_EQ(0, blk->del_file_count_);
+  EXPECT_EQ(blk->size_, src_->get_data_file_size());
+  RawMetaVec metas;
+  EXPECT_EQ(TFS_SUCCESS, src_->get_meta_infos(metas));
+  EXPECT_EQ(7U, metas.size());
+  int32_t live_size = 0;
+  for (RawMetaVecIter it = metas.begin(); it != metas.end(); ++it)
+  {
+    live_size += it->get_size();
+    EXPECT_LE(it->get_offset() + it->get_size(), src_->get_data_file_size());
+  }
+  EXPECT_EQ(blk->size_ - live_size, blk->del_size_);
+  for (uint64_t id = 1; id <= 10; ++id)
+  {
+    if (2 != id && 3 != id && 5 != id)
+    {
+      check_file(src_, id, size + static_cast<int32_t>(id));
+    }
+  }
+
+  // nothing left to move
+  ASSERT_EQ(TFS_SUCCESS, compact_block.compact_in_place(src_, moved));
+  EXPECT_EQ(0, moved);
+}
+
+TEST_F(CompactBlockTest, testIncrementalChanged)
+{
+  // the last file is planned into the hole of the first, then unlinked before the index swap
+  const int32_t size = 64 * 1024;
+  for (uint64_t id = 1; id <= 3; ++id)
+  {
+    add_file(id, size, 1 == id ? FI_DELETED : 0);
+  }
+  ASSERT_EQ(TFS_SUCCESS, src_->batch_write_meta(&src_info_, &metas_));
+  int32_t del_count = 0;
+  int32_t del_size = 0;
+  RawMetaVec deletes(1, metas_[0]);
+  ASSERT_EQ(TFS_SUCCESS, src_->drop_deleted_files(deletes, del_count, del_size));
+  EXPECT_EQ(1, del_count);
+
+  MovedFile move;
+  move.meta_ = metas_[2];
+  move.to_offset_ = 0;
+  int32_t len = sizeof(FileInfo);
+  ASSERT_EQ(TFS_SUCCESS, src_->read_raw_data(reinterpret_cast<char*>(&move.info_), len, move.meta_.get_offset()));
+  FileInfo finfo = move.info_;
+  finfo.flag_ |= FI_DELETED;
+  ASSERT_EQ(TFS_SUCCESS, src_->write_raw_data(reinterpret_cast<char*>(&finfo), sizeof(FileInfo),
+        move.meta_.get_offset()));
+
+  int32_t moved = 0;
+  std::vector<MovedFile> moves(1, move);
+  ASSERT_EQ(TFS_SUCCESS, src_->commit_moved_files(moves, del_size, moved));
+  EXPECT_EQ(0, moved);
+  RawMetaVec metas;
+  EXPECT_EQ(TFS_SUCCESS, src_->get_sorted_meta_infos(metas));
+  ASSERT_EQ(2U, metas.size());
+  EXPECT_EQ(metas_[2].get_offset(), metas[1].get_offset());
+  EXPECT_EQ(metas[1].get_offset() + metas[1].get_size(), src_->get_data_file_size());
+  check_file(src_, 2, size);
+}
+
+TEST(RateLimiterTest, testRate)
+{
+  RateLimiter limiter;
+  int64_t start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < 100; ++i)
+  {
+    limiter.acquire(1024 * 1024);
+  }
+  EXPECT_LT(tbsys::CTimeUtil::getTime() - start, 100000);
+
+  // the first takes its turn at once, the other 5 wait 100ms each
+  limiter.set_rate(10 * 1024 * 1024);
+  start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < 6; ++i)
+  {
+    limiter.acquire(1024 * 1024);
+  }
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  EXPECT_GE(cost, 490000);
+  EXPECT_LT(cost, 1500000);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
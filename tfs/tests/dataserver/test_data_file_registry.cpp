@@ -0,0 +1,268 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <tbtimeutil.h>
+#include "data_file.h"
+#include "common/func.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* WORK_DIR = "/tmp";
+
+class DataFileRegistryTest: public ::testing::Test
+{
+  public:
+    DataFileRegistryTest()
+    {
+    }
+    ~DataFileRegistryTest()
+    {
+    }
+    virtual void SetUp()
+    {
+    }
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(DataFileRegistryTest, testAcquireRelease)
+{
+  DataFileRegistry registry(4);
+  DataFile* datafile = NULL;
+  EXPECT_EQ(EXIT_DATAFILE_EXPIRE_ERROR, registry.acquire(1, false, 2, datafile, WORK_DIR));
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(1, true, 2, datafile, WORK_DIR));
+  ASSERT_TRUE(NULL != datafile);
+  EXPECT_EQ(2, datafile->get_ref());
+  EXPECT_EQ(5, datafile->set_data("hello", 5, 0));
+  registry.release(datafile);
+
+  DataFile* same = NULL;
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(1, false, 2, same, WORK_DIR));
+  EXPECT_EQ(datafile, same);
+  EXPECT_EQ(5, same->get_length());
+  registry.release(same);
+
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(2, true, 2, datafile, WORK_DIR));
+  registry.release(datafile);
+  EXPECT_EQ(2, registry.size());
+  // over limit
+  EXPECT_EQ(EXIT_DATAFILE_OVERLOAD, registry.acquire(3, true, 2, datafile, WORK_DIR));
+  EXPECT_EQ(2, registry.size());
+
+  // erase while someone still holds it, the holder keeps a valid datafile
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(2, false, 2, datafile, WORK_DIR));
+  EXPECT_EQ(TFS_SUCCESS, registry.erase(2));
+  EXPECT_EQ(1, registry.size());
+  EXPECT_EQ(1, datafile->get_ref());
+  EXPECT_EQ(3, datafile->set_data("abc", 3, 0));
+  registry.release(datafile);
+  EXPECT_EQ(EXIT_DATAFILE_EXPIRE_ERROR, registry.acquire(2, false, 2, datafile, WORK_DIR));
+}
+
+TEST_F(DataFileRegistryTest, testExpire)
+{
+  DataFileRegistry registry(4);
+  DataFile* busy = NULL;
+  DataFile* idle = NULL;
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(1, true, 10, busy, WORK_DIR));
+  EXPECT_EQ(TFS_SUCCESS, registry.acquire(2, true, 10, idle, WORK_DIR));
+  registry.release(idle);
+
+  int32_t old_size = 0;
+  int32_t new_size = 0;
+  EXPECT_EQ(TFS_SUCCESS, registry.expire(time(NULL) + 1, old_size, new_size));
+  EXPECT_EQ(2, old_size);
+  EXPECT_EQ(1, new_size);
+  registry.release(busy);
+
+  registry.clear();
+  EXPECT_EQ(0, registry.size());
+}
+
+class DataFileTest: public ::testing::Test
+{
+  public:
+    virtual void SetUp()
+    {
+      mkdir("/tmp/tmp", 0755);
+      WriteBufferPool::get_instance()->purge();
+    }
+
+    // fill buf with a pattern depending on file offset
+    static void make_data(char* buf, const int32_t len, const int32_t offset)
+    {
+      for (int32_t i = 0; i < len; ++i)
+      {
+        buf[i] = static_cast<char>((offset + i) % 251);
+      }
+    }
+
+    // read back by inner buffers, the same way as LogicBlock::close_write_file
+    static int check_data(DataFile& datafile)
+    {
+      char* data = NULL;
+      int32_t len = 0, offset = 0;
+      std::vector<char> expect(datafile.get_length());
+      make_data(&expect[0], datafile.get_length(), 0);
+      while ((data = datafile.get_data(NULL, &len, offset)) != NULL)
+      {
+        if (len <= 0 || 0 != memcmp(&expect[offset], data, len))
+        {
+          return TFS_ERROR;
+        }
+        offset += len;
+      }
+      return offset == datafile.get_length() ? TFS_SUCCESS : TFS_ERROR;
+    }
+};
+
+TEST_F(DataFileTest, testChunks)
+{
+  int64_t used_size = 0, cached_size = 0;
+  const int32_t len = 100 * 1024;
+  std::vector<char> buf(len);
+  {
+    DataFile datafile(1, WORK_DIR);
+    // fragments crossing chunk boundaries
+    for (int32_t offset = 0; offset < len; offset += 10000)
+    {
+      int32_t size = std::min(10000, len - offset);
+      make_data(&buf[0], size, offset);
+      EXPECT_EQ(size, datafile.set_data(&buf[0], size, offset));
+    }
+    EXPECT_EQ(len, datafile.get_length());
+    EXPECT_EQ(TFS_SUCCESS, check_data(datafile));
+
+    // memory follows the written bytes: 16K + 32K + 64K
+    WriteBufferPool::get_instance()->get_stat(used_size, cached_size);
+    EXPECT_EQ(112 * 1024, used_size);
+
+    int32_t read_len = 20000;
+    EXPECT_TRUE(NULL != datafile.get_data(&buf[0], &read_len, 10000));
+    EXPECT_EQ(20000, read_len);
+    EXPECT_EQ(static_cast<char>(10000 % 251), buf[0]);
+    EXPECT_EQ(static_cast<char>(29999 % 251), buf[19999]);
+
+    make_data(&buf[0], len, 0);
+    EXPECT_EQ(Func::crc(0, &buf[0], len), datafile.get_crc());
+  }
+  WriteBufferPool::get_instance()->get_stat(used_size, cached_size);
+  EXPECT_EQ(0, used_size);
+  EXPECT_EQ(112 * 1024, cached_size);
+}
+
+TEST_F(DataFileTest, testSpill)
+{
+  const int32_t len = 5 * 1024 * 1024;
+  const int32_t frag_size = 1024 * 1024;
+  std::vector<char> buf(len);
+  DataFile datafile(2, WORK_DIR);
+  for (int32_t offset = 0; offset < len; offset += frag_size)
+  {
+    make_data(&buf[0], frag_size, offset);
+    EXPECT_EQ(frag_size, datafile.set_data(&buf[0], frag_size, offset));
+  }
+  EXPECT_EQ(len, datafile.get_length());
+  EXPECT_EQ(TFS_SUCCESS, check_data(datafile));
+
+  int64_t used_size = 0, cached_size = 0;
+  WriteBufferPool::get_instance()->get_stat(used_size, cached_size);
+  EXPECT_EQ(0, used_size);
+
+  make_data(&buf[0], len, 0);
+  EXPECT_EQ(Func::crc(0, &buf[0], len), datafile.get_crc());
+  datafile.set_over();
+  EXPECT_EQ(0, datafile.get_length());
+  EXPECT_NE(0, access("/tmp/tmp/2.dat", F_OK));
+}
+
+struct BenchArg
+{
+  DataFileRegistry* registry_;
+  int32_t thread_index_;
+  int32_t loop_count_;
+  int32_t file_count_;
+  int64_t failed_;
+};
+
+static void* bench_writer(void* arg)
+{
+  BenchArg* bench = reinterpret_cast<BenchArg*>(arg);
+  char data[64];
+  memset(data, 'a', sizeof(data));
+  uint64_t base = static_cast<uint64_t>(bench->thread_index_) * bench->file_count_;
+  for (int32_t i = 0; i < bench->loop_count_; ++i)
+  {
+    uint64_t file_number = base + (i % bench->file_count_) + 1;
+    DataFile* datafile = NULL;
+    // like write_data: find (or create) the datafile, append one fragment
+    if (TFS_SUCCESS != bench->registry_->acquire(file_number, true, INT32_MAX, datafile, WORK_DIR))
+    {
+      ++bench->failed_;
+      continue;
+    }
+    datafile->set_data(data, sizeof(data), (i / bench->file_count_ % 1024) * sizeof(data));
+    bench->registry_->release(datafile);
+  }
+  return NULL;
+}
+
+static int64_t run_bench(const int32_t shard_count, const int32_t thread_count, const int32_t loop_count)
+{
+  DataFileRegistry registry(shard_count);
+  std::vector<pthread_t> threads(thread_count);
+  std::vector<BenchArg> args(thread_count);
+  int64_t start = tbsys::CTimeUtil::getTime();
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    args[i].registry_ = &registry;
+    args[i].thread_index_ = i;
+    args[i].loop_count_ = loop_count;
+    args[i].file_count_ = 2;
+    args[i].failed_ = 0;
+    pthread_create(&threads[i], NULL, bench_writer, &args[i]);
+  }
+  int64_t failed = 0;
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    pthread_join(threads[i], NULL);
+    failed += args[i].failed_;
+  }
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  EXPECT_EQ(0, failed);
+  EXPECT_EQ(thread_count * 2, registry.size());
+  return cost > 0 ? static_cast<int64_t>(thread_count) * loop_count * 1000000 / cost : 0;
+}
+
+// compare one shard (what a single global mutex gives) with the default sharding
+TEST_F(DataFileRegistryTest, testContention)
+{
+  const int32_t loop_count = 200000;
+  const int32_t thread_counts[] = {1, 4, 8, 16, 32, 64};
+  for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+  {
+    int64_t single = run_bench(1, thread_counts[i], loop_count);
+    int64_t sharded = run_bench(64, thread_counts[i], loop_count);
+    printf("threads: %2d, ops/s one shard: %10" PRI64_PREFIX "d, 64 shards: %10" PRI64_PREFIX "d\n",
+        thread_counts[i], single, sharded);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
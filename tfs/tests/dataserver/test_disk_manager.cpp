@@ -0,0 +1,241 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include "disk_manager.h"
+#include "logic_block.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATHS[] = { "./disk_manager_a", "./disk_manager_b" };
+static const int32_t DISK_COUNT = 2;
+
+class DiskManagerTest: public ::testing::Test
+{
+  public:
+    DiskManagerTest()
+    {
+    }
+    ~DiskManagerTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      fs_param_.mount_name_.assign(MOUNT_PATHS[0]);
+      // in KB, 32M of sparse blocks on each disk
+      fs_param_.max_mount_size_ = 32 * 1024;
+      fs_param_.base_fs_type_ = EXT3_FTRUN;
+      fs_param_.super_block_reserve_offset_ = 0;
+      fs_param_.avg_segment_size_ = 4 * 1024;
+      fs_param_.main_block_size_ = 2 * 1024 * 1024;
+      fs_param_.extend_block_size_ = 1024 * 1024;
+      fs_param_.block_type_ratio_ = 0.5;
+      fs_param_.file_system_version_ = 1;
+      fs_param_.hash_slot_ratio_ = 0.5;
+      fs_param_.bootstrap_thread_count_ = 1;
+      fs_param_.lazy_load_index_ = 0;
+      for (int32_t i = 0; i < DISK_COUNT; ++i)
+      {
+        fs_param_.mount_names_.push_back(MOUNT_PATHS[i]);
+        fs_param_.index_paths_.push_back("");
+      }
+
+      std::vector<FileSystemParameter> disks;
+      fs_param_.get_disks(disks);
+      ASSERT_EQ(DISK_COUNT, static_cast<int32_t>(disks.size()));
+      for (int32_t i = 0; i < DISK_COUNT; ++i)
+      {
+        EXPECT_EQ(MOUNT_PATHS[i], disks[i].mount_name_);
+        ASSERT_EQ(TFS_SUCCESS, BlockFileManager().format_block_file_system(disks[i]));
+      }
+      ASSERT_EQ(TFS_SUCCESS, manager_.bootstrap(fs_param_));
+    }
+    virtual void TearDown()
+    {
+      std::vector<FileSystemParameter> disks;
+      fs_param_.get_disks(disks);
+      for (uint32_t i = 0; i < disks.size(); ++i)
+      {
+        BlockFileManager().clear_block_file_system(disks[i]);
+      }
+    }
+
+  protected:
+    FileSystemParameter fs_param_;
+    DiskManager manager_;
+};
+
+TEST_F(DiskManagerTest, testSpread)
+{
+  EXPECT_EQ(DISK_COUNT, manager_.get_disk_count());
+  SuperBlock super_block;
+  ASSERT_EQ(TFS_SUCCESS, manager_.query_super_block(super_block));
+  const int32_t total_count = super_block.main_block_count_;
+  EXPECT_LT(8, total_count);
+
+  // the disk with the most free blocks takes the new one, the first on a tie
+  for (uint32_t id = 1; id <= 8; ++id)
+  {
+    uint32_t physical_id = 0;
+    ASSERT_EQ(TFS_SUCCESS, manager_.new_block(id, physical_id));
+    EXPECT_EQ(static_cast<int32_t>((id - 1) % DISK_COUNT), manager_.find_disk(id));
+  }
+  EXPECT_EQ(8, manager_.get_all_logic_block_size());
+  VUINT ids;
+  manager_.get_logic_block_ids(ids);
+  EXPECT_EQ(8U, ids.size());
+  std::list<LogicBlock*> blocks;
+  manager_.get_all_logic_block(blocks);
+  EXPECT_EQ(8U, blocks.size());
+
+  ASSERT_EQ(TFS_SUCCESS, manager_.query_super_block(super_block));
+  EXPECT_EQ(total_count, super_block.main_block_count_);
+  EXPECT_EQ(8, super_block.used_block_count_);
+  int32_t block_count = 0;
+  manager_.query_approx_block_count(block_count);
+  EXPECT_EQ(8, block_count);
+
+  // bitmaps of both disks
+  char* bit_map = NULL;
+  int32_t bit_map_len = 0, set_count = 0;
+  manager_.query_bit_map(&bit_map, bit_map_len, set_count);
+  EXPECT_EQ(8, set_count);
+  EXPECT_LT(0, bit_map_len);
+  tbsys::gDeleteA(bit_map);
+}
+
+TEST_F(DiskManagerTest, testRoute)
+{
+  uint32_t physical_id = 0;
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(1, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(2, physical_id));
+  EXPECT_EQ(1, manager_.find_disk(2));
+  // refused by the disk it is on, not created on the other
+  EXPECT_EQ(EXIT_BLOCK_EXIST_ERROR, manager_.new_block(2, physical_id));
+  EXPECT_EQ(2, manager_.get_all_logic_block_size());
+
+  LogicBlock* logic_block = manager_.get_logic_block(2);
+  ASSERT_TRUE(NULL != logic_block);
+  EXPECT_EQ(2U, logic_block->get_logic_block_id());
+  EXPECT_TRUE(NULL == manager_.get_logic_block(3));
+  bool loaded = true;
+  EXPECT_TRUE(NULL != manager_.scan_logic_block(1, loaded));
+  EXPECT_TRUE(NULL == manager_.scan_logic_block(3, loaded));
+  EXPECT_FALSE(loaded);
+
+  EXPECT_EQ(TFS_SUCCESS, manager_.del_block(2));
+  EXPECT_EQ(-1, manager_.find_disk(2));
+  EXPECT_EQ(EXIT_NO_LOGICBLOCK_ERROR, manager_.del_block(2));
+  EXPECT_TRUE(NULL != manager_.get_logic_block(1));
+
+  // disk 1 has the most free blocks again
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(3, physical_id));
+  EXPECT_EQ(1, manager_.find_disk(3));
+}
+
+TEST_F(DiskManagerTest, testCompactSameDisk)
+{
+  uint32_t physical_id = 0;
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(1, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(2, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(3, physical_id));
+  ASSERT_EQ(0, manager_.find_disk(1, C_MAIN_BLOCK));
+
+  // disk 1 has more free blocks, the compact block goes to the disk of the block still
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(1, physical_id, C_COMPACT_BLOCK));
+  EXPECT_EQ(0, manager_.find_disk(1, C_COMPACT_BLOCK));
+  EXPECT_EQ(-1, manager_.find_disk(2, C_COMPACT_BLOCK));
+  EXPECT_EQ(EXIT_NO_LOGICBLOCK_ERROR, manager_.new_block(9, physical_id, C_COMPACT_BLOCK));
+  EXPECT_EQ(1, manager_.get_all_logic_block_size(C_COMPACT_BLOCK));
+
+  LogicBlock* compact_block = manager_.get_logic_block(1, C_COMPACT_BLOCK);
+  ASSERT_TRUE(NULL != compact_block);
+  EXPECT_EQ(TFS_SUCCESS, manager_.switch_compact_blk(1));
+  EXPECT_EQ(compact_block, manager_.get_logic_block(1));
+  EXPECT_EQ(EXIT_COMPACT_BLOCK_ERROR, manager_.switch_compact_blk(2));
+
+  std::set<uint32_t> erase_blocks;
+  manager_.expire_compact_blk(time(NULL) + 1, erase_blocks);
+  ASSERT_EQ(1U, erase_blocks.size());
+  EXPECT_EQ(1U, *erase_blocks.begin());
+  EXPECT_EQ(TFS_SUCCESS, manager_.del_block(1, C_COMPACT_BLOCK));
+  EXPECT_EQ(0, manager_.get_all_logic_block_size(C_COMPACT_BLOCK));
+  EXPECT_EQ(0, manager_.find_disk(1));
+}
+
+TEST_F(DiskManagerTest, testExtendBlock)
+{
+  uint32_t physical_id = 0;
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(1, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(2, physical_id));
+  LogicBlock* logic_block = manager_.get_logic_block(2);
+  ASSERT_TRUE(NULL != logic_block);
+
+  // past the main block, an extend block is taken from the disk of the block
+  const int32_t size = 4096;
+  char buf[size];
+  memset(buf, 'a', size);
+  EXPECT_EQ(TFS_SUCCESS, logic_block->write_raw_data(buf, size, fs_param_.main_block_size_));
+  EXPECT_EQ(2U, logic_block->get_physic_block_list()->size());
+  SuperBlock super_block;
+  manager_.query_super_block(super_block);
+  EXPECT_EQ(1, super_block.used_extend_block_count_);
+}
+
+TEST_F(DiskManagerTest, testIOScheduler)
+{
+  uint32_t physical_id = 0;
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(1, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.new_block(2, physical_id));
+  ASSERT_EQ(TFS_SUCCESS, manager_.initialize_io(1, 0));
+
+  // a queue and threads for each disk
+  IOScheduler* first = manager_.get_io_scheduler(1);
+  IOScheduler* second = manager_.get_io_scheduler(2);
+  EXPECT_TRUE(first != second);
+  EXPECT_TRUE(first->enabled());
+  EXPECT_TRUE(second->enabled());
+  // no disk, run inline
+  IOScheduler* none = manager_.get_io_scheduler(3);
+  EXPECT_TRUE(none != first && none != second);
+  EXPECT_FALSE(none->enabled());
+
+  const int32_t size = 4096;
+  char buf[size];
+  memset(buf, 'a', size);
+  EXPECT_EQ(TFS_SUCCESS, second->write_raw_data(IO_CLASS_WRITE, manager_.get_logic_block(2), buf, size, 0));
+  IOClassStat stat;
+  second->get_stat(IO_CLASS_WRITE, stat);
+  EXPECT_EQ(1, stat.count_);
+  first->get_stat(IO_CLASS_WRITE, stat);
+  EXPECT_EQ(0, stat.count_);
+  manager_.get_io_stat(IO_CLASS_WRITE, stat);
+  EXPECT_EQ(1, stat.count_);
+
+  manager_.set_io_policy(IO_CLASS_COMPACT, IO_POLICY_DIRECT);
+  EXPECT_EQ(IO_POLICY_DIRECT, first->get_io_policy(IO_CLASS_COMPACT));
+  EXPECT_EQ(IO_POLICY_DIRECT, second->get_io_policy(IO_CLASS_COMPACT));
+  manager_.stop_io();
+  manager_.wait_io();
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include "file_cache.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+class FileCacheTest: public ::testing::Test
+{
+  public:
+    FileCacheTest()
+    {
+    }
+    ~FileCacheTest()
+    {
+    }
+    virtual void SetUp()
+    {
+      // 32 shards, 64K per shard
+      ASSERT_EQ(TFS_SUCCESS, cache_.initialize(32 * 65536, 16384, 2));
+    }
+    virtual void TearDown()
+    {
+      cache_.clear();
+    }
+
+    // FileInfo + data, data is filled with c
+    static int32_t make_file(char* buf, const uint64_t file_id, const int32_t data_len, const char c)
+    {
+      FileInfo* finfo = reinterpret_cast<FileInfo*>(buf);
+      memset(finfo, 0, FILEINFO_SIZE);
+      finfo->id_ = file_id;
+      finfo->size_ = data_len + FILEINFO_SIZE;
+      memset(buf + FILEINFO_SIZE, c, data_len);
+      return finfo->size_;
+    }
+
+  protected:
+    FileCache cache_;
+};
+
+TEST_F(FileCacheTest, testGetPut)
+{
+  char file[4096];
+  char buf[4096];
+  uint64_t generation = 0;
+  int32_t len = make_file(file, 100, 1024, 'a');
+
+  int32_t nbytes = len;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(1, 100, 0, buf, nbytes, generation));
+  // cold block is not admitted
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 100, file, len, 1, generation));
+  EXPECT_EQ(TFS_SUCCESS, cache_.put(1, 100, file, len, 2, generation));
+
+  nbytes = sizeof(buf);
+  EXPECT_EQ(TFS_SUCCESS, cache_.get(1, 100, 0, buf, nbytes, generation));
+  EXPECT_EQ(len, nbytes);
+  EXPECT_EQ(0, memcmp(file, buf, len));
+
+  // read from middle, length truncated to the file size
+  nbytes = 1024;
+  EXPECT_EQ(TFS_SUCCESS, cache_.get(1, 100, FILEINFO_SIZE + 512, buf, nbytes, generation));
+  EXPECT_EQ(512, nbytes);
+  EXPECT_EQ('a', buf[511]);
+
+  // same file id in another block is another file
+  nbytes = len;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(2, 100, 0, buf, nbytes, generation));
+
+  ReadCacheStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(2, stat.hit_count_);
+  EXPECT_EQ(2, stat.miss_count_);
+  EXPECT_EQ(1, stat.item_count_);
+  EXPECT_EQ(len, stat.used_size_);
+}
+
+TEST_F(FileCacheTest, testAdmission)
+{
+  char file[32768];
+  uint64_t generation = 0;
+  // too large
+  int32_t len = make_file(file, 100, 20000, 'a');
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 100, file, len, 10, generation));
+
+  // deleted file
+  len = make_file(file, 100, 100, 'a');
+  reinterpret_cast<FileInfo*>(file)->flag_ = 1;
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 100, file, len, 10, generation));
+
+  // not the whole file
+  len = make_file(file, 100, 100, 'a');
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 100, file, len - 1, 10, generation));
+
+  // wrong file id
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 101, file, len, 10, generation));
+}
+
+TEST_F(FileCacheTest, testInvalidate)
+{
+  char file[4096];
+  char buf[4096];
+  uint64_t generation = 0;
+  int32_t len = make_file(file, 100, 1024, 'a');
+  int32_t nbytes = len;
+
+  EXPECT_EQ(TFS_SUCCESS, cache_.put(1, 100, file, len, 2, generation));
+  make_file(file, 101, 1024, 'b');
+  EXPECT_EQ(TFS_SUCCESS, cache_.put(1, 101, file, len, 2, generation));
+
+  cache_.erase(1, 100);
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(1, 100, 0, buf, nbytes, generation));
+  nbytes = len;
+  EXPECT_EQ(TFS_SUCCESS, cache_.get(1, 101, 0, buf, nbytes, generation));
+
+  // a reader started before the block changed must not fill the cache
+  uint64_t old_generation = 0;
+  nbytes = len;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(1, 102, 0, buf, nbytes, old_generation));
+  cache_.erase(1, 102);
+  make_file(file, 102, 1024, 'c');
+  EXPECT_NE(TFS_SUCCESS, cache_.put(1, 102, file, len, 2, old_generation));
+
+  cache_.erase_block(1);
+  nbytes = len;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(1, 101, 0, buf, nbytes, generation));
+  EXPECT_EQ(TFS_SUCCESS, cache_.put(1, 102, file, len, 2, generation));
+}
+
+TEST_F(FileCacheTest, testEvict)
+{
+  char file[16384];
+  char buf[16384];
+  uint64_t generation = 0;
+  int32_t len = make_file(file, 1, 16000, 'a');
+  // all files of block 1 go to one 64K shard, only 4 of them fit
+  for (uint64_t id = 1; id <= 5; ++id)
+  {
+    reinterpret_cast<FileInfo*>(file)->id_ = id;
+    EXPECT_EQ(TFS_SUCCESS, cache_.put(1, id, file, len, 2, generation));
+  }
+
+  int32_t nbytes = len;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, cache_.get(1, 1, 0, buf, nbytes, generation));
+  nbytes = len;
+  EXPECT_EQ(TFS_SUCCESS, cache_.get(1, 5, 0, buf, nbytes, generation));
+
+  ReadCacheStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(1, stat.evict_count_);
+  EXPECT_EQ(4, stat.item_count_);
+  EXPECT_TRUE(stat.used_size_ <= 65536);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -13,6 +13,7 @@
  *      - initial release
  *
  */
+#include <vector>
 #include <gtest/gtest.h>
 #include "file_op.h"
 
@@ -187,6 +188,76 @@ TEST_F(FileOperationTest, testUnlink)
   file_op = NULL;
 }
 
+TEST_F(FileOperationTest, testPwritev)
+{
+  char buf[] = "hello";
+  char buf1[] = "world";
+  char read_buf[32];
+  struct iovec iov[2];
+  iov[0].iov_base = buf;
+  iov[0].iov_len = strlen(buf);
+  iov[1].iov_base = buf1;
+  iov[1].iov_len = strlen(buf1) + 1;
+
+  FileOperation* file_op = NULL;
+  file_op = new FileOperation(FILE_NAME, O_RDWR | O_LARGEFILE | O_CREAT);
+
+  file_op->ftruncate_file(0);
+  EXPECT_EQ(file_op->pwritev_file(iov, 2, 1), 0);
+  EXPECT_EQ(file_op->get_file_size(), static_cast<int64_t>(strlen(buf) + strlen(buf1) + 2));
+  EXPECT_EQ(file_op->pread_file(read_buf, strlen(buf) + strlen(buf1) + 1, 1), 0);
+  EXPECT_STREQ("helloworld", read_buf);
+  // iov is not changed
+  EXPECT_EQ(buf, iov[0].iov_base);
+  EXPECT_EQ(strlen(buf), iov[0].iov_len);
+
+  file_op->unlink_file();
+  delete file_op;
+  file_op = NULL;
+}
+
+TEST_F(FileOperationTest, testIOPolicy)
+{
+  const int32_t len = 3 * 1024 * 1024 + 100;
+  std::vector<char> buf(len);
+  std::vector<char> read_buf(len);
+  for (int32_t i = 0; i < len; ++i)
+  {
+    buf[i] = static_cast<char>(i % 251);
+  }
+
+  FileOperation* file_op = NULL;
+  file_op = new FileOperation(FILE_NAME, O_RDWR | O_LARGEFILE | O_CREAT);
+  file_op->ftruncate_file(0);
+  // aligned write goes direct, unaligned one through page cache
+  EXPECT_EQ(0, file_op->pwrite_file_ex(&buf[0], 2 * 1024 * 1024, 0, IO_POLICY_DIRECT));
+  EXPECT_EQ(0, file_op->pwrite_file_ex(&buf[2 * 1024 * 1024], len - 2 * 1024 * 1024, 2 * 1024 * 1024,
+        IO_POLICY_DIRECT));
+  EXPECT_EQ(len, file_op->get_file_size());
+
+  const IOPolicy policies[] = { IO_POLICY_CACHED, IO_POLICY_DONTNEED, IO_POLICY_DIRECT };
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i)
+  {
+    // unaligned offset and length, across aligned buffers
+    memset(&read_buf[0], 0, len);
+    EXPECT_EQ(0, file_op->pread_file_ex(&read_buf[0], len - 4197, 4097, policies[i]));
+    EXPECT_EQ(0, memcmp(&buf[4097], &read_buf[0], len - 4197));
+
+    EXPECT_EQ(0, file_op->pread_file_ex(&read_buf[0], 10, len - 10, policies[i]));
+    EXPECT_EQ(0, memcmp(&buf[len - 10], &read_buf[0], 10));
+    // beyond end of file
+    EXPECT_NE(0, file_op->pread_file_ex(&read_buf[0], 20, len - 10, policies[i]));
+  }
+
+  EXPECT_EQ(0, file_op->pwrite_file_ex("hello", 5, 100, IO_POLICY_DONTNEED));
+  EXPECT_EQ(0, file_op->pread_file_ex(&read_buf[0], 5, 100, IO_POLICY_DIRECT));
+  EXPECT_EQ(0, memcmp("hello", &read_buf[0], 5));
+
+  file_op->unlink_file();
+  delete file_op;
+  file_op = NULL;
+}
+
 int main(int argc, char* argv[])
 {
   testing::InitGoogleTest(&argc, argv);
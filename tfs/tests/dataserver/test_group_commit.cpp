@@ -0,0 +1,342 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <algorithm>
+#include <set>
+#include <tbsys.h>
+#include <tbtimeutil.h>
+#include "logic_block.h"
+#include "physical_block.h"
+#include "data_file.h"
+#include "common/func.h"
+#include "common/parameter.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATH = "./group_commit_mount";
+static const uint32_t BLOCK_ID = 1;
+static const int32_t BLOCK_LENGTH = 8 * 1024 * 1024;
+static const int32_t BUCKET_SIZE = 64;
+static const int32_t THREAD_COUNT = 8;
+static const int32_t MAX_DELAY = 50000; // us
+
+class GroupCommitTest: public ::testing::Test
+{
+  public:
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      char path[256];
+      // left by a run that did not finish
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), BLOCK_ID);
+      unlink(path);
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      int fd = open(path, O_RDWR | O_CREAT, 0644);
+      EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+      close(fd);
+
+      physical_ = new PhysicalBlock(BLOCK_ID, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+      block_ = new LogicBlock(BLOCK_ID, BLOCK_ID, MOUNT_PATH);
+      block_->add_physic_block(physical_);
+      EXPECT_EQ(TFS_SUCCESS, block_->init_block_file(BUCKET_SIZE, mmap_option(), C_MAIN_BLOCK));
+
+      // a leader waits long enough for all writers to join its group
+      SYSPARAM_DATASERVER.group_commit_max_delay_ = MAX_DELAY;
+      SYSPARAM_DATASERVER.group_commit_max_count_ = THREAD_COUNT;
+    }
+    virtual void TearDown()
+    {
+      SYSPARAM_DATASERVER.group_commit_max_delay_ = 0;
+      SYSPARAM_DATASERVER.group_commit_max_count_ = 32;
+      delete block_;
+      delete physical_;
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      unlink(path);
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), BLOCK_ID);
+      unlink(path);
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+    }
+
+    static MMapOption mmap_option()
+    {
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = 4 * 1024;
+      op.per_mmap_size_ = 4 * 1024;
+      return op;
+    }
+
+    // the block as a restarted dataserver sees it, from what is on disk only
+    void reload()
+    {
+      delete block_;
+      block_ = new LogicBlock(BLOCK_ID, BLOCK_ID, MOUNT_PATH);
+      block_->add_physic_block(physical_);
+      ASSERT_EQ(TFS_SUCCESS, block_->load_block_file(BUCKET_SIZE, mmap_option()));
+    }
+
+    static void fill_data(const uint64_t id, const int32_t seed, char* data, const int32_t size)
+    {
+      for (int32_t i = 0; i < size; ++i)
+      {
+        data[i] = static_cast<char>(id * 31 + seed * 7 + i / 5);
+      }
+    }
+
+    // a new file if file_id is 0, file_id is then the one given to the writer
+    static int write_file(LogicBlock* block, uint64_t& file_id, const int32_t seed, const int32_t size)
+    {
+      int ret = 0 == file_id ? block->open_write_file(file_id) : TFS_SUCCESS;
+      if (TFS_SUCCESS == ret)
+      {
+        std::vector<char> data(size);
+        fill_data(file_id, seed, &data[0], size);
+        DataFile datafile(file_id, MOUNT_PATH);
+        datafile.set_data(&data[0], size, 0);
+        ret = block->close_write_file(file_id, &datafile, datafile.get_crc());
+      }
+      return ret;
+    }
+
+    // the file is read whole with its own data, offset is where it lies in the block
+    static void check_file(LogicBlock* block, const uint64_t file_id, const int32_t seed, const int32_t size,
+        int32_t* offset = NULL)
+    {
+      std::vector<char> buf(sizeof(FileInfo) + size + 1);
+      int32_t nbytes = buf.size();
+      ASSERT_EQ(TFS_SUCCESS, block->read_file(file_id, &buf[0], nbytes, 0, 0)) << "fileid: " << file_id;
+      ASSERT_EQ(static_cast<int32_t>(sizeof(FileInfo) + size), nbytes) << "fileid: " << file_id;
+      const FileInfo* finfo = reinterpret_cast<const FileInfo*>(&buf[0]);
+      EXPECT_EQ(file_id, finfo->id_);
+      std::vector<char> expect(size);
+      fill_data(file_id, seed, &expect[0], size);
+      EXPECT_EQ(0, memcmp(&expect[0], &buf[sizeof(FileInfo)], size)) << "fileid: " << file_id;
+      EXPECT_EQ(Func::crc(0, &expect[0], size), finfo->crc_) << "fileid: " << file_id;
+      if (NULL != offset)
+      {
+        *offset = finfo->offset_;
+      }
+    }
+
+    // files of the block lie one after another from the start, none overlaps another
+    static void check_layout(LogicBlock* block, const int32_t file_count)
+    {
+      RawMetaVec metas;
+      ASSERT_EQ(TFS_SUCCESS, block->get_meta_infos(metas));
+      ASSERT_EQ(file_count, static_cast<int32_t>(metas.size()));
+      std::vector<std::pair<int32_t, int32_t> > spans;
+      for (RawMetaVecIter it = metas.begin(); it != metas.end(); ++it)
+      {
+        spans.push_back(std::make_pair(it->get_offset(), it->get_size()));
+      }
+      std::sort(spans.begin(), spans.end());
+      for (size_t i = 1; i < spans.size(); ++i)
+      {
+        EXPECT_LE(spans[i - 1].first + spans[i - 1].second, spans[i].first);
+      }
+      EXPECT_EQ(file_count, block->get_block_info()->file_count_);
+      EXPECT_LE(spans.back().first + spans.back().second, block->get_data_file_size());
+    }
+
+    // the files of one writer, in the order it closed them
+    struct WriterArgs
+    {
+      LogicBlock* block_;
+      int32_t seed_;
+      std::vector<uint64_t> file_ids_;  // 0 for a new file
+      std::vector<int32_t> sizes_;
+      std::vector<int> rets_;
+    };
+
+    static void* writer(void* arg)
+    {
+      WriterArgs* args = static_cast<WriterArgs*>(arg);
+      for (size_t i = 0; i < args->file_ids_.size(); ++i)
+      {
+        args->rets_.push_back(write_file(args->block_, args->file_ids_[i], args->seed_, args->sizes_[i]));
+      }
+      return NULL;
+    }
+
+    static void run_writers(std::vector<WriterArgs>& args)
+    {
+      std::vector<pthread_t> threads(args.size());
+      for (size_t i = 0; i < args.size(); ++i)
+      {
+        pthread_create(&threads[i], NULL, writer, &args[i]);
+      }
+      for (size_t i = 0; i < args.size(); ++i)
+      {
+        pthread_join(threads[i], NULL);
+      }
+    }
+
+  protected:
+    PhysicalBlock* physical_;
+    LogicBlock* block_;
+};
+
+// a lone writer waits for company as long as it may, then commits alone
+TEST_F(GroupCommitTest, testLoneWriter)
+{
+  uint64_t file_id = 0;
+  int64_t start = tbsys::CTimeUtil::getTime();
+  ASSERT_EQ(TFS_SUCCESS, write_file(block_, file_id, 1, 1000));
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  EXPECT_GE(cost, MAX_DELAY * 9 / 10);
+  check_file(block_, file_id, 1, 1000);
+  check_layout(block_, 1);
+}
+
+// writers close new files at once, every one of them gets its own file back, laid out in
+// the order they are committed, and all of them are on disk when the closes return
+TEST_F(GroupCommitTest, testConcurrentWriters)
+{
+  const int32_t round_count = 20;
+  std::vector<WriterArgs> args(THREAD_COUNT);
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    args[i].block_ = block_;
+    args[i].seed_ = 1;
+    for (int32_t j = 0; j < round_count; ++j)
+    {
+      args[i].file_ids_.push_back(0);
+      args[i].sizes_.push_back(100 + (i * round_count + j) * 37 % 4000);
+    }
+  }
+
+  int64_t start = tbsys::CTimeUtil::getTime();
+  run_writers(args);
+  int64_t cost = tbsys::CTimeUtil::getTime() - start;
+  // full groups are committed at once, a leader of its own every time would wait MAX_DELAY
+  // for each close
+  EXPECT_LT(cost, static_cast<int64_t>(round_count) * MAX_DELAY);
+
+  std::set<uint64_t> file_ids;
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    ASSERT_EQ(round_count, static_cast<int32_t>(args[i].rets_.size()));
+    int32_t last_offset = -1;
+    for (int32_t j = 0; j < round_count; ++j)
+    {
+      EXPECT_EQ(TFS_SUCCESS, args[i].rets_[j]);
+      EXPECT_TRUE(file_ids.insert(args[i].file_ids_[j]).second) << "fileid: " << args[i].file_ids_[j];
+      int32_t offset = 0;
+      check_file(block_, args[i].file_ids_[j], 1, args[i].sizes_[j], &offset);
+      // a later close of a writer is committed in a later group
+      EXPECT_GT(offset, last_offset);
+      last_offset = offset;
+    }
+  }
+  check_layout(block_, THREAD_COUNT * round_count);
+
+  reload();
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    for (int32_t j = 0; j < round_count; ++j)
+    {
+      check_file(block_, args[i].file_ids_[j], 1, args[i].sizes_[j]);
+    }
+  }
+  check_layout(block_, THREAD_COUNT * round_count);
+}
+
+// a group of new files, files rewritten in their space and files grown larger, each writer
+// sees its own change and nothing of the others
+TEST_F(GroupCommitTest, testMixedGroup)
+{
+  const int32_t size = 2000;
+  const int32_t files_per_writer = 4;
+  std::vector<WriterArgs> args(THREAD_COUNT);
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    args[i].block_ = block_;
+    args[i].seed_ = 1;
+    args[i].file_ids_.assign(files_per_writer, 0);
+    args[i].sizes_.assign(files_per_writer, size);
+  }
+  run_writers(args);
+  int32_t old_offsets[THREAD_COUNT][files_per_writer];
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    for (int32_t j = 0; j < files_per_writer; ++j)
+    {
+      ASSERT_EQ(TFS_SUCCESS, args[i].rets_[j]);
+      check_file(block_, args[i].file_ids_[j], 1, size, &old_offsets[i][j]);
+    }
+  }
+  int32_t old_data_size = block_->get_data_file_size();
+
+  // even writers rewrite their files smaller, odd ones larger, and every writer adds a new file
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    args[i].seed_ = 2;
+    args[i].rets_.clear();
+    for (int32_t j = 0; j < files_per_writer; ++j)
+    {
+      args[i].sizes_[j] = 0 == i % 2 ? size - 100 * (j + 1) : size + 100 * (j + 1);
+    }
+    args[i].file_ids_.push_back(0);
+    args[i].sizes_.push_back(500 + i);
+  }
+  run_writers(args);
+
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    ASSERT_EQ(files_per_writer + 1, static_cast<int32_t>(args[i].rets_.size()));
+    for (int32_t j = 0; j <= files_per_writer; ++j)
+    {
+      EXPECT_EQ(TFS_SUCCESS, args[i].rets_[j]);
+      int32_t offset = 0;
+      check_file(block_, args[i].file_ids_[j], 2, args[i].sizes_[j], &offset);
+      if (j == files_per_writer)
+      {
+        EXPECT_GE(offset, old_data_size);
+      }
+      else if (0 == i % 2)
+      {
+        EXPECT_EQ(old_offsets[i][j], offset);
+      }
+      else
+      {
+        EXPECT_GE(offset, old_data_size);
+      }
+    }
+  }
+  check_layout(block_, THREAD_COUNT * (files_per_writer + 1));
+
+  reload();
+  for (int32_t i = 0; i < THREAD_COUNT; ++i)
+  {
+    for (int32_t j = 0; j <= files_per_writer; ++j)
+    {
+      check_file(block_, args[i].file_ids_[j], 2, args[i].sizes_[j]);
+    }
+  }
+  check_layout(block_, THREAD_COUNT * (files_per_writer + 1));
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -18,6 +18,8 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <signal.h>
+#include <sys/resource.h>
 #include <tbsys.h>
 #include "index_handle.h"
 #include "common/error_msg.h"
@@ -509,6 +511,149 @@ TEST_F(TestIndexHandle, testDeleteSegmentMeta)
   EXPECT_EQ(50, i); // 50 elems in free list
 }
 
+TEST_F(TestIndexHandle, testApplyBatch)
+{
+  IndexHandle* handle = empty;
+  EXPECT_EQ(0, handle->create(1, 16, op, C_DATA_CLEAN));
+  EXPECT_EQ(0, handle->build_meta_table());
+  EXPECT_EQ(0, handle->write_segment_meta(1, RawMeta(1, 10, 10)));
+  // past the map of 1024 bytes, the nodes go by write of file
+  IndexBatch batch;
+  for (int32_t i = 2; i <= 100; ++i)
+  {
+    batch.write_meta(RawMeta(i, i * 10, 100));
+    batch.update_block_info(C_OPER_INSERT, 100);
+  }
+  EXPECT_EQ(0, handle->apply_batch(batch));
+  EXPECT_EQ(99, static_cast<int32_t>(handle->block_info()->file_count_));
+  EXPECT_EQ(99 * 100, static_cast<int32_t>(handle->block_info()->size_));
+  EXPECT_EQ(99, static_cast<int32_t>(handle->block_info()->version_));
+
+  batch.clear();
+  batch.delete_meta(1);
+  batch.delete_meta(18);
+  batch.update_meta(RawMeta(50, 5000, 200));
+  batch.override_meta(RawMeta(51, 5100, 300));
+  batch.override_meta(RawMeta(200, 20000, 400));
+  // the node freed above is reused, then freed again
+  batch.write_meta(RawMeta(201, 20100, 400));
+  batch.delete_meta(201);
+  batch.update_block_info(C_OPER_DELETE, 100);
+  EXPECT_EQ(0, handle->apply_batch(batch));
+  EXPECT_EQ(1, static_cast<int32_t>(handle->block_info()->del_file_count_));
+
+  RawMeta meta;
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(1, meta));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(18, meta));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(201, meta));
+  EXPECT_EQ(0, handle->read_segment_meta(50, meta));
+  EXPECT_EQ(5000, meta.get_offset());
+  EXPECT_EQ(0, handle->read_segment_meta(51, meta));
+  EXPECT_EQ(300, meta.get_size());
+  EXPECT_EQ(0, handle->read_segment_meta(200, meta));
+  EXPECT_EQ(20000, meta.get_offset());
+  RawMetaVec metas;
+  EXPECT_EQ(0, handle->traverse_segment_meta(metas));
+  EXPECT_EQ(99U, metas.size());
+
+  // the same after the table is built from the chains again
+  EXPECT_EQ(0, handle->build_meta_table());
+  EXPECT_EQ(0, handle->read_segment_meta(34, meta));
+  EXPECT_EQ(340, meta.get_offset());
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(18, meta));
+  // a freed node is reused by a single write too
+  EXPECT_EQ(0, handle->write_segment_meta(18, RawMeta(18, 1800, 100)));
+  EXPECT_EQ(0, handle->read_segment_meta(18, meta));
+  EXPECT_EQ(1800, meta.get_offset());
+}
+
+TEST_F(TestIndexHandle, testApplyBatchAllOrNone)
+{
+  IndexHandle* handle = empty;
+  EXPECT_EQ(0, handle->create(1, 16, op, C_DATA_CLEAN));
+  EXPECT_EQ(0, handle->write_segment_meta(1, RawMeta(1, 10, 10)));
+  IndexHeader header;
+  memcpy(&header, handle->index_header(), sizeof(IndexHeader));
+
+  IndexBatch batch;
+  batch.write_meta(RawMeta(2, 20, 100));
+  batch.delete_meta(1);
+  batch.update_block_info(C_OPER_INSERT, 100);
+  // not there
+  batch.update_meta(RawMeta(3, 30, 100));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->apply_batch(batch));
+
+  EXPECT_EQ(0, memcmp(&header, handle->index_header(), sizeof(IndexHeader)));
+  RawMeta meta;
+  EXPECT_EQ(0, handle->read_segment_meta(1, meta));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(2, meta));
+
+  batch.clear();
+  batch.write_meta(RawMeta(1, 10, 10));
+  EXPECT_EQ(EXIT_META_UNEXPECT_FOUND_ERROR, handle->apply_batch(batch));
+  EXPECT_EQ(0, memcmp(&header, handle->index_header(), sizeof(IndexHeader)));
+}
+
+TEST_F(TestIndexHandle, testApplyBatchWriteFail)
+{
+  IndexHandle* handle = empty;
+  EXPECT_EQ(0, handle->create(1, 16, op, C_DATA_CLEAN));
+  EXPECT_EQ(0, handle->build_meta_table());
+  IndexBatch batch;
+  for (int32_t i = 1; i <= 100; ++i)
+  {
+    batch.write_meta(RawMeta(i, i * 10, 100));
+  }
+  EXPECT_EQ(0, handle->apply_batch(batch));
+  IndexHeader header;
+  memcpy(&header, handle->index_header(), sizeof(IndexHeader));
+  RawMetaVec old_metas;
+  EXPECT_EQ(0, handle->traverse_segment_meta(old_metas));
+
+  // nodes in the map change in place, then the new nodes past the end of file fail to write
+  struct rlimit old_limit, limit;
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  limit = old_limit;
+  limit.rlim_cur = header.index_file_size_;
+  signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+  batch.clear();
+  batch.update_meta(RawMeta(1, 5000, 200));
+  batch.delete_meta(2);
+  for (int32_t i = 101; i <= 120; ++i)
+  {
+    batch.write_meta(RawMeta(i, i * 10, 100));
+  }
+  EXPECT_NE(0, handle->apply_batch(batch));
+  setrlimit(RLIMIT_FSIZE, &old_limit);
+  signal(SIGXFSZ, SIG_DFL);
+
+  // the index on disk is as before the batch
+  EXPECT_EQ(0, memcmp(&header, handle->index_header(), sizeof(IndexHeader)));
+  EXPECT_EQ(0, handle->build_meta_table());
+  RawMetaVec metas;
+  EXPECT_EQ(0, handle->traverse_segment_meta(metas));
+  ASSERT_EQ(old_metas.size(), metas.size());
+  for (uint32_t i = 0; i < metas.size(); ++i)
+  {
+    EXPECT_EQ(old_metas[i].get_file_id(), metas[i].get_file_id());
+    EXPECT_EQ(old_metas[i].get_offset(), metas[i].get_offset());
+    EXPECT_EQ(old_metas[i].get_size(), metas[i].get_size());
+  }
+  RawMeta meta;
+  EXPECT_EQ(0, handle->read_segment_meta(1, meta));
+  EXPECT_EQ(10, meta.get_offset());
+  EXPECT_EQ(0, handle->read_segment_meta(2, meta));
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(101, meta));
+
+  // and takes the batch once the writes go
+  EXPECT_EQ(0, handle->apply_batch(batch));
+  EXPECT_EQ(0, handle->read_segment_meta(1, meta));
+  EXPECT_EQ(5000, meta.get_offset());
+  EXPECT_EQ(EXIT_META_NOT_FOUND_ERROR, handle->read_segment_meta(2, meta));
+  EXPECT_EQ(0, handle->read_segment_meta(120, meta));
+}
+
 TEST_F(TestIndexHandle, testMetaRW)
 {
   uint32_t logic_block_id =101;
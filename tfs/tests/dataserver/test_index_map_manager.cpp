@@ -0,0 +1,193 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include "index_map_manager.h"
+#include "logic_block.h"
+#include "physical_block.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const char* MOUNT_PATH = "./index_map_mount";
+static const int32_t BLOCK_LENGTH = 1024 * 1024;
+static const int32_t BLOCK_COUNT = 4;
+static const int32_t FIRST_MMAP_SIZE = 64 * 1024;
+
+class IndexMapManagerTest: public ::testing::Test
+{
+  public:
+    IndexMapManagerTest()
+    {
+    }
+    ~IndexMapManagerTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = FIRST_MMAP_SIZE;
+      op.per_mmap_size_ = 64 * 1024;
+      for (int32_t i = 0; i < BLOCK_COUNT; ++i)
+      {
+        uint32_t block_id = i + 1;
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, block_id);
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+        close(fd);
+
+        physicals_[i] = new PhysicalBlock(block_id, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+        blocks_[i] = new LogicBlock(block_id, block_id, MOUNT_PATH);
+        blocks_[i]->add_physic_block(physicals_[i]);
+        EXPECT_EQ(TFS_SUCCESS, blocks_[i]->init_block_file(1024, op, C_MAIN_BLOCK));
+
+        BlockInfo info;
+        memset(&info, 0, sizeof(info));
+        info.block_id_ = block_id;
+        info.file_count_ = 100;
+        info.size_ = 100 * 1024;
+        RawMetaVec metas;
+        for (int32_t j = 1; j <= 100; ++j)
+        {
+          metas.push_back(RawMeta(j, (j - 1) * 1024, 1024));
+        }
+        EXPECT_EQ(TFS_SUCCESS, blocks_[i]->batch_write_meta(&info, &metas));
+        logic_blocks_.push_back(blocks_[i]);
+      }
+    }
+    virtual void TearDown()
+    {
+      for (int32_t i = 0; i < BLOCK_COUNT; ++i)
+      {
+        delete blocks_[i];
+        delete physicals_[i];
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, i + 1);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), i + 1);
+        unlink(path);
+      }
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+    }
+
+    void visit(const int32_t index, const int32_t count)
+    {
+      for (int32_t i = 0; i < count; ++i)
+      {
+        blocks_[index]->add_visit_count();
+      }
+      blocks_[index]->set_last_access(time(NULL));
+    }
+
+  protected:
+    LogicBlock* blocks_[BLOCK_COUNT];
+    PhysicalBlock* physicals_[BLOCK_COUNT];
+    std::list<LogicBlock*> logic_blocks_;
+};
+
+TEST_F(IndexMapManagerTest, testStat)
+{
+  IndexMapManager manager;
+  manager.initialize(0, 0, false);
+  manager.check(logic_blocks_);
+  IndexMapStat stat;
+  manager.get_stat(stat);
+  EXPECT_EQ(0, stat.budget_);
+  EXPECT_EQ(BLOCK_COUNT, stat.block_count_);
+  EXPECT_EQ(BLOCK_COUNT * FIRST_MMAP_SIZE, stat.map_size_);
+  // no budget nor pin, the pages are not scanned
+  EXPECT_EQ(0, stat.resident_size_);
+  EXPECT_EQ(0, stat.pinned_count_);
+  EXPECT_EQ(0, stat.release_count_);
+  EXPECT_NE(std::string::npos, manager.format_stat().find("unlimited"));
+
+  // the header and buckets written by init and batch write are there
+  manager.initialize(stat.map_size_, 0, false);
+  manager.check(logic_blocks_);
+  manager.get_stat(stat);
+  EXPECT_EQ(BLOCK_COUNT, stat.block_count_);
+  EXPECT_GT(stat.resident_size_, 0);
+  EXPECT_LE(stat.resident_size_, stat.map_size_);
+  EXPECT_EQ(0, stat.release_count_);
+}
+
+TEST_F(IndexMapManagerTest, testPinHottest)
+{
+  IndexMapManager manager;
+  manager.initialize(0, 1, false);
+  visit(2, 10);
+  visit(1, 3);
+  manager.check(logic_blocks_);
+  IndexMapStat stat;
+  manager.get_stat(stat);
+  EXPECT_EQ(1, stat.pinned_count_);
+
+  // scores cool down by half at every check, a burst elsewhere takes the pin
+  visit(0, 100);
+  manager.check(logic_blocks_);
+  manager.get_stat(stat);
+  EXPECT_EQ(1, stat.pinned_count_);
+
+  // all over a budget of one byte, block 2 is released with the others now that it is not pinned
+  manager.initialize(1, 1, false);
+  manager.check(logic_blocks_);
+  manager.get_stat(stat);
+  EXPECT_EQ(BLOCK_COUNT - 1, stat.release_count_);
+  EXPECT_GT(blocks_[0]->get_index_resident_size(), 0);
+}
+
+TEST_F(IndexMapManagerTest, testReleaseColdest)
+{
+  IndexMapManager manager;
+  manager.initialize(BLOCK_COUNT * FIRST_MMAP_SIZE, 0, false);
+  manager.check(logic_blocks_);
+  IndexMapStat stat;
+  manager.get_stat(stat);
+  int64_t resident_size = stat.resident_size_;
+  ASSERT_GT(resident_size, 0);
+
+  // budget leaves room for all but about one block, the one accessed longest ago goes
+  blocks_[0]->set_last_access(time(NULL) - 100);
+  for (int32_t i = 1; i < BLOCK_COUNT; ++i)
+  {
+    blocks_[i]->set_last_access(time(NULL));
+  }
+  int32_t coldest_size = blocks_[0]->get_index_resident_size();
+  manager.initialize(resident_size - coldest_size, 0, false);
+  manager.check(logic_blocks_);
+  manager.get_stat(stat);
+  EXPECT_EQ(1, stat.release_count_);
+  EXPECT_LE(stat.resident_size_, stat.budget_);
+
+  // a released index is still there to use
+  RawMetaVec metas;
+  EXPECT_EQ(TFS_SUCCESS, blocks_[0]->get_meta_infos(metas));
+  EXPECT_EQ(100U, metas.size());
+  EXPECT_EQ(100U, blocks_[0]->get_block_info()->file_count_);
+  EXPECT_GT(blocks_[0]->get_index_resident_size(), 0);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
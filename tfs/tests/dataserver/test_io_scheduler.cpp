@@ -0,0 +1,187 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <vector>
+#include "io_scheduler.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+// records the order tasks are run in
+class OrderTask: public IOTask
+{
+  public:
+    OrderTask(std::vector<int>& order, tbutil::Mutex& mutex, const int tag) :
+      order_(order), mutex_(mutex), tag_(tag)
+    {
+    }
+    virtual void run()
+    {
+      tbutil::Mutex::Lock lock(mutex_);
+      order_.push_back(tag_);
+    }
+  private:
+    std::vector<int>& order_;
+    tbutil::Mutex& mutex_;
+    int tag_;
+};
+
+// holds the io thread until opened
+class GateTask: public IOTask
+{
+  public:
+    GateTask(tbutil::Monitor<tbutil::Mutex>& monitor, bool& running, bool& open) :
+      monitor_(monitor), running_(running), open_(open)
+    {
+    }
+    virtual void run()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      running_ = true;
+      monitor_.notifyAll();
+      while (!open_)
+      {
+        monitor_.wait();
+      }
+    }
+  private:
+    tbutil::Monitor<tbutil::Mutex>& monitor_;
+    bool& running_;
+    bool& open_;
+};
+
+class IOSchedulerTest: public ::testing::Test
+{
+  public:
+    IOSchedulerTest() : running_(false), open_(false)
+    {
+    }
+    ~IOSchedulerTest()
+    {
+    }
+    virtual void SetUp()
+    {
+    }
+    virtual void TearDown()
+    {
+    }
+
+    void hold(IOScheduler& scheduler)
+    {
+      ASSERT_EQ(TFS_SUCCESS, scheduler.submit(new GateTask(monitor_, running_, open_), IO_CLASS_READ));
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      while (!running_)
+      {
+        monitor_.wait();
+      }
+    }
+
+    void release()
+    {
+      tbutil::Monitor<tbutil::Mutex>::Lock lock(monitor_);
+      open_ = true;
+      monitor_.notifyAll();
+    }
+
+  protected:
+    tbutil::Monitor<tbutil::Mutex> monitor_;
+    bool running_;
+    bool open_;
+    std::vector<int> order_;
+    tbutil::Mutex order_mutex_;
+};
+
+TEST_F(IOSchedulerTest, testInline)
+{
+  IOScheduler scheduler;
+  ASSERT_EQ(TFS_SUCCESS, scheduler.initialize("/tmp", 0, 0));
+  EXPECT_FALSE(scheduler.enabled());
+  OrderTask task(order_, order_mutex_, 1);
+  EXPECT_EQ(EXIT_IO_QUEUE_FULL_ERROR, scheduler.submit(&task, IO_CLASS_READ));
+  // run in this thread
+  scheduler.execute(task, IO_CLASS_COMPACT);
+  ASSERT_EQ(1U, order_.size());
+}
+
+TEST_F(IOSchedulerTest, testWeight)
+{
+  IOScheduler scheduler;
+  ASSERT_EQ(TFS_SUCCESS, scheduler.initialize("/tmp", 1, 0));
+  hold(scheduler);
+  // compaction is queued first, still reads go before most of it
+  for (int i = 0; i < 16; ++i)
+  {
+    EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, IO_CLASS_COMPACT), IO_CLASS_COMPACT));
+  }
+  for (int i = 0; i < 16; ++i)
+  {
+    EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, IO_CLASS_READ), IO_CLASS_READ));
+  }
+  EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, IO_CLASS_WRITE), IO_CLASS_WRITE));
+  IOClassStat stat;
+  scheduler.get_stat(IO_CLASS_COMPACT, stat);
+  EXPECT_EQ(16, stat.queue_depth_);
+  release();
+
+  // blocking execute, queued behind all compaction, so everything is done when it returns
+  OrderTask last(order_, order_mutex_, IO_CLASS_COUNT);
+  scheduler.execute(last, IO_CLASS_COMPACT);
+
+  // the gate took one read credit of the first round:
+  // 7 reads, the write, 1 compaction, 8 reads, 1 compaction, the last read, then compaction
+  ASSERT_EQ(34U, order_.size());
+  EXPECT_EQ(IO_CLASS_WRITE, order_[7]);
+  EXPECT_EQ(IO_CLASS_COMPACT, order_[8]);
+  EXPECT_EQ(IO_CLASS_COMPACT, order_[17]);
+  EXPECT_EQ(IO_CLASS_READ, order_[18]);
+  EXPECT_EQ(IO_CLASS_COUNT, order_[33]);
+  int compact_count = 0;
+  for (int i = 0; i < 19; ++i)
+  {
+    compact_count += IO_CLASS_COMPACT == order_[i] ? 1 : 0;
+  }
+  EXPECT_EQ(2, compact_count);
+
+  scheduler.get_stat(IO_CLASS_READ, stat);
+  EXPECT_EQ(17, stat.count_);
+  EXPECT_EQ(0, stat.queue_depth_);
+  scheduler.get_stat(IO_CLASS_COMPACT, stat);
+  EXPECT_EQ(17, stat.count_);
+  EXPECT_TRUE(stat.wait_time_ > 0);
+  scheduler.stop();
+  scheduler.wait();
+}
+
+TEST_F(IOSchedulerTest, testQueueFull)
+{
+  IOScheduler scheduler;
+  ASSERT_EQ(TFS_SUCCESS, scheduler.initialize("/tmp", 1, 2));
+  hold(scheduler);
+  EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, 0), IO_CLASS_READ));
+  EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, 0), IO_CLASS_READ));
+  OrderTask task(order_, order_mutex_, 0);
+  EXPECT_EQ(EXIT_IO_QUEUE_FULL_ERROR, scheduler.submit(&task, IO_CLASS_READ));
+  // every class has its own queue
+  EXPECT_EQ(TFS_SUCCESS, scheduler.submit(new OrderTask(order_, order_mutex_, 0), IO_CLASS_COMPACT));
+  release();
+  scheduler.stop();
+  scheduler.wait();
+  EXPECT_EQ(3U, order_.size());
+  EXPECT_EQ(EXIT_IO_QUEUE_FULL_ERROR, scheduler.submit(&task, IO_CLASS_READ));
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
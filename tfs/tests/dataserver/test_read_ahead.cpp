@@ -0,0 +1,248 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include "read_ahead.h"
+#include "logic_block.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+
+static const std::string MOUNT_PATH = "./mount_read_ahead";
+static const int32_t FILE_SIZE = 2 * 1024 * 1024;
+static const int32_t WINDOW_SIZE = 256 * 1024;
+static const int32_t PIECE_SIZE = 64 * 1024;
+
+class ReadAheadTest: public ::testing::Test
+{
+  protected:
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+
+    static void TearDownTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("debug");
+    }
+
+  public:
+    ReadAheadTest() : logic_block_(NULL), physical_block_(NULL), data_handle_(NULL)
+    {
+    }
+    ~ReadAheadTest()
+    {
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH.c_str(), 0775);
+      std::string file_name = MOUNT_PATH + "/1";
+      close(open(file_name.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR));
+
+      logic_block_ = new LogicBlock(1);
+      physical_block_ = new PhysicalBlock(1, MOUNT_PATH, FILE_SIZE + BLOCK_RESERVER_LENGTH, C_MAIN_BLOCK);
+      logic_block_->add_physic_block(physical_block_);
+      data_handle_ = new DataHandle(logic_block_);
+
+      std::vector<char> data(FILE_SIZE);
+      make_data(&data[0], FILE_SIZE, 0, 0);
+      ASSERT_EQ(TFS_SUCCESS, data_handle_->write_segment_data(&data[0], FILE_SIZE, 0));
+      // 16 shards, one window per shard
+      ASSERT_EQ(TFS_SUCCESS, cache_.initialize(16 * WINDOW_SIZE, WINDOW_SIZE));
+    }
+    virtual void TearDown()
+    {
+      cache_.clear();
+      tbsys::gDelete(data_handle_);
+      tbsys::gDelete(physical_block_);
+      tbsys::gDelete(logic_block_);
+      unlink((MOUNT_PATH + "/1").c_str());
+      rmdir(MOUNT_PATH.c_str());
+    }
+
+    static void make_data(char* buf, const int32_t len, const int32_t offset, const int32_t seed)
+    {
+      for (int32_t i = 0; i < len; ++i)
+      {
+        buf[i] = static_cast<char>((offset + i + seed) % 251);
+      }
+    }
+
+    // read the whole file by pieces, check every piece
+    int read_all(const int32_t seed)
+    {
+      std::vector<char> buf(PIECE_SIZE);
+      std::vector<char> expect(PIECE_SIZE);
+      for (int32_t offset = 0; offset < FILE_SIZE; offset += PIECE_SIZE)
+      {
+        int ret = cache_.read(1, 10, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, offset);
+        make_data(&expect[0], PIECE_SIZE, offset, seed);
+        if (TFS_SUCCESS != ret || 0 != memcmp(&buf[0], &expect[0], PIECE_SIZE))
+        {
+          return TFS_ERROR;
+        }
+      }
+      return TFS_SUCCESS;
+    }
+
+  protected:
+    ReadAheadCache cache_;
+    LogicBlock* logic_block_;
+    PhysicalBlock* physical_block_;
+    DataHandle* data_handle_;
+};
+
+TEST_F(ReadAheadTest, testSequential)
+{
+  EXPECT_EQ(TFS_SUCCESS, read_all(0));
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  // the first read goes to disk, then every window serves 4 pieces
+  EXPECT_EQ(1, stat.direct_count_);
+  EXPECT_EQ(8, stat.fill_count_);
+  EXPECT_EQ(23, stat.hit_count_);
+  EXPECT_EQ(1, stat.stream_count_);
+}
+
+TEST_F(ReadAheadTest, testRandom)
+{
+  std::vector<char> buf(PIECE_SIZE);
+  std::vector<char> expect(PIECE_SIZE);
+  const int32_t offsets[] = {5, 3, 9, 1, 20, 7};
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i)
+  {
+    int32_t offset = offsets[i] * PIECE_SIZE;
+    EXPECT_EQ(TFS_SUCCESS, cache_.read(1, 10, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, offset));
+    make_data(&expect[0], PIECE_SIZE, offset, 0);
+    EXPECT_EQ(0, memcmp(&buf[0], &expect[0], PIECE_SIZE));
+  }
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(6, stat.direct_count_);
+  EXPECT_EQ(0, stat.fill_count_);
+}
+
+TEST_F(ReadAheadTest, testInvalidate)
+{
+  std::vector<char> buf(PIECE_SIZE);
+  EXPECT_EQ(TFS_SUCCESS, cache_.read(1, 10, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, 0));
+  EXPECT_EQ(TFS_SUCCESS, cache_.read(1, 10, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, PIECE_SIZE));
+
+  // file rewritten on disk, the window must not be used any more
+  std::vector<char> data(FILE_SIZE);
+  make_data(&data[0], FILE_SIZE, 0, 1);
+  ASSERT_EQ(TFS_SUCCESS, data_handle_->write_segment_data(&data[0], FILE_SIZE, 0));
+  cache_.erase(1, 10);
+  EXPECT_EQ(TFS_SUCCESS, read_all(1));
+
+  make_data(&data[0], FILE_SIZE, 0, 2);
+  ASSERT_EQ(TFS_SUCCESS, data_handle_->write_segment_data(&data[0], FILE_SIZE, 0));
+  cache_.erase_block(1);
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(0, stat.stream_count_);
+  EXPECT_EQ(TFS_SUCCESS, read_all(2));
+}
+
+TEST_F(ReadAheadTest, testEvict)
+{
+  std::vector<char> buf(PIECE_SIZE);
+  // one window per shard, a new window of the same shard is taken from the old stream,
+  // the streams themselves are all kept
+  for (uint64_t file_id = 1; file_id <= 64; ++file_id)
+  {
+    EXPECT_EQ(TFS_SUCCESS, cache_.read(1, file_id, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, 0));
+    EXPECT_EQ(TFS_SUCCESS, cache_.read(1, file_id, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, PIECE_SIZE));
+  }
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(64, stat.stream_count_);
+  EXPECT_TRUE(stat.window_count_ <= 16);
+  EXPECT_EQ(64, stat.fill_count_);
+
+  cache_.clear();
+  cache_.get_stat(stat);
+  EXPECT_EQ(0, stat.stream_count_);
+  EXPECT_EQ(0, stat.window_count_);
+}
+
+TEST_F(ReadAheadTest, testMixedLoad)
+{
+  // between the pieces of a file read on, many small files are read whole and the heads
+  // of many big files once, the sequential stream is not pushed out by them
+  std::vector<char> buf(PIECE_SIZE);
+  std::vector<char> expect(PIECE_SIZE);
+  uint64_t other_id = 1000;
+  for (int32_t offset = 0; offset < FILE_SIZE; offset += PIECE_SIZE)
+  {
+    for (int32_t i = 0; i < 50; ++i)
+    {
+      EXPECT_EQ(TFS_SUCCESS, cache_.read(1, ++other_id, PIECE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, 0));
+      EXPECT_EQ(TFS_SUCCESS, cache_.read(1, ++other_id, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, 0));
+    }
+    ASSERT_EQ(TFS_SUCCESS, cache_.read(1, 10, FILE_SIZE, data_handle_, 0, &buf[0], PIECE_SIZE, offset));
+    make_data(&expect[0], PIECE_SIZE, offset, 0);
+    EXPECT_EQ(0, memcmp(&buf[0], &expect[0], PIECE_SIZE));
+  }
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(8, stat.fill_count_);
+  EXPECT_EQ(23, stat.hit_count_);
+  // small files read whole are not tracked
+  EXPECT_EQ(1 + 50 * FILE_SIZE / PIECE_SIZE, stat.stream_count_);
+}
+
+struct ReaderArg
+{
+  ReadAheadTest* test_;
+  int ret_;
+};
+
+class ReadAheadConcurrentTest: public ReadAheadTest
+{
+  public:
+    static void* reader(void* arg)
+    {
+      ReaderArg* reader_arg = reinterpret_cast<ReaderArg*>(arg);
+      reader_arg->ret_ = static_cast<ReadAheadConcurrentTest*>(reader_arg->test_)->read_all(0);
+      return NULL;
+    }
+};
+
+TEST_F(ReadAheadConcurrentTest, testConcurrent)
+{
+  const int32_t thread_count = 8;
+  pthread_t threads[thread_count];
+  ReaderArg args[thread_count];
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    args[i].test_ = this;
+    args[i].ret_ = TFS_ERROR;
+    pthread_create(&threads[i], NULL, reader, &args[i]);
+  }
+  for (int32_t i = 0; i < thread_count; ++i)
+  {
+    pthread_join(threads[i], NULL);
+    EXPECT_EQ(TFS_SUCCESS, args[i].ret_);
+  }
+  ReadAheadStat stat;
+  cache_.get_stat(stat);
+  EXPECT_EQ(thread_count * FILE_SIZE / PIECE_SIZE,
+      stat.hit_count_ + stat.fill_count_ + stat.direct_count_ + stat.wait_count_);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+/*
+ * (C) 2007-2010 Alibaba Group Holding Limited.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *
+ * Version: $Id$
+ *
+ */
+#include <gtest/gtest.h>
+#include <tbsys.h>
+#include "logic_block.h"
+#include "physical_block.h"
+#include "message/write_data_message.h"
+#include "common/stream.h"
+#include "common/func.h"
+#include "common/error_msg.h"
+
+using namespace tfs::dataserver;
+using namespace tfs::common;
+using namespace tfs::message;
+
+static const char* MOUNT_PATH = "./replicate_mount";
+static const int32_t BLOCK_LENGTH = 16 * 1024 * 1024;
+static const uint32_t BLOCK_ID = 100;
+
+class ReplicateBlockTest: public ::testing::Test
+{
+  public:
+    ReplicateBlockTest()
+    {
+    }
+    ~ReplicateBlockTest()
+    {
+    }
+    static void SetUpTestCase()
+    {
+      TBSYS_LOGGER.setLogLevel("error");
+    }
+    virtual void SetUp()
+    {
+      mkdir(MOUNT_PATH, 0775);
+      mkdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str(), 0775);
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      int fd = open(path, O_RDWR | O_CREAT, 0644);
+      EXPECT_EQ(0, ftruncate(fd, BLOCK_LENGTH));
+      close(fd);
+
+      physical_ = new PhysicalBlock(BLOCK_ID, MOUNT_PATH, BLOCK_LENGTH, C_MAIN_BLOCK);
+      block_ = new LogicBlock(BLOCK_ID, BLOCK_ID, MOUNT_PATH);
+      block_->add_physic_block(physical_);
+      MMapOption op;
+      op.max_mmap_size_ = 1024 * 1024;
+      op.first_mmap_size_ = 64 * 1024;
+      op.per_mmap_size_ = 64 * 1024;
+      EXPECT_EQ(TFS_SUCCESS, block_->init_block_file(64, op, C_MAIN_BLOCK));
+    }
+    virtual void TearDown()
+    {
+      delete block_;
+      delete physical_;
+      char path[256];
+      snprintf(path, sizeof(path), "%s/%u", MOUNT_PATH, BLOCK_ID);
+      unlink(path);
+      snprintf(path, sizeof(path), "%s%s%u", MOUNT_PATH, INDEX_DIR_PREFIX.c_str(), BLOCK_ID);
+      unlink(path);
+      rmdir((std::string(MOUNT_PATH) + INDEX_DIR_PREFIX).c_str());
+      rmdir(MOUNT_PATH);
+    }
+
+  protected:
+    LogicBlock* block_;
+    PhysicalBlock* physical_;
+};
+
+// packets of a window are written in any order, a retry writes some of them again
+TEST_F(ReplicateBlockTest, testWriteOutOfOrder)
+{
+  const int32_t chunk = 1024 * 1024;
+  const int32_t count = 6;
+  char* data = new char[chunk * count];
+  for (int32_t i = 0; i < chunk * count; ++i)
+  {
+    data[i] = static_cast<char>(i / 13);
+  }
+  const int32_t order[] = { 0, 2, 1, 5, 3, 4, 3, 5 };
+  for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); ++i)
+  {
+    int32_t offset = order[i] * chunk;
+    // the last one is short
+    int32_t len = order[i] == count - 1 ? chunk / 2 : chunk;
+    EXPECT_EQ(TFS_SUCCESS, block_->write_raw_data(data + offset, len, offset));
+  }
+  int32_t total_len = chunk * (count - 1) + chunk / 2;
+  EXPECT_EQ(total_len, block_->get_data_file_size());
+
+  char* buf = new char[total_len];
+  int32_t len = total_len;
+  EXPECT_EQ(TFS_SUCCESS, block_->read_raw_data(buf, len, 0));
+  EXPECT_EQ(total_len, len);
+  EXPECT_EQ(0, memcmp(data, buf, total_len));
+  delete []buf;
+  delete []data;
+}
+
+TEST(WriteRawDataMessageTest, testDataCrc)
+{
+  char data[4096];
+  memset(data, 'r', sizeof(data));
+  WriteRawDataMessage msg;
+  msg.set_block_id(BLOCK_ID);
+  msg.set_offset(8192);
+  msg.set_length(sizeof(data));
+  msg.set_data(data);
+  msg.set_new_block(1);
+  msg.set_data_crc(Func::crc(0, data, sizeof(data)));
+
+  Stream output(msg.length());
+  ASSERT_EQ(TFS_SUCCESS, msg.serialize(output));
+  EXPECT_EQ(msg.length(), output.get_data_length());
+  WriteRawDataMessage other;
+  ASSERT_EQ(TFS_SUCCESS, other.deserialize(output));
+  uint32_t crc = 0;
+  EXPECT_TRUE(other.get_data_crc(crc));
+  EXPECT_EQ(Func::crc(0, data, sizeof(data)), crc);
+  EXPECT_EQ(Func::crc(0, other.get_data(), other.get_length()), crc);
+  EXPECT_EQ(8192, other.get_offset());
+  EXPECT_EQ(1, other.get_new_block());
+
+  // an older sender has no crc
+  WriteRawDataMessage old_msg;
+  old_msg.set_block_id(BLOCK_ID);
+  old_msg.set_length(sizeof(data));
+  old_msg.set_data(data);
+  Stream old_output(old_msg.length());
+  ASSERT_EQ(TFS_SUCCESS, old_msg.serialize(old_output));
+  WriteRawDataMessage old_other;
+  ASSERT_EQ(TFS_SUCCESS, old_other.deserialize(old_output));
+  EXPECT_FALSE(old_other.get_data_crc(crc));
+  EXPECT_EQ(0, memcmp(data, old_other.get_data(), sizeof(data)));
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}